@@ -5,40 +5,21 @@ function ClassNLLCriterion:__init()
    self.sizeAverage = true
 end
 
-function ClassNLLCriterion:updateOutput(input, target)
-   if input:dim() == 1 then
-      self.output = -input[target]
-   elseif input:dim() == 2 then
-      local output = 0
-      for i=1,target:size(1) do
-         output = output - input[i][target[i]]
-      end
-      if self.sizeAverage then
-         output = output / target:size(1)
+-- targets of another type than the input are converted
+function ClassNLLCriterion:convertTarget(input, target)
+   if type(target) ~= 'number' and torch.typename(target) ~= torch.typename(input) then
+      if torch.typename(self.targetBuffer) ~= torch.typename(input) then
+         self.targetBuffer = input.new()
       end
-      self.output = output
-   else
-      error('matrix or vector expected')
+      target = self.targetBuffer:resize(target:size()):copy(target)
    end
-   return self.output
+   return target
 end
 
-function ClassNLLCriterion:updateGradInput(input, target)
-   self.gradInput:resizeAs(input)
-   self.gradInput:zero()
-
-  if input:dim() == 1 then
-      self.gradInput[target] = -1
-   else
-      local z = -1
-      if self.sizeAverage then
-         z = z / target:size(1)
-      end
-      local gradInput = self.gradInput
-      for i=1,target:size(1) do
-         gradInput[i][target[i]] = z
-      end
-   end
+function ClassNLLCriterion:updateOutput(input, target)
+   return input.nn.ClassNLLCriterion_updateOutput(self, input, self:convertTarget(input, target))
+end
 
-   return self.gradInput
+function ClassNLLCriterion:updateGradInput(input, target)
+   return input.nn.ClassNLLCriterion_updateGradInput(self, input, self:convertTarget(input, target))
 end
@@ -1,5 +1,8 @@
 local Concat, parent = torch.class('nn.Concat', 'nn.Module')
 
+-- writes its output through narrow() and copy()
+Concat.stridedViews = true
+
 function Concat:__init(dimension)
    parent.__init(self)
    self.modules = {}
@@ -16,7 +19,62 @@ function Concat:get(index)
    return self.modules[index]
 end
 
+local function isTensor(x)
+   return torch.typename(x) and torch.typename(x):find('torch%..+Tensor')
+end
+
+local function sameSize(size, tensor)
+   if size:size() ~= tensor:dim() then
+      return false
+   end
+   for d=1,size:size() do
+      if size[d] ~= tensor:size(d) then
+         return false
+      end
+   end
+   return true
+end
+
+-- gives back their own output tensors to the modules writing in ours
+local function detachViews(self)
+   for i,module in ipairs(self.modules) do
+      if self.views and self.views[i] then
+         module:setOutputView(module.output.new())
+      end
+   end
+   self.views = {}
+   self.inputSize = nil
+end
+
+-- After a first forward, as long as the input size does not change, each
+-- module writes its output directly in its slice of self.output, if it
+-- accepts it (see Module:setOutputView()). self.views[i] is true if module i
+-- holds its slice, false if it does not. Slices are handed again when
+-- self.output itself becomes a view of another tensor.
 function Concat:updateOutput(input)
+   if self.inputSize and sameSize(self.inputSize, input) then
+      local offset = 1
+      for i,module in ipairs(self.modules) do
+         local slice = self.output:narrow(self.dimension, offset, self.outputSizes[i])
+         if self.views[i] == nil or (self.views[i] and not module.output:isSetTo(slice)) then
+            self.views[i] = module:setOutputView(slice)
+         end
+         local currentOutput = module:updateOutput(input)
+         if not currentOutput:isSetTo(slice) then
+            if not sameSize(slice:size(), currentOutput) then
+               -- the output size changed anyway
+               detachViews(self)
+               return self:updateOutput(input)
+            end
+            slice:copy(currentOutput)
+            self.views[i] = false
+         end
+         offset = offset + self.outputSizes[i]
+      end
+      return self.output
+   end
+
+   detachViews(self)
    local outs = {}
    for i=1,#self.modules do
       local currentOutput = self.modules[i]:updateOutput(input)
@@ -30,15 +88,21 @@ function Concat:updateOutput(input)
    self.output:resize(self.size)
    
    local offset = 1
+   self.outputSizes = {}
    for i,module in ipairs(self.modules) do
-      --local currentOutput = module:updateOutput(input)
       local currentOutput = outs[i]
       self.output:narrow(self.dimension, offset, currentOutput:size(self.dimension)):copy(currentOutput)
       offset = offset + currentOutput:size(self.dimension)
+      self.outputSizes[i] = currentOutput:size(self.dimension)
+   end
+   if isTensor(input) then
+      self.inputSize = input:size()
    end
    return self.output
 end
 
+-- the gradInputs of the modules are summed in self.gradInput: unlike the
+-- outputs, they are not written in place, so that each module keeps its own
 function Concat:updateGradInput(input, gradOutput)
    self.gradInput:resizeAs(input)
 
@@ -92,6 +156,11 @@ function Concat:updateParameters(learningRate)
    end
 end
 
+function Concat:type(type)
+   detachViews(self)
+   return parent.type(self, type)
+end
+
 function Concat:share(mlp,...)
    for i=1,#self.modules do
       self.modules[i]:share(mlp.modules[i],...); 
@@ -0,0 +1,17 @@
+local CrossEntropyCriterion, parent = torch.class('nn.CrossEntropyCriterion', 'nn.Criterion')
+
+function CrossEntropyCriterion:__init()
+   parent.__init(self)
+   self.sizeAverage = true
+   self.logsum = torch.Tensor()
+end
+
+CrossEntropyCriterion.convertTarget = torch.getmetatable('nn.ClassNLLCriterion').convertTarget
+
+function CrossEntropyCriterion:updateOutput(input, target)
+   return input.nn.CrossEntropyCriterion_updateOutput(self, input, self:convertTarget(input, target))
+end
+
+function CrossEntropyCriterion:updateGradInput(input, target)
+   return input.nn.CrossEntropyCriterion_updateGradInput(self, input, self:convertTarget(input, target))
+end
@@ -22,20 +22,25 @@ function JoinTable:updateOutput(input)
    local offset = 1  
    for i=1,#input do
       local currentOutput = input[i]
-      self.output:narrow(self.dimension, offset, 
-			 currentOutput:size(self.dimension)):copy(currentOutput)
+      local slice = self.output:narrow(self.dimension, offset,
+                                       currentOutput:size(self.dimension))
+      -- nothing to do for an input already written in its place (see
+      -- Module:setOutputView())
+      if not currentOutput:isSetTo(slice) then
+         slice:copy(currentOutput)
+      end
       offset = offset + currentOutput:size(self.dimension)
    end
    return self.output
 
 end
 
+-- the gradInputs are views of gradOutput: no copy
 function JoinTable:updateGradInput(input, gradOutput)
    for i=1,#input do 
       if self.gradInput[i] == nil then
          self.gradInput[i] = input[i].new()
       end
-      self.gradInput[i]:resizeAs(input[i])
    end
 
    local offset = 1
@@ -43,7 +48,7 @@ function JoinTable:updateGradInput(input, gradOutput)
       local currentOutput = input[i] 
       local currentGradInput = gradOutput:narrow(self.dimension, offset, 
 					  currentOutput:size(self.dimension))
-      self.gradInput[i]:copy(currentGradInput)
+      self.gradInput[i]:set(currentGradInput)
       offset = offset + currentOutput:size(self.dimension)
    end
    return self.gradInput
@@ -1,5 +1,8 @@
 local Linear, parent = torch.class('nn.Linear', 'nn.Module')
 
+-- writes in any output or gradInput view (see Module:setOutputView())
+Linear.stridedViews = true
+
 function Linear:__init(inputSize, outputSize)
    parent.__init(self)
 
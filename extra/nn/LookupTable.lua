@@ -1,6 +1,6 @@
 local LookupTable, parent = torch.class('nn.LookupTable', 'nn.Module')
 
-LookupTable.__version = 2
+LookupTable.__version = 3
 
 function LookupTable:__init(nIndex, ...)
    parent.__init(self)
@@ -22,54 +22,68 @@ function LookupTable:__init(nIndex, ...)
    self.size[1] = nIndex
    self.weight = torch.Tensor(self.size)
    self.gradWeight = torch.Tensor(self.size):zero()
-   self.inputs = {}
+   -- sorted indices of the rows of gradWeight which may be non-zero
+   self.touched = torch.LongTensor()
 
    self:reset()
 end
 
 function LookupTable:reset(stdv)
    stdv = stdv or 1
-   self.weight:apply(function()
-                        return torch.normal(0, stdv)
-                     end)
+   self.weight:normal(0, stdv)
 end
 
-function LookupTable:updateOutput(input)
-   local nIndex = input:size(1)
-   self.size[1] = nIndex
-   self.output:resize(self.size)
-
-   for i=1,nIndex do
-      self.output:select(1, i):copy(self.weight:select(1, input[i]))
+-- indices of another type than LongTensor are converted
+function LookupTable:indices(input)
+   if torch.typename(input) ~= 'torch.LongTensor' then
+      self.indexBuffer = self.indexBuffer or torch.LongTensor()
+      input = self.indexBuffer:resize(input:size()):copy(input)
    end
+   return input
+end
 
-   return self.output
+function LookupTable:updateOutput(input)
+   return self.weight.nn.LookupTable_updateOutput(self, self:indices(input))
 end
 
 function LookupTable:zeroGradParameters()
-   for k,_ in pairs(self.inputs) do
-      self.gradWeight:select(1, k):zero()
-   end
-   self.inputs = {}
+   self.weight.nn.LookupTable_zeroGradParameters(self)
 end
 
 function LookupTable:accGradParameters(input, gradOutput, scale)
-   for i=1,input:size(1) do
-      local k = input[i]
-      self.inputs[k] = true
-      self.gradWeight:select(1, k):add(scale, gradOutput:select(1, i))
-   end
+   self.weight.nn.LookupTable_accGradParameters(self, self:indices(input), gradOutput, scale)
 end
 
 function LookupTable:accUpdateGradParameters(input, gradOutput, lr)
-   for i=1,input:size(1) do
-      self.weight:select(1, input[i]):add(-lr, gradOutput:select(1, i))
-   end
+   self.weight.nn.LookupTable_accUpdateGradParameters(self, self:indices(input), gradOutput, lr)
 end
 
 function LookupTable:updateParameters(learningRate)
-   for k,_ in pairs(self.inputs) do
-      self.weight:select(1, k):add(-learningRate, self.gradWeight:select(1, k))
+   self.weight.nn.LookupTable_updateParameters(self, learningRate)
+end
+
+-- the indices stay LongTensors
+function LookupTable:type(type)
+   local touched, indexBuffer = self.touched, self.indexBuffer
+   parent.type(self, type)
+   self.touched, self.indexBuffer = touched, indexBuffer
+   return self
+end
+
+function LookupTable:read(file, version)
+   local var = file:readObject()
+   for k,v in pairs(var) do
+      self[k] = v
+   end
+   -- before version 3, the touched rows were the keys of self.inputs
+   if version < 3 then
+      local touched = {}
+      for k,_ in pairs(self.inputs or {}) do
+         table.insert(touched, k)
+      end
+      table.sort(touched)
+      self.touched = (#touched > 0 and torch.LongTensor(touched) or torch.LongTensor())
+      self.inputs = nil
    end
 end
 
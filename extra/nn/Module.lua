@@ -104,6 +104,40 @@ function Module:clone(...)
    return clone
 end
 
+-- A container which would copy the output (or gradInput) of a module into a
+-- part of a larger tensor, like nn.Concat, can instead give the module a view
+-- of this part, of the size of its last output: as resizing a tensor to its
+-- own size leaves it untouched, the module then writes its results in
+-- place. Only modules whose results are written through the tensor methods
+-- handle non-contiguous views; they set stridedViews.
+Module.stridedViews = false
+
+local function acceptsView(self, current, view)
+   return torch.typename(current) ~= nil
+      and torch.typename(current) == torch.typename(view)
+      and (self.stridedViews or view:isContiguous())
+end
+
+-- Returns true if the module will write its next outputs in view. A module
+-- may still replace its output by another tensor (Identity does), which the
+-- container must check after each forward.
+function Module:setOutputView(view)
+   if acceptsView(self, self.output, view) then
+      self.output = view
+      return true
+   end
+   return false
+end
+
+-- Same as setOutputView(), for the next gradInputs.
+function Module:setGradInputView(view)
+   if acceptsView(self, self.gradInput, view) then
+      self.gradInput = view
+      return true
+   end
+   return false
+end
+
 function Module:type(type)
    -- find all tensors and convert them
    for key,param in pairs(self) do
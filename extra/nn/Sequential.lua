@@ -89,6 +89,23 @@ function Sequential:share(mlp,...)
    end
 end
 
+-- the output is the one of the last module, the gradInput the one of the first
+function Sequential:setOutputView(view)
+   if #self.modules > 0 and self.modules[#self.modules]:setOutputView(view) then
+      self.output = view
+      return true
+   end
+   return false
+end
+
+function Sequential:setGradInputView(view)
+   if #self.modules > 0 and self.modules[1]:setGradInputView(view) then
+      self.gradInput = view
+      return true
+   end
+   return false
+end
+
 function Sequential:reset(stdv)
    for i=1,#self.modules do
       self.modules[i]:reset(stdv)
@@ -1,5 +1,8 @@
 local Sigmoid = torch.class('nn.Sigmoid', 'nn.Module')
 
+-- writes in any output or gradInput view (see Module:setOutputView())
+Sigmoid.stridedViews = true
+
 function Sigmoid:updateOutput(input)
    return input.nn.Sigmoid_updateOutput(self, input)
 end
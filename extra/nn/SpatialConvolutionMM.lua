@@ -1,12 +1,19 @@
 local SpatialConvolutionMM, parent = torch.class('nn.SpatialConvolutionMM', 'nn.Module')
 
-function SpatialConvolutionMM:__init(nInputPlane, nOutputPlane, kW, kH)
+function SpatialConvolutionMM:__init(nInputPlane, nOutputPlane, kW, kH, dW, dH, padW, padH)
    parent.__init(self)
 
+   dW = dW or 1
+   dH = dH or 1
+
    self.nInputPlane = nInputPlane
    self.nOutputPlane = nOutputPlane
    self.kW = kW
    self.kH = kH
+   self.dW = dW
+   self.dH = dH
+   self.padW = padW or 0
+   self.padH = padH or self.padW
 
    self.weight = torch.Tensor(nOutputPlane, nInputPlane*kH*kW)
    self.bias = torch.Tensor(nOutputPlane)
@@ -33,7 +40,16 @@ function SpatialConvolutionMM:reset(stdv)
                    end)   
 end
 
+-- modules saved before strides and padding were supported
+local function backCompatibility(self)
+   self.dW = self.dW or 1
+   self.dH = self.dH or 1
+   self.padW = self.padW or 0
+   self.padH = self.padH or 0
+end
+
 function SpatialConvolutionMM:updateOutput(input)
+   backCompatibility(self)
    return input.nn.SpatialConvolutionMM_updateOutput(self, input)
 end
 
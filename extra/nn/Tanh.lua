@@ -1,5 +1,8 @@
 local Tanh = torch.class('nn.Tanh', 'nn.Module')
 
+-- writes in any output or gradInput view (see Module:setOutputView())
+Tanh.stridedViews = true
+
 function Tanh:updateOutput(input)
    return input.nn.Tanh_updateOutput(self, input)
 end
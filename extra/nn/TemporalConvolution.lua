@@ -14,6 +14,9 @@ function TemporalConvolution:__init(inputFrameSize, outputFrameSize, kW, dW)
    self.bias = torch.Tensor(outputFrameSize)
    self.gradWeight = torch.Tensor(outputFrameSize, inputFrameSize*kW)
    self.gradBias = torch.Tensor(outputFrameSize)
+
+   self.finput = torch.Tensor()
+   self.fgradInput = torch.Tensor()
    
    self:reset()
 end
@@ -33,6 +36,9 @@ function TemporalConvolution:reset(stdv)
 end
 
 function TemporalConvolution:updateOutput(input)
+   -- modules saved before the unfolded buffers existed
+   self.finput = self.finput or input.new()
+   self.fgradInput = self.fgradInput or input.new()
    return input.nn.TemporalConvolution_updateOutput(self, input)
 end
 
@@ -0,0 +1,115 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/ClassNLLCriterion.c"
+#else
+
+/* returns the targets (at index 3) as a new contiguous tensor, after checking
+   them against the input (also used by CrossEntropyCriterion) */
+static THTensor* nn_(ClassNLLCriterion_target)(lua_State *L, THTensor *input, long *nframe, long *dim)
+{
+  THTensor *target = NULL;
+  real *target_data;
+  long t;
+
+  if(input->nDimension == 1)
+  {
+    *nframe = 1;
+    *dim = input->size[0];
+    target = THTensor_(newWithSize1d)(1);
+    THTensor_(fill)(target, luaL_checknumber(L, 3));
+  }
+  else if(input->nDimension == 2)
+  {
+    *nframe = input->size[0];
+    *dim = input->size[1];
+    target = luaT_checkudata(L, 3, torch_Tensor);
+    THArgCheck((target->nDimension == 1) && (target->size[0] == *nframe), 3, "inconsistent target size");
+    target = THTensor_(newContiguous)(target);
+  }
+  else
+    THArgCheck(0, 2, "vector or matrix expected");
+
+  target_data = THTensor_(data)(target);
+  for(t = 0; t < *nframe; t++)
+  {
+    if(!((target_data[t] >= 1) && (target_data[t] <= *dim)))
+    {
+      THTensor_(free)(target);
+      THArgCheck(0, 3, "target out of range");
+    }
+  }
+
+  return target;
+}
+
+static int nn_(ClassNLLCriterion_updateOutput)(lua_State *L)
+{
+  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
+  int sizeAverage = luaT_getfieldcheckboolean(L, 1, "sizeAverage");
+  real *input_data, *target_data;
+  long nframe, dim;
+  long t;
+  THTensor *target;
+  accreal sum;
+
+  target = nn_(ClassNLLCriterion_target)(L, input, &nframe, &dim);
+
+  input = THTensor_(newContiguous)(input);
+  input_data = THTensor_(data)(input);
+  target_data = THTensor_(data)(target);
+
+  sum = 0;
+  for(t = 0; t < nframe; t++)
+    sum -= input_data[t*dim + (long)target_data[t]-1];
+
+  if(sizeAverage)
+    sum /= nframe;
+
+  lua_pushnumber(L, sum);
+  lua_setfield(L, 1, "output");
+
+  THTensor_(free)(input);
+  THTensor_(free)(target);
+  lua_pushnumber(L, sum);
+  return 1;
+}
+
+static int nn_(ClassNLLCriterion_updateGradInput)(lua_State *L)
+{
+  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
+  int sizeAverage = luaT_getfieldcheckboolean(L, 1, "sizeAverage");
+  THTensor *gradInput = luaT_getfieldcheckudata(L, 1, "gradInput", torch_Tensor);
+  real *gradInput_data, *target_data;
+  long nframe, dim;
+  long t;
+  THTensor *target;
+  real g;
+
+  target = nn_(ClassNLLCriterion_target)(L, input, &nframe, &dim);
+  g = (sizeAverage ? 1./((real)nframe) : 1.);
+
+  THTensor_(resizeAs)(gradInput, input);
+  THTensor_(zero)(gradInput);
+  gradInput_data = THTensor_(data)(gradInput);
+  target_data = THTensor_(data)(target);
+
+  for(t = 0; t < nframe; t++)
+    gradInput_data[t*dim + (long)target_data[t]-1] = -g;
+
+  THTensor_(free)(target);
+  return 1;
+}
+
+static const struct luaL_Reg nn_(ClassNLLCriterion__) [] = {
+  {"ClassNLLCriterion_updateOutput", nn_(ClassNLLCriterion_updateOutput)},
+  {"ClassNLLCriterion_updateGradInput", nn_(ClassNLLCriterion_updateGradInput)},
+  {NULL, NULL}
+};
+
+static void nn_(ClassNLLCriterion_init)(lua_State *L)
+{
+  luaT_pushmetatable(L, torch_Tensor);
+  luaT_registeratname(L, nn_(ClassNLLCriterion__), "nn");
+  lua_pop(L,1);
+}
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/CrossEntropyCriterion.c"
+#else
+
+/* LogSoftMax followed by ClassNLLCriterion. Only the log of the partition
+   function of each frame is kept (in self.logsum) for the backward pass, which
+   computes softmax(input) - 1[target] directly. */
+
+static int nn_(CrossEntropyCriterion_updateOutput)(lua_State *L)
+{
+  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
+  int sizeAverage = luaT_getfieldcheckboolean(L, 1, "sizeAverage");
+  THTensor *logsum = luaT_getfieldcheckudata(L, 1, "logsum", torch_Tensor);
+  real *input_data, *target_data, *logsum_data;
+  long nframe, dim;
+  long t, d;
+  THTensor *target;
+  accreal sum;
+
+  target = nn_(ClassNLLCriterion_target)(L, input, &nframe, &dim);
+
+  input = THTensor_(newContiguous)(input);
+  THTensor_(resize1d)(logsum, nframe);
+  input_data = THTensor_(data)(input);
+  target_data = THTensor_(data)(target);
+  logsum_data = THTensor_(data)(logsum);
+
+  sum = 0;
+  for(t = 0; t < nframe; t++)
+  {
+    accreal logsum_ = 0;
+    real maxInput = -THInf;
+
+    for(d = 0; d < dim; d++)
+      maxInput = THMax(maxInput, input_data[d]);
+
+    for(d = 0; d < dim; d++)
+      logsum_ += exp(input_data[d]-maxInput);
+    logsum_ = maxInput + log(logsum_);
+
+    logsum_data[t] = logsum_;
+    sum += logsum_ - input_data[(long)target_data[t]-1];
+    input_data += dim;
+  }
+
+  if(sizeAverage)
+    sum /= nframe;
+
+  lua_pushnumber(L, sum);
+  lua_setfield(L, 1, "output");
+
+  THTensor_(free)(input);
+  THTensor_(free)(target);
+  lua_pushnumber(L, sum);
+  return 1;
+}
+
+static int nn_(CrossEntropyCriterion_updateGradInput)(lua_State *L)
+{
+  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
+  int sizeAverage = luaT_getfieldcheckboolean(L, 1, "sizeAverage");
+  THTensor *logsum = luaT_getfieldcheckudata(L, 1, "logsum", torch_Tensor);
+  THTensor *gradInput = luaT_getfieldcheckudata(L, 1, "gradInput", torch_Tensor);
+  real *input_data, *gradInput_data, *target_data, *logsum_data;
+  long nframe, dim;
+  long t, d;
+  THTensor *target;
+  real g;
+
+  target = nn_(ClassNLLCriterion_target)(L, input, &nframe, &dim);
+  if((logsum->nDimension != 1) || (logsum->size[0] != nframe))
+  {
+    THTensor_(free)(target);
+    THError("updateOutput must be called before updateGradInput");
+  }
+  g = (sizeAverage ? 1./((real)nframe) : 1.);
+
+  input = THTensor_(newContiguous)(input);
+  THTensor_(resizeAs)(gradInput, input);
+  input_data = THTensor_(data)(input);
+  gradInput_data = THTensor_(data)(gradInput);
+  target_data = THTensor_(data)(target);
+  logsum_data = THTensor_(data)(logsum);
+
+  for(t = 0; t < nframe; t++)
+  {
+    real logsum_ = logsum_data[t];
+
+    for(d = 0; d < dim; d++)
+      gradInput_data[d] = exp(input_data[d]-logsum_)*g;
+    gradInput_data[(long)target_data[t]-1] -= g;
+
+    input_data += dim;
+    gradInput_data += dim;
+  }
+
+  THTensor_(free)(input);
+  THTensor_(free)(target);
+  return 1;
+}
+
+static const struct luaL_Reg nn_(CrossEntropyCriterion__) [] = {
+  {"CrossEntropyCriterion_updateOutput", nn_(CrossEntropyCriterion_updateOutput)},
+  {"CrossEntropyCriterion_updateGradInput", nn_(CrossEntropyCriterion_updateGradInput)},
+  {NULL, NULL}
+};
+
+static void nn_(CrossEntropyCriterion_init)(lua_State *L)
+{
+  luaT_pushmetatable(L, torch_Tensor);
+  luaT_registeratname(L, nn_(CrossEntropyCriterion__), "nn");
+  lua_pop(L,1);
+}
+
+#endif
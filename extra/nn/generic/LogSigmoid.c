@@ -8,13 +8,11 @@ static int nn_(LogSigmoid_updateOutput)(lua_State *L)
   THTensor *buffer = luaT_getfieldcheckudata(L, 1, "buffer", torch_Tensor);
   THTensor *output = luaT_getfieldcheckudata(L, 1, "output", torch_Tensor);
 
-  THTensor_(resizeAs)(output, input);
-  THTensor_(resizeAs)(buffer, input);
-
-  TH_TENSOR_APPLY3(real, output, real, input, real, buffer,    \
-                   real z = exp(-*input_data);                 \
-                   *buffer_data = z;                           \
-                   *output_data = -log(1. + z);)
+  /* buffer = exp(-input), output = -log(1 + buffer) */
+  THTensor_(mul)(buffer, input, -1);
+  THTensor_(exp)(buffer, buffer);
+  THTensor_(log1p)(output, buffer);
+  THTensor_(mul)(output, output, -1);
 
   return 1;
 }
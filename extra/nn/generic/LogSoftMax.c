@@ -30,15 +30,14 @@ static int nn_(LogSoftMax_updateOutput)(lua_State *L)
   output_data = THTensor_(data)(output);
   for(t = 0; t < nframe; t++)
   {
-    accreal logsum = 0;
-    real maxInput = -THInf;
+    accreal logsum;
+    real maxInput = THVector_(max)(input_data, dim);
 
+    /* the output frame holds exp(input-max) first */
     for(d = 0; d < dim; d++)
-      maxInput = THMax(maxInput, input_data[d]);
-
-    for(d = 0; d < dim; d++)
-      logsum += THExpMinusApprox(maxInput-input_data[d]);
-    logsum = maxInput + log(logsum);
+      output_data[d] = input_data[d] - maxInput;
+    THVector_(exp)(output_data, output_data, dim);
+    logsum = maxInput + log(THVector_(sum)(output_data, dim));
 
     for(d = 0; d < dim; d++)
       output_data[d] = input_data[d] - logsum;
@@ -80,12 +79,11 @@ static int nn_(LogSoftMax_updateGradInput)(lua_State *L)
   gradOutput_data = THTensor_(data)(gradOutput);
   for(t = 0; t < nframe; t++)
   {
-    accreal sum = 0;
-    for(d = 0; d < dim; d++)
-      sum += gradOutput_data[d];
+    accreal sum = THVector_(sum)(gradOutput_data, dim);
 
+    THVector_(exp)(gradInput_data, output_data, dim);
     for(d = 0; d < dim; d++)
-      gradInput_data[d] = gradOutput_data[d] - exp(output_data[d])*sum;
+      gradInput_data[d] = gradOutput_data[d] - gradInput_data[d]*sum;
 
     gradInput_data += dim;
     output_data += dim;
@@ -0,0 +1,263 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/LookupTable.c"
+#else
+
+/* The indices (at index 2) are a 1D or 2D LongTensor. Each index selects a
+   row of the weight, that is a slice along its first dimension, which must be
+   contiguous for the accumulations. */
+
+/* returns the indices as a new contiguous tensor, after checking their range */
+static THLongTensor* nn_(LookupTable_indices)(lua_State *L, THTensor *weight)
+{
+  THLongTensor *input = luaT_checkudata(L, 2, "torch.LongTensor");
+  long nIndex = weight->size[0];
+  long *input_data;
+  long i, n;
+
+  THArgCheck(input->nDimension == 1 || input->nDimension == 2, 2, "vector or matrix of indices expected");
+
+  input = THLongTensor_newContiguous(input);
+  input_data = THLongTensor_data(input);
+  n = THLongTensor_nElement(input);
+  for(i = 0; i < n; i++)
+  {
+    if(input_data[i] < 1 || input_data[i] > nIndex)
+    {
+      THLongTensor_free(input);
+      THArgCheck(0, 2, "index out of range");
+    }
+  }
+
+  return input;
+}
+
+static long nn_(LookupTable_rowSize)(THTensor *weight)
+{
+  return (weight->size[0] > 0 ? THTensor_(nElement)(weight)/weight->size[0] : 0);
+}
+
+/* orders (index, position) pairs by index, then position */
+static int nn_(LookupTable_compare)(const void *a, const void *b)
+{
+  const long *x = a, *y = b;
+
+  if(x[0] != y[0])
+    return (x[0] < y[0] ? -1 : 1);
+  return (x[1] < y[1] ? -1 : (x[1] > y[1] ? 1 : 0));
+}
+
+/* Adds the rows of src times scale to the rows of dst selected by the
+   indices. The indices are sorted, so that all the rows going to a same
+   index are accumulated by a single thread, in their original order: there
+   are no races, and the result does not depend on the number of threads.
+   If touched is not NULL, the sorted indices which were not in it are
+   added. */
+static void nn_(LookupTable_scatterAdd)(real *dst, long rowSize, THLongTensor *input, real *src, real scale, THLongTensor *touched)
+{
+  long *input_data = THLongTensor_data(input);
+  long n = THLongTensor_nElement(input);
+  long *pairs, *segments;
+  long i, s, nsegment = 0;
+
+  if(n == 0)
+    return;
+
+  pairs = THAlloc(sizeof(long)*2*n);
+  segments = THAlloc(sizeof(long)*(n+1));
+  for(i = 0; i < n; i++)
+  {
+    pairs[2*i] = input_data[i]-1;
+    pairs[2*i+1] = i;
+  }
+  qsort(pairs, n, 2*sizeof(long), nn_(LookupTable_compare));
+
+  for(i = 0; i < n; i++)
+  {
+    if(i == 0 || pairs[2*i] != pairs[2*i-2])
+      segments[nsegment++] = i;
+  }
+  segments[nsegment] = n;
+
+#pragma omp parallel for private(s) schedule(dynamic, 16) if(n*rowSize >= THGetParallelThreshold())
+  for(s = 0; s < nsegment; s++)
+  {
+    real *row = dst + pairs[2*segments[s]]*rowSize;
+    long k;
+
+    for(k = segments[s]; k < segments[s+1]; k++)
+      THVector_(add)(row, src + pairs[2*k+1]*rowSize, scale, rowSize);
+  }
+
+  if(touched)
+  {
+    /* merge with the (sorted, unique) touched indices */
+    long ntouched = THLongTensor_nElement(touched);
+    long *touched_data = THLongTensor_data(touched);
+    long *merged = THAlloc(sizeof(long)*(ntouched+nsegment));
+    long nmerged = 0, t = 0;
+
+    s = 0;
+    while(t < ntouched || s < nsegment)
+    {
+      long index;
+
+      if(s == nsegment || (t < ntouched && touched_data[t] <= pairs[2*segments[s]]+1))
+      {
+        index = touched_data[t++];
+        if(s < nsegment && index == pairs[2*segments[s]]+1)
+          s++;
+      }
+      else
+        index = pairs[2*segments[s++]]+1;
+      merged[nmerged++] = index;
+    }
+
+    THLongTensor_resize1d(touched, nmerged);
+    memcpy(THLongTensor_data(touched), merged, sizeof(long)*nmerged);
+    THFree(merged);
+  }
+
+  THFree(pairs);
+  THFree(segments);
+}
+
+static int nn_(LookupTable_updateOutput)(lua_State *L)
+{
+  THTensor *weight = luaT_getfieldcheckudata(L, 1, "weight", torch_Tensor);
+  THTensor *output = luaT_getfieldcheckudata(L, 1, "output", torch_Tensor);
+  THLongTensor *input = nn_(LookupTable_indices)(L, weight);
+  long *input_data = THLongTensor_data(input);
+  long n = THLongTensor_nElement(input);
+  long rowSize = nn_(LookupTable_rowSize)(weight);
+  THLongStorage *size;
+  real *weight_data, *output_data;
+  long i;
+  int d;
+
+  /* the output has the size of the input, followed by the size of a row */
+  size = THLongStorage_newWithSize(input->nDimension + weight->nDimension - 1);
+  for(d = 0; d < input->nDimension; d++)
+    size->data[d] = input->size[d];
+  for(d = 1; d < weight->nDimension; d++)
+    size->data[input->nDimension+d-1] = weight->size[d];
+  THTensor_(resize)(output, size, NULL);
+  THLongStorage_free(size);
+
+  weight = THTensor_(newContiguous)(weight);
+  weight_data = THTensor_(data)(weight);
+  output_data = THTensor_(data)(output);
+
+#pragma omp parallel for private(i) if(n*rowSize >= THGetParallelThreshold())
+  for(i = 0; i < n; i++)
+    memcpy(output_data + i*rowSize, weight_data + (input_data[i]-1)*rowSize, sizeof(real)*rowSize);
+
+  THTensor_(free)(weight);
+  THLongTensor_free(input);
+  return 1;
+}
+
+/* accumulates in the rows of target (a field of the module) */
+static void nn_(LookupTable_accumulate)(lua_State *L, const char *target, real scale, THLongTensor *touched)
+{
+  THTensor *gradOutput = luaT_checkudata(L, 3, torch_Tensor);
+  THTensor *dst = luaT_getfieldcheckudata(L, 1, target, torch_Tensor);
+  THLongTensor *input = luaT_checkudata(L, 2, "torch.LongTensor");
+  long rowSize = nn_(LookupTable_rowSize)(dst);
+
+  /* checked before the indices are copied, which would leak on error */
+  THArgCheck(THTensor_(isContiguous)(dst), 1, "contiguous weight and gradWeight expected");
+  THArgCheck(THTensor_(nElement)(gradOutput) == THLongTensor_nElement(input)*rowSize, 3, "inconsistent gradOutput size");
+
+  input = nn_(LookupTable_indices)(L, dst);
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+  nn_(LookupTable_scatterAdd)(THTensor_(data)(dst), rowSize, input, THTensor_(data)(gradOutput), scale, touched);
+
+  THTensor_(free)(gradOutput);
+  THLongTensor_free(input);
+}
+
+static int nn_(LookupTable_accGradParameters)(lua_State *L)
+{
+  real scale = luaL_optnumber(L, 4, 1);
+  THLongTensor *touched = luaT_getfieldcheckudata(L, 1, "touched", "torch.LongTensor");
+
+  THArgCheck(THLongTensor_isContiguous(touched), 1, "contiguous touched expected");
+  nn_(LookupTable_accumulate)(L, "gradWeight", scale, touched);
+  return 0;
+}
+
+static int nn_(LookupTable_accUpdateGradParameters)(lua_State *L)
+{
+  real lr = luaL_checknumber(L, 4);
+
+  nn_(LookupTable_accumulate)(L, "weight", -lr, NULL);
+  return 0;
+}
+
+/* only the touched rows of gradWeight are non-zero */
+static int nn_(LookupTable_updateParameters)(lua_State *L)
+{
+  real lr = luaL_checknumber(L, 2);
+  THTensor *weight = luaT_getfieldcheckudata(L, 1, "weight", torch_Tensor);
+  THTensor *gradWeight = luaT_getfieldcheckudata(L, 1, "gradWeight", torch_Tensor);
+  THLongTensor *touched = luaT_getfieldcheckudata(L, 1, "touched", "torch.LongTensor");
+  long *touched_data = THLongTensor_data(touched);
+  long ntouched = THLongTensor_nElement(touched);
+  long rowSize = nn_(LookupTable_rowSize)(weight);
+  real *weight_data, *gradWeight_data;
+  long i;
+
+  THArgCheck(THTensor_(isContiguous)(weight) && THTensor_(isContiguous)(gradWeight)
+             && THLongTensor_isContiguous(touched), 1, "contiguous weight, gradWeight and touched expected");
+  weight_data = THTensor_(data)(weight);
+  gradWeight_data = THTensor_(data)(gradWeight);
+
+#pragma omp parallel for private(i) if(ntouched*rowSize >= THGetParallelThreshold())
+  for(i = 0; i < ntouched; i++)
+  {
+    long offset = (touched_data[i]-1)*rowSize;
+    THVector_(add)(weight_data + offset, gradWeight_data + offset, -lr, rowSize);
+  }
+
+  return 0;
+}
+
+static int nn_(LookupTable_zeroGradParameters)(lua_State *L)
+{
+  THTensor *gradWeight = luaT_getfieldcheckudata(L, 1, "gradWeight", torch_Tensor);
+  THLongTensor *touched = luaT_getfieldcheckudata(L, 1, "touched", "torch.LongTensor");
+  long *touched_data = THLongTensor_data(touched);
+  long ntouched = THLongTensor_nElement(touched);
+  long rowSize = nn_(LookupTable_rowSize)(gradWeight);
+  real *gradWeight_data;
+  long i;
+
+  THArgCheck(THTensor_(isContiguous)(gradWeight) && THLongTensor_isContiguous(touched), 1,
+             "contiguous gradWeight and touched expected");
+  gradWeight_data = THTensor_(data)(gradWeight);
+
+#pragma omp parallel for private(i) if(ntouched*rowSize >= THGetParallelThreshold())
+  for(i = 0; i < ntouched; i++)
+    THVector_(fill)(gradWeight_data + (touched_data[i]-1)*rowSize, 0, rowSize);
+
+  THLongTensor_resize1d(touched, 0);
+  return 0;
+}
+
+static const struct luaL_Reg nn_(LookupTable__) [] = {
+  {"LookupTable_updateOutput", nn_(LookupTable_updateOutput)},
+  {"LookupTable_accGradParameters", nn_(LookupTable_accGradParameters)},
+  {"LookupTable_accUpdateGradParameters", nn_(LookupTable_accUpdateGradParameters)},
+  {"LookupTable_updateParameters", nn_(LookupTable_updateParameters)},
+  {"LookupTable_zeroGradParameters", nn_(LookupTable_zeroGradParameters)},
+  {NULL, NULL}
+};
+
+static void nn_(LookupTable_init)(lua_State *L)
+{
+  luaT_pushmetatable(L, torch_Tensor);
+  luaT_registeratname(L, nn_(LookupTable__), "nn");
+  lua_pop(L,1);
+}
+
+#endif
@@ -7,10 +7,7 @@ static int nn_(Sigmoid_updateOutput)(lua_State *L)
   THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
   THTensor *output = luaT_getfieldcheckudata(L, 1, "output", torch_Tensor);
 
-  THTensor_(resizeAs)(output, input);
-
-  TH_TENSOR_APPLY2(real, output, real, input, \
-                   *output_data = 1./(1.+ exp(- *input_data));)
+  THTensor_(sigmoid)(output, input);
 
   return 1;
 }
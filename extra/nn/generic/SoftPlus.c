@@ -7,10 +7,8 @@ static int nn_(SoftPlus_updateOutput)(lua_State *L)
   THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
   THTensor *output = luaT_getfieldcheckudata(L, 1, "output", torch_Tensor);
   
-  THTensor_(resizeAs)(output, input);
-
-  TH_TENSOR_APPLY2(real, output, real, input,               \
-                   *output_data = log1p(exp(*input_data));)
+  THTensor_(exp)(output, input);
+  THTensor_(log1p)(output, output);
     
     return 1;
 }
@@ -21,9 +19,9 @@ static int nn_(SoftPlus_updateGradInput)(lua_State *L)
   THTensor *output = luaT_getfieldcheckudata(L, 1, "output", torch_Tensor);
   THTensor *gradInput = luaT_getfieldcheckudata(L, 1, "gradInput", torch_Tensor);
 
-  THTensor_(resizeAs)(gradInput, output);
-  TH_TENSOR_APPLY3(real, gradInput, real, gradOutput, real, output,    \
-                   real z = exp(*output_data);                         \
+  THTensor_(exp)(gradInput, output);
+  TH_TENSOR_APPLY2(real, gradInput, real, gradOutput,                  \
+                   real z = *gradInput_data;                           \
                    *gradInput_data = *gradOutput_data * (z - 1.)/z;)
     return 1;
 }
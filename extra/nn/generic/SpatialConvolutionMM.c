@@ -2,9 +2,26 @@
 #define TH_GENERIC_FILE "generic/SpatialConvolutionMM.c"
 #else
 
+/* the outputs x in [*x0, *x1) of a row read columns inside the input, the
+   others read the zero padding */
+static void nn_(unfolded_range)(int kw, int dW, int padW, int inputWidth, int outputWidth, int *x0, int *x1)
+{
+  int first = padW - kw;                 /* x*dW >= first */
+  int last = inputWidth - 1 + padW - kw; /* x*dW <= last */
+
+  *x0 = (first > 0 ? (first + dW - 1) / dW : 0);
+  *x1 = (last >= 0 ? last / dW + 1 : 0);
+  if(*x1 > outputWidth)
+    *x1 = outputWidth;
+  if(*x0 > *x1)
+    *x0 = *x1;
+}
+
 /* note: due to write issues, this one cannot be parallelized as well as unfolded_copy */
 static void nn_(unfolded_acc)(THTensor *finput, THTensor *input,
                                int kW, int kH,
+                               int dW, int dH,
+                               int padW, int padH,
                                int nInputPlane,
                                int inputWidth, int inputHeight,
                                int outputWidth, int outputHeight)
@@ -16,15 +33,30 @@ static void nn_(unfolded_acc)(THTensor *finput, THTensor *input,
 #pragma omp parallel for private(nip)
   for(nip = 0; nip < nInputPlane; nip++)
   {
-    int kw, kh, y;
+    int kw, kh, y, x, x0, x1;
     for(kh = 0; kh < kH; kh++)
     {
       for(kw = 0; kw < kW; kw++)
       {
         real *src = finput_data + nip*(kH*kW*outputHeight*outputWidth) + kh*(kW*outputHeight*outputWidth) + kw*(outputHeight*outputWidth);
-        real *dst = input_data + nip*(inputHeight*inputWidth) + kh*inputWidth + kw;
+        real *dst = input_data + nip*(inputHeight*inputWidth);
+        nn_(unfolded_range)(kw, dW, padW, inputWidth, outputWidth, &x0, &x1);
         for(y = 0; y < outputHeight; y++)
-          THVector_(add)(dst+y*inputWidth, src+y*outputWidth, 1, outputWidth); /* note: THVector_add could handle 1 value better */
+        {
+          int iy = y*dH - padH + kh;
+          real *dstrow, *srcrow;
+          if(iy < 0 || iy >= inputHeight || x0 == x1)
+            continue;
+          dstrow = dst + iy*inputWidth + x0*dW - padW + kw;
+          srcrow = src + y*outputWidth + x0;
+          if(dW == 1)
+            THVector_(add)(dstrow, srcrow, 1, x1-x0); /* note: THVector_add could handle 1 value better */
+          else
+          {
+            for(x = 0; x < x1-x0; x++)
+              dstrow[x*dW] += srcrow[x];
+          }
+        }
       }
     }
   }
@@ -32,6 +64,8 @@ static void nn_(unfolded_acc)(THTensor *finput, THTensor *input,
 
 static void nn_(unfolded_copy)(THTensor *finput, THTensor *input,
                                int kW, int kH,
+                               int dW, int dH,
+                               int padW, int padH,
                                int nInputPlane,
                                int inputWidth, int inputHeight,
                                int outputWidth, int outputHeight)
@@ -47,33 +81,61 @@ static void nn_(unfolded_copy)(THTensor *finput, THTensor *input,
     int rest = k % (kH*kW);
     int kh = rest / kW;
     int kw = rest % kW;
-    int y;
+    int y, x, x0, x1;
     real *dst = finput_data + nip*(kH*kW*outputHeight*outputWidth) + kh*(kW*outputHeight*outputWidth) + kw*(outputHeight*outputWidth);
-    real *src = input_data + nip*(inputHeight*inputWidth) + kh*inputWidth + kw;
+    real *src = input_data + nip*(inputHeight*inputWidth);
+    nn_(unfolded_range)(kw, dW, padW, inputWidth, outputWidth, &x0, &x1);
     for(y = 0; y < outputHeight; y++)
-      memcpy(dst+y*outputWidth, src+y*inputWidth, sizeof(real)*outputWidth);
+    {
+      int iy = y*dH - padH + kh;
+      real *dstrow = dst + y*outputWidth;
+      real *srcrow;
+      if(iy < 0 || iy >= inputHeight)
+      {
+        memset(dstrow, 0, sizeof(real)*outputWidth);
+        continue;
+      }
+      /* the padding is never copied from the input */
+      if(x0 > 0)
+        memset(dstrow, 0, sizeof(real)*x0);
+      if(x1 > x0)
+      {
+        srcrow = src + iy*inputWidth + x0*dW - padW + kw;
+        if(dW == 1)
+          memcpy(dstrow+x0, srcrow, sizeof(real)*(x1-x0));
+        else
+        {
+          for(x = 0; x < x1-x0; x++)
+            dstrow[x0+x] = srcrow[x*dW];
+        }
+      }
+      if(x1 < outputWidth)
+        memset(dstrow+x1, 0, sizeof(real)*(outputWidth-x1));
+    }
   }
 }
 
 static void nn_(SpatialConvolutionMM_updateOutput_frame)(THTensor *input, THTensor *output, THTensor *weight, THTensor *bias, THTensor *finput,
-                                                         int kW, int kH,
+                                                         int kW, int kH, int dW, int dH, int padW, int padH,
                                                          long nInputPlane, long inputWidth, long inputHeight,
                                                          long nOutputPlane, long outputWidth, long outputHeight)
 {
+  THTensor output2d;
   long i;
 
-  nn_(unfolded_copy)(finput, input, kW, kH, nInputPlane, inputWidth, inputHeight, outputWidth, outputHeight);
+  nn_(unfolded_copy)(finput, input, kW, kH, dW, dH, padW, padH, nInputPlane, inputWidth, inputHeight, outputWidth, outputHeight);
 
-  THTensor *output2d = THTensor_(newWithStorage2d)(output->storage, output->storageOffset,
-                                                   nOutputPlane, -1,
-                                                   outputHeight*outputWidth, -1);
+  THTensor_(initView)(&output2d);
+  THTensor_(setStorage2d)(&output2d, output->storage, output->storageOffset,
+                          nOutputPlane, -1,
+                          outputHeight*outputWidth, -1);
 
   for(i = 0; i < nOutputPlane; i++)
     THVector_(fill)(output->storage->data+output->storageOffset+output->stride[0]*i, THTensor_(get1d)(bias, i), outputHeight*outputWidth);
 
-  THTensor_(addmm)(output2d, 1, output2d, 1, weight, finput);
+  THTensor_(addmm)(&output2d, 1, &output2d, 1, weight, finput);
 
-  THTensor_(free)(output2d);
+  THTensor_(releaseView)(&output2d);
 }
 
 static int nn_(SpatialConvolutionMM_updateOutput)(lua_State *L)
@@ -81,6 +143,10 @@ static int nn_(SpatialConvolutionMM_updateOutput)(lua_State *L)
   THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
   int kW = luaT_getfieldcheckint(L, 1, "kW");
   int kH = luaT_getfieldcheckint(L, 1, "kH");
+  int dW = luaT_getfieldcheckint(L, 1, "dW");
+  int dH = luaT_getfieldcheckint(L, 1, "dH");
+  int padW = luaT_getfieldcheckint(L, 1, "padW");
+  int padH = luaT_getfieldcheckint(L, 1, "padH");
 
   THTensor *finput = luaT_getfieldcheckudata(L, 1, "finput", torch_Tensor);
   THTensor *weight = luaT_getfieldcheckudata(L, 1, "weight", torch_Tensor);
@@ -102,8 +168,10 @@ static int nn_(SpatialConvolutionMM_updateOutput)(lua_State *L)
   long inputWidth   = input->size[dimw];
   long inputHeight  = input->size[dimh];
   long nOutputPlane = weight->size[0];
-  long outputWidth  = (inputWidth - kW) + 1;
-  long outputHeight = (inputHeight - kH) + 1;
+  long outputWidth  = (inputWidth + 2*padW - kW) / dW + 1;
+  long outputHeight = (inputHeight + 2*padH - kH) / dH + 1;
+
+  luaL_argcheck(L, inputWidth + 2*padW >= kW && inputHeight + 2*padH >= kH, 2, "input image smaller than kernel size");
 
   if(input->nDimension == 3)
   {
@@ -111,7 +179,7 @@ static int nn_(SpatialConvolutionMM_updateOutput)(lua_State *L)
     THTensor_(resize3d)(output, nOutputPlane, outputHeight, outputWidth);
     
     nn_(SpatialConvolutionMM_updateOutput_frame)(input, output, weight, bias, finput,
-                                                 kW, kH,
+                                                 kW, kH, dW, dH, padW, padH,
                                                  nInputPlane, inputWidth, inputHeight,
                                                  nOutputPlane, outputWidth, outputHeight);
   }
@@ -119,6 +187,7 @@ static int nn_(SpatialConvolutionMM_updateOutput)(lua_State *L)
   {
     long T = input->size[0];
     long t;
+    THTensor output3d, weight3d;
 
     THTensor_(resize3d)(finput, T, kW*kH*nInputPlane, outputHeight*outputWidth);
     THTensor_(resize4d)(output, T, nOutputPlane, outputHeight, outputWidth);
@@ -126,26 +195,50 @@ static int nn_(SpatialConvolutionMM_updateOutput)(lua_State *L)
     THStorage_(clearFlag)(input->storage, TH_STORAGE_REFCOUNTED);
     THStorage_(clearFlag)(output->storage, TH_STORAGE_REFCOUNTED);
     THStorage_(clearFlag)(finput->storage, TH_STORAGE_REFCOUNTED);
-//    mkl_set_num_threads(1);
+
 #pragma omp parallel for private(t)
     for(t = 0; t < T; t++)
     {
-      THTensor *input_t = THTensor_(newSelect)(input, 0, t);
-      THTensor *output_t = THTensor_(newSelect)(output, 0, t);
-      THTensor *finput_t = THTensor_(newSelect)(finput, 0, t);
-
-      nn_(SpatialConvolutionMM_updateOutput_frame)(input_t, output_t, weight, bias, finput_t,
-                                                   kW, kH,
-                                                   nInputPlane, inputWidth, inputHeight,
-                                                   nOutputPlane, outputWidth, outputHeight);
-
-      THTensor_(free)(input_t);
-      THTensor_(free)(output_t);      
-      THTensor_(free)(finput_t);
+      THTensor input_t, output_t, finput_t;
+      long i;
+
+      /* views on the stack: no allocation per frame */
+      THTensor_(initView)(&input_t);
+      THTensor_(initView)(&output_t);
+      THTensor_(initView)(&finput_t);
+      THTensor_(select)(&input_t, input, 0, t);
+      THTensor_(select)(&output_t, output, 0, t);
+      THTensor_(select)(&finput_t, finput, 0, t);
+
+      nn_(unfolded_copy)(&finput_t, &input_t, kW, kH, dW, dH, padW, padH, nInputPlane, inputWidth, inputHeight, outputWidth, outputHeight);
+
+      for(i = 0; i < nOutputPlane; i++)
+        THVector_(fill)(output_t.storage->data+output_t.storageOffset+output_t.stride[0]*i, THTensor_(get1d)(bias, i), outputHeight*outputWidth);
+
+      THTensor_(releaseView)(&input_t);
+      THTensor_(releaseView)(&output_t);
+      THTensor_(releaseView)(&finput_t);
     }
     THStorage_(setFlag)(input->storage, TH_STORAGE_REFCOUNTED);
     THStorage_(setFlag)(output->storage, TH_STORAGE_REFCOUNTED);
     THStorage_(setFlag)(finput->storage, TH_STORAGE_REFCOUNTED);
+
+    /* all the frames share the same weight matrix */
+    THTensor_(initView)(&output3d);
+    THTensor_(initView)(&weight3d);
+    THTensor_(setStorage3d)(&output3d, output->storage, output->storageOffset,
+                            T, -1,
+                            nOutputPlane, -1,
+                            outputHeight*outputWidth, -1);
+    THTensor_(setStorage3d)(&weight3d, weight->storage, weight->storageOffset,
+                            T, 0,
+                            weight->size[0], weight->stride[0],
+                            weight->size[1], weight->stride[1]);
+
+    THTensor_(baddbmm)(&output3d, 1, &output3d, 1, &weight3d, finput);
+
+    THTensor_(releaseView)(&output3d);
+    THTensor_(releaseView)(&weight3d);
   }
 //  mkl_set_num_threads(4);
 
@@ -154,17 +247,20 @@ static int nn_(SpatialConvolutionMM_updateOutput)(lua_State *L)
 
 
 static void nn_(SpatialConvolutionMM_updateGradInput_frame)(THTensor *gradInput, THTensor *gradOutput, THTensor *weight, THTensor *fgradInput,
-                                                            int kW, int kH)
+                                                            int kW, int kH, int dW, int dH, int padW, int padH)
 {
-  THTensor *gradOutput2d = THTensor_(newWithStorage2d)(gradOutput->storage, gradOutput->storageOffset,
-                                                       gradOutput->size[0], -1,
-                                                       gradOutput->size[1]*gradOutput->size[2], -1);
-  THTensor_(addmm)(fgradInput, 0, fgradInput, 1, weight, gradOutput2d);
-  THTensor_(free)(gradOutput2d);
+  THTensor gradOutput2d;
+
+  THTensor_(initView)(&gradOutput2d);
+  THTensor_(setStorage2d)(&gradOutput2d, gradOutput->storage, gradOutput->storageOffset,
+                          gradOutput->size[0], -1,
+                          gradOutput->size[1]*gradOutput->size[2], -1);
+  THTensor_(addmm)(fgradInput, 0, fgradInput, 1, weight, &gradOutput2d);
+  THTensor_(releaseView)(&gradOutput2d);
 
   THTensor_(zero)(gradInput);
 
-  nn_(unfolded_acc)(fgradInput, gradInput, kW, kH, gradInput->size[0], gradInput->size[2], gradInput->size[1], gradOutput->size[2], gradOutput->size[1]);
+  nn_(unfolded_acc)(fgradInput, gradInput, kW, kH, dW, dH, padW, padH, gradInput->size[0], gradInput->size[2], gradInput->size[1], gradOutput->size[2], gradOutput->size[1]);
 }
 
 static int nn_(SpatialConvolutionMM_updateGradInput)(lua_State *L)
@@ -173,6 +269,10 @@ static int nn_(SpatialConvolutionMM_updateGradInput)(lua_State *L)
   THTensor *gradOutput = luaT_checkudata(L, 3, torch_Tensor);
   int kW = luaT_getfieldcheckint(L, 1, "kW");
   int kH = luaT_getfieldcheckint(L, 1, "kH");
+  int dW = luaT_getfieldcheckint(L, 1, "dW");
+  int dH = luaT_getfieldcheckint(L, 1, "dH");
+  int padW = luaT_getfieldcheckint(L, 1, "padW");
+  int padH = luaT_getfieldcheckint(L, 1, "padH");
   int nOutputPlane = luaT_getfieldcheckint(L, 1, "nOutputPlane");
 
   THTensor *finput = luaT_getfieldcheckudata(L, 1, "finput", torch_Tensor);
@@ -188,36 +288,55 @@ static int nn_(SpatialConvolutionMM_updateGradInput)(lua_State *L)
 
   if(input->nDimension == 3)
   {   
-    nn_(SpatialConvolutionMM_updateGradInput_frame)(gradInput, gradOutput, weight, fgradInput, kW, kH);
+    nn_(SpatialConvolutionMM_updateGradInput_frame)(gradInput, gradOutput, weight, fgradInput, kW, kH, dW, dH, padW, padH);
   }
   else
   {
     long T = input->size[0];
     long t;
+    THTensor gradOutput3d, weight3d;
+
+    /* all the frames share the same (transposed) weight matrix */
+    THTensor_(initView)(&gradOutput3d);
+    THTensor_(initView)(&weight3d);
+    THTensor_(setStorage3d)(&gradOutput3d, gradOutput->storage, gradOutput->storageOffset,
+                            T, gradOutput->stride[0],
+                            gradOutput->size[1], -1,
+                            gradOutput->size[2]*gradOutput->size[3], -1);
+    THTensor_(setStorage3d)(&weight3d, weight->storage, weight->storageOffset,
+                            T, 0,
+                            weight->size[0], weight->stride[0],
+                            weight->size[1], weight->stride[1]);
+
+    THTensor_(baddbmm)(fgradInput, 0, fgradInput, 1, &weight3d, &gradOutput3d);
+
+    THTensor_(releaseView)(&gradOutput3d);
+    THTensor_(releaseView)(&weight3d);
 
     THStorage_(clearFlag)(gradInput->storage, TH_STORAGE_REFCOUNTED);
-    THStorage_(clearFlag)(gradOutput->storage, TH_STORAGE_REFCOUNTED);
     THStorage_(clearFlag)(fgradInput->storage, TH_STORAGE_REFCOUNTED);
 
 #pragma omp parallel for private(t)
     for(t = 0; t < T; t++)
     {
-      THTensor *gradInput_t = THTensor_(newSelect)(gradInput, 0, t);
-      THTensor *gradOutput_t = THTensor_(newSelect)(gradOutput, 0, t);
-      THTensor *fgradInput_t = THTensor_(newSelect)(fgradInput, 0, t);
-
-      nn_(SpatialConvolutionMM_updateGradInput_frame)(gradInput_t, gradOutput_t, weight, fgradInput_t, kW, kH);
-      
-      THTensor_(free)(gradInput_t);
-      THTensor_(free)(gradOutput_t);      
-      THTensor_(free)(fgradInput_t);
+      THTensor gradInput_t, fgradInput_t;
+
+      THTensor_(initView)(&gradInput_t);
+      THTensor_(initView)(&fgradInput_t);
+      THTensor_(select)(&gradInput_t, gradInput, 0, t);
+      THTensor_(select)(&fgradInput_t, fgradInput, 0, t);
+
+      THTensor_(zero)(&gradInput_t);
+      nn_(unfolded_acc)(&fgradInput_t, &gradInput_t, kW, kH, dW, dH, padW, padH, gradInput_t.size[0], gradInput_t.size[2], gradInput_t.size[1], gradOutput->size[3], gradOutput->size[2]);
+
+      THTensor_(releaseView)(&gradInput_t);
+      THTensor_(releaseView)(&fgradInput_t);
     }
 
     THStorage_(setFlag)(gradInput->storage, TH_STORAGE_REFCOUNTED);
-    THStorage_(setFlag)(gradOutput->storage, TH_STORAGE_REFCOUNTED);
-    THStorage_(setFlag)(fgradInput->storage, TH_STORAGE_REFCOUNTED);    
+    THStorage_(setFlag)(fgradInput->storage, TH_STORAGE_REFCOUNTED);
   }
-    
+
   THTensor_(transpose)(weight, weight, 0, 1);
 
   return 1;
@@ -226,28 +345,28 @@ static int nn_(SpatialConvolutionMM_updateGradInput)(lua_State *L)
 static void nn_(SpatialConvolutionMM_accGradParameters_frame)(THTensor *gradOutput, THTensor *gradWeight, THTensor *gradBias, THTensor *finput,
                                                               real scale)
 {
+  THTensor gradOutput2d;
   long i;
 
-  THTensor *gradOutput2d = THTensor_(newWithStorage2d)(gradOutput->storage, gradOutput->storageOffset,
-                                                       gradOutput->size[0], -1,
-                                                       gradOutput->size[1]*gradOutput->size[2], -1);
+  THTensor_(initView)(&gradOutput2d);
+  THTensor_(setStorage2d)(&gradOutput2d, gradOutput->storage, gradOutput->storageOffset,
+                          gradOutput->size[0], -1,
+                          gradOutput->size[1]*gradOutput->size[2], -1);
   THTensor_(transpose)(finput, finput, 0, 1);
-  THTensor_(addmm)(gradWeight, 1, gradWeight, scale, gradOutput2d, finput);
+  THTensor_(addmm)(gradWeight, 1, gradWeight, scale, &gradOutput2d, finput);
   THTensor_(transpose)(finput, finput, 0, 1);
 
-  THTensor *gradOutputPlane = THTensor_(new)();
   for(i = 0; i < gradBias->size[0]; i++)
   {
     long k;
     real sum = 0;
-    real *data = gradOutput2d->storage->data + gradOutput2d->storageOffset + i*gradOutput2d->stride[0];
-    for(k = 0; k < gradOutput2d->size[1]; k++)
+    real *data = gradOutput2d.storage->data + gradOutput2d.storageOffset + i*gradOutput2d.stride[0];
+    for(k = 0; k < gradOutput2d.size[1]; k++)
       sum += data[k];
     (gradBias->storage->data + gradBias->storageOffset)[i] += scale*sum;
   }
 
-  THTensor_(free)(gradOutputPlane);
-  THTensor_(free)(gradOutput2d);
+  THTensor_(releaseView)(&gradOutput2d);
 }
 
 static int nn_(SpatialConvolutionMM_accGradParameters)(lua_State *L)
@@ -274,13 +393,17 @@ static int nn_(SpatialConvolutionMM_accGradParameters)(lua_State *L)
 
     for(t = 0; t < T; t++)
     {
-      THTensor *gradOutput_t = THTensor_(newSelect)(gradOutput, 0, t);
-      THTensor *finput_t = THTensor_(newSelect)(finput, 0, t);
+      THTensor gradOutput_t, finput_t;
+
+      THTensor_(initView)(&gradOutput_t);
+      THTensor_(initView)(&finput_t);
+      THTensor_(select)(&gradOutput_t, gradOutput, 0, t);
+      THTensor_(select)(&finput_t, finput, 0, t);
 
-      nn_(SpatialConvolutionMM_accGradParameters_frame)(gradOutput_t, gradWeight, gradBias, finput_t, scale);
+      nn_(SpatialConvolutionMM_accGradParameters_frame)(&gradOutput_t, gradWeight, gradBias, &finput_t, scale);
 
-      THTensor_(free)(gradOutput_t);      
-      THTensor_(free)(finput_t);
+      THTensor_(releaseView)(&gradOutput_t);
+      THTensor_(releaseView)(&finput_t);
     }
   }
 
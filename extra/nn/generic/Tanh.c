@@ -7,29 +7,7 @@ static int nn_(Tanh_updateOutput)(lua_State *L)
   THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
   THTensor *output = luaT_getfieldcheckudata(L, 1, "output", torch_Tensor);
 
-  THTensor_(resizeAs)(output, input);
-
-  if (input->nDimension == 1 || !THTensor_(isContiguous)(input) || !THTensor_(isContiguous)(output))
-  {
-    TH_TENSOR_APPLY2(real, output, real, input,   \
-         *output_data = tanh(*input_data););
-  }
-  else
-  {
-    real* output_data = THTensor_(data)(output);
-    real* input_data  = THTensor_(data)(input);
-    long k;
-
-#pragma omp parallel for private(k)
-    for (k = 0; k < input->size[0]; k++)
-    {
-      real* ptr_output = output_data + k*input->stride[0];
-      real* ptr_input  = input_data  + k*input->stride[0];
-      long i;
-      for (i = 0; i < input->stride[0]; i++)
-  ptr_output[i] = tanh(ptr_input[i]);
-    }
-  }
+  THTensor_(tanh)(output, input);
   return 1;
 }
 
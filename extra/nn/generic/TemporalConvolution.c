@@ -2,9 +2,71 @@
 #define TH_GENERIC_FILE "generic/TemporalConvolution.c"
 #else
 
+/* The input is a sequence (nInputFrame x inputFrameSize), or a batch of
+   sequences (nBatch x nInputFrame x inputFrameSize). As in SpatialConvolutionMM,
+   the windows of kW input frames are unfolded in finput
+   (nBatch*nOutputFrame x kW*inputFrameSize), so that each pass over the
+   whole batch is a single matrix-matrix product with the weight. */
+
+/* copies each window of the (contiguous) input in a row of finput */
+static void nn_(TemporalConvolution_unfold)(real *finput_data, real *input_data,
+                                             int kW, int dW, long inputFrameSize,
+                                             long nBatch, long nInputFrame, long nOutputFrame)
+{
+  long k;
+  long rowSize = kW*inputFrameSize;
+
+#pragma omp parallel for private(k) if(nBatch*nOutputFrame*rowSize >= THGetParallelThreshold())
+  for(k = 0; k < nBatch*nOutputFrame; k++)
+  {
+    long b = k / nOutputFrame;
+    long t = k % nOutputFrame;
+    memcpy(finput_data + k*rowSize,
+           input_data + (b*nInputFrame + t*dW)*inputFrameSize,
+           sizeof(real)*rowSize);
+  }
+}
+
+/* the inverse of unfold: sums the window gradients over each input frame.
+   Each input frame is written by one thread only, so overlapping windows
+   (dW < kW) need no synchronization. */
+static void nn_(TemporalConvolution_fold)(real *input_data, real *finput_data,
+                                           int kW, int dW, long inputFrameSize,
+                                           long nBatch, long nInputFrame, long nOutputFrame)
+{
+  long k;
+  long rowSize = kW*inputFrameSize;
+
+#pragma omp parallel for private(k) if(nBatch*nInputFrame*inputFrameSize >= THGetParallelThreshold())
+  for(k = 0; k < nBatch*nInputFrame; k++)
+  {
+    long b = k / nInputFrame;
+    long i = k % nInputFrame;
+    long tfirst = (i < kW ? 0 : (i-kW)/dW+1);
+    long tlast = THMin(i/dW, nOutputFrame-1);
+    real *dst = input_data + k*inputFrameSize;
+    long t;
+
+    THVector_(fill)(dst, 0, inputFrameSize);
+    for(t = tfirst; t <= tlast; t++)
+      THVector_(add)(dst, finput_data + (b*nOutputFrame + t)*rowSize + (i-t*dW)*inputFrameSize, 1, inputFrameSize);
+  }
+}
+
+/* views a contiguous 2D or 3D tensor as a matrix, the first dimensions
+   merged, in matrix (a view on the stack, see THTensor_(initView)) */
+static void nn_(TemporalConvolution_matrix)(THTensor *matrix, THTensor *tensor)
+{
+  long size1 = tensor->size[tensor->nDimension-1];
+  THTensor_(initView)(matrix);
+  THTensor_(setStorage2d)(matrix, tensor->storage, tensor->storageOffset,
+                          THTensor_(nElement)(tensor)/size1, size1,
+                          size1, 1);
+}
+
 static int nn_(TemporalConvolution_updateOutput)(lua_State *L)
 {
-  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);  
+  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
   int kW = luaT_getfieldcheckint(L, 1, "kW");
   int dW = luaT_getfieldcheckint(L, 1, "dW");
   int inputFrameSize = luaT_getfieldcheckint(L, 1, "inputFrameSize");
@@ -12,167 +74,150 @@ static int nn_(TemporalConvolution_updateOutput)(lua_State *L)
 
   THTensor *weight = luaT_getfieldcheckudata(L, 1, "weight", torch_Tensor);
   THTensor *bias = luaT_getfieldcheckudata(L, 1, "bias", torch_Tensor);
+  THTensor *finput = luaT_getfieldcheckudata(L, 1, "finput", torch_Tensor);
   THTensor *output = luaT_getfieldcheckudata(L, 1, "output", torch_Tensor);
 
-  THTensor *outputWindow, *inputWindow;
-  int nInputFrame, nOutputFrame;
+  THTensor output2d, finput2d, weightT;
+  THTensor *bias_;
+  real *output_data, *bias_data;
+  long nBatch, nInputFrame, nOutputFrame;
   long k;
-  
-  luaL_argcheck(L, input->nDimension == 2, 2, "2D tensor expected");
-  luaL_argcheck(L, input->size[1] == inputFrameSize, 2, "invalid input frame size");
-  luaL_argcheck(L, input->size[0] >= kW, 2, "input sequence smaller than kernel size");
+  int dimf = 1;
 
-  input = THTensor_(newContiguous)(input);
-  outputWindow = THTensor_(new)();
-  inputWindow = THTensor_(new)();
+  luaL_argcheck(L, input->nDimension == 2 || input->nDimension == 3, 2, "2D or 3D(batch mode) tensor expected");
+  if(input->nDimension == 3)
+    dimf++;
+  luaL_argcheck(L, input->size[dimf] == inputFrameSize, 2, "invalid input frame size");
+  luaL_argcheck(L, input->size[dimf-1] >= kW, 2, "input sequence smaller than kernel size");
 
-  nInputFrame = input->size[0];
+  nBatch = (input->nDimension == 3 ? input->size[0] : 1);
+  nInputFrame = input->size[dimf-1];
   nOutputFrame = (nInputFrame - kW) / dW + 1;
 
-  THTensor_(resize2d)(output,
-                      nOutputFrame,
-                      outputFrameSize);
-
-  /* bias first */
-  for(k = 0; k < nOutputFrame; k++)
+  if(input->nDimension == 2)
   {
-    THTensor_(select)(outputWindow, output, 0, k);
-    THTensor_(copy)(outputWindow, bias);
+    THTensor_(resize2d)(finput, nOutputFrame, kW*inputFrameSize);
+    THTensor_(resize2d)(output, nOutputFrame, outputFrameSize);
   }
-
-  /* ouch */
-  for(k = 0; nOutputFrame > 0; k++)
+  else
   {
-    long outputFrameStride = (kW-1)/dW+1;
-    long inputFrameStride = outputFrameStride*dW;
-    long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-    nOutputFrame -= nFrame;
-
-    THTensor_(setStorage2d)(inputWindow, input->storage,
-                            input->storageOffset+k*dW*input->size[1],
-                            nFrame, inputFrameStride*input->size[1],
-                            kW*input->size[1], 1);
-
-    THTensor_(setStorage2d)(outputWindow, output->storage, 
-                            output->storageOffset + k*output->size[1],
-                            nFrame, outputFrameStride*output->size[1],
-                            output->size[1], 1);
-
-    THTensor_(transpose)(weight, NULL, 0, 1);
-    THTensor_(addmm)(outputWindow, 1, outputWindow, 1, inputWindow, weight);
-    THTensor_(transpose)(weight, NULL, 0, 1);
+    THTensor_(resize3d)(finput, nBatch, nOutputFrame, kW*inputFrameSize);
+    THTensor_(resize3d)(output, nBatch, nOutputFrame, outputFrameSize);
   }
 
-  THTensor_(free)(outputWindow);
-  THTensor_(free)(inputWindow);
+  input = THTensor_(newContiguous)(input);
+  nn_(TemporalConvolution_unfold)(THTensor_(data)(finput), THTensor_(data)(input),
+                                  kW, dW, inputFrameSize, nBatch, nInputFrame, nOutputFrame);
   THTensor_(free)(input);
 
+  /* bias first */
+  bias_ = THTensor_(newContiguous)(bias);
+  bias_data = THTensor_(data)(bias_);
+  output_data = THTensor_(data)(output);
+#pragma omp parallel for private(k) if(nBatch*nOutputFrame*outputFrameSize >= THGetParallelThreshold())
+  for(k = 0; k < nBatch*nOutputFrame; k++)
+    memcpy(output_data + k*outputFrameSize, bias_data, sizeof(real)*outputFrameSize);
+  THTensor_(free)(bias_);
+
+  /* all the frames of all the sequences at once */
+  nn_(TemporalConvolution_matrix)(&output2d, output);
+  nn_(TemporalConvolution_matrix)(&finput2d, finput);
+  THTensor_(initView)(&weightT);
+  THTensor_(transpose)(&weightT, weight, 0, 1);
+  THTensor_(addmm)(&output2d, 1, &output2d, 1, &finput2d, &weightT);
+
+  THTensor_(releaseView)(&output2d);
+  THTensor_(releaseView)(&finput2d);
+  THTensor_(releaseView)(&weightT);
+
   return 1;
 }
 
 static int nn_(TemporalConvolution_updateGradInput)(lua_State *L)
 {
-  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);  
-  THTensor *gradOutput = luaT_checkudata(L, 3, torch_Tensor);  
+  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
+  THTensor *gradOutput = luaT_checkudata(L, 3, torch_Tensor);
   int kW = luaT_getfieldcheckint(L, 1, "kW");
   int dW = luaT_getfieldcheckint(L, 1, "dW");
-  long nInputFrame = input->size[0];
-  long nOutputFrame = gradOutput->size[0];
+  int inputFrameSize = luaT_getfieldcheckint(L, 1, "inputFrameSize");
 
   THTensor *weight = luaT_getfieldcheckudata(L, 1, "weight", torch_Tensor);
+  THTensor *fgradInput = luaT_getfieldcheckudata(L, 1, "fgradInput", torch_Tensor);
   THTensor *gradInput = luaT_getfieldcheckudata(L, 1, "gradInput", torch_Tensor);
 
-  THTensor *gradOutputWindow;
-  THTensor *gradInputWindow;
-  long k;
+  THTensor gradOutput2d, fgradInput2d;
+  long nBatch = (input->nDimension == 3 ? input->size[0] : 1);
+  long nInputFrame = input->size[input->nDimension-2];
+  long nOutputFrame = (nInputFrame - kW) / dW + 1;
 
-  gradOutputWindow = THTensor_(new)();
-  gradInputWindow = THTensor_(new)();
+  THArgCheck(gradOutput->nDimension == input->nDimension && gradOutput->size[gradOutput->nDimension-2] == nOutputFrame,
+             3, "inconsistent gradOutput size");
 
   THTensor_(resizeAs)(gradInput, input);
-  THTensor_(zero)(gradInput);
+  THTensor_(resize2d)(fgradInput, nBatch*nOutputFrame, kW*inputFrameSize);
 
-  /* ouch */
-  for(k = 0; nOutputFrame > 0; k++)
-  {
-    long outputFrameStride = (kW-1)/dW+1;
-    long inputFrameStride = outputFrameStride*dW;
-    long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-    nOutputFrame -= nFrame;
-
-    THTensor_(setStorage2d)(gradOutputWindow, gradOutput->storage,
-                            gradOutput->storageOffset + k*gradOutput->size[1],
-                            nFrame, outputFrameStride*gradOutput->size[1],
-                            gradOutput->size[1], 1);
-
-    THTensor_(setStorage2d)(gradInputWindow, gradInput->storage,
-                            gradInput->storageOffset+k*dW*gradInput->size[1],
-                            nFrame, inputFrameStride*gradInput->size[1],
-                            kW*gradInput->size[1], 1);
-
-    THTensor_(addmm)(gradInputWindow, 1, gradInputWindow, 1, gradOutputWindow, weight);
-  }
+  /* gradient with respect to each window */
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+  nn_(TemporalConvolution_matrix)(&gradOutput2d, gradOutput);
+  nn_(TemporalConvolution_matrix)(&fgradInput2d, fgradInput);
+  THTensor_(addmm)(&fgradInput2d, 0, &fgradInput2d, 1, &gradOutput2d, weight);
 
-  THTensor_(free)(gradOutputWindow);
-  THTensor_(free)(gradInputWindow);
+  nn_(TemporalConvolution_fold)(THTensor_(data)(gradInput), THTensor_(data)(fgradInput),
+                                kW, dW, inputFrameSize, nBatch, nInputFrame, nOutputFrame);
+
+  THTensor_(releaseView)(&gradOutput2d);
+  THTensor_(releaseView)(&fgradInput2d);
+  THTensor_(free)(gradOutput);
 
   return 1;
 }
 
 static int nn_(TemporalConvolution_accGradParameters)(lua_State *L)
 {
-  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);  
-  THTensor *gradOutput = luaT_checkudata(L, 3, torch_Tensor);  
+  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
+  THTensor *gradOutput = luaT_checkudata(L, 3, torch_Tensor);
   real scale = luaL_optnumber(L, 4, 1);
   int kW = luaT_getfieldcheckint(L, 1, "kW");
   int dW = luaT_getfieldcheckint(L, 1, "dW");
-  long nInputFrame = input->size[0];
-  long nOutputFrame = gradOutput->size[0];
+  int outputFrameSize = luaT_getfieldcheckint(L, 1, "outputFrameSize");
 
   THTensor *gradWeight = luaT_getfieldcheckudata(L, 1, "gradWeight", torch_Tensor);
   THTensor *gradBias = luaT_getfieldcheckudata(L, 1, "gradBias", torch_Tensor);
+  THTensor *finput = luaT_getfieldcheckudata(L, 1, "finput", torch_Tensor);
 
-  THTensor *gradOutputWindow;
-  THTensor *inputWindow;
+  THTensor gradOutput2d, gradOutputT, finput2d;
+  THTensor *gradBias_;
+  real *gradOutput_data, *gradBias_data;
+  long nBatch = (input->nDimension == 3 ? input->size[0] : 1);
+  long nOutputFrame = (input->size[input->nDimension-2] - kW) / dW + 1;
   long k;
 
-  input = THTensor_(newContiguous)(input);
-  gradOutputWindow = THTensor_(new)();
-  inputWindow = THTensor_(new)();
-
-  /* bias first */
-  for(k = 0; k < nOutputFrame; k++)
-  {
-    THTensor_(select)(gradOutputWindow, gradOutput, 0, k);
-    THTensor_(cadd)(gradBias, gradBias, scale, gradOutputWindow);
-  }
-
-  /* ouch */
-  for(k = 0; nOutputFrame > 0; k++)
-  {
-    long outputFrameStride = (kW-1)/dW+1;
-    long inputFrameStride = outputFrameStride*dW;
-    long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-    nOutputFrame -= nFrame;
-
-    THTensor_(setStorage2d)(inputWindow, input->storage,
-                            input->storageOffset+k*dW*input->size[1],
-                            nFrame, inputFrameStride*input->size[1],
-                            kW*input->size[1], 1);
-
-    THTensor_(setStorage2d)(gradOutputWindow, gradOutput->storage, 
-                            gradOutput->storageOffset + k*gradOutput->size[1],
-                            nFrame, outputFrameStride*gradOutput->size[1],
-                            gradOutput->size[1], 1);
-
-    THTensor_(transpose)(gradOutputWindow, NULL, 0, 1);
-    THTensor_(addmm)(gradWeight, 1, gradWeight, scale, gradOutputWindow, inputWindow);
-    THTensor_(transpose)(gradOutputWindow, NULL, 0, 1);
-  }
-
-  THTensor_(free)(gradOutputWindow);
-  THTensor_(free)(inputWindow);
-  THTensor_(free)(input);
+  THArgCheck(gradOutput->nDimension == input->nDimension && gradOutput->size[gradOutput->nDimension-2] == nOutputFrame,
+             3, "inconsistent gradOutput size");
+  THArgCheck(THTensor_(nElement)(finput) == nBatch*nOutputFrame*kW*input->size[input->nDimension-1],
+             1, "forward must be called on the same input first");
+
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+  gradOutput_data = THTensor_(data)(gradOutput);
+
+  /* bias first; the frames are summed in order, for reproducible results */
+  gradBias_ = THTensor_(newContiguous)(gradBias);
+  gradBias_data = THTensor_(data)(gradBias_);
+  for(k = 0; k < nBatch*nOutputFrame; k++)
+    THVector_(add)(gradBias_data, gradOutput_data + k*outputFrameSize, scale, outputFrameSize);
+  THTensor_(freeCopyTo)(gradBias_, gradBias);
+
+  /* the windows unfolded by the forward */
+  nn_(TemporalConvolution_matrix)(&gradOutput2d, gradOutput);
+  THTensor_(initView)(&gradOutputT);
+  THTensor_(transpose)(&gradOutputT, &gradOutput2d, 0, 1);
+  nn_(TemporalConvolution_matrix)(&finput2d, finput);
+  THTensor_(addmm)(gradWeight, 1, gradWeight, scale, &gradOutputT, &finput2d);
+
+  THTensor_(releaseView)(&gradOutput2d);
+  THTensor_(releaseView)(&gradOutputT);
+  THTensor_(releaseView)(&finput2d);
+  THTensor_(free)(gradOutput);
 
   return 0;
 }
@@ -104,6 +104,15 @@
 #include "generic/L1Cost.c"
 #include "THGenerateFloatTypes.h"
 
+#include "generic/ClassNLLCriterion.c"
+#include "THGenerateFloatTypes.h"
+
+#include "generic/CrossEntropyCriterion.c"
+#include "THGenerateFloatTypes.h"
+
+#include "generic/LookupTable.c"
+#include "THGenerateFloatTypes.h"
+
 DLL_EXPORT int luaopen_libnn(lua_State *L)
 {
   lua_newtable(L);
@@ -143,6 +152,9 @@ DLL_EXPORT int luaopen_libnn(lua_State *L)
   nn_FloatMultiMarginCriterion_init(L);
   nn_FloatMultiLabelMarginCriterion_init(L);
   nn_FloatL1Cost_init(L);
+  nn_FloatClassNLLCriterion_init(L);
+  nn_FloatCrossEntropyCriterion_init(L);
+  nn_FloatLookupTable_init(L);
 
   nn_DoubleMin_init(L);
   nn_DoubleMax_init(L);
@@ -177,6 +189,9 @@ DLL_EXPORT int luaopen_libnn(lua_State *L)
   nn_DoubleMultiMarginCriterion_init(L);
   nn_DoubleMultiLabelMarginCriterion_init(L);
   nn_DoubleL1Cost_init(L);
+  nn_DoubleClassNLLCriterion_init(L);
+  nn_DoubleCrossEntropyCriterion_init(L);
+  nn_DoubleLookupTable_init(L);
 
   return 1;
 }
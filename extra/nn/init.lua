@@ -85,6 +85,7 @@ include('MSECriterion.lua')
 include('MarginCriterion.lua')
 include('AbsCriterion.lua')
 include('ClassNLLCriterion.lua')
+include('CrossEntropyCriterion.lua')
 include('DistKLDivCriterion.lua')
 include('MultiCriterion.lua')
 include('L1HingeEmbeddingCriterion.lua')
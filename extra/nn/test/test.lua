@@ -385,6 +385,72 @@ function nntest.LogSoftmax()
    mytester:asserteq(berr, 0, torch.typename(module) .. ' - i/o backward err ')
 end
 
+function nntest.ClassNLLCriterion()
+   local nframe = math.random(10,20)
+   local dim = math.random(5,10)
+   local input = torch.randn(nframe, dim)
+   local target = torch.LongTensor(nframe)
+   for i=1,nframe do
+      target[i] = math.random(1,dim)
+   end
+   local cri = nn.ClassNLLCriterion()
+
+   local output = 0
+   local gradInput = torch.zeros(nframe, dim)
+   for i=1,nframe do
+      output = output - input[i][target[i]]/nframe
+      gradInput[i][target[i]] = -1/nframe
+   end
+   mytester:assertlt(math.abs(cri:forward(input, target) - output), precision, 'batch output')
+   mytester:assertlt(cri:backward(input, target):clone():add(-1, gradInput):abs():max(), precision, 'batch gradInput')
+
+   cri.sizeAverage = false
+   mytester:assertlt(math.abs(cri:forward(input, target) - output*nframe), precision, 'batch output without average')
+
+   mytester:asserteq(cri:forward(input[1], target[1]), -input[1][target[1]], 'vector output')
+   mytester:asserteq(cri:backward(input[1], target[1])[target[1]], -1, 'vector gradInput')
+   mytester:asserteq(cri:backward(input[1], target[1]):sum(), -1, 'vector gradInput sum')
+
+   cri:float()
+   mytester:assertlt(math.abs(cri:forward(input:float(), target) - output*nframe), 1e-4, 'float output')
+end
+
+function nntest.CrossEntropyCriterion()
+   local nframe = math.random(10,20)
+   local dim = math.random(5,10)
+   local input = torch.randn(nframe, dim)
+   local target = torch.Tensor(nframe)
+   for i=1,nframe do
+      target[i] = math.random(1,dim)
+   end
+   local cri = nn.CrossEntropyCriterion()
+
+   -- log-softmax and negative log-likelihood of each frame
+   local output = torch.zeros(nframe)
+   local gradInput = torch.zeros(nframe, dim)
+   for i=1,nframe do
+      local logprob = input[i]:clone():add(-math.log(input[i]:clone():exp():sum()))
+      output[i] = -logprob[target[i]]
+      gradInput[i]:copy(logprob):exp()
+      gradInput[i][target[i]] = gradInput[i][target[i]] - 1
+   end
+
+   mytester:assertlt(math.abs(cri:forward(input, target) - output:mean()), precision, 'batch output')
+   mytester:assertlt(cri:backward(input, target):clone():add(-1/nframe, gradInput):abs():max(), precision, 'batch gradInput')
+   cri.sizeAverage = false
+   mytester:assertlt(math.abs(cri:forward(input, target) - output:sum()), precision, 'batch output without average')
+   mytester:assertlt(cri:backward(input, target):clone():add(-1, gradInput):abs():max(), precision, 'batch gradInput without average')
+
+   mytester:assertlt(math.abs(cri:forward(input[2], target[2]) - output[2]), precision, 'vector output')
+   mytester:assertlt(cri:backward(input[2], target[2]):clone():add(-1, gradInput[2]):abs():max(), precision, 'vector gradInput')
+
+   -- same as LogSoftMax followed by ClassNLLCriterion
+   local logsoftmax = nn.LogSoftMax()
+   local nll = nn.ClassNLLCriterion()
+   nll.sizeAverage = false
+   mytester:assertlt(math.abs(nll:forward(logsoftmax:forward(input), target) - output:sum()), expprecision*nframe, 'LogSoftMax + ClassNLLCriterion')
+end
+
 -- function nntest.TemporalLogSoftmax()
 --    local ini = math.random(10,20)
 --    local inj = math.random(10,20)
@@ -399,6 +465,87 @@ end
 --    mytester:asserteq(berr, 0, torch.typename(module) .. ' - i/o backward err ')
 -- end
 
+function nntest.LookupTable()
+   local nIndex = math.random(10,20)
+   local dim = math.random(3,8)
+   local nthread = torch.getnumthreads()
+   local threshold = torch.getparallelthreshold()
+   local function totable(x)
+      local t = {}
+      for i=1,x:nElement() do
+         t[i] = x[i]
+      end
+      return t
+   end
+   for _,isize in ipairs{{7}, {3,5}} do
+      local input = torch.LongTensor(unpack(isize)):random(1,nIndex)
+      local flat = torch.LongTensor(input:storage())
+      flat[1] = flat[2] -- at least one repeated index
+      local n = input:nElement()
+      local gradOutput = torch.randn(n, dim)
+      local module = nn.LookupTable(nIndex, dim)
+
+      -- forward, with indices of the module type as well
+      local output = module:forward(input):clone()
+      local size = input:size():totable()
+      table.insert(size, dim)
+      mytester:assertTableEq(output:size():totable(), size, 'output size')
+      local ref = torch.Tensor(n, dim)
+      for i=1,n do
+         ref[i]:copy(module.weight[flat[i]])
+      end
+      mytester:assertlt((output:resize(n, dim)-ref):abs():max(), precision, 'forward ' .. #isize .. 'D')
+      mytester:assertlt((module:forward(input:double()):clone():resize(n, dim)-ref):abs():max(), precision, 'forward double indices')
+      mytester:assertError(function() module:forward(torch.LongTensor{nIndex+1}) end, 'index out of range')
+
+      -- accumulation, serial and parallel
+      local refGrad = torch.zeros(nIndex, dim)
+      for i=1,n do
+         refGrad[flat[i]]:add(0.5, gradOutput[i])
+      end
+      for _,threads in ipairs{1, math.max(nthread, 4)} do
+         torch.setnumthreads(threads)
+         torch.setparallelthreshold(1)
+         module:zeroGradParameters()
+         mytester:asserteq(module.gradWeight:abs():max(), 0, 'zeroGradParameters')
+         module:accGradParameters(input, gradOutput:clone():resize(unpack(size)), 0.5)
+         mytester:assertlt((module.gradWeight-refGrad):abs():max(), precision, 'accGradParameters ' .. threads .. ' threads')
+      end
+      torch.setnumthreads(nthread)
+      torch.setparallelthreshold(threshold)
+
+      -- the touched rows are the (sorted, unique) indices
+      local touched = {}
+      for i=1,n do
+         touched[flat[i]] = true
+      end
+      local expected = {}
+      for k=1,nIndex do
+         if touched[k] then
+            table.insert(expected, k)
+         end
+      end
+      mytester:assertTableEq(totable(module.touched), expected, 'touched rows')
+      module:accGradParameters(input, gradOutput, 1)
+      mytester:assertTableEq(totable(module.touched), expected, 'touched rows after a second batch')
+
+      -- sparse update
+      local weight = module.weight:clone()
+      module:updateParameters(0.1)
+      mytester:assertlt((module.weight-torch.add(weight, -0.1, module.gradWeight)):abs():max(), precision, 'updateParameters')
+      local weight = module.weight:clone()
+      module:accUpdateGradParameters(input, gradOutput, 0.1)
+      mytester:assertlt((module.weight-torch.add(weight, -0.2, refGrad)):abs():max(), precision, 'accUpdateGradParameters')
+   end
+
+   -- the indices stay LongTensors through type conversions and serialization
+   local module = nn.LookupTable(5, 2):float()
+   module:accGradParameters(torch.LongTensor{3,1,3}, torch.FloatTensor(3, 2):fill(1))
+   local clone = module:clone()
+   mytester:asserteq(torch.typename(clone.touched), 'torch.LongTensor', 'touched type')
+   mytester:assertTableEq(totable(clone.touched), {1,3}, 'touched after clone')
+end
+
 function nntest.Max()
    local ini = math.random(10,20)
    local inj = math.random(10,20)
@@ -695,11 +842,15 @@ function nntest.SpatialConvolutionMM()
    local to = math.random(1,10)
    local ki = math.random(1,5)
    local kj = math.random(1,5)
+   local si = math.random(1,3)
+   local sj = math.random(1,3)
+   local padW = math.random(0,2)
+   local padH = math.random(0,2)
    local outi = math.random(10,20)
    local outj = math.random(10,20)
-   local ini = outi-1+ki
-   local inj = outj-1+kj
-   local module = nn.SpatialConvolutionMM(from, to, ki, kj)
+   local ini = (outi-1)*si+ki-padW*2
+   local inj = (outj-1)*sj+kj-padH*2
+   local module = nn.SpatialConvolutionMM(from, to, ki, kj, si, sj, padW, padH)
    local input = torch.Tensor(from, inj, ini):zero()
 
    -- stochastic
@@ -733,11 +884,12 @@ function nntest.SpatialConvolutionMM()
    
    --verbose = true
    local batch = math.random(2,5)
-   outi = math.random(4,8)
-   outj = math.random(4,8)
-   ini = outi-1+ki
-   inj = outj-1+kj
-   module = nn.SpatialConvolutionMM(from, to, ki, kj)
+   -- at least 5 outputs, so that (out-1)*s >= 2*pad keeps the input non-empty
+   outi = math.random(5,8)
+   outj = math.random(5,8)
+   ini = (outi-1)*si+ki-padW*2
+   inj = (outj-1)*sj+kj-padH*2
+   module = nn.SpatialConvolutionMM(from, to, ki, kj, si, sj, padW, padH)
    input = torch.Tensor(batch,from,inj,ini):zero()
 
    local err = jac.testJacobian(module, input)
@@ -768,6 +920,24 @@ function nntest.SpatialConvolutionMM()
    local ferr, berr = jac.testIO(module, input)
    mytester:asserteq(0, ferr, torch.typename(module) .. ' - i/o forward err ')
    mytester:asserteq(0, berr, torch.typename(module) .. ' - i/o backward err ')
+
+   -- same as an explicit zero padding followed by SpatialConvolution
+   local ref = nn.Sequential()
+   ref:add(nn.SpatialZeroPadding(padW, padW, padH, padH))
+   ref:add(nn.SpatialConvolution(from, to, ki, kj, si, sj))
+   ref.modules[2].weight:copy(module.weight)
+   ref.modules[2].bias:copy(module.bias)
+   input = torch.rand(from, inj, ini)
+   local output = module:forward(input)
+   mytester:assertlt((output - ref:forward(input)):abs():max(), precision, 'error with padding and stride (forward)')
+   local gradOutput = torch.rand(output:size())
+   module:zeroGradParameters()
+   ref:zeroGradParameters()
+   local gradInput = module:backward(input, gradOutput)
+   mytester:assertlt((gradInput - ref:backward(input, gradOutput)):abs():max(), precision,
+                     'error with padding and stride (backward)')
+   mytester:assertlt((module.gradWeight - ref.modules[2].gradWeight:clone():resizeAs(module.gradWeight)):abs():max(), precision,
+                     'error with padding and stride (gradWeight)')
 end
 
 function nntest.SpatialConvolutionMap()
@@ -1258,6 +1428,34 @@ function nntest.TemporalConvolution()
    local ferr, berr = jac.testIO(module, input)
    mytester:asserteq(0, ferr, torch.typename(module) .. ' - i/o forward err ')
    mytester:asserteq(0, berr, torch.typename(module) .. ' - i/o backward err ')
+
+   -- batch mode: same as each sequence on its own
+   local batch = math.random(2,5)
+   local input = torch.randn(batch, ini, from)
+   local gradOutput = torch.randn(batch, outi, to)
+   module:zeroGradParameters()
+   local output = module:forward(input):clone()
+   local gradInput = module:backward(input, gradOutput):clone()
+   local gradWeight = module.gradWeight:clone()
+   local gradBias = module.gradBias:clone()
+   mytester:assertTableEq(output:size():totable(), {batch, outi, to}, 'batch output size')
+   module:zeroGradParameters()
+   for i=1,batch do
+      mytester:assertlt((module:forward(input[i])-output[i]):abs():max(), precision, 'batch forward')
+      mytester:assertlt((module:backward(input[i], gradOutput[i])-gradInput[i]):abs():max(), precision, 'batch backward')
+   end
+   mytester:assertlt((module.gradWeight-gradWeight):abs():max(), precision, 'batch gradWeight')
+   mytester:assertlt((module.gradBias-gradBias):abs():max(), precision, 'batch gradBias')
+
+   local input = torch.Tensor(batch, ini, from):zero()
+   local err = jac.testJacobian(module, input)
+   mytester:assertlt(err, precision, 'batch error on state ')
+
+   local err = jac.testJacobianParameters(module, input, module.weight, module.gradWeight)
+   mytester:assertlt(err , precision, 'batch error on weight ')
+
+   local err = jac.testJacobianParameters(module, input, module.bias, module.gradBias)
+   mytester:assertlt(err , precision, 'batch error on bias ')
 end
 
 function nntest.TemporalSubSampling()
@@ -1504,6 +1702,109 @@ function nntest.Module_getParameters_7()
    mytester:asserteq(p:nElement(), 121, 'error: incorrect number of elements in flat vector')
 end
 
+function nntest.Concat()
+   local from = math.random(2,5)
+   local batch = math.random(2,5)
+   -- modules writing in place (Linear, Sequential), or not (Identity, Exp)
+   local function build(dimension)
+      local module = nn.Concat(dimension)
+      module:add(nn.Linear(from, 3))
+      module:add(nn.Sequential():add(nn.Linear(from, 4)):add(nn.Tanh()))
+      module:add(nn.Identity())
+      module:add(nn.Exp())
+      return module
+   end
+   -- the output and gradInput of the modules of a Concat, run one by one
+   local function reference(module, input, gradOutput, dimension)
+      local output = gradOutput:clone()
+      local gradInput = input:clone():zero()
+      local offset = 1
+      module:zeroGradParameters()
+      for i,m in ipairs(module.modules) do
+         local o = m:forward(input)
+         local n = o:size(dimension)
+         output:narrow(dimension, offset, n):copy(o)
+         gradInput:add(m:backward(input, gradOutput:narrow(dimension, offset, n)))
+         offset = offset + n
+      end
+      return output, gradInput
+   end
+   local function check(module, input, dimension, name, eps)
+      local output = module:forward(input):clone()
+      local gradOutput = output:clone():normal(0, 1)
+      module:zeroGradParameters()
+      local gradInput = module:backward(input, gradOutput):clone()
+      local refOutput, refGradInput = reference(module:clone(), input, gradOutput, dimension)
+      mytester:assertlt((output-refOutput):abs():max(), eps or precision, 'forward ' .. name)
+      mytester:assertlt((gradInput-refGradInput):abs():max(), eps or precision, 'backward ' .. name)
+   end
+
+   for dimension,size in ipairs{{from}, {batch, from}} do
+      local module = build(dimension)
+      for step=1,3 do
+         check(module, torch.randn(unpack(size)), dimension, dimension .. 'D step ' .. step)
+      end
+      -- after the first forward, the Linear and the Sequential write in place
+      mytester:assert(module.modules[1].output:isSetTo(module.output:narrow(dimension, 1, 3)), 'output view')
+      mytester:assert(module.modules[2].modules[2].output:isSetTo(module.output:narrow(dimension, 4, 4)), 'output view in Sequential')
+      mytester:assert(not module.modules[4].output:isSetTo(module.output:narrow(dimension, 8+from, from)) or dimension == 1, 'strided output view')
+      -- each module keeps its own gradInput
+      local input = torch.randn(unpack(size))
+      local gradOutput = module:forward(input):clone():normal(0, 1)
+      module:backward(input, gradOutput)
+      local first = nn.Linear(from, 3)
+      first.weight:copy(module.modules[1].weight)
+      first.bias:copy(module.modules[1].bias)
+      local refGradInput = first:backward(input, gradOutput:narrow(dimension, 1, 3))
+      mytester:assertlt((module.modules[1].gradInput-refGradInput):abs():max(), precision, 'gradInput of the first module')
+
+      -- a failed forward, and a new type
+      local badSize = {unpack(size)}
+      badSize[dimension] = from+1
+      mytester:assert(not pcall(function() module:forward(torch.randn(unpack(badSize))) end), 'invalid input size')
+      module:float()
+      for step=1,2 do
+         check(module, torch.randn(unpack(size)):float(), dimension, dimension .. 'D float', 1e-4)
+      end
+      mytester:assert(module.modules[1].output:isSetTo(module.output:narrow(dimension, 1, 3)), 'output view after type()')
+   end
+
+   -- a batch size change, with the modules writing in place
+   local module = build(2)
+   local input1 = torch.randn(batch, from)
+   local input2 = torch.randn(batch+1, from)
+   check(module, input1, 2, 'batch')
+   check(module, input1, 2, 'batch, in place')
+   check(module, input2, 2, 'batch size change')
+   check(module, input1, 2, 'batch size change back')
+   local err = jac.testJacobian(module, input1:zero())
+   mytester:assertlt(err, precision, 'error on state ')
+
+   -- Concat within Concat
+   local module = nn.Concat(1):add(build(1)):add(nn.Linear(from, 2))
+   local input = torch.randn(from)
+   check(module, input, 1, 'nested')
+   check(module, input, 1, 'nested, in place')
+   mytester:assert(module.modules[1].modules[1].output:isSetTo(module.output:narrow(1, 1, 3)), 'nested output view')
+end
+
+function nntest.JoinTable()
+   local x = torch.randn(3, 4)
+   local y = torch.randn(3, 2)
+   local module = nn.JoinTable(2)
+   local output = module:forward{x, y}
+   mytester:assertlt((output:narrow(2, 1, 4)-x):abs():max(), precision, 'forward 1')
+   mytester:assertlt((output:narrow(2, 5, 2)-y):abs():max(), precision, 'forward 2')
+   local gradOutput = torch.randn(3, 6)
+   local gradInput = module:backward({x, y}, gradOutput)
+   mytester:assertlt((gradInput[1]-gradOutput:narrow(2, 1, 4)):abs():max(), precision, 'backward 1')
+   mytester:assertlt((gradInput[2]-gradOutput:narrow(2, 5, 2)):abs():max(), precision, 'backward 2')
+   -- an input already in place
+   local x = module.output:narrow(2, 1, 4)
+   x:fill(1)
+   mytester:asserteq(module:forward{x, y}:narrow(2, 1, 4):min(), 1, 'forward in place')
+end
+
 mytester:add(nntest)
 
 if not nn then
@@ -2,6 +2,7 @@
 #define TH_INC
 
 #include "THGeneral.h"
+#include "THAllocator.h"
 
 #include "THBlas.h"
 #ifdef USE_LAPACK
@@ -15,6 +16,7 @@
 #include "THTensor.h"
 #include "THTensorApply.h"
 #include "THTensorDimApply.h"
+#include "THTensorParallelApply.h"
 
 #include "THFile.h"
 #include "THDiskFile.h"
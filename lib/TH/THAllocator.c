@@ -0,0 +1,605 @@
+#include "THAllocator.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#define TH_ALLOCATOR_THREAD_CACHE
+#endif
+
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+/* ----------------------------------------------------------------------- */
+/* THAlloc/THRealloc/THFree                                                 */
+/* ----------------------------------------------------------------------- */
+
+/* 16 bytes, so the returned pointers keep the alignment of the allocator */
+typedef union THAllocHeader
+{
+  struct
+  {
+    THAllocator *allocator;
+    long size;
+  } h;
+  char pad[16];
+} THAllocHeader;
+
+static THAllocator *THAllocator_current = &THCachingAllocator;
+static volatile long THAllocator_allocated = 0;
+static volatile long THAllocator_peak = 0;
+
+static void THAllocator_count(long size)
+{
+  long allocated = THAtomicAddLong(&THAllocator_allocated, size) + size;
+  long peak;
+
+  if(size <= 0)
+    return;
+
+  do
+  {
+    peak = THAllocator_peak;
+  } while(allocated > peak && !THAtomicCASLong(&THAllocator_peak, peak, allocated));
+}
+
+void* THAlloc(long size)
+{
+  THAllocator *allocator = THAllocator_current;
+  THAllocHeader *header;
+
+  if(size < 0 || size > LONG_MAX - (long)sizeof(THAllocHeader))
+    THError("$ Torch: invalid memory size -- maybe an overflow?");
+
+  if(size == 0)
+    return NULL;
+
+  header = allocator->malloc(allocator->ctx, size + sizeof(THAllocHeader));
+  if(!header)
+    THError("$ Torch: not enough memory: you tried to allocate %ldGB. Buy new RAM!", size/1073741824);
+
+  header->h.allocator = allocator;
+  header->h.size = size;
+  THAllocator_count(size);
+
+  return header+1;
+}
+
+void* THRealloc(void *ptr, long size)
+{
+  THAllocHeader *header, *newHeader;
+  THAllocator *allocator;
+  long oldSize;
+
+  if(!ptr)
+    return(THAlloc(size));
+
+  if(size == 0)
+  {
+    THFree(ptr);
+    return NULL;
+  }
+
+  if(size < 0 || size > LONG_MAX - (long)sizeof(THAllocHeader))
+    THError("$ Torch: invalid memory size -- maybe an overflow?");
+
+  header = ((THAllocHeader*)ptr)-1;
+  allocator = header->h.allocator;
+  oldSize = header->h.size;
+
+  if(allocator->realloc)
+    newHeader = allocator->realloc(allocator->ctx, header, oldSize + sizeof(THAllocHeader), size + sizeof(THAllocHeader));
+  else
+  {
+    newHeader = allocator->malloc(allocator->ctx, size + sizeof(THAllocHeader));
+    if(newHeader)
+    {
+      memcpy(newHeader, header, THMin(oldSize, size) + sizeof(THAllocHeader));
+      allocator->free(allocator->ctx, header, oldSize + sizeof(THAllocHeader));
+    }
+  }
+
+  if(!newHeader)
+    THError("$ Torch: not enough memory: you tried to reallocate %ldGB. Buy new RAM!", size/1073741824);
+
+  newHeader->h.size = size;
+  THAllocator_count(size - oldSize);
+
+  return newHeader+1;
+}
+
+void THFree(void *ptr)
+{
+  THAllocHeader *header;
+  THAllocator *allocator;
+
+  if(!ptr)
+    return;
+
+  header = ((THAllocHeader*)ptr)-1;
+  allocator = header->h.allocator;
+  THAllocator_count(-header->h.size);
+  allocator->free(allocator->ctx, header, header->h.size + sizeof(THAllocHeader));
+}
+
+void THAllocator_set(THAllocator *allocator)
+{
+  THAllocator_current = (allocator ? allocator : &THCachingAllocator);
+}
+
+THAllocator* THAllocator_get(void)
+{
+  return THAllocator_current;
+}
+
+void THAllocator_emptyCache(void)
+{
+  if(THAllocator_current->emptyCache)
+    THAllocator_current->emptyCache(THAllocator_current->ctx);
+}
+
+void THAllocator_getStats(THAllocatorStats *stats)
+{
+  stats->allocated = THAllocator_allocated;
+  stats->peak = THAllocator_peak;
+  stats->cached = (THAllocator_current->cached ? THAllocator_current->cached(THAllocator_current->ctx) : 0);
+}
+
+void THAllocator_resetPeak(void)
+{
+  THAllocator_peak = THAllocator_allocated;
+}
+
+/* ----------------------------------------------------------------------- */
+/* System allocator                                                         */
+/* ----------------------------------------------------------------------- */
+
+static void* THSystemAllocator_malloc(void *ctx, long size)
+{
+  return malloc(size);
+}
+
+static void* THSystemAllocator_realloc(void *ctx, void *ptr, long oldSize, long size)
+{
+  return realloc(ptr, size);
+}
+
+static void THSystemAllocator_free(void *ctx, void *ptr, long size)
+{
+  free(ptr);
+}
+
+THAllocator THSystemAllocator = {
+  "system",
+  THSystemAllocator_malloc,
+  THSystemAllocator_realloc,
+  THSystemAllocator_free,
+  NULL,
+  NULL,
+  NULL
+};
+
+/* ----------------------------------------------------------------------- */
+/* Caching allocator                                                        */
+/* ----------------------------------------------------------------------- */
+
+/* Size classes: multiples of 16 bytes up to 128 bytes, then 4 classes per
+   power of 2 (at most 25% of waste), up to MAX_CLASS_SIZE. Larger blocks are
+   not cached. */
+#define THCaching_NCLASS 92
+#define THCaching_MAX_CLASS_SIZE (1L << 28)
+
+/* blocks of at least that many bytes are mapped directly */
+#define THCaching_MAP_MIN (1L << 21)
+#define THCaching_HUGE_PAGE_SIZE (1L << 21)
+
+/* thread caches keep classes up to 32KB, at most 1MB per thread */
+#define THCaching_NTHREADCLASS 40
+#define THCaching_THREAD_MAX_BYTES (1L << 20)
+
+typedef struct THCachingBlock
+{
+  struct THCachingBlock *next;
+} THCachingBlock;
+
+static THCachingBlock *THCaching_bins[THCaching_NCLASS];
+static long THCaching_globalBytes = 0;  /* in THCaching_bins, under the lock */
+static long THCaching_maxCached = 1L << 30;
+static int THCaching_hugePages = 0;
+
+#ifdef _WIN32
+static SRWLOCK THCaching_lock = SRWLOCK_INIT;
+#define THCaching_LOCK() AcquireSRWLockExclusive(&THCaching_lock)
+#define THCaching_UNLOCK() ReleaseSRWLockExclusive(&THCaching_lock)
+#else
+static pthread_mutex_t THCaching_lock = PTHREAD_MUTEX_INITIALIZER;
+#define THCaching_LOCK() pthread_mutex_lock(&THCaching_lock)
+#define THCaching_UNLOCK() pthread_mutex_unlock(&THCaching_lock)
+#endif
+
+/* size actually allocated for a request of the given size, and its class
+   (-1 if not cached) */
+static long THCaching_blockSize(long size, int *cls)
+{
+  long step, blockSize;
+  int p;
+
+  if(size <= 128)
+  {
+    *cls = (int)((size+15)/16) - 1;
+    return ((size+15)/16)*16;
+  }
+
+  if(size > THCaching_MAX_CLASS_SIZE)
+  {
+    *cls = -1;
+    return size;
+  }
+
+  /* 2^p < size <= 2^(p+1) */
+  for(p = 7; (1L << (p+1)) < size; p++);
+  step = 1L << (p-2);
+  blockSize = ((size+step-1)/step)*step;
+  *cls = 8 + (p-7)*4 + (int)(blockSize/step) - 5;
+  return blockSize;
+}
+
+/* size of the blocks of a class */
+static long THCaching_classSize(int cls)
+{
+  if(cls < 8)
+    return (cls+1)*16;
+  return (1L << (5+(cls-8)/4))*((cls-8)%4 + 5);
+}
+
+#ifdef HAVE_MMAP
+/* mapped blocks cover whole pages; the size of uncached blocks is not
+   rounded by THCaching_blockSize */
+static long THCaching_mapSize(long size)
+{
+  static long pageSize = 0;
+  if(pageSize == 0)
+    pageSize = sysconf(_SC_PAGESIZE);
+  return ((size+pageSize-1)/pageSize)*pageSize;
+}
+#endif
+
+static void* THCaching_systemAlloc(long size)
+{
+#ifdef HAVE_MMAP
+  if(size >= THCaching_MAP_MIN)
+  {
+    char *ptr;
+
+    size = THCaching_mapSize(size);
+    if(!THCaching_hugePages)
+    {
+      ptr = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+      return (ptr == MAP_FAILED ? NULL : ptr);
+    }
+    else
+    {
+      /* align on a huge page boundary, and trim the rest */
+      long mapSize = size + THCaching_HUGE_PAGE_SIZE;
+      long head;
+      char *map = mmap(NULL, mapSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+      if(map == MAP_FAILED)
+        return NULL;
+      ptr = (char*)((((size_t)map) + THCaching_HUGE_PAGE_SIZE - 1) & ~((size_t)THCaching_HUGE_PAGE_SIZE - 1));
+      head = ptr - map;
+      if((head > 0 && munmap(map, head) != 0) ||
+         munmap(ptr + size, mapSize - head - size) != 0)
+      {
+        munmap(map, mapSize);
+        return NULL;
+      }
+#ifdef MADV_HUGEPAGE
+      madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+      return ptr;
+    }
+  }
+#endif
+  return malloc(size);
+}
+
+static void THCaching_systemFree(void *ptr, long size)
+{
+#ifdef HAVE_MMAP
+  if(size >= THCaching_MAP_MIN)
+  {
+    if(munmap(ptr, THCaching_mapSize(size)) != 0)
+      THError("$ Torch: unable to unmap memory: %s", strerror(errno));
+    return;
+  }
+#endif
+  free(ptr);
+}
+
+/* puts a block in the global cache, or gives it back to the system if full */
+static void THCaching_release(THCachingBlock *block, int cls, long blockSize)
+{
+  int cached = 0;
+
+  THCaching_LOCK();
+  if(THCaching_globalBytes + blockSize <= THCaching_maxCached)
+  {
+    block->next = THCaching_bins[cls];
+    THCaching_bins[cls] = block;
+    THCaching_globalBytes += blockSize;
+    cached = 1;
+  }
+  THCaching_UNLOCK();
+
+  if(!cached)
+    THCaching_systemFree(block, blockSize);
+}
+
+#ifdef TH_ALLOCATOR_THREAD_CACHE
+
+typedef struct THCachingThreadCache
+{
+  THCachingBlock *bins[THCaching_NTHREADCLASS];
+  long bytes;
+  int state; /* 0: not registered yet, 1: active, 2: thread exiting */
+  struct THCachingThreadCache *prev, *next;
+} THCachingThreadCache;
+
+static __thread THCachingThreadCache THCaching_threadCache;
+static THCachingThreadCache *THCaching_threadCaches = NULL; /* active ones, under the lock */
+static pthread_key_t THCaching_threadKey;
+static pthread_once_t THCaching_threadKeyOnce = PTHREAD_ONCE_INIT;
+
+/* moves the blocks of a thread cache to the global cache (or to the system) */
+static void THCaching_flushThreadCache(THCachingThreadCache *tc, int toSystem)
+{
+  int cls;
+  for(cls = 0; cls < THCaching_NTHREADCLASS; cls++)
+  {
+    while(tc->bins[cls])
+    {
+      THCachingBlock *block = tc->bins[cls];
+      long blockSize = THCaching_classSize(cls);
+
+      tc->bins[cls] = block->next;
+      tc->bytes -= blockSize;
+      if(toSystem)
+        THCaching_systemFree(block, blockSize);
+      else
+        THCaching_release(block, cls, blockSize);
+    }
+  }
+}
+
+static void THCaching_threadExit(void *tc_)
+{
+  THCachingThreadCache *tc = tc_;
+
+  THCaching_LOCK();
+  if(tc->prev)
+    tc->prev->next = tc->next;
+  else
+    THCaching_threadCaches = tc->next;
+  if(tc->next)
+    tc->next->prev = tc->prev;
+  THCaching_UNLOCK();
+
+  tc->state = 2;
+  THCaching_flushThreadCache(tc, 0);
+}
+
+static void THCaching_createThreadKey(void)
+{
+  pthread_key_create(&THCaching_threadKey, THCaching_threadExit);
+}
+
+#endif
+
+static void* THCaching_malloc(void *ctx, long size)
+{
+  THCachingBlock *block;
+  int cls;
+  long blockSize = THCaching_blockSize(size, &cls);
+
+  if(cls < 0)
+    return THCaching_systemAlloc(blockSize);
+
+#ifdef TH_ALLOCATOR_THREAD_CACHE
+  if(cls < THCaching_NTHREADCLASS)
+  {
+    THCachingThreadCache *tc = &THCaching_threadCache;
+    block = tc->bins[cls];
+    if(block)
+    {
+      tc->bins[cls] = block->next;
+      tc->bytes -= blockSize;
+      return block;
+    }
+  }
+#endif
+
+  THCaching_LOCK();
+  block = THCaching_bins[cls];
+  if(block)
+  {
+    THCaching_bins[cls] = block->next;
+    THCaching_globalBytes -= blockSize;
+  }
+  THCaching_UNLOCK();
+
+  if(block)
+    return block;
+
+  block = THCaching_systemAlloc(blockSize);
+  if(!block)
+  {
+    /* the cache might be holding the memory we need */
+    THCachingAllocator.emptyCache(ctx);
+    block = THCaching_systemAlloc(blockSize);
+  }
+  return block;
+}
+
+static void THCaching_free(void *ctx, void *ptr, long size)
+{
+  THCachingBlock *block = ptr;
+  int cls;
+  long blockSize = THCaching_blockSize(size, &cls);
+
+  if(cls < 0)
+  {
+    THCaching_systemFree(ptr, blockSize);
+    return;
+  }
+
+#ifdef TH_ALLOCATOR_THREAD_CACHE
+  if(cls < THCaching_NTHREADCLASS && THCaching_maxCached > 0)
+  {
+    THCachingThreadCache *tc = &THCaching_threadCache;
+
+    if(tc->state == 0)
+    {
+      /* flush the cache when the thread exits */
+      pthread_once(&THCaching_threadKeyOnce, THCaching_createThreadKey);
+      pthread_setspecific(THCaching_threadKey, tc);
+      THCaching_LOCK();
+      tc->next = THCaching_threadCaches;
+      if(tc->next)
+        tc->next->prev = tc;
+      THCaching_threadCaches = tc;
+      THCaching_UNLOCK();
+      tc->state = 1;
+    }
+
+    if(tc->state == 1 && tc->bytes + blockSize <= THCaching_THREAD_MAX_BYTES)
+    {
+      block->next = tc->bins[cls];
+      tc->bins[cls] = block;
+      tc->bytes += blockSize;
+      return;
+    }
+  }
+#endif
+
+  THCaching_release(block, cls, blockSize);
+}
+
+static void* THCaching_realloc(void *ctx, void *ptr, long oldSize, long size)
+{
+  int oldCls, cls;
+  long oldBlockSize = THCaching_blockSize(oldSize, &oldCls);
+  long blockSize = THCaching_blockSize(size, &cls);
+  void *newPtr;
+
+  /* the block is already big enough */
+  if(cls >= 0 && blockSize == oldBlockSize)
+    return ptr;
+
+  newPtr = THCaching_malloc(ctx, size);
+  if(!newPtr)
+    return NULL;
+  memcpy(newPtr, ptr, THMin(oldSize, size));
+  THCaching_free(ctx, ptr, oldSize);
+  return newPtr;
+}
+
+static long THCaching_cached(void *ctx)
+{
+  long bytes;
+
+  THCaching_LOCK();
+  bytes = THCaching_globalBytes;
+#ifdef TH_ALLOCATOR_THREAD_CACHE
+  {
+    /* the other threads might be updating their counters: approximate */
+    THCachingThreadCache *tc;
+    for(tc = THCaching_threadCaches; tc; tc = tc->next)
+      bytes += tc->bytes;
+  }
+#endif
+  THCaching_UNLOCK();
+
+  return bytes;
+}
+
+/* empties the global cache and the one of the calling thread (the caches of
+   other threads are emptied when they exit) */
+static void THCaching_emptyCache(void *ctx)
+{
+  THCachingBlock *bins[THCaching_NCLASS];
+  int cls;
+
+#ifdef TH_ALLOCATOR_THREAD_CACHE
+  THCaching_flushThreadCache(&THCaching_threadCache, 1);
+#endif
+
+  THCaching_LOCK();
+  for(cls = 0; cls < THCaching_NCLASS; cls++)
+  {
+    bins[cls] = THCaching_bins[cls];
+    THCaching_bins[cls] = NULL;
+  }
+  THCaching_globalBytes = 0;
+  THCaching_UNLOCK();
+
+  for(cls = 0; cls < THCaching_NCLASS; cls++)
+  {
+    while(bins[cls])
+    {
+      THCachingBlock *block = bins[cls];
+      long blockSize = THCaching_classSize(cls);
+      bins[cls] = block->next;
+      THCaching_systemFree(block, blockSize);
+    }
+  }
+}
+
+THAllocator THCachingAllocator = {
+  "caching",
+  THCaching_malloc,
+  THCaching_realloc,
+  THCaching_free,
+  THCaching_cached,
+  THCaching_emptyCache,
+  NULL
+};
+
+void THCachingAllocator_setMaxCached(long bytes)
+{
+  int overflow;
+
+  THCaching_LOCK();
+  THCaching_maxCached = (bytes < 0 ? 0 : bytes);
+  overflow = (THCaching_globalBytes > THCaching_maxCached);
+  THCaching_UNLOCK();
+
+  if(overflow)
+    THCaching_emptyCache(NULL);
+}
+
+long THCachingAllocator_getMaxCached(void)
+{
+  long bytes;
+
+  THCaching_LOCK();
+  bytes = THCaching_maxCached;
+  THCaching_UNLOCK();
+  return bytes;
+}
+
+void THCachingAllocator_setHugePages(int enabled)
+{
+  THCaching_hugePages = (enabled != 0);
+}
+
+int THCachingAllocator_getHugePages(void)
+{
+  return THCaching_hugePages;
+}
@@ -0,0 +1,57 @@
+#ifndef TH_ALLOCATOR_INC
+#define TH_ALLOCATOR_INC
+
+#include "THGeneral.h"
+
+/*
+   Memory allocator behind THAlloc/THRealloc/THFree.
+
+   THAlloc keeps the size of each block and the allocator which returned it
+   in a small header, so blocks are always given back to the allocator which
+   allocated them, even if the current allocator has changed since.
+   Consequently, memory obtained with THAlloc must be freed with THFree (and
+   not free()), and vice versa.
+
+   An allocator is given sizes which include this header. realloc, cached and
+   emptyCache may be NULL.
+*/
+
+typedef struct THAllocator
+{
+  const char *name;
+  void* (*malloc)(void *ctx, long size);
+  void* (*realloc)(void *ctx, void *ptr, long oldSize, long size);
+  void (*free)(void *ctx, void *ptr, long size);
+  long (*cached)(void *ctx);      /* bytes kept for reuse */
+  void (*emptyCache)(void *ctx);  /* give cached memory back to the system */
+  void *ctx;
+} THAllocator;
+
+typedef struct THAllocatorStats
+{
+  long allocated; /* bytes currently allocated with THAlloc */
+  long peak;      /* maximum of allocated since the last reset */
+  long cached;    /* bytes cached by the current allocator */
+} THAllocatorStats;
+
+/* plain malloc/realloc/free */
+TH_API THAllocator THSystemAllocator;
+
+/* Size-class caching allocator (the default). Freed blocks are kept in
+   per-size bins, first in a small cache local to the freeing thread, then in
+   a global cache, up to a maximum number of cached bytes. Large blocks are
+   mapped directly, optionally backed by transparent huge pages. */
+TH_API THAllocator THCachingAllocator;
+TH_API void THCachingAllocator_setMaxCached(long bytes);
+TH_API long THCachingAllocator_getMaxCached(void);
+TH_API void THCachingAllocator_setHugePages(int enabled);
+TH_API int THCachingAllocator_getHugePages(void);
+
+/* NULL selects the default allocator */
+TH_API void THAllocator_set(THAllocator *allocator);
+TH_API THAllocator* THAllocator_get(void);
+TH_API void THAllocator_emptyCache(void);
+TH_API void THAllocator_getStats(THAllocatorStats *stats);
+TH_API void THAllocator_resetPeak(void);
+
+#endif
@@ -1,4 +1,50 @@
 #include "THBlas.h"
+#include "THVector.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef USE_BLAS
+static int THBlas_gemmMode = TH_GEMM_BLAS;
+#else
+static int THBlas_gemmMode = TH_GEMM_BUILTIN;
+#endif
+
+void THBlas_setGemmMode(int mode)
+{
+  THArgCheck(mode >= TH_GEMM_BLAS && mode <= TH_GEMM_REFERENCE, 1, "unknown gemm mode");
+#ifndef USE_BLAS
+  if(mode == TH_GEMM_BLAS)
+    mode = TH_GEMM_BUILTIN;
+#endif
+  THBlas_gemmMode = mode;
+}
+
+int THBlas_getGemmMode(void)
+{
+  return THBlas_gemmMode;
+}
+
+/* Blocking of the built-in gemm. A KC x NC block of op(B) is packed in
+   panels of NR columns, meant to stay in the L3 cache, and each MC x KC
+   block of op(A) in panels of MR rows (given by the micro-kernel, at most
+   MR_MAX), meant to stay in the L2 cache. */
+#define THBlas_GEMM_KC 256
+#define THBlas_GEMM_MC 128
+#define THBlas_GEMM_NC 2040
+#define THBlas_GEMM_NR TH_VECTOR_GEMM_NR
+#define THBlas_GEMM_MR_MAX 32
+
+/* below this number of multiply-adds, the reference loop is faster */
+#define THBlas_GEMM_MIN_BUILTIN 4096
+
+/* below this number of multiply-adds, gemm runs on a single thread */
+#define THBlas_GEMM_MIN_PARALLEL 262144
+
+/* below this total number of multiply-adds, gemmBatched runs on a single
+   thread */
+#define THBlas_GEMM_MIN_BATCH_PARALLEL 32768
 
 #include "generic/THBlas.c"
 #include "THGenerateAllTypes.h"
@@ -5,6 +5,15 @@
 
 #define THBlas_(NAME) TH_CONCAT_4(TH,Real,Blas_,NAME)
 
+/* gemm implementations: external BLAS (when available), built-in blocked
+   gemm, or reference triple loop */
+#define TH_GEMM_BLAS      0
+#define TH_GEMM_BUILTIN   1
+#define TH_GEMM_REFERENCE 2
+
+TH_API void THBlas_setGemmMode(int mode);
+TH_API int THBlas_getGemmMode(void);
+
 #include "generic/THBlas.h"
 #include "THGenerateAllTypes.h"
 
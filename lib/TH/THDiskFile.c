@@ -9,6 +9,7 @@ typedef struct THDiskFile__
     FILE *handle;
     char *name;
     int isNativeEncoding;
+    int isMmap;
 
 } THDiskFile;
 
@@ -267,6 +268,27 @@ static void THDiskFile_free(THFile *self)
   THFree(dfself);
 }
 
+void THDiskFile_mmap(THFile *self)
+{
+  THDiskFile *dfself = (THDiskFile*)(self);
+  THArgCheck(dfself->handle != NULL, 1, "attempt to use a closed file");
+  THArgCheck(dfself->file.vtable->free == THDiskFile_free, 1, "pipes cannot be mapped");
+  dfself->isMmap = 1;
+}
+
+void THDiskFile_noMmap(THFile *self)
+{
+  THDiskFile *dfself = (THDiskFile*)(self);
+  THArgCheck(dfself->handle != NULL, 1, "attempt to use a closed file");
+  dfself->isMmap = 0;
+}
+
+int THDiskFile_isMmap(THFile *self)
+{
+  THDiskFile *dfself = (THDiskFile*)(self);
+  return dfself->isMmap && dfself->file.isBinary && dfself->isNativeEncoding && !dfself->file.isWritable;
+}
+
 /* READ_WRITE_METHODS(int, Bool, */
 /*                    int value = 0; int ret = fscanf(file->handle, "%d", &value); array[i] = (value ? 1 : 0); if(ret <= 0) break; else result++, */
 /*                    int value = (array[i] ? 1 : 0); nElemWritten = fprintf(file->handle, "%d", value), */
@@ -478,6 +500,7 @@ THFile *THDiskFile_new(const char *name, const char *mode, int isQuiet)
   self->name = THAlloc(strlen(name)+1);
   strcpy(self->name, name);
   self->isNativeEncoding = 1;
+  self->isMmap = 0;
 
   self->file.vtable = &vtable;
   self->file.isQuiet = isQuiet;
@@ -579,6 +602,7 @@ THFile *THPipeFile_new(const char *name, const char *mode, int isQuiet)
   self->name = THAlloc(strlen(name)+1);
   strcpy(self->name, name);
   self->isNativeEncoding = 1;
+  self->isMmap = 0;
 
   self->file.vtable = &vtable;
   self->file.isQuiet = isQuiet;
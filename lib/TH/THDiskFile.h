@@ -14,4 +14,11 @@ void THDiskFile_nativeEndianEncoding(THFile *self);
 void THDiskFile_littleEndianEncoding(THFile *self);
 void THDiskFile_bigEndianEncoding(THFile *self);
 
+/* Storages read from a mapped file point directly into a (private) mapping
+   of the file, instead of being copied. Only binary, native-endian,
+   read-only files are actually mapped. */
+void THDiskFile_mmap(THFile *self);
+void THDiskFile_noMmap(THFile *self);
+int THDiskFile_isMmap(THFile *self);
+
 #endif
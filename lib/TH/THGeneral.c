@@ -1,5 +1,9 @@
 #include "THGeneral.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 /* Torch Error Handling */
 static void defaultTorchErrorHandlerFunction(const char *msg)
 {
@@ -57,46 +61,35 @@ void THSetArgErrorHandler( void (*torchArgErrorHandlerFunction_)(int argNumber,
     torchArgErrorHandlerFunction = defaultTorchArgErrorHandlerFunction;
 }
 
-void* THAlloc(long size)
+/* Torch Threads */
+void THSetNumThreads(int num_threads)
 {
-  void *ptr;
-
-  if(size < 0)
-    THError("$ Torch: invalid memory size -- maybe an overflow?");
-
-  if(size == 0)
-    return NULL;
-
-  ptr = malloc(size);
-  if(!ptr)
-    THError("$ Torch: not enough memory: you tried to allocate %dGB. Buy new RAM!", size/1073741824);
+#ifdef _OPENMP
+  if(num_threads > 0)
+    omp_set_num_threads(num_threads);
+#endif
+}
 
-  return ptr;
+int THGetNumThreads(void)
+{
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
 }
 
-void* THRealloc(void *ptr, long size)
+/* below this number of elements, elementwise operations stay serial */
+static long torchParallelThreshold = 100000;
+
+void THSetParallelThreshold(long threshold)
 {
-  if(!ptr)
-    return(THAlloc(size));
-  
-  if(size == 0)
-  {
-    THFree(ptr);
-    return NULL;
-  }
-
-  if(size < 0)
-    THError("$ Torch: invalid memory size -- maybe an overflow?");
-
-  ptr = realloc(ptr, size);
-  if(!ptr)
-    THError("$ Torch: not enough memory: you tried to reallocate %dGB. Buy new RAM!", size/1073741824);
-  return ptr;
+  torchParallelThreshold = (threshold < 1 ? 1 : threshold);
 }
 
-void THFree(void *ptr)
+long THGetParallelThreshold(void)
 {
-  free(ptr);
+  return torchParallelThreshold;
 }
 
 #ifdef _MSC_VER
@@ -1,28 +1,39 @@
 #include "THGeneral.h"
 #include "THRandom.h"
 
-/* The initial seed. */
-static unsigned long the_initial_seed;
-
 /* Code for the Mersenne Twister random generator.... */
-#define n 624
+#define n TH_GENERATOR_MT_N
 #define m 397
-static int left = 1;
-static int initf = 0;
-static unsigned long *next;
-static unsigned long state[n]; /* the array for the state vector  */
-/********************************/
-
-/* For normal distribution */
-static double normal_x;
-static double normal_y;
-static double normal_rho;
-static int normal_is_valid = 0;
 
-unsigned long THRandom_seed()
+/* The generator used by the THRandom_* functions. */
+static THGenerator default_generator = {TH_GENERATOR_MT, 0, 0, 1};
+
+THGenerator* THGenerator_new(int type)
+{
+  THGenerator *gen;
+  THArgCheck(type == TH_GENERATOR_MT || type == TH_GENERATOR_PHILOX, 1, "unknown generator type");
+  gen = THAlloc(sizeof(THGenerator));
+  memset(gen, 0, sizeof(THGenerator));
+  gen->type = type;
+  gen->left = 1;
+  return gen;
+}
+
+void THGenerator_free(THGenerator *gen)
+{
+  if(gen && gen != &default_generator)
+    THFree(gen);
+}
+
+THGenerator* THGenerator_default(void)
+{
+  return &default_generator;
+}
+
+unsigned long THGenerator_seed(THGenerator *gen)
 {
   unsigned long s = (unsigned long)time(0);
-  THRandom_manualSeed(s);
+  THGenerator_manualSeed(gen, s);
   return s;
 }
 
@@ -77,8 +88,6 @@ unsigned long THRandom_seed()
 
 /* Macros for the Mersenne Twister random generator... */
 /* Period parameters */  
-/* #define n 624 */
-/* #define m 397 */
 #define MATRIX_A 0x9908b0dfUL   /* constant vector a */
 #define UMASK 0x80000000UL /* most significant w-r bits */
 #define LMASK 0x7fffffffUL /* least significant r bits */
@@ -86,46 +95,52 @@ unsigned long THRandom_seed()
 #define TWIST(u,v) ((MIXBITS(u,v) >> 1) ^ ((v)&1UL ? MATRIX_A : 0UL))
 /*********************************************************** That's it. */
 
-void THRandom_manualSeed(unsigned long the_seed_)
+void THGenerator_manualSeed(THGenerator *gen, unsigned long the_seed_)
 {
-  int j;
-  the_initial_seed = the_seed_;
-  state[0]= the_initial_seed & 0xffffffffUL;
-  for(j = 1; j < n; j++)
+  gen->the_initial_seed = the_seed_;
+  gen->initf = 1;
+
+  if(gen->type == TH_GENERATOR_PHILOX)
   {
-    state[j] = (1812433253UL * (state[j-1] ^ (state[j-1] >> 30)) + j); 
-    /* See Knuth TAOCP Vol2. 3rd Ed. P.106 for multiplier. */
-    /* In the previous versions, mSBs of the seed affect   */
-    /* only mSBs of the array state[].                        */
-    /* 2002/01/09 modified by makoto matsumoto             */
-    state[j] &= 0xffffffffUL;  /* for >32 bit machines */
+    gen->offset = 0;
+    THPhilox_init(&gen->philox, the_seed_);
+  }
+  else
+  {
+    unsigned long *state = gen->state;
+    int j;
+    state[0]= the_seed_ & 0xffffffffUL;
+    for(j = 1; j < n; j++)
+    {
+      state[j] = (1812433253UL * (state[j-1] ^ (state[j-1] >> 30)) + j); 
+      /* See Knuth TAOCP Vol2. 3rd Ed. P.106 for multiplier. */
+      /* In the previous versions, mSBs of the seed affect   */
+      /* only mSBs of the array state[].                        */
+      /* 2002/01/09 modified by makoto matsumoto             */
+      state[j] &= 0xffffffffUL;  /* for >32 bit machines */
+    }
+    gen->left = 1;
   }
-  left = 1;
-  initf = 1;
 }
 
-unsigned long THRandom_initialSeed()
+unsigned long THGenerator_initialSeed(THGenerator *gen)
 {
-  if(initf == 0)
+  if(gen->initf == 0)
   {
-    THRandom_seed();
+    THGenerator_seed(gen);
   }
 
-  return the_initial_seed;
+  return gen->the_initial_seed;
 }
 
-void THRandom_nextState()
+static void THGenerator_nextState(THGenerator *gen)
 {
-  unsigned long *p=state;
+  unsigned long *state = gen->state;
+  unsigned long *p = state;
   int j;
 
-  /* if init_genrand() has not been called, */
-  /* a default initial seed is used         */
-  if(initf == 0)
-    THRandom_seed();
-
-  left = n;
-  next = state;
+  gen->left = n;
+  gen->next = 0;
     
   for(j = n-m+1; --j; p++) 
     *p = p[m] ^ TWIST(p[0], p[1]);
@@ -136,39 +151,59 @@ void THRandom_nextState()
   *p = p[m-n] ^ TWIST(p[0], state[0]);
 }
 
-unsigned long THRandom_random()
+unsigned long long THGenerator_reserve(THGenerator *gen, unsigned long long count)
 {
-  unsigned long y;
+  unsigned long long pos;
 
-  if (--left == 0)
-    THRandom_nextState();
-  y = *next++;
-  
-  /* Tempering */
-  y ^= (y >> 11);
-  y ^= (y << 7) & 0x9d2c5680UL;
-  y ^= (y << 15) & 0xefc60000UL;
+  THArgCheck(gen->type == TH_GENERATOR_PHILOX, 1, "only Philox generators can be split by offset");
+
+  /* if init_genrand() has not been called, */
+  /* a default initial seed is used         */
+  if(gen->initf == 0)
+    THGenerator_seed(gen);
+
+  pos = gen->offset;
+  gen->offset += count;
+  return pos;
+}
+
+/* Tempering */
+#define TEMPER(y) \
+  y ^= (y >> 11); \
+  y ^= (y << 7) & 0x9d2c5680UL; \
+  y ^= (y << 15) & 0xefc60000UL; \
   y ^= (y >> 18);
 
+/* next number of a (seeded) Mersenne Twister */
+static inline unsigned long THGenerator_nextMT(THGenerator *gen)
+{
+  unsigned long y;
+
+  if (--gen->left == 0)
+    THGenerator_nextState(gen);
+  y = gen->state[gen->next++];
+  TEMPER(y)
+
   return y;
 }
 
-/* generates a random number on [0,1)-double-interval */
-static double __uniform__()
+unsigned long THGenerator_random(THGenerator *gen)
 {
-  unsigned long y;
+  if(gen->type == TH_GENERATOR_PHILOX)
+    return THPhilox_get(&gen->philox, THGenerator_reserve(gen, 1));
+
+  /* if init_genrand() has not been called, */
+  /* a default initial seed is used         */
+  if(gen->initf == 0)
+    THGenerator_seed(gen);
 
-  if(--left == 0)
-    THRandom_nextState();
-  y = *next++;
+  return THGenerator_nextMT(gen);
+}
 
-  /* Tempering */
-  y ^= (y >> 11);
-  y ^= (y << 7) & 0x9d2c5680UL;
-  y ^= (y << 15) & 0xefc60000UL;
-  y ^= (y >> 18);
-  
-  return (double)y * (1.0/4294967296.0); 
+/* generates a random number on [0,1)-double-interval */
+static double __uniform__(THGenerator *gen)
+{
+  return (double)THGenerator_random(gen) * (1.0/4294967296.0); 
   /* divided by 2^32 */
 }
 
@@ -180,59 +215,304 @@ static double __uniform__()
 
 *********************************************************/
 
-double THRandom_uniform(double a, double b)
+double THGenerator_uniform(THGenerator *gen, double a, double b)
 {
-  return(__uniform__() * (b - a) + a);
+  return(__uniform__(gen) * (b - a) + a);
 }
 
-double THRandom_normal(double mean, double stdv)
+double THGenerator_normal(THGenerator *gen, double mean, double stdv)
+{
+  double x;
+  unsigned long long pos;
+  THArgCheck(stdv > 0, 2, "standard deviation must be strictly positive");
+  pos = (gen->type == TH_GENERATOR_PHILOX ? THGenerator_reserve(gen, 1) : 0);
+  THGenerator_normalBlock(gen, pos, &x, 1, mean, stdv);
+  return x;
+}
+
+double THGenerator_exponential(THGenerator *gen, double lambda)
+{
+  return(-1. / lambda * log(1-__uniform__(gen)));
+}
+
+double THGenerator_cauchy(THGenerator *gen, double median, double sigma)
+{
+  return(median + sigma * tan(M_PI*(__uniform__(gen)-0.5)));
+}
+
+/* Faut etre malade pour utiliser ca.
+   M'enfin. */
+double THGenerator_logNormal(THGenerator *gen, double mean, double stdv)
 {
+  double zm = mean*mean;
+  double zs = stdv*stdv;
   THArgCheck(stdv > 0, 2, "standard deviation must be strictly positive");
+  return(exp(THGenerator_normal(gen, log(zm/sqrt(zs + zm)), sqrt(log(zs/zm+1)) )));
+}
+
+int THGenerator_geometric(THGenerator *gen, double p)
+{
+  THArgCheck(p > 0 && p < 1, 1, "must be > 0 and < 1");
+  return((int)(log(1-__uniform__(gen)) / log(p)) + 1);
+}
 
-  if(!normal_is_valid)
+int THGenerator_bernoulli(THGenerator *gen, double p)
+{
+  THArgCheck(p >= 0 && p <= 1, 1, "must be >= 0 and <= 1");
+  return(__uniform__(gen) <= p);
+}
+
+/* Bulk generation */
+
+void THGenerator_uniformBlock(THGenerator *gen, unsigned long long pos, double *buf, long size, double a, double b)
+{
+  if(gen->type == TH_GENERATOR_PHILOX)
   {
-    normal_x = __uniform__();
-    normal_y = __uniform__();
-    normal_rho = sqrt(-2. * log(1.0-normal_y));
-    normal_is_valid = 1;
+    unsigned int value[4];
+
+    while(size > 0)
+    {
+      long skip = (long)(pos & 3);
+      long k, len = THMin(size, 4-skip);
+
+      THPhilox_block(gen->philox.key, pos >> 2, 0, value);
+      for(k = 0; k < len; k++)
+        buf[k] = (double)value[skip+k] * (1.0/4294967296.0) * (b - a) + a;
+
+      buf += len;
+      pos += len;
+      size -= len;
+    }
   }
   else
-    normal_is_valid = 0;
-  
-  if(normal_is_valid)
-    return normal_rho*cos(2.*M_PI*normal_x)*stdv+mean;
+  {
+    if(gen->initf == 0)
+      THGenerator_seed(gen);
+
+    /* temper directly the numbers left in the state */
+    while(size > 0)
+    {
+      const unsigned long *state;
+      long k, len;
+
+      if(gen->left == 1)
+      {
+        THGenerator_nextState(gen);
+        gen->left++;
+      }
+
+      len = THMin(size, gen->left-1);
+      state = gen->state+gen->next;
+      for(k = 0; k < len; k++)
+      {
+        unsigned long y = state[k];
+        TEMPER(y)
+        buf[k] = (double)y * (1.0/4294967296.0) * (b - a) + a;
+      }
+
+      gen->next += len;
+      gen->left -= len;
+      buf += len;
+      size -= len;
+    }
+  }
+}
+
+/*
+   Normal numbers: ziggurat method, with the improvements of J. A. Doornik,
+   "An improved ziggurat method to generate normal random samples" (2005).
+
+   Most of the numbers cost two uniform numbers, a multiplication and a
+   comparison; only about 1.2% of them need an exponential or a logarithm.
+*/
+
+#define ZIGGURAT_C 128
+#define ZIGGURAT_R 3.442619855899
+#define ZIGGURAT_V 9.91256303526217e-3
+
+static double ziggurat_x[ZIGGURAT_C+1];
+static double ziggurat_ratio[ZIGGURAT_C];
+static volatile int ziggurat_initialized = 0;
+
+static void THRandom_zigguratInit(void)
+{
+  if(ziggurat_initialized)
+    return;
+
+#ifdef _OPENMP
+#pragma omp critical(THRandom_ziggurat)
+#endif
+  {
+    if(!ziggurat_initialized)
+    {
+      double f = exp(-0.5*ZIGGURAT_R*ZIGGURAT_R);
+      int i;
+
+      ziggurat_x[0] = ZIGGURAT_V/f;
+      ziggurat_x[1] = ZIGGURAT_R;
+      ziggurat_x[ZIGGURAT_C] = 0;
+      for(i = 2; i < ZIGGURAT_C; i++)
+      {
+        ziggurat_x[i] = sqrt(-2.*log(ZIGGURAT_V/ziggurat_x[i-1] + f));
+        f = exp(-0.5*ziggurat_x[i]*ziggurat_x[i]);
+      }
+      for(i = 0; i < ZIGGURAT_C; i++)
+        ziggurat_ratio[i] = ziggurat_x[i+1]/ziggurat_x[i];
+
+      ziggurat_initialized = 1;
+    }
+  }
+}
+
+/* The 32 bits numbers used by the ziggurat: the next ones of a Mersenne
+   Twister, or those of a Philox stream (one per result, starting at block
+   0). */
+typedef struct THRandomSource
+{
+  THGenerator *gen;
+  unsigned long long stream;
+  unsigned long long block;
+  unsigned int value[4];
+  int used;
+} THRandomSource;
+
+static inline double THRandomSource_uniform(THRandomSource *src)
+{
+  unsigned long y;
+
+  if(src->gen->type == TH_GENERATOR_PHILOX)
+  {
+    if(src->used == 4)
+    {
+      src->block++;
+      THPhilox_block(src->gen->philox.key, src->block, src->stream, src->value);
+      src->used = 0;
+    }
+    y = src->value[src->used++];
+  }
   else
-    return normal_rho*sin(2.*M_PI*normal_x)*stdv+mean;
+    y = THGenerator_nextMT(src->gen);
+
+  return (double)y * (1.0/4294967296.0);
+}
+
+static double THRandom_zigguratTail(THRandomSource *src, int negative)
+{
+  double x, y;
+  do
+  {
+    x = log(1.0-THRandomSource_uniform(src)) / ZIGGURAT_R;
+    y = log(1.0-THRandomSource_uniform(src));
+  } while(-2*y < x*x);
+  return (negative ? x-ZIGGURAT_R : ZIGGURAT_R-x);
+}
+
+static inline double THRandom_ziggurat(THRandomSource *src)
+{
+  for(;;)
+  {
+    double u = 2*THRandomSource_uniform(src)-1;
+    int i = (int)(THRandomSource_uniform(src) * ZIGGURAT_C);
+    double x, f0, f1;
+
+    if(fabs(u) < ziggurat_ratio[i])
+      return u*ziggurat_x[i];
+
+    if(i == 0)
+      return THRandom_zigguratTail(src, u < 0);
+
+    x = u*ziggurat_x[i];
+    f0 = exp(-0.5*(ziggurat_x[i]*ziggurat_x[i] - x*x));
+    f1 = exp(-0.5*(ziggurat_x[i+1]*ziggurat_x[i+1] - x*x));
+    if(f1 + THRandomSource_uniform(src)*(f0-f1) < 1.0)
+      return x;
+  }
+}
+
+void THGenerator_normalBlock(THGenerator *gen, unsigned long long pos, double *buf, long size, double mean, double stdv)
+{
+  THRandomSource src = {0};
+  long k;
+
+  THArgCheck(stdv > 0, 6, "standard deviation must be strictly positive");
+  THRandom_zigguratInit();
+  src.gen = gen;
+
+  if(gen->type == TH_GENERATOR_PHILOX)
+  {
+    /* the number at position p comes from stream p+1 */
+    for(k = 0; k < size; k++)
+    {
+      src.stream = pos+1+k;
+      src.block = 0;
+      src.used = 0;
+      THPhilox_block(gen->philox.key, 0, src.stream, src.value);
+      buf[k] = THRandom_ziggurat(&src)*stdv + mean;
+    }
+  }
+  else
+  {
+    if(gen->initf == 0)
+      THGenerator_seed(gen);
+
+    for(k = 0; k < size; k++)
+      buf[k] = THRandom_ziggurat(&src)*stdv + mean;
+  }
+}
+
+/* The THRandom_* functions use the default generator. */
+
+unsigned long THRandom_seed()
+{
+  return THGenerator_seed(&default_generator);
+}
+
+void THRandom_manualSeed(unsigned long the_seed_)
+{
+  THGenerator_manualSeed(&default_generator, the_seed_);
+}
+
+unsigned long THRandom_initialSeed()
+{
+  return THGenerator_initialSeed(&default_generator);
+}
+
+unsigned long THRandom_random()
+{
+  return THGenerator_random(&default_generator);
+}
+
+double THRandom_uniform(double a, double b)
+{
+  return THGenerator_uniform(&default_generator, a, b);
+}
+
+double THRandom_normal(double mean, double stdv)
+{
+  return THGenerator_normal(&default_generator, mean, stdv);
 }
 
 double THRandom_exponential(double lambda)
 {
-  return(-1. / lambda * log(1-__uniform__()));
+  return THGenerator_exponential(&default_generator, lambda);
 }
 
 double THRandom_cauchy(double median, double sigma)
 {
-  return(median + sigma * tan(M_PI*(__uniform__()-0.5)));
+  return THGenerator_cauchy(&default_generator, median, sigma);
 }
 
-/* Faut etre malade pour utiliser ca.
-   M'enfin. */
 double THRandom_logNormal(double mean, double stdv)
 {
-  double zm = mean*mean;
-  double zs = stdv*stdv;
-  THArgCheck(stdv > 0, 2, "standard deviation must be strictly positive");
-  return(exp(THRandom_normal(log(zm/sqrt(zs + zm)), sqrt(log(zs/zm+1)) )));
+  return THGenerator_logNormal(&default_generator, mean, stdv);
 }
 
 int THRandom_geometric(double p)
 {
-  THArgCheck(p > 0 && p < 1, 1, "must be > 0 and < 1");
-  return((int)(log(1-__uniform__()) / log(p)) + 1);
+  return THGenerator_geometric(&default_generator, p);
 }
 
 int THRandom_bernoulli(double p)
 {
-  THArgCheck(p >= 0 && p <= 1, 1, "must be >= 0 and <= 1");
-  return(__uniform__() <= p);
+  return THGenerator_bernoulli(&default_generator, p);
 }
@@ -3,6 +3,142 @@
 
 #include "THGeneral.h"
 
+/*
+   Random number generators.
+
+   A THGenerator holds the whole state of a generator, so that several
+   independent streams can be used at the same time (typically one per
+   thread, as a generator is not thread-safe). The THRandom_* functions below
+   use the default generator, which is a Mersenne Twister.
+
+   Two kinds of generators are available:
+   - TH_GENERATOR_MT: the Mersenne Twister MT19937, which is sequential.
+   - TH_GENERATOR_PHILOX: the counter-based Philox4x32-10. Its n-th number is
+     a function of the seed and of n only, so a stream can be split by offset
+     and consumed in parallel: see THGenerator_reserve().
+*/
+
+/* Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+   3", SC'11). A block of 4 numbers is computed from a 128 bits counter and
+   the 64 bits seed (the key). The low half of the counter is the block
+   number, the high half selects a stream: the numbers of a generator are
+   found in stream 0, and samplers which need a variable number of values per
+   result (as the normal one) use a stream per result.
+
+   A THPhilox computes the numbers of stream 0 at any position, and keeps the
+   last block: reading consecutive positions costs one block every 4
+   numbers. */
+typedef struct THPhilox
+{
+  unsigned int key[2];
+  unsigned long long block;
+  unsigned int value[4];
+} THPhilox;
+
+static inline void THPhilox_block(const unsigned int *key_, unsigned long long block, unsigned long long stream, unsigned int *value)
+{
+  unsigned int key[2];
+  unsigned int c0 = (unsigned int)block, c1 = (unsigned int)(block >> 32);
+  unsigned int c2 = (unsigned int)stream, c3 = (unsigned int)(stream >> 32);
+  int r;
+
+  key[0] = key_[0];
+  key[1] = key_[1];
+  for(r = 0; r < 10; r++)
+  {
+    unsigned long long p0 = (unsigned long long)0xD2511F53U * c0;
+    unsigned long long p1 = (unsigned long long)0xCD9E8D57U * c2;
+    c0 = (unsigned int)(p1 >> 32) ^ c1 ^ key[0];
+    c1 = (unsigned int)p1;
+    c2 = (unsigned int)(p0 >> 32) ^ c3 ^ key[1];
+    c3 = (unsigned int)p0;
+    key[0] += 0x9E3779B9U;
+    key[1] += 0xBB67AE85U;
+  }
+  value[0] = c0;
+  value[1] = c1;
+  value[2] = c2;
+  value[3] = c3;
+}
+
+static inline void THPhilox_init(THPhilox *philox, unsigned long seed)
+{
+  philox->key[0] = (unsigned int)(seed & 0xffffffffUL);
+  philox->key[1] = (unsigned int)(((unsigned long long)seed >> 32) & 0xffffffffUL);
+  philox->block = 0;
+  THPhilox_block(philox->key, 0, 0, philox->value);
+}
+
+/* Returns the 32 bits number at the given position of the stream. */
+static inline unsigned int THPhilox_get(THPhilox *philox, unsigned long long pos)
+{
+  if((pos >> 2) != philox->block)
+  {
+    philox->block = pos >> 2;
+    THPhilox_block(philox->key, philox->block, 0, philox->value);
+  }
+  return philox->value[pos & 3];
+}
+
+#define TH_GENERATOR_MT 0
+#define TH_GENERATOR_PHILOX 1
+
+#define TH_GENERATOR_MT_N 624
+
+typedef struct THGenerator
+{
+  int type;
+  unsigned long the_initial_seed;
+  int initf;
+
+  /* Mersenne Twister */
+  int left;
+  int next;
+  unsigned long state[TH_GENERATOR_MT_N];
+
+  /* Philox: number of 32 bits values already used */
+  unsigned long long offset;
+  THPhilox philox;
+} THGenerator;
+
+/* Creates a new generator of the given type, seeded with the current time at
+   its first use. */
+TH_API THGenerator* THGenerator_new(int type);
+TH_API void THGenerator_free(THGenerator *gen);
+
+/* The generator used by the THRandom_* functions. */
+TH_API THGenerator* THGenerator_default(void);
+
+TH_API unsigned long THGenerator_seed(THGenerator *gen);
+TH_API void THGenerator_manualSeed(THGenerator *gen, unsigned long the_seed_);
+TH_API unsigned long THGenerator_initialSeed(THGenerator *gen);
+TH_API unsigned long THGenerator_random(THGenerator *gen);
+TH_API double THGenerator_uniform(THGenerator *gen, double a, double b);
+TH_API double THGenerator_normal(THGenerator *gen, double mean, double stdv);
+TH_API double THGenerator_exponential(THGenerator *gen, double lambda);
+TH_API double THGenerator_cauchy(THGenerator *gen, double median, double sigma);
+TH_API double THGenerator_logNormal(THGenerator *gen, double mean, double stdv);
+TH_API int THGenerator_geometric(THGenerator *gen, double p);
+TH_API int THGenerator_bernoulli(THGenerator *gen, double p);
+
+/* Skips the next n numbers of a Philox generator, and returns the position
+   of the first one: they can then be computed in any order (and by any
+   thread) with THPhilox_get() or the block functions below. */
+TH_API unsigned long long THGenerator_reserve(THGenerator *gen, unsigned long long n);
+
+/* Bulk generation of n numbers into buf, uniform on [a,b[ or normal.
+
+   A Mersenne Twister ignores pos and draws its next numbers: the uniform
+   ones are the same as with n calls to THGenerator_uniform(), the normal ones
+   as with n calls to THGenerator_normal().
+
+   A Philox generator computes the numbers found at positions pos to pos+n-1,
+   which must have been reserved with THGenerator_reserve(). The generator is
+   left untouched, so that several threads can fill different ranges at the
+   same time. */
+TH_API void THGenerator_uniformBlock(THGenerator *gen, unsigned long long pos, double *buf, long n, double a, double b);
+TH_API void THGenerator_normalBlock(THGenerator *gen, unsigned long long pos, double *buf, long n, double mean, double stdv);
+
 /* Initializes the random number generator with the current time (granularity: seconds) and returns the seed. */
 TH_API unsigned long THRandom_seed();
 
@@ -1,5 +1,106 @@
 #include "THStorage.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* memory accounting: index TH_STORAGE_NTYPES holds the total */
+static volatile long THStorage_live[TH_STORAGE_NTYPES+1];
+static volatile long THStorage_peak[TH_STORAGE_NTYPES+1];
+
+static THStorageMemoryHook THStorage_hook = NULL;
+static void *THStorage_hookData = NULL;
+static long THStorage_hookThreshold = 0;
+static volatile int THStorage_hookPending = 0;
+
+static void THStorage_updatePeak(volatile long *peak, long live)
+{
+  long peak_;
+  do
+  {
+    peak_ = *peak;
+  } while(live > peak_ && !THAtomicCASLong(peak, peak_, live));
+}
+
+static void THStorage_countMemory(int type, long bytes)
+{
+  long live;
+
+  if(bytes == 0)
+    return;
+
+  live = THAtomicAddLong(&THStorage_live[type], bytes) + bytes;
+  if(bytes > 0)
+    THStorage_updatePeak(&THStorage_peak[type], live);
+
+  live = THAtomicAddLong(&THStorage_live[TH_STORAGE_NTYPES], bytes) + bytes;
+  if(bytes < 0)
+    return;
+
+  THStorage_updatePeak(&THStorage_peak[TH_STORAGE_NTYPES], live);
+  if(THStorage_hook && live >= THStorage_hookThreshold && live-bytes < THStorage_hookThreshold)
+    THStorage_hookPending = 1;
+
+  if(THStorage_hookPending)
+  {
+#ifdef _OPENMP
+    if(omp_in_parallel())
+      return;
+#endif
+    THStorage_hookPending = 0;
+    if(THStorage_hook)
+      THStorage_hook(live, THStorage_hookThreshold, THStorage_hookData);
+  }
+}
+
+const char* THStorage_typeName(int type)
+{
+  static const char *names[TH_STORAGE_NTYPES] = {"Byte", "Char", "Short", "Int", "Long", "Float", "Double"};
+  THArgCheck(type >= 0 && type < TH_STORAGE_NTYPES, 1, "unknown storage type");
+  return names[type];
+}
+
+void THStorage_getMemoryStats(THStorageMemoryStats *stats)
+{
+  int type;
+  for(type = 0; type < TH_STORAGE_NTYPES; type++)
+  {
+    stats->typeLive[type] = THStorage_live[type];
+    stats->typePeak[type] = THStorage_peak[type];
+  }
+  stats->live = THStorage_live[TH_STORAGE_NTYPES];
+  stats->peak = THStorage_peak[TH_STORAGE_NTYPES];
+}
+
+void THStorage_resetMemoryStats(void)
+{
+  int type;
+  for(type = 0; type <= TH_STORAGE_NTYPES; type++)
+    THStorage_peak[type] = THStorage_live[type];
+}
+
+void THStorage_setMemoryHook(long threshold, THStorageMemoryHook hook, void *data)
+{
+  THStorage_hook = hook;
+  THStorage_hookData = data;
+  THStorage_hookThreshold = threshold;
+  THStorage_hookPending = 0;
+}
+
+#if defined(_WIN32) || defined(HAVE_MMAP)
+/* file mappings start at a multiple of this many bytes */
+static long THStorage_mapGranularity(void)
+{
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (long)info.dwAllocationGranularity;
+#else
+  return sysconf(_SC_PAGESIZE);
+#endif
+}
+#endif
+
 #include "generic/THStorage.c"
 #include "THGenerateAllTypes.h"
 
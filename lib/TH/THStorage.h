@@ -24,6 +24,38 @@
 #define TH_STORAGE_GET(storage, idx) ((storage)->data[(idx)])
 #define TH_STORAGE_SET(storage, idx, value) ((storage)->data[(idx)] = (value))
 
+/* Memory accounting: the bytes held by the storages of each type (including
+   memory-mapped ones) are counted when storages are allocated, resized and
+   freed. */
+#define TH_STORAGE_NTYPES 7
+#define THByteStorage_TYPE   0
+#define THCharStorage_TYPE   1
+#define THShortStorage_TYPE  2
+#define THIntStorage_TYPE    3
+#define THLongStorage_TYPE   4
+#define THFloatStorage_TYPE  5
+#define THDoubleStorage_TYPE 6
+
+typedef struct THStorageMemoryStats
+{
+  long live;                          /* bytes currently held, all types */
+  long peak;                          /* maximum of live since the last reset */
+  long typeLive[TH_STORAGE_NTYPES];   /* same, per type */
+  long typePeak[TH_STORAGE_NTYPES];
+} THStorageMemoryStats;
+
+/* called when live memory goes over a threshold; never called from inside
+   an OpenMP parallel region (it is then delayed to the next serial
+   allocation) */
+typedef void (*THStorageMemoryHook)(long live, long threshold, void *data);
+
+TH_API const char* THStorage_typeName(int type);
+TH_API void THStorage_getMemoryStats(THStorageMemoryStats *stats);
+/* resets the peaks to the current live memory */
+TH_API void THStorage_resetMemoryStats(void);
+/* a NULL hook removes it */
+TH_API void THStorage_setMemoryHook(long threshold, THStorageMemoryHook hook, void *data);
+
 #include "generic/THStorage.h"
 #include "THGenerateAllTypes.h"
 
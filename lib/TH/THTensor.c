@@ -4,6 +4,7 @@
 #include "THLapack.h"
 #include "THRandom.h"
 #include "THTensorDimApply.h"
+#include "THTensorParallelApply.h"
 
 #include "generic/THTensor.c"
 #include "THGenerateAllTypes.h"
@@ -17,6 +18,15 @@
 #include "generic/THTensorMath.c"
 #include "THGenerateAllTypes.h"
 
+#include "generic/THTensorSort.c"
+#include "THGenerateAllTypes.h"
+
+#include "generic/THTensorIndex.c"
+#include "THGenerateAllTypes.h"
+
+#include "generic/THTensorExpr.c"
+#include "THGenerateAllTypes.h"
+
 #include "generic/THTensorConv.c"
 #include "THGenerateAllTypes.h"
 
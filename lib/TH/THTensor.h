@@ -3,6 +3,8 @@
 
 #include "THStorage.h"
 #include "THTensorApply.h"
+#include "THRandom.h"
+#include "THTensorExpr.h"
 
 #define THTensor          TH_CONCAT_3(TH,Real,Tensor)
 #define THTensor_(NAME)   TH_CONCAT_4(TH,Real,Tensor_,NAME)
@@ -24,6 +26,18 @@
 #include "generic/THTensorMath.h"
 #include "THGenerateAllTypes.h"
 
+/* sorting and selection */
+#include "generic/THTensorSort.h"
+#include "THGenerateAllTypes.h"
+
+/* indexing along a dimension */
+#include "generic/THTensorIndex.h"
+#include "THGenerateAllTypes.h"
+
+/* fused elementwise expressions */
+#include "generic/THTensorExpr.h"
+#include "THGenerateAllTypes.h"
+
 /* convolutions */
 #include "generic/THTensorConv.h"
 #include "THGenerateAllTypes.h"
@@ -1,6 +1,24 @@
 #ifndef TH_TENSOR_DIM_APPLY_INC
 #define TH_TENSOR_DIM_APPLY_INC
 
+/* Returns the offset of the slice number s of a tensor along dimension.
+   Tensors with the same sizes (but along dimension) number their slices the
+   same way, so the slices can be processed in any order, e.g. in parallel. */
+static inline long THTensor_sliceOffset(int nDimension, const long *size, const long *stride, int dimension, long s)
+{
+  long offset = 0;
+  int d;
+
+  for(d = nDimension-1; d >= 0; d--)
+  {
+    if(d == dimension)
+      continue;
+    offset += (s % size[d])*stride[d];
+    s /= size[d];
+  }
+  return offset;
+}
+
 #define TH_TENSOR_DIM_APPLY3(TYPE1, TENSOR1, TYPE2, TENSOR2, TYPE3, TENSOR3, DIMENSION, CODE) \
 { \
   TYPE1 *TENSOR1##_data = NULL; \
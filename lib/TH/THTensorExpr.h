@@ -0,0 +1,78 @@
+#ifndef TH_TENSOR_EXPR_INC
+#define TH_TENSOR_EXPR_INC
+
+#include <string.h>
+
+/* Elementwise expressions, evaluated in a single pass by THTensor_(evaluate)().
+
+   An expression is a program for a stack machine, in postfix order: each
+   instruction pushes an operand, or replaces the values on top of the stack
+   by the result of an operation on them. For instance (a+b)*2 is
+
+     TENSOR 0, TENSOR 1, ADD, MULVALUE 2
+
+   Instructions marked as float only are not available for integer tensors. */
+
+#define TH_EXPR_TENSOR     0   /* push operand arg */
+#define TH_EXPR_VALUE      1   /* push value */
+#define TH_EXPR_ADD        2   /* x y -> x+y */
+#define TH_EXPR_SUB        3   /* x y -> x-y */
+#define TH_EXPR_MUL        4   /* x y -> x*y */
+#define TH_EXPR_DIV        5   /* x y -> x/y */
+#define TH_EXPR_ADDVALUE   6   /* x -> x+value */
+#define TH_EXPR_MULVALUE   7   /* x -> x*value */
+#define TH_EXPR_DIVVALUE   8   /* x -> x/value */
+#define TH_EXPR_NEG        9   /* x -> -x */
+#define TH_EXPR_SIGN      10   /* x -> sign(x) */
+#define TH_EXPR_POWVALUE  11   /* x -> pow(x, value) (float only) */
+#define TH_EXPR_ATAN2     12   /* x y -> atan2(x, y) (float only) */
+#define TH_EXPR_ABS       13   /* the remaining ones: x -> f(x) (float only) */
+#define TH_EXPR_EXP       14
+#define TH_EXPR_LOG       15
+#define TH_EXPR_LOG1P     16
+#define TH_EXPR_SQRT      17
+#define TH_EXPR_TANH      18
+#define TH_EXPR_SIGMOID   19
+#define TH_EXPR_COS       20
+#define TH_EXPR_ACOS      21
+#define TH_EXPR_COSH      22
+#define TH_EXPR_SIN       23
+#define TH_EXPR_ASIN      24
+#define TH_EXPR_SINH      25
+#define TH_EXPR_TAN       26
+#define TH_EXPR_ATAN      27
+#define TH_EXPR_CEIL      28
+#define TH_EXPR_FLOOR     29
+
+/* number of instructions */
+#define TH_EXPR_NOPCODE   30
+
+/* maximum depth of the stack */
+#define TH_EXPR_STACK     16
+
+typedef struct THExprInstr
+{
+    int op;
+    int arg;       /* operand index (TH_EXPR_TENSOR) */
+    double value;  /* constant (TH_EXPR_VALUE and TH_EXPR_*VALUE) */
+} THExprInstr;
+
+/* the opcode of an instruction given by its lower case name ("tensor",
+   "add", "mulvalue"...), or -1 if there is no such instruction */
+static inline int THExpr_opcode(const char *name)
+{
+  static const char *names[TH_EXPR_NOPCODE] = {
+    "tensor", "value", "add", "sub", "mul", "div", "addvalue", "mulvalue", "divvalue",
+    "neg", "sign", "powvalue", "atan2", "abs", "exp", "log", "log1p", "sqrt", "tanh",
+    "sigmoid", "cos", "acos", "cosh", "sin", "asin", "sinh", "tan", "atan", "ceil", "floor"};
+  int op;
+
+  for(op = 0; op < TH_EXPR_NOPCODE; op++)
+  {
+    if(!strcmp(name, names[op]))
+      return op;
+  }
+  return -1;
+}
+
+#endif
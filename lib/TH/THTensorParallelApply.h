@@ -0,0 +1,386 @@
+#ifndef TH_TENSOR_PARALLEL_APPLY_INC
+#define TH_TENSOR_PARALLEL_APPLY_INC
+
+#include "THTensorApply.h"
+
+/*
+   Parallel versions of TH_TENSOR_APPLY, TH_TENSOR_APPLY2 and TH_TENSOR_APPLY3.
+
+   The linear iteration space (of nElement elements) is split in one chunk per
+   thread. Each thread seeks directly to the start of its chunk in every
+   tensor, and then walks it along the innermost (collapsed) dimension, so
+   non-contiguous tensors are handled as well as contiguous ones.
+
+   CODE must be purely elementwise: it may only use TENSOR##_data, and may not
+   break out of the loop or rely on TENSOR##_size, TENSOR##_stride or
+   TENSOR##_i (use the serial macros for that). It must not call THError()
+   either, as errors cannot be thrown from a thread.
+
+   Tensors with less than THGetParallelThreshold() elements, calls made from
+   an already parallel region, and builds without OpenMP all fall back on the
+   serial macros.
+*/
+
+/* Collapses a tensor geometry: dimensions of size 1 are dropped, and
+   neighbour dimensions which are contiguous in memory are merged. Returns the
+   number of remaining dimensions (at least one). */
+static inline int THTensorApply_collapse(int nDimension, const long *size, const long *stride, long *csize, long *cstride)
+{
+  int d, n = 0;
+
+  for(d = 0; d < nDimension; d++)
+  {
+    if(size[d] == 1)
+      continue;
+
+    if(n > 0 && cstride[n-1] == size[d]*stride[d])
+    {
+      csize[n-1] *= size[d];
+      cstride[n-1] = stride[d];
+    }
+    else
+    {
+      csize[n] = size[d];
+      cstride[n] = stride[d];
+      n++;
+    }
+  }
+
+  if(n == 0)
+  {
+    csize[0] = 1;
+    cstride[0] = 1;
+    n = 1;
+  }
+
+  return n;
+}
+
+/* Sets counter to the coordinates of the given linear index, and returns the
+   corresponding offset in memory. */
+static inline long THTensorApply_seek(int nDimension, const long *size, const long *stride, long *counter, long index)
+{
+  long offset = 0;
+  int d;
+
+  for(d = nDimension-1; d >= 0; d--)
+  {
+    counter[d] = index % size[d];
+    offset += counter[d]*stride[d];
+    index /= size[d];
+  }
+
+  return offset;
+}
+
+/* Moves the counter forward by n elements along the innermost dimension (n
+   must not go past its end). The caller is supposed to have already moved its
+   pointer by n*stride[nDimension-1]: the returned value is the extra offset
+   due to the carries in the outer dimensions. */
+static inline long THTensorApply_carry(int nDimension, const long *size, const long *stride, long *counter, long n)
+{
+  long offset = 0;
+  int d = nDimension-1;
+
+  counter[d] += n;
+  while(d > 0 && counter[d] == size[d])
+  {
+    offset -= counter[d]*stride[d];
+    counter[d] = 0;
+    d--;
+    counter[d]++;
+    offset += stride[d];
+  }
+
+  return offset;
+}
+
+/* number of elements of a tensor, as computed by the apply macros */
+#define TH_TENSOR_PARALLEL_APPLY_NELEMENT(TENSOR, N) \
+{ \
+  int TH_TENSOR_PARALLEL_APPLY_d; \
+  N = (TENSOR->nDimension ? 1 : 0); \
+  for(TH_TENSOR_PARALLEL_APPLY_d = 0; TH_TENSOR_PARALLEL_APPLY_d < TENSOR->nDimension; TH_TENSOR_PARALLEL_APPLY_d++) \
+    N *= TENSOR->size[TH_TENSOR_PARALLEL_APPLY_d]; \
+}
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Sets offset and length to the chunk of [0, n) of the calling thread, when
+   [0, n) is split in one contiguous chunk per thread of the current parallel
+   region. Outside of a parallel region, the chunk is the whole range. */
+static inline void THTensorApply_chunk(long n, long *offset, long *length)
+{
+#ifdef _OPENMP
+  int nthread = omp_get_num_threads();
+  int tid = omp_get_thread_num();
+
+  *offset = n/nthread*tid + THMin(tid, n%nthread);
+  *length = n/nthread + (tid < n%nthread ? 1 : 0);
+#else
+  *offset = 0;
+  *length = n;
+#endif
+}
+
+#ifdef _OPENMP
+
+#define TH_TENSOR_PARALLEL_APPLY_ISPARALLEL(N) \
+  ((N) >= THGetParallelThreshold() && THGetNumThreads() > 1 && !omp_in_parallel())
+
+/* declares the collapsed geometry of a tensor (before the parallel region) */
+#define TH_TENSOR_PARALLEL_APPLY_GEOMETRY(TENSOR) \
+  long TENSOR##_cgeometry_stack[2*TH_TENSOR_APPLY_MAX_DIM]; \
+  long *TENSOR##_csize = (TENSOR->nDimension <= TH_TENSOR_APPLY_MAX_DIM ? TENSOR##_cgeometry_stack : (long*)THAlloc(sizeof(long)*2*TENSOR->nDimension)); \
+  long *TENSOR##_cstride = TENSOR##_csize+THMax(TENSOR->nDimension, TH_TENSOR_APPLY_MAX_DIM); \
+  int TENSOR##_cdim = THTensorApply_collapse(TENSOR->nDimension, TENSOR->size, TENSOR->stride, TENSOR##_csize, TENSOR##_cstride); \
+  long TENSOR##_istride = TENSOR##_cstride[TENSOR##_cdim-1];
+
+/* positions a tensor at the beginning of the chunk of the current thread */
+#define TH_TENSOR_PARALLEL_APPLY_SEEK(TYPE, TENSOR, START) \
+  long TENSOR##_counter_stack[TH_TENSOR_APPLY_MAX_DIM]; \
+  long *TENSOR##_counter = (TENSOR##_cdim <= TH_TENSOR_APPLY_MAX_DIM ? TENSOR##_counter_stack : (long*)THAlloc(sizeof(long)*TENSOR##_cdim)); \
+  TYPE *TENSOR##_data = TENSOR->storage->data+TENSOR->storageOffset \
+    + THTensorApply_seek(TENSOR##_cdim, TENSOR##_csize, TENSOR##_cstride, TENSOR##_counter, START);
+
+/* largest run of elements which can be done along the innermost dimension */
+#define TH_TENSOR_PARALLEL_APPLY_RUN(TENSOR, RUN) \
+  if(TENSOR##_csize[TENSOR##_cdim-1]-TENSOR##_counter[TENSOR##_cdim-1] < RUN) \
+    RUN = TENSOR##_csize[TENSOR##_cdim-1]-TENSOR##_counter[TENSOR##_cdim-1];
+
+#define TH_TENSOR_PARALLEL_APPLY_CARRY(TENSOR, RUN) \
+  TENSOR##_data += THTensorApply_carry(TENSOR##_cdim, TENSOR##_csize, TENSOR##_cstride, TENSOR##_counter, RUN);
+
+#define TH_TENSOR_PARALLEL_APPLY_FREE(TENSOR) \
+  if(TENSOR##_counter != TENSOR##_counter_stack) \
+    THFree(TENSOR##_counter);
+
+#define TH_TENSOR_PARALLEL_APPLY_FREE_GEOMETRY(TENSOR) \
+  if(TENSOR##_csize != TENSOR##_cgeometry_stack) \
+    THFree(TENSOR##_csize);
+
+/* start and end of the chunk of the current thread */
+#define TH_TENSOR_PARALLEL_APPLY_CHUNK(N) \
+  int TH_TENSOR_PARALLEL_APPLY_nthread = omp_get_num_threads(); \
+  int TH_TENSOR_PARALLEL_APPLY_tid = omp_get_thread_num(); \
+  long TH_TENSOR_PARALLEL_APPLY_idx = (N)/TH_TENSOR_PARALLEL_APPLY_nthread*TH_TENSOR_PARALLEL_APPLY_tid \
+    + THMin(TH_TENSOR_PARALLEL_APPLY_tid, (N)%TH_TENSOR_PARALLEL_APPLY_nthread); \
+  long TH_TENSOR_PARALLEL_APPLY_end = TH_TENSOR_PARALLEL_APPLY_idx + (N)/TH_TENSOR_PARALLEL_APPLY_nthread \
+    + (TH_TENSOR_PARALLEL_APPLY_tid < (N)%TH_TENSOR_PARALLEL_APPLY_nthread ? 1 : 0); \
+  long TH_TENSOR_PARALLEL_APPLY_run, TH_TENSOR_PARALLEL_APPLY_k;
+
+#define TH_TENSOR_PARALLEL_APPLY3(TYPE1, TENSOR1, TYPE2, TENSOR2, TYPE3, TENSOR3, CODE) \
+{ \
+  long TH_TENSOR_PARALLEL_APPLY_n1, TH_TENSOR_PARALLEL_APPLY_n2, TH_TENSOR_PARALLEL_APPLY_n3; \
+  TH_TENSOR_PARALLEL_APPLY_NELEMENT(TENSOR1, TH_TENSOR_PARALLEL_APPLY_n1); \
+  TH_TENSOR_PARALLEL_APPLY_NELEMENT(TENSOR2, TH_TENSOR_PARALLEL_APPLY_n2); \
+  TH_TENSOR_PARALLEL_APPLY_NELEMENT(TENSOR3, TH_TENSOR_PARALLEL_APPLY_n3); \
+\
+  if(TH_TENSOR_PARALLEL_APPLY_n1 != TH_TENSOR_PARALLEL_APPLY_n2 || TH_TENSOR_PARALLEL_APPLY_n1 != TH_TENSOR_PARALLEL_APPLY_n3) \
+    THError("inconsistent tensor size"); \
+\
+  if(!TH_TENSOR_PARALLEL_APPLY_ISPARALLEL(TH_TENSOR_PARALLEL_APPLY_n1)) \
+    TH_TENSOR_APPLY3(TYPE1, TENSOR1, TYPE2, TENSOR2, TYPE3, TENSOR3, CODE) \
+  else \
+  { \
+    TH_TENSOR_PARALLEL_APPLY_GEOMETRY(TENSOR1) \
+    TH_TENSOR_PARALLEL_APPLY_GEOMETRY(TENSOR2) \
+    TH_TENSOR_PARALLEL_APPLY_GEOMETRY(TENSOR3) \
+    int TH_TENSOR_PARALLEL_APPLY_isunit = (TENSOR1##_istride == 1 && TENSOR2##_istride == 1 && TENSOR3##_istride == 1); \
+\
+    _Pragma("omp parallel") \
+    { \
+      TH_TENSOR_PARALLEL_APPLY_CHUNK(TH_TENSOR_PARALLEL_APPLY_n1) \
+      TH_TENSOR_PARALLEL_APPLY_SEEK(TYPE1, TENSOR1, TH_TENSOR_PARALLEL_APPLY_idx) \
+      TH_TENSOR_PARALLEL_APPLY_SEEK(TYPE2, TENSOR2, TH_TENSOR_PARALLEL_APPLY_idx) \
+      TH_TENSOR_PARALLEL_APPLY_SEEK(TYPE3, TENSOR3, TH_TENSOR_PARALLEL_APPLY_idx) \
+\
+      while(TH_TENSOR_PARALLEL_APPLY_idx < TH_TENSOR_PARALLEL_APPLY_end) \
+      { \
+        TH_TENSOR_PARALLEL_APPLY_run = TH_TENSOR_PARALLEL_APPLY_end-TH_TENSOR_PARALLEL_APPLY_idx; \
+        TH_TENSOR_PARALLEL_APPLY_RUN(TENSOR1, TH_TENSOR_PARALLEL_APPLY_run) \
+        TH_TENSOR_PARALLEL_APPLY_RUN(TENSOR2, TH_TENSOR_PARALLEL_APPLY_run) \
+        TH_TENSOR_PARALLEL_APPLY_RUN(TENSOR3, TH_TENSOR_PARALLEL_APPLY_run) \
+\
+        if(TH_TENSOR_PARALLEL_APPLY_isunit) \
+        { \
+          for(TH_TENSOR_PARALLEL_APPLY_k = 0; TH_TENSOR_PARALLEL_APPLY_k < TH_TENSOR_PARALLEL_APPLY_run; TH_TENSOR_PARALLEL_APPLY_k++, TENSOR1##_data++, TENSOR2##_data++, TENSOR3##_data++) \
+          { \
+            CODE \
+          } \
+        } \
+        else \
+        { \
+          for(TH_TENSOR_PARALLEL_APPLY_k = 0; TH_TENSOR_PARALLEL_APPLY_k < TH_TENSOR_PARALLEL_APPLY_run; TH_TENSOR_PARALLEL_APPLY_k++, TENSOR1##_data += TENSOR1##_istride, TENSOR2##_data += TENSOR2##_istride, TENSOR3##_data += TENSOR3##_istride) \
+          { \
+            CODE \
+          } \
+        } \
+\
+        TH_TENSOR_PARALLEL_APPLY_CARRY(TENSOR1, TH_TENSOR_PARALLEL_APPLY_run) \
+        TH_TENSOR_PARALLEL_APPLY_CARRY(TENSOR2, TH_TENSOR_PARALLEL_APPLY_run) \
+        TH_TENSOR_PARALLEL_APPLY_CARRY(TENSOR3, TH_TENSOR_PARALLEL_APPLY_run) \
+        TH_TENSOR_PARALLEL_APPLY_idx += TH_TENSOR_PARALLEL_APPLY_run; \
+      } \
+\
+      TH_TENSOR_PARALLEL_APPLY_FREE(TENSOR1) \
+      TH_TENSOR_PARALLEL_APPLY_FREE(TENSOR2) \
+      TH_TENSOR_PARALLEL_APPLY_FREE(TENSOR3) \
+    } \
+\
+    TH_TENSOR_PARALLEL_APPLY_FREE_GEOMETRY(TENSOR1) \
+    TH_TENSOR_PARALLEL_APPLY_FREE_GEOMETRY(TENSOR2) \
+    TH_TENSOR_PARALLEL_APPLY_FREE_GEOMETRY(TENSOR3) \
+  } \
+}
+
+#define TH_TENSOR_PARALLEL_APPLY2(TYPE1, TENSOR1, TYPE2, TENSOR2, CODE) \
+{ \
+  long TH_TENSOR_PARALLEL_APPLY_n1, TH_TENSOR_PARALLEL_APPLY_n2; \
+  TH_TENSOR_PARALLEL_APPLY_NELEMENT(TENSOR1, TH_TENSOR_PARALLEL_APPLY_n1); \
+  TH_TENSOR_PARALLEL_APPLY_NELEMENT(TENSOR2, TH_TENSOR_PARALLEL_APPLY_n2); \
+\
+  if(TH_TENSOR_PARALLEL_APPLY_n1 != TH_TENSOR_PARALLEL_APPLY_n2) \
+    THError("inconsistent tensor size"); \
+\
+  if(!TH_TENSOR_PARALLEL_APPLY_ISPARALLEL(TH_TENSOR_PARALLEL_APPLY_n1)) \
+    TH_TENSOR_APPLY2(TYPE1, TENSOR1, TYPE2, TENSOR2, CODE) \
+  else \
+  { \
+    TH_TENSOR_PARALLEL_APPLY_GEOMETRY(TENSOR1) \
+    TH_TENSOR_PARALLEL_APPLY_GEOMETRY(TENSOR2) \
+    int TH_TENSOR_PARALLEL_APPLY_isunit = (TENSOR1##_istride == 1 && TENSOR2##_istride == 1); \
+\
+    _Pragma("omp parallel") \
+    { \
+      TH_TENSOR_PARALLEL_APPLY_CHUNK(TH_TENSOR_PARALLEL_APPLY_n1) \
+      TH_TENSOR_PARALLEL_APPLY_SEEK(TYPE1, TENSOR1, TH_TENSOR_PARALLEL_APPLY_idx) \
+      TH_TENSOR_PARALLEL_APPLY_SEEK(TYPE2, TENSOR2, TH_TENSOR_PARALLEL_APPLY_idx) \
+\
+      while(TH_TENSOR_PARALLEL_APPLY_idx < TH_TENSOR_PARALLEL_APPLY_end) \
+      { \
+        TH_TENSOR_PARALLEL_APPLY_run = TH_TENSOR_PARALLEL_APPLY_end-TH_TENSOR_PARALLEL_APPLY_idx; \
+        TH_TENSOR_PARALLEL_APPLY_RUN(TENSOR1, TH_TENSOR_PARALLEL_APPLY_run) \
+        TH_TENSOR_PARALLEL_APPLY_RUN(TENSOR2, TH_TENSOR_PARALLEL_APPLY_run) \
+\
+        if(TH_TENSOR_PARALLEL_APPLY_isunit) \
+        { \
+          for(TH_TENSOR_PARALLEL_APPLY_k = 0; TH_TENSOR_PARALLEL_APPLY_k < TH_TENSOR_PARALLEL_APPLY_run; TH_TENSOR_PARALLEL_APPLY_k++, TENSOR1##_data++, TENSOR2##_data++) \
+          { \
+            CODE \
+          } \
+        } \
+        else \
+        { \
+          for(TH_TENSOR_PARALLEL_APPLY_k = 0; TH_TENSOR_PARALLEL_APPLY_k < TH_TENSOR_PARALLEL_APPLY_run; TH_TENSOR_PARALLEL_APPLY_k++, TENSOR1##_data += TENSOR1##_istride, TENSOR2##_data += TENSOR2##_istride) \
+          { \
+            CODE \
+          } \
+        } \
+\
+        TH_TENSOR_PARALLEL_APPLY_CARRY(TENSOR1, TH_TENSOR_PARALLEL_APPLY_run) \
+        TH_TENSOR_PARALLEL_APPLY_CARRY(TENSOR2, TH_TENSOR_PARALLEL_APPLY_run) \
+        TH_TENSOR_PARALLEL_APPLY_idx += TH_TENSOR_PARALLEL_APPLY_run; \
+      } \
+\
+      TH_TENSOR_PARALLEL_APPLY_FREE(TENSOR1) \
+      TH_TENSOR_PARALLEL_APPLY_FREE(TENSOR2) \
+    } \
+\
+    TH_TENSOR_PARALLEL_APPLY_FREE_GEOMETRY(TENSOR1) \
+    TH_TENSOR_PARALLEL_APPLY_FREE_GEOMETRY(TENSOR2) \
+  } \
+}
+
+#define TH_TENSOR_PARALLEL_APPLY(TYPE, TENSOR, CODE) \
+{ \
+  long TH_TENSOR_PARALLEL_APPLY_n1; \
+  TH_TENSOR_PARALLEL_APPLY_NELEMENT(TENSOR, TH_TENSOR_PARALLEL_APPLY_n1); \
+\
+  if(!TH_TENSOR_PARALLEL_APPLY_ISPARALLEL(TH_TENSOR_PARALLEL_APPLY_n1)) \
+    TH_TENSOR_APPLY(TYPE, TENSOR, CODE) \
+  else \
+  { \
+    TH_TENSOR_PARALLEL_APPLY_GEOMETRY(TENSOR) \
+\
+    _Pragma("omp parallel") \
+    { \
+      TH_TENSOR_PARALLEL_APPLY_CHUNK(TH_TENSOR_PARALLEL_APPLY_n1) \
+      TH_TENSOR_PARALLEL_APPLY_SEEK(TYPE, TENSOR, TH_TENSOR_PARALLEL_APPLY_idx) \
+\
+      while(TH_TENSOR_PARALLEL_APPLY_idx < TH_TENSOR_PARALLEL_APPLY_end) \
+      { \
+        TH_TENSOR_PARALLEL_APPLY_run = TH_TENSOR_PARALLEL_APPLY_end-TH_TENSOR_PARALLEL_APPLY_idx; \
+        TH_TENSOR_PARALLEL_APPLY_RUN(TENSOR, TH_TENSOR_PARALLEL_APPLY_run) \
+\
+        if(TENSOR##_istride == 1) \
+        { \
+          for(TH_TENSOR_PARALLEL_APPLY_k = 0; TH_TENSOR_PARALLEL_APPLY_k < TH_TENSOR_PARALLEL_APPLY_run; TH_TENSOR_PARALLEL_APPLY_k++, TENSOR##_data++) \
+          { \
+            CODE \
+          } \
+        } \
+        else \
+        { \
+          for(TH_TENSOR_PARALLEL_APPLY_k = 0; TH_TENSOR_PARALLEL_APPLY_k < TH_TENSOR_PARALLEL_APPLY_run; TH_TENSOR_PARALLEL_APPLY_k++, TENSOR##_data += TENSOR##_istride) \
+          { \
+            CODE \
+          } \
+        } \
+\
+        TH_TENSOR_PARALLEL_APPLY_CARRY(TENSOR, TH_TENSOR_PARALLEL_APPLY_run) \
+        TH_TENSOR_PARALLEL_APPLY_idx += TH_TENSOR_PARALLEL_APPLY_run; \
+      } \
+\
+      TH_TENSOR_PARALLEL_APPLY_FREE(TENSOR) \
+    } \
+\
+    TH_TENSOR_PARALLEL_APPLY_FREE_GEOMETRY(TENSOR) \
+  } \
+}
+
+/* Splits [0, N) in one contiguous chunk per thread, and runs CODE on each
+   chunk, with OFFSET and LENGTH set to its start and size. Meant for
+   contiguous tensors, where CODE can call a THVector function. */
+#define TH_PARALLEL_CHUNKS(N, OFFSET, LENGTH, CODE) \
+{ \
+  if(!TH_TENSOR_PARALLEL_APPLY_ISPARALLEL(N)) \
+  { \
+    long OFFSET = 0; \
+    long LENGTH = (N); \
+    CODE \
+  } \
+  else \
+  { \
+    _Pragma("omp parallel") \
+    { \
+      long OFFSET, LENGTH; \
+      THTensorApply_chunk((N), &OFFSET, &LENGTH); \
+      CODE \
+    } \
+  } \
+}
+
+#else
+
+#define TH_PARALLEL_CHUNKS(N, OFFSET, LENGTH, CODE) \
+{ \
+  long OFFSET = 0; \
+  long LENGTH = (N); \
+  CODE \
+}
+
+#define TH_TENSOR_PARALLEL_APPLY3(TYPE1, TENSOR1, TYPE2, TENSOR2, TYPE3, TENSOR3, CODE) \
+  TH_TENSOR_APPLY3(TYPE1, TENSOR1, TYPE2, TENSOR2, TYPE3, TENSOR3, CODE)
+
+#define TH_TENSOR_PARALLEL_APPLY2(TYPE1, TENSOR1, TYPE2, TENSOR2, CODE) \
+  TH_TENSOR_APPLY2(TYPE1, TENSOR1, TYPE2, TENSOR2, CODE)
+
+#define TH_TENSOR_PARALLEL_APPLY(TYPE, TENSOR, CODE) \
+  TH_TENSOR_APPLY(TYPE, TENSOR, CODE)
+
+#endif
+
+#endif
@@ -0,0 +1,211 @@
+#include "THVector.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define TH_VECTOR_CPUID
+#include <cpuid.h>
+#endif
+
+#define THVectorSIMD_(NAME) TH_CONCAT_3(THVector_(NAME),_,TH_VECTOR_ISA)
+
+/* see THVector_setFastMath() */
+static int THVector_fastMath = 1;
+
+/* SIMD versions (see THVectorSSE2.c, THVectorAVX.c, ...) */
+#ifdef TH_HAVE_SSE2
+#define TH_VECTOR_ISA SSE2
+#include "generic/THVectorSIMD.h"
+#include "THGenerateFloatTypes.h"
+#undef TH_VECTOR_ISA
+#endif
+
+#ifdef TH_HAVE_AVX
+#define TH_VECTOR_ISA AVX
+#include "generic/THVectorSIMD.h"
+#include "THGenerateFloatTypes.h"
+#undef TH_VECTOR_ISA
+#endif
+
+#ifdef TH_HAVE_AVX2
+#define TH_VECTOR_ISA AVX2
+#include "generic/THVectorSIMD.h"
+#include "THGenerateFloatTypes.h"
+#undef TH_VECTOR_ISA
+#endif
+
+#ifdef TH_HAVE_AVX512
+#define TH_VECTOR_ISA AVX512
+#include "generic/THVectorSIMD.h"
+#include "THGenerateFloatTypes.h"
+#undef TH_VECTOR_ISA
+#endif
+
+#ifdef __NEON__
+#include "THVectorNEON.c"
+static void THFloatVector_dispatchInitNEON(void);
+static void THDoubleVector_dispatchInitNEON(void);
+#endif
+
+/* plain C versions */
+#include "generic/THVector.c"
+#include "THGenerateAllTypes.h"
+
+/* dispatched functions */
+#include "generic/THVectorDispatch.c"
+#include "THGenerateAllTypes.h"
+
+#ifdef __NEON__
+static void THFloatVector_dispatchInitNEON(void)
+{
+  THFloatVector_fill_DISPATCHPTR = &THFloatVector_fill_NEON;
+  THFloatVector_add_DISPATCHPTR = &THFloatVector_add_NEON;
+  THFloatVector_diff_DISPATCHPTR = &THFloatVector_diff_NEON;
+  THFloatVector_scale_DISPATCHPTR = &THFloatVector_scale_NEON;
+  THFloatVector_mul_DISPATCHPTR = &THFloatVector_mul_NEON;
+}
+
+static void THDoubleVector_dispatchInitNEON(void)
+{
+}
+#endif
+
+static int THVector_simd = TH_SIMD_DEFAULT;
+static int THVector_simdSupported = -1;
+
+#ifdef TH_VECTOR_CPUID
+/* extended control register: which register states are saved by the OS */
+static unsigned long long THVector_xgetbv(void)
+{
+  unsigned int eax, edx;
+  __asm__ __volatile__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+  return ((unsigned long long)edx << 32) | eax;
+}
+#endif
+
+static int THVector_detectSIMD(void)
+{
+  int simd = TH_SIMD_DEFAULT;
+#ifdef TH_VECTOR_CPUID
+  unsigned int eax, ebx, ecx, edx;
+  unsigned long long xcr0 = 0;
+  int hasAVX = 0;
+
+  if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    return simd;
+
+  if(edx & bit_SSE2)
+    simd = TH_SIMD_SSE2;
+
+  /* AVX needs the OS to save the ymm registers */
+  if((ecx & bit_OSXSAVE) && (ecx & bit_AVX))
+  {
+    xcr0 = THVector_xgetbv();
+    hasAVX = ((xcr0 & 0x6) == 0x6);
+  }
+  if(!hasAVX)
+    return simd;
+  simd = TH_SIMD_AVX;
+
+  if(!(ecx & bit_FMA) || __get_cpuid_max(0, NULL) < 7)
+    return simd;
+
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  if(!(ebx & bit_AVX2))
+    return simd;
+  simd = TH_SIMD_AVX2;
+
+  /* AVX-512 needs the opmask and zmm registers to be saved as well */
+  if((ebx & bit_AVX512F) && ((xcr0 & 0xe6) == 0xe6))
+    simd = TH_SIMD_AVX512;
+#elif defined(TH_HAVE_SSE2)
+  simd = TH_SIMD_SSE2;
+#endif
+  return simd;
+}
+
+int THVector_getSIMDSupported(void)
+{
+  if(THVector_simdSupported < 0)
+  {
+    int simd = THVector_detectSIMD();
+
+    /* do not go beyond what we compiled */
+#ifndef TH_HAVE_AVX512
+    if(simd >= TH_SIMD_AVX512)
+      simd = TH_SIMD_AVX2;
+#endif
+#ifndef TH_HAVE_AVX2
+    if(simd >= TH_SIMD_AVX2)
+      simd = TH_SIMD_AVX;
+#endif
+#ifndef TH_HAVE_AVX
+    if(simd >= TH_SIMD_AVX)
+      simd = TH_SIMD_SSE2;
+#endif
+#ifndef TH_HAVE_SSE2
+    if(simd >= TH_SIMD_SSE2)
+      simd = TH_SIMD_DEFAULT;
+#endif
+    THVector_simdSupported = simd;
+  }
+  return THVector_simdSupported;
+}
+
+int THVector_getSIMD(void)
+{
+  return THVector_simd;
+}
+
+int THVector_setSIMD(int simd)
+{
+  int supported = THVector_getSIMDSupported();
+
+  if(simd < TH_SIMD_DEFAULT)
+    simd = TH_SIMD_DEFAULT;
+  if(simd > supported)
+    simd = supported;
+
+  THFloatVector_dispatchInit(simd);
+  THDoubleVector_dispatchInit(simd);
+  THVector_simd = simd;
+
+  return simd;
+}
+
+void THVector_setFastMath(int fast)
+{
+  THVector_fastMath = (fast != 0);
+  THFloatVector_dispatchInit(THVector_simd);
+  THDoubleVector_dispatchInit(THVector_simd);
+}
+
+int THVector_getFastMath(void)
+{
+  return THVector_fastMath;
+}
+
+const char* THVector_SIMDName(int simd)
+{
+  switch(simd)
+  {
+    case TH_SIMD_SSE2:
+      return "sse2";
+    case TH_SIMD_AVX:
+      return "avx";
+    case TH_SIMD_AVX2:
+      return "avx2";
+    case TH_SIMD_AVX512:
+      return "avx512";
+    default:
+      return "default";
+  }
+}
+
+/* select the best instruction set when the library is loaded (otherwise the
+   plain C versions are used until THVector_setSIMD() is called) */
+#ifdef __GNUC__
+__attribute__((constructor))
+static void THVector_init(void)
+{
+  THVector_setSIMD(THVector_getSIMDSupported());
+}
+#endif
@@ -0,0 +1,136 @@
+/* AVX versions of the THVector operations (see THVector.c), compiled with -mavx */
+
+#include "THVector.h"
+#include <immintrin.h>
+
+#define TH_VECTOR_ISA AVX
+#define THVectorSIMD_(NAME) TH_CONCAT_3(THVector_(NAME),_,TH_VECTOR_ISA)
+
+#define THFloatSIMD_t __m256
+#define THFloatSIMD_SIZE 8
+#define THFloatSIMD_load _mm256_loadu_ps
+#define THFloatSIMD_store _mm256_storeu_ps
+#define THFloatSIMD_set1 _mm256_set1_ps
+#define THFloatSIMD_add _mm256_add_ps
+#define THFloatSIMD_sub _mm256_sub_ps
+#define THFloatSIMD_mul _mm256_mul_ps
+#define THFloatSIMD_div _mm256_div_ps
+#define THFloatSIMD_max _mm256_max_ps
+#define THFloatSIMD_min _mm256_min_ps
+#define THFloatSIMD_fmadd(a, b, c) _mm256_add_ps(_mm256_mul_ps(a, b), c)
+
+#define THDoubleSIMD_t __m256d
+#define THDoubleSIMD_SIZE 4
+#define THDoubleSIMD_load _mm256_loadu_pd
+#define THDoubleSIMD_store _mm256_storeu_pd
+#define THDoubleSIMD_set1 _mm256_set1_pd
+#define THDoubleSIMD_add _mm256_add_pd
+#define THDoubleSIMD_sub _mm256_sub_pd
+#define THDoubleSIMD_mul _mm256_mul_pd
+#define THDoubleSIMD_div _mm256_div_pd
+#define THDoubleSIMD_max _mm256_max_pd
+#define THDoubleSIMD_min _mm256_min_pd
+#define THDoubleSIMD_fmadd(a, b, c) _mm256_add_pd(_mm256_mul_pd(a, b), c)
+
+/* exponent manipulations, for the transcendental functions (see
+   generic/THVectorSIMD.c); AVX has no 256-bit integer operations, so these
+   are done on each 128-bit half */
+
+#define THVectorAVX_SPLIT(X, LO, HI) \
+  __m128i LO = _mm256_castsi256_si128(X); \
+  __m128i HI = _mm256_extractf128_si256(X, 1);
+
+#define THVectorAVX_JOIN(LO, HI) \
+  _mm256_insertf128_si256(_mm256_castsi128_si256(LO), HI, 1)
+
+/* rounds to the nearest integer */
+static inline __m256 THFloatSIMD_round(__m256 x)
+{
+  return _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+
+/* 2^n, for an integer n in [-126, 127] */
+static inline __m256 THFloatSIMD_pow2n(__m256 n)
+{
+  __m256i e = _mm256_cvtps_epi32(n);
+  __m128i bias = _mm_set1_epi32(127);
+  THVectorAVX_SPLIT(e, lo, hi)
+  lo = _mm_slli_epi32(_mm_add_epi32(lo, bias), 23);
+  hi = _mm_slli_epi32(_mm_add_epi32(hi, bias), 23);
+  return _mm256_castsi256_ps(THVectorAVX_JOIN(lo, hi));
+}
+
+/* x*2^n, for an integer n in [-252, 254] */
+static inline __m256 THFloatSIMD_ldexp(__m256 x, __m256 n)
+{
+  __m256 h = THFloatSIMD_round(_mm256_mul_ps(n, _mm256_set1_ps(0.5f)));
+  return _mm256_mul_ps(_mm256_mul_ps(x, THFloatSIMD_pow2n(h)), THFloatSIMD_pow2n(_mm256_sub_ps(n, h)));
+}
+
+/* exponent and mantissa (in [1, 2)) of a positive normal number */
+static inline __m256 THFloatSIMD_getexp(__m256 x)
+{
+  __m256i e = _mm256_castps_si256(x);
+  __m128i bias = _mm_set1_epi32(127);
+  THVectorAVX_SPLIT(e, lo, hi)
+  lo = _mm_sub_epi32(_mm_srli_epi32(lo, 23), bias);
+  hi = _mm_sub_epi32(_mm_srli_epi32(hi, 23), bias);
+  return _mm256_cvtepi32_ps(THVectorAVX_JOIN(lo, hi));
+}
+
+static inline __m256 THFloatSIMD_getmant(__m256 x)
+{
+  __m256 mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x007fffff));
+  return _mm256_or_ps(_mm256_and_ps(x, mask), _mm256_set1_ps(1.0f));
+}
+
+/* a < b ? x : y */
+static inline __m256 THFloatSIMD_selectlt(__m256 a, __m256 b, __m256 x, __m256 y)
+{
+  return _mm256_blendv_ps(y, x, _mm256_cmp_ps(a, b, _CMP_LT_OQ));
+}
+
+static inline __m256d THDoubleSIMD_round(__m256d x)
+{
+  return _mm256_round_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+
+/* 2^n, for an integer n in [-1022, 1023] */
+static inline __m256d THDoubleSIMD_pow2n(__m256d n)
+{
+  __m128i e = _mm_add_epi32(_mm256_cvtpd_epi32(n), _mm_set1_epi32(1023));
+  __m128i lo = _mm_slli_epi64(_mm_unpacklo_epi32(e, _mm_setzero_si128()), 52);
+  __m128i hi = _mm_slli_epi64(_mm_unpackhi_epi32(e, _mm_setzero_si128()), 52);
+  return _mm256_castsi256_pd(THVectorAVX_JOIN(lo, hi));
+}
+
+/* x*2^n, for an integer n in [-2044, 2046] */
+static inline __m256d THDoubleSIMD_ldexp(__m256d x, __m256d n)
+{
+  __m256d h = THDoubleSIMD_round(_mm256_mul_pd(n, _mm256_set1_pd(0.5)));
+  return _mm256_mul_pd(_mm256_mul_pd(x, THDoubleSIMD_pow2n(h)), THDoubleSIMD_pow2n(_mm256_sub_pd(n, h)));
+}
+
+/* the biased exponent is converted by putting it in the mantissa of 2^52 */
+static inline __m256d THDoubleSIMD_getexp(__m256d x)
+{
+  __m256i bits = _mm256_castpd_si256(x);
+  __m256d e;
+  THVectorAVX_SPLIT(bits, lo, hi)
+  e = _mm256_castsi256_pd(THVectorAVX_JOIN(_mm_srli_epi64(lo, 52), _mm_srli_epi64(hi, 52)));
+  return _mm256_sub_pd(_mm256_or_pd(e, _mm256_set1_pd(4503599627370496.0)), _mm256_set1_pd(4503599627370496.0+1023));
+}
+
+static inline __m256d THDoubleSIMD_getmant(__m256d x)
+{
+  __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x000fffffffffffffLL));
+  return _mm256_or_pd(_mm256_and_pd(x, mask), _mm256_set1_pd(1.0));
+}
+
+static inline __m256d THDoubleSIMD_selectlt(__m256d a, __m256d b, __m256d x, __m256d y)
+{
+  return _mm256_blendv_pd(y, x, _mm256_cmp_pd(a, b, _CMP_LT_OQ));
+}
+
+#define TH_GENERIC_FILE "generic/THVectorSIMD.c"
+#include "THGenerateFloatTypes.h"
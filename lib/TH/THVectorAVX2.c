@@ -0,0 +1,115 @@
+/* AVX2 and FMA versions of the THVector operations (see THVector.c), compiled
+   with -mavx2 -mfma */
+
+#include "THVector.h"
+#include <immintrin.h>
+
+#define TH_VECTOR_ISA AVX2
+#define THVectorSIMD_(NAME) TH_CONCAT_3(THVector_(NAME),_,TH_VECTOR_ISA)
+
+#define THFloatSIMD_t __m256
+#define THFloatSIMD_SIZE 8
+#define THFloatSIMD_load _mm256_loadu_ps
+#define THFloatSIMD_store _mm256_storeu_ps
+#define THFloatSIMD_set1 _mm256_set1_ps
+#define THFloatSIMD_add _mm256_add_ps
+#define THFloatSIMD_sub _mm256_sub_ps
+#define THFloatSIMD_mul _mm256_mul_ps
+#define THFloatSIMD_div _mm256_div_ps
+#define THFloatSIMD_max _mm256_max_ps
+#define THFloatSIMD_min _mm256_min_ps
+#define THFloatSIMD_fmadd _mm256_fmadd_ps
+
+#define THDoubleSIMD_t __m256d
+#define THDoubleSIMD_SIZE 4
+#define THDoubleSIMD_load _mm256_loadu_pd
+#define THDoubleSIMD_store _mm256_storeu_pd
+#define THDoubleSIMD_set1 _mm256_set1_pd
+#define THDoubleSIMD_add _mm256_add_pd
+#define THDoubleSIMD_sub _mm256_sub_pd
+#define THDoubleSIMD_mul _mm256_mul_pd
+#define THDoubleSIMD_div _mm256_div_pd
+#define THDoubleSIMD_max _mm256_max_pd
+#define THDoubleSIMD_min _mm256_min_pd
+#define THDoubleSIMD_fmadd _mm256_fmadd_pd
+
+/* exponent manipulations, for the transcendental functions (see
+   generic/THVectorSIMD.c) */
+
+/* rounds to the nearest integer */
+static inline __m256 THFloatSIMD_round(__m256 x)
+{
+  return _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+
+/* 2^n, for an integer n in [-126, 127] */
+static inline __m256 THFloatSIMD_pow2n(__m256 n)
+{
+  return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23));
+}
+
+/* x*2^n, for an integer n in [-252, 254] */
+static inline __m256 THFloatSIMD_ldexp(__m256 x, __m256 n)
+{
+  __m256 h = THFloatSIMD_round(_mm256_mul_ps(n, _mm256_set1_ps(0.5f)));
+  return _mm256_mul_ps(_mm256_mul_ps(x, THFloatSIMD_pow2n(h)), THFloatSIMD_pow2n(_mm256_sub_ps(n, h)));
+}
+
+/* exponent and mantissa (in [1, 2)) of a positive normal number */
+static inline __m256 THFloatSIMD_getexp(__m256 x)
+{
+  __m256i e = _mm256_srli_epi32(_mm256_castps_si256(x), 23);
+  return _mm256_cvtepi32_ps(_mm256_sub_epi32(e, _mm256_set1_epi32(127)));
+}
+
+static inline __m256 THFloatSIMD_getmant(__m256 x)
+{
+  __m256 mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x007fffff));
+  return _mm256_or_ps(_mm256_and_ps(x, mask), _mm256_set1_ps(1.0f));
+}
+
+/* a < b ? x : y */
+static inline __m256 THFloatSIMD_selectlt(__m256 a, __m256 b, __m256 x, __m256 y)
+{
+  return _mm256_blendv_ps(y, x, _mm256_cmp_ps(a, b, _CMP_LT_OQ));
+}
+
+static inline __m256d THDoubleSIMD_round(__m256d x)
+{
+  return _mm256_round_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+
+/* 2^n, for an integer n in [-1022, 1023] */
+static inline __m256d THDoubleSIMD_pow2n(__m256d n)
+{
+  __m128i e = _mm_add_epi32(_mm256_cvtpd_epi32(n), _mm_set1_epi32(1023));
+  return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_cvtepi32_epi64(e), 52));
+}
+
+/* x*2^n, for an integer n in [-2044, 2046] */
+static inline __m256d THDoubleSIMD_ldexp(__m256d x, __m256d n)
+{
+  __m256d h = THDoubleSIMD_round(_mm256_mul_pd(n, _mm256_set1_pd(0.5)));
+  return _mm256_mul_pd(_mm256_mul_pd(x, THDoubleSIMD_pow2n(h)), THDoubleSIMD_pow2n(_mm256_sub_pd(n, h)));
+}
+
+/* the biased exponent is converted by putting it in the mantissa of 2^52 */
+static inline __m256d THDoubleSIMD_getexp(__m256d x)
+{
+  __m256d e = _mm256_castsi256_pd(_mm256_srli_epi64(_mm256_castpd_si256(x), 52));
+  return _mm256_sub_pd(_mm256_or_pd(e, _mm256_set1_pd(4503599627370496.0)), _mm256_set1_pd(4503599627370496.0+1023));
+}
+
+static inline __m256d THDoubleSIMD_getmant(__m256d x)
+{
+  __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x000fffffffffffffLL));
+  return _mm256_or_pd(_mm256_and_pd(x, mask), _mm256_set1_pd(1.0));
+}
+
+static inline __m256d THDoubleSIMD_selectlt(__m256d a, __m256d b, __m256d x, __m256d y)
+{
+  return _mm256_blendv_pd(y, x, _mm256_cmp_pd(a, b, _CMP_LT_OQ));
+}
+
+#define TH_GENERIC_FILE "generic/THVectorSIMD.c"
+#include "THGenerateFloatTypes.h"
@@ -0,0 +1,51 @@
+/* AVX-512 versions of the THVector operations (see THVector.c), compiled with
+   -mavx512f */
+
+#include "THVector.h"
+#include <immintrin.h>
+
+#define TH_VECTOR_ISA AVX512
+#define THVectorSIMD_(NAME) TH_CONCAT_3(THVector_(NAME),_,TH_VECTOR_ISA)
+
+#define THFloatSIMD_t __m512
+#define THFloatSIMD_SIZE 16
+#define THFloatSIMD_load _mm512_loadu_ps
+#define THFloatSIMD_store _mm512_storeu_ps
+#define THFloatSIMD_set1 _mm512_set1_ps
+#define THFloatSIMD_add _mm512_add_ps
+#define THFloatSIMD_sub _mm512_sub_ps
+#define THFloatSIMD_mul _mm512_mul_ps
+#define THFloatSIMD_div _mm512_div_ps
+#define THFloatSIMD_max _mm512_max_ps
+#define THFloatSIMD_min _mm512_min_ps
+#define THFloatSIMD_fmadd _mm512_fmadd_ps
+
+#define THDoubleSIMD_t __m512d
+#define THDoubleSIMD_SIZE 8
+#define THDoubleSIMD_load _mm512_loadu_pd
+#define THDoubleSIMD_store _mm512_storeu_pd
+#define THDoubleSIMD_set1 _mm512_set1_pd
+#define THDoubleSIMD_add _mm512_add_pd
+#define THDoubleSIMD_sub _mm512_sub_pd
+#define THDoubleSIMD_mul _mm512_mul_pd
+#define THDoubleSIMD_div _mm512_div_pd
+#define THDoubleSIMD_max _mm512_max_pd
+#define THDoubleSIMD_min _mm512_min_pd
+#define THDoubleSIMD_fmadd _mm512_fmadd_pd
+
+/* exponent manipulations, for the transcendental functions (see
+   generic/THVectorSIMD.c): AVX-512 has instructions for all of them */
+#define THFloatSIMD_round(x) _mm512_roundscale_ps(x, _MM_FROUND_TO_NEAREST_INT)
+#define THFloatSIMD_ldexp _mm512_scalef_ps
+#define THFloatSIMD_getexp _mm512_getexp_ps
+#define THFloatSIMD_getmant(x) _mm512_getmant_ps(x, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_src)
+#define THFloatSIMD_selectlt(a, b, x, y) _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, b, _CMP_LT_OQ), y, x)
+
+#define THDoubleSIMD_round(x) _mm512_roundscale_pd(x, _MM_FROUND_TO_NEAREST_INT)
+#define THDoubleSIMD_ldexp _mm512_scalef_pd
+#define THDoubleSIMD_getexp _mm512_getexp_pd
+#define THDoubleSIMD_getmant(x) _mm512_getmant_pd(x, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_src)
+#define THDoubleSIMD_selectlt(a, b, x, y) _mm512_mask_blend_pd(_mm512_cmp_pd_mask(a, b, _CMP_LT_OQ), y, x)
+
+#define TH_GENERIC_FILE "generic/THVectorSIMD.c"
+#include "THGenerateFloatTypes.h"
@@ -0,0 +1,116 @@
+/* SSE2 versions of the THVector operations (see THVector.c) */
+
+#include "THVector.h"
+#include <emmintrin.h>
+
+#define TH_VECTOR_ISA SSE2
+#define THVectorSIMD_(NAME) TH_CONCAT_3(THVector_(NAME),_,TH_VECTOR_ISA)
+
+#define THFloatSIMD_t __m128
+#define THFloatSIMD_SIZE 4
+#define THFloatSIMD_load _mm_loadu_ps
+#define THFloatSIMD_store _mm_storeu_ps
+#define THFloatSIMD_set1 _mm_set1_ps
+#define THFloatSIMD_add _mm_add_ps
+#define THFloatSIMD_sub _mm_sub_ps
+#define THFloatSIMD_mul _mm_mul_ps
+#define THFloatSIMD_div _mm_div_ps
+#define THFloatSIMD_max _mm_max_ps
+#define THFloatSIMD_min _mm_min_ps
+#define THFloatSIMD_fmadd(a, b, c) _mm_add_ps(_mm_mul_ps(a, b), c)
+
+#define THDoubleSIMD_t __m128d
+#define THDoubleSIMD_SIZE 2
+#define THDoubleSIMD_load _mm_loadu_pd
+#define THDoubleSIMD_store _mm_storeu_pd
+#define THDoubleSIMD_set1 _mm_set1_pd
+#define THDoubleSIMD_add _mm_add_pd
+#define THDoubleSIMD_sub _mm_sub_pd
+#define THDoubleSIMD_mul _mm_mul_pd
+#define THDoubleSIMD_div _mm_div_pd
+#define THDoubleSIMD_max _mm_max_pd
+#define THDoubleSIMD_min _mm_min_pd
+#define THDoubleSIMD_fmadd(a, b, c) _mm_add_pd(_mm_mul_pd(a, b), c)
+
+/* exponent manipulations, for the transcendental functions (see
+   generic/THVectorSIMD.c) */
+
+/* rounds to the nearest integer (|x| < 2^31) */
+static inline __m128 THFloatSIMD_round(__m128 x)
+{
+  return _mm_cvtepi32_ps(_mm_cvtps_epi32(x));
+}
+
+/* 2^n, for an integer n in [-126, 127] */
+static inline __m128 THFloatSIMD_pow2n(__m128 n)
+{
+  return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127)), 23));
+}
+
+/* x*2^n, for an integer n in [-252, 254] */
+static inline __m128 THFloatSIMD_ldexp(__m128 x, __m128 n)
+{
+  __m128 h = THFloatSIMD_round(_mm_mul_ps(n, _mm_set1_ps(0.5f)));
+  return _mm_mul_ps(_mm_mul_ps(x, THFloatSIMD_pow2n(h)), THFloatSIMD_pow2n(_mm_sub_ps(n, h)));
+}
+
+/* exponent and mantissa (in [1, 2)) of a positive normal number */
+static inline __m128 THFloatSIMD_getexp(__m128 x)
+{
+  __m128i e = _mm_srli_epi32(_mm_castps_si128(x), 23);
+  return _mm_cvtepi32_ps(_mm_sub_epi32(e, _mm_set1_epi32(127)));
+}
+
+static inline __m128 THFloatSIMD_getmant(__m128 x)
+{
+  __m128 mask = _mm_castsi128_ps(_mm_set1_epi32(0x007fffff));
+  return _mm_or_ps(_mm_and_ps(x, mask), _mm_set1_ps(1.0f));
+}
+
+/* a < b ? x : y */
+static inline __m128 THFloatSIMD_selectlt(__m128 a, __m128 b, __m128 x, __m128 y)
+{
+  __m128 m = _mm_cmplt_ps(a, b);
+  return _mm_or_ps(_mm_and_ps(m, x), _mm_andnot_ps(m, y));
+}
+
+static inline __m128d THDoubleSIMD_round(__m128d x)
+{
+  return _mm_cvtepi32_pd(_mm_cvtpd_epi32(x));
+}
+
+/* 2^n, for an integer n in [-1022, 1023] */
+static inline __m128d THDoubleSIMD_pow2n(__m128d n)
+{
+  __m128i e = _mm_add_epi32(_mm_cvtpd_epi32(n), _mm_set1_epi32(1023));
+  return _mm_castsi128_pd(_mm_slli_epi64(_mm_unpacklo_epi32(e, _mm_setzero_si128()), 52));
+}
+
+/* x*2^n, for an integer n in [-2044, 2046] */
+static inline __m128d THDoubleSIMD_ldexp(__m128d x, __m128d n)
+{
+  __m128d h = THDoubleSIMD_round(_mm_mul_pd(n, _mm_set1_pd(0.5)));
+  return _mm_mul_pd(_mm_mul_pd(x, THDoubleSIMD_pow2n(h)), THDoubleSIMD_pow2n(_mm_sub_pd(n, h)));
+}
+
+/* the biased exponent is converted by putting it in the mantissa of 2^52 */
+static inline __m128d THDoubleSIMD_getexp(__m128d x)
+{
+  __m128d e = _mm_castsi128_pd(_mm_srli_epi64(_mm_castpd_si128(x), 52));
+  return _mm_sub_pd(_mm_or_pd(e, _mm_set1_pd(4503599627370496.0)), _mm_set1_pd(4503599627370496.0+1023));
+}
+
+static inline __m128d THDoubleSIMD_getmant(__m128d x)
+{
+  __m128d mask = _mm_castsi128_pd(_mm_set1_epi64x(0x000fffffffffffffLL));
+  return _mm_or_pd(_mm_and_pd(x, mask), _mm_set1_pd(1.0));
+}
+
+static inline __m128d THDoubleSIMD_selectlt(__m128d a, __m128d b, __m128d x, __m128d y)
+{
+  __m128d m = _mm_cmplt_pd(a, b);
+  return _mm_or_pd(_mm_and_pd(m, x), _mm_andnot_pd(m, y));
+}
+
+#define TH_GENERIC_FILE "generic/THVectorSIMD.c"
+#include "THGenerateFloatTypes.h"
@@ -154,6 +154,8 @@ real THBlas_(dot)(long n, real *x, long incx, real *y, long incy)
 #endif
   }
 #endif
+  if( (incx == 1) && (incy == 1) )
+    return (real)THVector_(dot)(x, y, n);
   {
     long i;
     real sum = 0;
@@ -256,38 +258,284 @@ void THBlas_(ger)(long m, long n, real alpha, real *x, long incx, real *y, long
   }
 }
 
-void THBlas_(gemm)(char transa, char transb, long m, long n, long k, real alpha, real *a, long lda, real *b, long ldb, real beta, real *c, long ldc)
+/* reference triple loop; as in BLAS, c is not read when beta is 0 */
+static void THBlas_(gemmReference)(int transa_, int transb_, long m, long n, long k, real alpha, real *a, long lda, real *b, long ldb, real beta, real *c, long ldc)
 {
-  int transa_ = ((transa == 't') || (transa == 'T'));
-  int transb_ = ((transb == 't') || (transb == 'T'));
+  long i, j, l;
+  if(!transa_ && !transb_)
+  {
+    real *a_ = a;
+    for(i = 0; i < m; i++)
+    {
+      real *b_ = b;
+      for(j = 0; j < n; j++)
+      {
+        real sum = 0;
+        for(l = 0; l < k; l++)
+          sum += a_[l*lda]*b_[l];
+        b_ += ldb;
+        c[j*ldc+i] = (beta == 0 ? alpha*sum : beta*c[j*ldc+i]+alpha*sum);
+      }
+      a_++;
+    }
+  }
+  else if(transa_ && !transb_)
+  {
+    real *a_ = a;
+    for(i = 0; i < m; i++)
+    {
+      real *b_ = b;
+      for(j = 0; j < n; j++)
+      {
+        real sum = 0;
+        for(l = 0; l < k; l++)
+          sum += a_[l]*b_[l];
+        b_ += ldb;
+        c[j*ldc+i] = (beta == 0 ? alpha*sum : beta*c[j*ldc+i]+alpha*sum);
+      }
+      a_ += lda;
+    }
+  }
+  else if(!transa_ && transb_)
+  {
+    real *a_ = a;
+    for(i = 0; i < m; i++)
+    {
+      real *b_ = b;
+      for(j = 0; j < n; j++)
+      {
+        real sum = 0;
+        for(l = 0; l < k; l++)
+          sum += a_[l*lda]*b_[l*ldb];
+        b_++;
+        c[j*ldc+i] = (beta == 0 ? alpha*sum : beta*c[j*ldc+i]+alpha*sum);
+      }
+      a_++;
+    }
+  }
+  else
+  {
+    real *a_ = a;
+    for(i = 0; i < m; i++)
+    {
+      real *b_ = b;
+      for(j = 0; j < n; j++)
+      {
+        real sum = 0;
+        for(l = 0; l < k; l++)
+          sum += a_[l]*b_[l*ldb];
+        b_++;
+        c[j*ldc+i] = (beta == 0 ? alpha*sum : beta*c[j*ldc+i]+alpha*sum);
+      }
+      a_ += lda;
+    }
+  }
+}
+
+/* packs the mc x kc block of op(A) starting at (i0, p0), in panels of mr
+   rows (zero-padded), each stored row by row */
+static void THBlas_(gemmPackA)(int transa_, real *a, long lda, long i0, long p0, long mc, long kc, long mr, real *pa)
+{
+  long ir, p, i;
+
+  for(ir = 0; ir < mc; ir += mr)
+  {
+    long mr_ = THMin(mr, mc-ir);
+    for(p = 0; p < kc; p++, pa += mr)
+    {
+      if(transa_)
+      {
+        real *a_ = a + (p0+p) + (i0+ir)*lda;
+        for(i = 0; i < mr_; i++)
+          pa[i] = a_[i*lda];
+      }
+      else
+      {
+        real *a_ = a + (i0+ir) + (p0+p)*lda;
+        for(i = 0; i < mr_; i++)
+          pa[i] = a_[i];
+      }
+      for(i = mr_; i < mr; i++)
+        pa[i] = 0;
+    }
+  }
+}
+
+/* packs the kc x nr panel of op(B) starting at (p0, j0) (zero-padded),
+   stored row by row */
+static void THBlas_(gemmPackB)(int transb_, real *b, long ldb, long p0, long j0, long kc, long nr_, real *pb)
+{
+  long p, j;
+
+  for(p = 0; p < kc; p++, pb += THBlas_GEMM_NR)
+  {
+    if(transb_)
+    {
+      real *b_ = b + j0 + (p0+p)*ldb;
+      for(j = 0; j < nr_; j++)
+        pb[j] = b_[j];
+    }
+    else
+    {
+      real *b_ = b + (p0+p) + j0*ldb;
+      for(j = 0; j < nr_; j++)
+        pb[j] = b_[j*ldb];
+    }
+    for(j = nr_; j < THBlas_GEMM_NR; j++)
+      pb[j] = 0;
+  }
+}
+
+/* Built-in gemm: the packed panels of op(A) and op(B) are multiplied by
+   the register-blocked micro-kernel THVector_(gemmKernel). Threads share the
+   packing of op(B), and then split the MC x NC blocks of C, over M first, and
+   over N as well when there are not enough blocks along M. */
+static void THBlas_(gemmBuiltin)(int transa_, int transb_, long m, long n, long k, real alpha, real *a, long lda, real *b, long ldb, real beta, real *c, long ldc)
+{
+  long mr = THVector_(gemmMR)();
+  long nr = THBlas_GEMM_NR;
+  long kcmax = THMin(k, THBlas_GEMM_KC);
+  long ncmax = (THMin(n, THBlas_GEMM_NC)+nr-1)/nr*nr;
+  int nthread = 1;
+  int parallel = 0;
+  long mc, mblock, ngroup;
+  real *pa, *pb;
+  long j;
+
+  if(mr > THBlas_GEMM_MR_MAX)
+    THError("gemm micro-kernel is too large");
+
+  /* C = beta*C (C is not read when beta is 0) */
+  for(j = 0; j < n; j++)
+  {
+    if(beta == 0)
+      THVector_(fill)(c+j*ldc, 0, m);
+    else if(beta != 1)
+      THVector_(scale)(c+j*ldc, beta, m);
+  }
+
+  if(alpha == 0 || k == 0)
+    return;
+
+#ifdef _OPENMP
+  if((double)m*n*k >= THBlas_GEMM_MIN_PARALLEL && !omp_in_parallel())
+  {
+    nthread = THGetNumThreads();
+    parallel = (nthread > 1);
+  }
+#endif
+
+  /* enough blocks along M to keep all threads busy, if possible */
+  mc = THBlas_GEMM_MC/mr*mr;
+  if((m+mc-1)/mc < nthread)
+    mc = THMax(((m+nthread-1)/nthread+mr-1)/mr*mr, mr);
+  mblock = (m+mc-1)/mc;
+  ngroup = THMax(nthread/mblock, 1);
 
+  pb = (real*)THAlloc(sizeof(real)*kcmax*ncmax);
+  pa = (real*)THAlloc(sizeof(real)*nthread*((mc+mr-1)/mr*mr)*kcmax);
+
+#pragma omp parallel if(parallel)
+  {
+    real *pa_ = pa;
+    long jc, pc;
+#ifdef _OPENMP
+    pa_ += omp_get_thread_num()*((mc+mr-1)/mr*mr)*kcmax;
+#endif
+
+    for(jc = 0; jc < n; jc += THBlas_GEMM_NC)
+    {
+      long nc = THMin(THBlas_GEMM_NC, n-jc);
+      long npanel = (nc+nr-1)/nr;
+
+      for(pc = 0; pc < k; pc += THBlas_GEMM_KC)
+      {
+        long kc = THMin(THBlas_GEMM_KC, k-pc);
+        long jp, item;
+
+#pragma omp for schedule(static)
+        for(jp = 0; jp < npanel; jp++)
+          THBlas_(gemmPackB)(transb_, b, ldb, pc, jc+jp*nr, kc, THMin(nr, nc-jp*nr), pb+jp*nr*kc);
+
+#pragma omp for schedule(static)
+        for(item = 0; item < mblock*ngroup; item++)
+        {
+          long ic = (item/ngroup)*mc;
+          long mc_ = THMin(mc, m-ic);
+          long jp0 = npanel*(item%ngroup)/ngroup;
+          long jp1 = npanel*(item%ngroup+1)/ngroup;
+          long ir;
+
+          THBlas_(gemmPackA)(transa_, a, lda, ic, pc, mc_, kc, mr, pa_);
+
+          for(jp = jp0; jp < jp1; jp++)
+          {
+            long nr_ = THMin(nr, nc-jp*nr);
+            for(ir = 0; ir < mc_; ir += mr)
+            {
+              long mr_ = THMin(mr, mc_-ir);
+              real *c_ = c + (ic+ir) + (jc+jp*nr)*ldc;
+
+              if(mr_ == mr && nr_ == nr)
+                THVector_(gemmKernel)(kc, alpha, pa_+ir*kc, pb+jp*nr*kc, c_, ldc);
+              else
+              {
+                /* partial block on the edges of C */
+                real tmp[THBlas_GEMM_MR_MAX*THBlas_GEMM_NR];
+                long i, jj;
+                for(i = 0; i < mr*nr; i++)
+                  tmp[i] = 0;
+                THVector_(gemmKernel)(kc, alpha, pa_+ir*kc, pb+jp*nr*kc, tmp, mr);
+                for(jj = 0; jj < nr_; jj++)
+                {
+                  for(i = 0; i < mr_; i++)
+                    c_[jj*ldc+i] += tmp[jj*mr+i];
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  THFree(pa);
+  THFree(pb);
+}
+
+/* leading dimensions of vectors may be anything: make them valid for BLAS */
+static void THBlas_(gemmFixLeadingDims)(int transa_, int transb_, long m, long n, long k, long *lda, long *ldb, long *ldc)
+{
   if(n == 1)
-    ldc = m;
+    *ldc = m;
 
   if(transa_)
   {
     if(m == 1)
-      lda = k;
+      *lda = k;
   }
   else
   {
     if(k == 1)
-      lda = m;
+      *lda = m;
   }
 
   if(transb_)
   {
     if(k == 1)
-      ldb = n;
+      *ldb = n;
   }
   else
   {
     if(n == 1)
-      ldb = k;
+      *ldb = k;
   }
+}
 
+static void THBlas_(gemmRun)(char transa, char transb, int transa_, int transb_, long m, long n, long k, real alpha, real *a, long lda, real *b, long ldb, real beta, real *c, long ldc)
+{
 #if defined(USE_BLAS) && (defined(TH_REAL_IS_DOUBLE) || defined(TH_REAL_IS_FLOAT))
-  if( (m <= INT_MAX) && (n <= INT_MAX) && (k <= INT_MAX) && (lda <= INT_MAX)  && (ldb <= INT_MAX) && (ldc <= INT_MAX) )
+  if( (THBlas_getGemmMode() == TH_GEMM_BLAS) && (m <= INT_MAX) && (n <= INT_MAX) && (k <= INT_MAX) && (lda <= INT_MAX)  && (ldb <= INT_MAX) && (ldc <= INT_MAX) )
   {
     int i_m = (int)m;
     int i_n = (int)n;
@@ -306,77 +554,44 @@ void THBlas_(gemm)(char transa, char transb, long m, long n, long k, real alpha,
     return;
   }
 #endif
-  {
-    long i, j, l;
-    if(!transa_ && !transb_)
-    {
-      real *a_ = a;
-      for(i = 0; i < m; i++)
-      {
-        real *b_ = b;
-        for(j = 0; j < n; j++)
-        {
-          real sum = 0;
-          for(l = 0; l < k; l++)
-            sum += a_[l*lda]*b_[l];
-          b_ += ldb;
-          c[j*ldc+i] = beta*c[j*ldc+i]+alpha*sum;
-        }
-        a_++;
-      }
-    }
-    else if(transa_ && !transb_)
-    {
-      real *a_ = a;
-      for(i = 0; i < m; i++)
-      {
-        real *b_ = b;
-        for(j = 0; j < n; j++)
-        {
-          real sum = 0;
-          for(l = 0; l < k; l++)
-            sum += a_[l]*b_[l];
-          b_ += ldb;
-          c[j*ldc+i] = beta*c[j*ldc+i]+alpha*sum;
-        }
-        a_ += lda;
-      }
-    }
-    else if(!transa_ && transb_)
-    {
-      real *a_ = a;
-      for(i = 0; i < m; i++)
-      {
-        real *b_ = b;
-        for(j = 0; j < n; j++)
-        {
-          real sum = 0;
-          for(l = 0; l < k; l++)
-            sum += a_[l*lda]*b_[l*ldb];
-          b_++;
-          c[j*ldc+i] = beta*c[j*ldc+i]+alpha*sum;
-        }
-        a_++;
-      }
-    }
-    else
-    {
-      real *a_ = a;
-      for(i = 0; i < m; i++)
-      {
-        real *b_ = b;
-        for(j = 0; j < n; j++)
-        {
-          real sum = 0;
-          for(l = 0; l < k; l++)
-            sum += a_[l]*b_[l*ldb];
-          b_++;
-          c[j*ldc+i] = beta*c[j*ldc+i]+alpha*sum;
-        }
-        a_ += lda;
-      }
-    }
-  }
+
+  if(THBlas_getGemmMode() == TH_GEMM_REFERENCE || (double)m*n*k < THBlas_GEMM_MIN_BUILTIN)
+    THBlas_(gemmReference)(transa_, transb_, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+  else
+    THBlas_(gemmBuiltin)(transa_, transb_, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+}
+
+void THBlas_(gemm)(char transa, char transb, long m, long n, long k, real alpha, real *a, long lda, real *b, long ldb, real beta, real *c, long ldc)
+{
+  int transa_ = ((transa == 't') || (transa == 'T'));
+  int transb_ = ((transb == 't') || (transb == 'T'));
+
+  THBlas_(gemmFixLeadingDims)(transa_, transb_, m, n, k, &lda, &ldb, &ldc);
+  THBlas_(gemmRun)(transa, transb, transa_, transb_, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+}
+
+void THBlas_(gemmBatched)(char transa, char transb, long batch, long m, long n, long k,
+                          real alpha, real *a, long lda, long strideA, real *b, long ldb, long strideB,
+                          real beta, real *c, long ldc, long strideC)
+{
+  int transa_ = ((transa == 't') || (transa == 'T'));
+  int transb_ = ((transb == 't') || (transb == 'T'));
+  int parallel = 0;
+  long i;
+
+  THBlas_(gemmFixLeadingDims)(transa_, transb_, m, n, k, &lda, &ldb, &ldc);
+
+#ifdef _OPENMP
+  /* split the batch across threads, unless each product is large enough to
+     be parallelized on its own and there are not enough of them */
+  parallel = (batch > 1) && !omp_in_parallel()
+    && ((double)m*n*k*batch >= THBlas_GEMM_MIN_BATCH_PARALLEL)
+    && ((double)m*n*k < THBlas_GEMM_MIN_PARALLEL || batch >= omp_get_max_threads());
+#endif
+
+#pragma omp parallel for if(parallel) private(i)
+  for(i = 0; i < batch; i++)
+    THBlas_(gemmRun)(transa, transb, transa_, transb_, m, n, k, alpha, a+i*strideA, lda, b+i*strideB, ldb, beta, c+i*strideC, ldc);
 }
 
 #endif
@@ -15,5 +15,10 @@ void THBlas_(ger)(long m, long n, real alpha, real *x, long incx, real *y, long
 
 /* Level 3 */
 void THBlas_(gemm)(char transa, char transb, long m, long n, long k, real alpha, real *a, long lda, real *b, long ldb, real beta, real *c, long ldc);
+/* batch products c[i] = alpha*a[i]*b[i] + beta*c[i], where the i-th matrix of
+   x starts at x + i*strideX (strides may be 0 to reuse the same matrix) */
+void THBlas_(gemmBatched)(char transa, char transb, long batch, long m, long n, long k,
+                          real alpha, real *a, long lda, long strideA, real *b, long ldb, long strideB,
+                          real beta, real *c, long ldc, long strideC);
 
 #endif
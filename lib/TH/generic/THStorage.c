@@ -24,6 +24,7 @@ THStorage* THStorage_(newWithSize)(long size)
   storage->size = size;
   storage->refcount = 1;
   storage->flag = TH_STORAGE_REFCOUNTED | TH_STORAGE_RESIZABLE | TH_STORAGE_FREEMEM;
+  THStorage_countMemory(THStorage_(TYPE), sizeof(real)*size);
   return storage;
 }
 
@@ -65,7 +66,7 @@ THStorage* THStorage_(newWithSize4)(real data0, real data1, real data2, real dat
 
 THStorage* THStorage_(newWithMapping)(const char *fileName, int isShared)
 {
-  THStorage *storage = THAlloc(sizeof(THStorage));
+  THStorage *storage;
   long size;
 
   /* check size */
@@ -125,6 +126,7 @@ THStorage* THStorage_(newWithMapping)(const char *fileName, int isShared)
       storage->data = MapViewOfFile(hmfile, FILE_MAP_COPY, 0, 0, 0);
       
     storage->size = size;
+    THStorage_countMemory(THStorage_(TYPE), sizeof(real)*size);
     if(storage->data == NULL)
     {
       THStorage_(free)(storage);
@@ -158,6 +160,7 @@ THStorage* THStorage_(newWithMapping)(const char *fileName, int isShared)
       storage->data = mmap(NULL, size*sizeof(real), PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
 
     storage->size = size;
+    THStorage_countMemory(THStorage_(TYPE), sizeof(real)*size);
     if(storage->data == MAP_FAILED)
     {
       storage->data = NULL; /* let's be sure it is NULL before calling free() */
@@ -173,6 +176,86 @@ THStorage* THStorage_(newWithMapping)(const char *fileName, int isShared)
   return storage;
 }
 
+THStorage* THStorage_(newWithMappingRange)(const char *fileName, long offset, long size, int isShared)
+{
+  THStorage *storage;
+  long granularity = THStorage_mapGranularity();
+  long start = offset - offset % granularity; /* mappings must start on a boundary */
+  long length = offset - start + size*sizeof(real);
+  long fileSize;
+  FILE *f;
+
+  THArgCheck(offset >= 0, 2, "offset must be positive");
+  THArgCheck(size >= 0, 3, "size must be positive");
+
+  /* check size: pages beyond the end of the file cannot be accessed */
+  f = fopen(fileName, "rb");
+  if(f == NULL)
+    THError("unable to open file <%s> for mapping (read-only mode)", fileName);
+  fseek(f, 0, SEEK_END);
+  fileSize = ftell(f);
+  fclose(f);
+  if(offset + (long)sizeof(real)*size > fileSize)
+    THError("range [%ld, %ld[ is out of file <%s> (%ld bytes)", offset, offset + (long)sizeof(real)*size, fileName, fileSize);
+
+  if(size == 0)
+    return THStorage_(new)();
+
+#ifdef _WIN32
+  {
+    HANDLE hfile;
+    HANDLE hmfile;
+    char *data;
+
+    hfile = CreateFileA(fileName, (isShared ? GENERIC_READ|GENERIC_WRITE : GENERIC_READ), FILE_SHARE_WRITE|FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (hfile == INVALID_HANDLE_VALUE)
+      THError("could not open file <%s> in %s mode", fileName, (isShared ? "read-write" : "read-only"));
+
+    if( (hmfile = CreateFileMapping(hfile, NULL, (isShared ? PAGE_READWRITE : PAGE_WRITECOPY), 0, 0, NULL)) == NULL )
+    {
+      CloseHandle(hfile);
+      THError("could not create a map on file <%s>", fileName);
+    }
+
+#if SIZEOF_SIZE_T > 4
+    data = MapViewOfFile(hmfile, (isShared ? FILE_MAP_ALL_ACCESS : FILE_MAP_COPY), (DWORD)(start >> 32), (DWORD)(start & 0xFFFFFFFF), length);
+#else
+    data = MapViewOfFile(hmfile, (isShared ? FILE_MAP_ALL_ACCESS : FILE_MAP_COPY), 0, (DWORD)start, length);
+#endif
+    CloseHandle(hfile);
+    CloseHandle(hmfile);
+    if(data == NULL)
+      THError("memory map failed on file <%s>", fileName);
+
+    storage = THAlloc(sizeof(THStorage));
+    storage->data = (real*)(data + (offset - start));
+  }
+#else
+  {
+    int fd;
+    char *data;
+
+    fd = open(fileName, (isShared ? O_RDWR : O_RDONLY));
+    if(fd == -1)
+      THError("unable to open file <%s> in %s mode", fileName, (isShared ? "read-write" : "read-only"));
+
+    data = mmap(NULL, length, PROT_READ|PROT_WRITE, (isShared ? MAP_SHARED : MAP_PRIVATE), fd, start);
+    close(fd);
+    if(data == MAP_FAILED)
+      THError("memory map failed on file <%s>", fileName);
+
+    storage = THAlloc(sizeof(THStorage));
+    storage->data = (real*)(data + (offset - start));
+  }
+#endif
+
+  storage->size = size;
+  storage->refcount = 1;
+  storage->flag = TH_STORAGE_REFCOUNTED | TH_STORAGE_MAPPED | TH_STORAGE_FREEMEM;
+  THStorage_countMemory(THStorage_(TYPE), sizeof(real)*size);
+  return storage;
+}
+
 #else
 
 THStorage* THStorage_(newWithMapping)(const char *fileName, int isShared)
@@ -180,6 +263,11 @@ THStorage* THStorage_(newWithMapping)(const char *fileName, int isShared)
   THError("Mapped file Storages are not supported on your system");
 }
 
+THStorage* THStorage_(newWithMappingRange)(const char *fileName, long offset, long size, int isShared)
+{
+  THError("Mapped file Storages are not supported on your system");
+}
+
 #endif
 
 void THStorage_(setFlag)(THStorage *storage, const char flag)
@@ -198,6 +286,22 @@ void THStorage_(retain)(THStorage *storage)
     ++storage->refcount;
 }
 
+#if defined(_WIN32) || defined(HAVE_MMAP)
+/* unmaps the data of a mapped storage */
+static void THStorage_(unmap)(THStorage *storage)
+{
+  /* the data of a mapped range does not start on a mapping boundary */
+  long delta = (long)((size_t)storage->data % THStorage_mapGranularity());
+  char *start = (char*)storage->data - delta;
+#ifdef _WIN32
+  if(!UnmapViewOfFile((LPINT)start))
+#else
+  if(munmap(start, delta + storage->size*sizeof(real)))
+#endif
+    THError("could not unmap the shared memory file");
+}
+#endif
+
 void THStorage_(free)(THStorage *storage)
 {
   if(!storage)
@@ -207,18 +311,12 @@ void THStorage_(free)(THStorage *storage)
   {
     if(--storage->refcount == 0)
     {
+      THStorage_countMemory(THStorage_(TYPE), -(long)sizeof(real)*storage->size);
       if(storage->flag & TH_STORAGE_FREEMEM)
       {
 #if defined(_WIN32) || defined(HAVE_MMAP)
         if(storage->flag & TH_STORAGE_MAPPED)
-        {
-#ifdef _WIN32
-          if(!UnmapViewOfFile((LPINT)storage->data))
-#else
-            if (munmap(storage->data, storage->size*sizeof(real)))
-#endif
-              THError("could not unmap the shared memory file");
-        }
+          THStorage_(unmap)(storage);
         else
 #endif
           THFree(storage->data);
@@ -235,6 +333,7 @@ THStorage* THStorage_(newWithData)(real *data, long size)
   storage->size = size;
   storage->refcount = 1;
   storage->flag = TH_STORAGE_REFCOUNTED | TH_STORAGE_RESIZABLE | TH_STORAGE_FREEMEM;
+  THStorage_countMemory(THStorage_(TYPE), sizeof(real)*size);
   return storage;
 }
 
@@ -242,9 +341,40 @@ void THStorage_(resize)(THStorage *storage, long size)
 {
   if(storage->flag & TH_STORAGE_RESIZABLE)
   {
+    long oldSize = storage->size;
     storage->data = THRealloc(storage->data, sizeof(real)*size);
     storage->size = size;
+    THStorage_countMemory(THStorage_(TYPE), (long)sizeof(real)*(size-oldSize));
   }
+#if defined(_WIN32) || defined(HAVE_MMAP)
+  else if((storage->flag & TH_STORAGE_MAPPED) && (storage->flag & TH_STORAGE_FREEMEM) && size != storage->size)
+  {
+    /* a mapping cannot be resized: the data is copied in memory of its own,
+       and the storage is not mapped anymore */
+    long oldSize = storage->size;
+    real *data = THAlloc(sizeof(real)*size);
+    memcpy(data, storage->data, sizeof(real)*THMin(size, oldSize));
+    THStorage_(unmap)(storage);
+    storage->data = data;
+    storage->size = size;
+    storage->flag = (storage->flag & ~TH_STORAGE_MAPPED) | TH_STORAGE_RESIZABLE;
+    THStorage_countMemory(THStorage_(TYPE), (long)sizeof(real)*(size-oldSize));
+  }
+#endif
+}
+
+void THStorage_(swap)(THStorage *storage1, THStorage *storage2)
+{
+  real *data = storage1->data;
+  long size = storage1->size;
+  char flag = storage1->flag;
+
+  storage1->data = storage2->data;
+  storage1->size = storage2->size;
+  storage1->flag = storage2->flag;
+  storage2->data = data;
+  storage2->size = size;
+  storage2->flag = flag;
 }
 
 void THStorage_(fill)(THStorage *storage, real value)
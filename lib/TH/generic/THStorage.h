@@ -21,6 +21,7 @@
 #define TH_STORAGE_MAPPED     4
 #define TH_STORAGE_FREEMEM    8
 
+/* also declared for the LuaJIT FFI in pkg/torch/FFI.lua */
 typedef struct THStorage
 {
     real *data;
@@ -44,12 +45,16 @@ TH_API THStorage* THStorage_(newWithSize2)(real, real);
 TH_API THStorage* THStorage_(newWithSize3)(real, real, real);
 TH_API THStorage* THStorage_(newWithSize4)(real, real, real, real);
 TH_API THStorage* THStorage_(newWithMapping)(const char *fileName, int isShared);
+/* maps size elements of the file, starting at byte offset (which need not be aligned) */
+TH_API THStorage* THStorage_(newWithMappingRange)(const char *fileName, long offset, long size, int isShared);
 TH_API THStorage* THStorage_(newWithData)(real *data, long size);
 
 /* should not differ with API */
 TH_API void THStorage_(setFlag)(THStorage *storage, const char flag);
 TH_API void THStorage_(clearFlag)(THStorage *storage, const char flag);
 TH_API void THStorage_(retain)(THStorage *storage);
+/* exchanges the contents (data, size and flags) of two storages */
+TH_API void THStorage_(swap)(THStorage *storage1, THStorage *storage2);
 
 /* might differ with other API (like CUDA) */
 TH_API void THStorage_(free)(THStorage *storage);
@@ -67,6 +67,7 @@ void THTensor_(clearFlag)(THTensor *self, const char flag)
 static void THTensor_(rawInit)(THTensor *self);
 static void THTensor_(rawSet)(THTensor *self, THStorage *storage, long storageOffset, int nDimension, long *size, long *stride);
 static void THTensor_(rawResize)(THTensor *self, int nDimension, long *size, long *stride);
+static void THTensor_(rawResizeDim)(THTensor *self, int nDimension);
 
 
 /* Empty init */
@@ -417,9 +418,6 @@ void THTensor_(transpose)(THTensor *self, THTensor *src, int dimension1, int dim
 
 void THTensor_(unfold)(THTensor *self, THTensor *src, int dimension, long size, long step)
 {
-  long *newSize;
-  long *newStride;
-  int d;
 
   if(!src)
     src = self;
@@ -430,31 +428,12 @@ void THTensor_(unfold)(THTensor *self, THTensor *src, int dimension, long size,
   THArgCheck(step > 0, 4, "invalid step");
 
   THTensor_(set)(self, src);
+  THTensor_(rawResizeDim)(self, self->nDimension+1);
 
-  newSize = THAlloc(sizeof(long)*(self->nDimension+1));
-  newStride = THAlloc(sizeof(long)*(self->nDimension+1));
-
-  newSize[self->nDimension] = size;
-  newStride[self->nDimension] = self->stride[dimension];
-  for(d = 0; d < self->nDimension; d++)
-  {
-    if(d == dimension)
-    {
-      newSize[d] = (self->size[d] - size) / step + 1;
-      newStride[d] = step*self->stride[d];
-    }
-    else
-    {
-      newSize[d] = self->size[d];
-      newStride[d] = self->stride[d];
-    }
-  }
-
-  THFree(self->size);
-  THFree(self->stride);
-
-  self->size = newSize;
-  self->stride = newStride;
+  self->size[self->nDimension] = size;
+  self->stride[self->nDimension] = self->stride[dimension];
+  self->size[dimension] = (self->size[dimension] - size) / step + 1;
+  self->stride[dimension] = step*self->stride[dimension];
   self->nDimension++;
 }
 
@@ -531,6 +510,21 @@ int THTensor_(isContiguous)(const THTensor *self)
   return 1;
 }
 
+/* same elements of the same storage, in the same order */
+int THTensor_(isSetTo)(const THTensor *self, const THTensor *src)
+{
+  int d;
+  if(self->storage != src->storage || self->storageOffset != src->storageOffset
+     || self->nDimension != src->nDimension)
+    return 0;
+  for(d = 0; d < self->nDimension; d++)
+  {
+    if(self->size[d] != src->size[d] || self->stride[d] != src->stride[d])
+      return 0;
+  }
+  return 1;
+}
+
 long THTensor_(nElement)(const THTensor *self)
 {
   if(self->nDimension == 0)
@@ -560,15 +554,29 @@ void THTensor_(free)(THTensor *self)
   {
     if(--self->refcount == 0)
     {
-      THFree(self->size);
-      THFree(self->stride);
-      if(self->storage)
-        THStorage_(free)(self->storage);
+      THTensor_(releaseView)(self);
       THFree(self);
     }
   }
 }
 
+void THTensor_(initView)(THTensor *self)
+{
+  THTensor_(rawInit)(self);
+  self->flag = 0;
+}
+
+void THTensor_(releaseView)(THTensor *self)
+{
+  if(self->size != self->inlineSize)
+  {
+    THFree(self->size);
+    THFree(self->stride);
+  }
+  if(self->storage)
+    THStorage_(free)(self->storage);
+}
+
 void THTensor_(freeCopyTo)(THTensor *self, THTensor *dst)
 {
   if(self != dst)
@@ -584,8 +592,8 @@ static void THTensor_(rawInit)(THTensor *self)
   self->refcount = 1;
   self->storage = NULL;
   self->storageOffset = 0;
-  self->size = NULL;
-  self->stride = NULL;
+  self->size = self->inlineSize;
+  self->stride = self->inlineStride;
   self->nDimension = 0;    
   self->flag = TH_TENSOR_REFCOUNTED;
 }
@@ -616,6 +624,40 @@ static void THTensor_(rawSet)(THTensor *self, THStorage *storage, long storageOf
   THTensor_(rawResize)(self, nDimension, size, stride);
 }
 
+/* makes room for nDimension sizes and strides, keeping the current ones */
+static void THTensor_(rawResizeDim)(THTensor *self, int nDimension)
+{
+  int keep = THMin(self->nDimension, nDimension);
+
+  if(nDimension <= TH_TENSOR_INLINE_DIMS)
+  {
+    if(self->size != self->inlineSize)
+    {
+      if(keep > 0)
+      {
+        memcpy(self->inlineSize, self->size, sizeof(long)*keep);
+        memcpy(self->inlineStride, self->stride, sizeof(long)*keep);
+      }
+      THFree(self->size);
+      THFree(self->stride);
+      self->size = self->inlineSize;
+      self->stride = self->inlineStride;
+    }
+  }
+  else if(self->size == self->inlineSize)
+  {
+    self->size = THAlloc(sizeof(long)*nDimension);
+    self->stride = THAlloc(sizeof(long)*nDimension);
+    memcpy(self->size, self->inlineSize, sizeof(long)*keep);
+    memcpy(self->stride, self->inlineStride, sizeof(long)*keep);
+  }
+  else
+  {
+    self->size = THRealloc(self->size, sizeof(long)*nDimension);
+    self->stride = THRealloc(self->stride, sizeof(long)*nDimension);
+  }
+}
+
 static void THTensor_(rawResize)(THTensor *self, int nDimension, long *size, long *stride)
 {
   int d;
@@ -650,8 +692,7 @@ static void THTensor_(rawResize)(THTensor *self, int nDimension, long *size, lon
   {
     if(nDimension != self->nDimension)
     {
-      self->size = THRealloc(self->size, sizeof(long)*nDimension);
-      self->stride = THRealloc(self->stride, sizeof(long)*nDimension);
+      THTensor_(rawResizeDim)(self, nDimension);
       self->nDimension = nDimension;
     }
   
@@ -6,6 +6,11 @@
 
 #define TH_TENSOR_REFCOUNTED 1
 
+/* size and stride point to inlineSize and inlineStride for tensors with up
+   to TH_TENSOR_INLINE_DIMS dimensions, and are allocated otherwise */
+#define TH_TENSOR_INLINE_DIMS 4
+
+/* also declared for the LuaJIT FFI in pkg/torch/FFI.lua */
 typedef struct THTensor
 {
     long *size;
@@ -18,6 +23,9 @@ typedef struct THTensor
 
     char flag;
 
+    long inlineSize[TH_TENSOR_INLINE_DIMS];
+    long inlineStride[TH_TENSOR_INLINE_DIMS];
+
 } THTensor;
 
 
@@ -103,12 +111,22 @@ TH_API void THTensor_(squeeze)(THTensor *self, THTensor *src);
 TH_API void THTensor_(squeeze1d)(THTensor *self, THTensor *src, int dimension_);
     
 TH_API int THTensor_(isContiguous)(const THTensor *self);
+TH_API int THTensor_(isSetTo)(const THTensor *self, const THTensor *src);
 TH_API long THTensor_(nElement)(const THTensor *self);
 
 TH_API void THTensor_(retain)(THTensor *self);
 TH_API void THTensor_(free)(THTensor *self);
 TH_API void THTensor_(freeCopyTo)(THTensor *self, THTensor *dst);
 
+/* Tensors in memory owned by the caller, typically temporary views on the
+   stack in C code: THTensor_(initView) makes an empty tensor, which is then
+   set with select(), narrow(), setStorage()... without any allocation (up to
+   TH_TENSOR_INLINE_DIMS dimensions). Such a tensor is not reference counted
+   (free() and retain() do nothing), must not be kept by the functions it is
+   given to, and is released with THTensor_(releaseView). */
+TH_API void THTensor_(initView)(THTensor *self);
+TH_API void THTensor_(releaseView)(THTensor *self);
+
 /* Slow access methods [check everything] */
 TH_API void THTensor_(set1d)(THTensor *tensor, long x0, real value);
 TH_API void THTensor_(set2d)(THTensor *tensor, long x0, long x1, real value);
@@ -0,0 +1,295 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/THTensorExpr.c"
+#else
+
+/* Fused evaluation of elementwise expressions (see THTensorExpr.h).
+
+   The elements are processed in blocks of TH_EXPR_BLOCK, small enough for the
+   stack of intermediate blocks to stay in the L1 cache: each operand is read
+   once and the result written once, whatever the number of operations. Each
+   operation is a simple loop over a block, which the compiler vectorizes, or
+   a THVector function. Contiguous ranges of blocks are evaluated in
+   parallel. */
+
+#define TH_EXPR_BLOCK 256
+
+/* checks that the program leaves one value on the stack, without going
+   beyond its capacity */
+static void THTensor_(evaluateCheck)(int ncode, const THExprInstr *code, int noperand)
+{
+  int depth = 0;
+  int pc;
+
+  for(pc = 0; pc < ncode; pc++)
+  {
+    int op = code[pc].op;
+    int pop;
+
+    THArgCheck(op >= 0 && op < TH_EXPR_NOPCODE, 2, "invalid instruction");
+#if !defined(TH_REAL_IS_FLOAT) && !defined(TH_REAL_IS_DOUBLE)
+    THArgCheck(op < TH_EXPR_POWVALUE, 2, "instruction only available for floating point tensors");
+#endif
+
+    if(op == TH_EXPR_TENSOR)
+    {
+      THArgCheck(code[pc].arg >= 0 && code[pc].arg < noperand, 3, "invalid operand");
+      pop = 0;
+    }
+    else if(op == TH_EXPR_VALUE)
+      pop = 0;
+    else if(op == TH_EXPR_ADD || op == TH_EXPR_SUB || op == TH_EXPR_MUL || op == TH_EXPR_DIV || op == TH_EXPR_ATAN2)
+      pop = 2;
+    else
+      pop = 1;
+
+    THArgCheck(depth >= pop, 2, "missing operand");
+    depth += 1-pop;
+    THArgCheck(depth <= TH_EXPR_STACK, 2, "expression too deep");
+  }
+  THArgCheck(depth == 1, 2, "expression should give one value");
+}
+
+/* Evaluates n (at most TH_EXPR_BLOCK) elements into r, the operands starting
+   at operand[k]+first. Each value on the stack is either a block of an
+   operand, or its own block in stack; the last instruction writes into r.
+   If precise is set, exp, log, log1p, tanh and sigmoid use the C library,
+   as the tensor functions do on non-contiguous tensors. */
+static void THTensor_(evaluateBlock)(real *r, long n, int ncode, const THExprInstr *code,
+                                     real **operand, long first, real (*stack)[TH_EXPR_BLOCK], int precise)
+{
+  real *top[TH_EXPR_STACK];
+  int sp = 0;
+  int pc;
+  long i;
+
+  for(pc = 0; pc < ncode; pc++)
+  {
+    int op = code[pc].op;
+    real value = (real)code[pc].value;
+    real *x, *y = NULL, *z;
+
+    if(op == TH_EXPR_TENSOR)
+    {
+      top[sp++] = operand[code[pc].arg] + first;
+      continue;
+    }
+
+    if(op == TH_EXPR_VALUE)
+    {
+      z = (pc == ncode-1 ? r : stack[sp]);
+      for(i = 0; i < n; i++)
+        z[i] = value;
+      top[sp++] = z;
+      continue;
+    }
+
+    if(op == TH_EXPR_ADD || op == TH_EXPR_SUB || op == TH_EXPR_MUL || op == TH_EXPR_DIV || op == TH_EXPR_ATAN2)
+      y = top[--sp];
+    x = top[sp-1];
+    z = (pc == ncode-1 ? r : stack[sp-1]);
+
+    switch(op)
+    {
+      case TH_EXPR_ADD:
+        for(i = 0; i < n; i++)
+          z[i] = x[i] + y[i];
+        break;
+      case TH_EXPR_SUB:
+        for(i = 0; i < n; i++)
+          z[i] = x[i] - y[i];
+        break;
+      case TH_EXPR_MUL:
+        for(i = 0; i < n; i++)
+          z[i] = x[i] * y[i];
+        break;
+      case TH_EXPR_DIV:
+        for(i = 0; i < n; i++)
+          z[i] = x[i] / y[i];
+        break;
+      case TH_EXPR_ADDVALUE:
+        for(i = 0; i < n; i++)
+          z[i] = x[i] + value;
+        break;
+      case TH_EXPR_MULVALUE:
+        for(i = 0; i < n; i++)
+          z[i] = x[i] * value;
+        break;
+      case TH_EXPR_DIVVALUE:
+        for(i = 0; i < n; i++)
+          z[i] = x[i] / value;
+        break;
+      case TH_EXPR_NEG:
+        for(i = 0; i < n; i++)
+          z[i] = -x[i];
+        break;
+      case TH_EXPR_SIGN:
+        for(i = 0; i < n; i++)
+          z[i] = (x[i] > 0 ? 1 : (x[i] < 0 ? -1 : 0));
+        break;
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+      case TH_EXPR_POWVALUE:
+        for(i = 0; i < n; i++)
+          z[i] = pow(x[i], value);
+        break;
+      case TH_EXPR_ATAN2:
+        for(i = 0; i < n; i++)
+          z[i] = atan2(x[i], y[i]);
+        break;
+      case TH_EXPR_ABS:
+        for(i = 0; i < n; i++)
+          z[i] = fabs(x[i]);
+        break;
+      case TH_EXPR_EXP:
+        if(precise)
+          for(i = 0; i < n; i++)
+            z[i] = exp(x[i]);
+        else
+          THVector_(exp)(z, x, n);
+        break;
+      case TH_EXPR_LOG:
+        if(precise)
+          for(i = 0; i < n; i++)
+            z[i] = log(x[i]);
+        else
+          THVector_(log)(z, x, n);
+        break;
+      case TH_EXPR_LOG1P:
+        if(precise)
+          for(i = 0; i < n; i++)
+            z[i] = log1p(x[i]);
+        else
+          THVector_(log1p)(z, x, n);
+        break;
+      case TH_EXPR_SQRT:
+        for(i = 0; i < n; i++)
+          z[i] = sqrt(x[i]);
+        break;
+      case TH_EXPR_TANH:
+        if(precise)
+          for(i = 0; i < n; i++)
+            z[i] = tanh(x[i]);
+        else
+          THVector_(tanh)(z, x, n);
+        break;
+      case TH_EXPR_SIGMOID:
+        if(precise)
+          for(i = 0; i < n; i++)
+            z[i] = 1./(1.+exp(-x[i]));
+        else
+          THVector_(sigmoid)(z, x, n);
+        break;
+      case TH_EXPR_COS:
+        for(i = 0; i < n; i++)
+          z[i] = cos(x[i]);
+        break;
+      case TH_EXPR_ACOS:
+        for(i = 0; i < n; i++)
+          z[i] = acos(x[i]);
+        break;
+      case TH_EXPR_COSH:
+        for(i = 0; i < n; i++)
+          z[i] = cosh(x[i]);
+        break;
+      case TH_EXPR_SIN:
+        for(i = 0; i < n; i++)
+          z[i] = sin(x[i]);
+        break;
+      case TH_EXPR_ASIN:
+        for(i = 0; i < n; i++)
+          z[i] = asin(x[i]);
+        break;
+      case TH_EXPR_SINH:
+        for(i = 0; i < n; i++)
+          z[i] = sinh(x[i]);
+        break;
+      case TH_EXPR_TAN:
+        for(i = 0; i < n; i++)
+          z[i] = tan(x[i]);
+        break;
+      case TH_EXPR_ATAN:
+        for(i = 0; i < n; i++)
+          z[i] = atan(x[i]);
+        break;
+      case TH_EXPR_CEIL:
+        for(i = 0; i < n; i++)
+          z[i] = ceil(x[i]);
+        break;
+      case TH_EXPR_FLOOR:
+        for(i = 0; i < n; i++)
+          z[i] = floor(x[i]);
+        break;
+#endif
+    }
+    top[sp-1] = z;
+  }
+
+  /* a program made of a single operand */
+  if(top[0] != r)
+    memcpy(r, top[0], sizeof(real)*n);
+}
+
+void THTensor_(evaluate)(THTensor *r_, int ncode, const THExprInstr *code, int noperand, THTensor **operand)
+{
+  THTensor **contiguous;
+  THTensor *result;
+  real **data;
+  real *r_data;
+  long n;
+  int k, precise;
+
+  THTensor_(evaluateCheck)(ncode, code, noperand);
+  THArgCheck(noperand > 0, 3, "at least one operand expected");
+  n = THTensor_(nElement)(operand[0]);
+  for(k = 1; k < noperand; k++)
+    THArgCheck(THTensor_(nElement)(operand[k]) == n, 3, "operands should have the same number of elements");
+
+  /* the kernels of the tensor functions: the C library if a tensor is not
+     contiguous */
+  precise = 0;
+  for(k = 0; k < noperand; k++)
+    precise |= !THTensor_(isContiguous)(operand[k]);
+
+  /* before resizing r_, which may be one of the operands */
+  contiguous = THAlloc(sizeof(THTensor*)*noperand);
+  data = THAlloc(sizeof(real*)*noperand);
+  for(k = 0; k < noperand; k++)
+  {
+    contiguous[k] = THTensor_(newContiguous)(operand[k]);
+    data[k] = THTensor_(data)(contiguous[k]);
+  }
+
+  THTensor_(resizeAs)(r_, operand[0]);
+  precise |= !THTensor_(isContiguous)(r_);
+
+  if(THTensor_(isContiguous)(r_))
+  {
+    result = r_;
+    THTensor_(retain)(result);
+  }
+  else
+  {
+    result = THTensor_(new)();
+    THTensor_(resizeAs)(result, r_);
+  }
+  r_data = THTensor_(data)(result);
+
+  TH_PARALLEL_CHUNKS(n, offset, length,
+                     real stack[TH_EXPR_STACK][TH_EXPR_BLOCK];
+                     long first;
+                     for(first = offset; first < offset+length; first += TH_EXPR_BLOCK)
+                       THTensor_(evaluateBlock)(r_data+first, THMin(TH_EXPR_BLOCK, offset+length-first),
+                                                ncode, code, data, first, stack, precise););
+
+  if(result != r_)
+    THTensor_(copy)(r_, result);
+  THTensor_(free)(result);
+
+  for(k = 0; k < noperand; k++)
+    THTensor_(free)(contiguous[k]);
+  THFree(contiguous);
+  THFree(data);
+}
+
+#undef TH_EXPR_BLOCK
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/THTensorExpr.h"
+#else
+
+/* r_ = the elementwise expression given by code (see THTensorExpr.h), over
+   operands with the same number of elements; r_ is resized as operand[0] */
+TH_API void THTensor_(evaluate)(THTensor *r_, int ncode, const THExprInstr *code, int noperand, THTensor **operand);
+
+#endif
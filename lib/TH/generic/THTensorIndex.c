@@ -0,0 +1,348 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/THTensorIndex.c"
+#else
+
+/* Indexing along a dimension, with a LongTensor of indices starting at 1 (as
+   in Lua).
+
+   A tensor is seen as a set of slices along dim: the sub-tensors with a fixed
+   coordinate along dim. The offsets of the elements in a slice are the same
+   for every slice, so they are computed once. When the slices are contiguous
+   rows (the tensor is contiguous, and the dimensions before dim have size 1)
+   there is no offset table, and rows are handled with memcpy() or a THVector
+   function.
+
+   indexSelect fills the output slices in parallel. indexCopy, indexAdd and
+   indexFill may write the same slice several times (duplicate indices), so
+   they split the slices instead: each thread goes through all the indices, in
+   order, on its own part of every slice. The result is the one of a serial
+   loop: the last duplicate wins in indexCopy and all of them are summed in
+   indexAdd.
+
+   gather and scatter index each element separately, and process the slices
+   along dim in parallel (as sort). Their indices are checked on the fly, and
+   an error is raised after the parallel region. */
+
+#define TH_INDEX_OFFSET(OFFSETS, K) ((OFFSETS) ? (OFFSETS)[K] : (K))
+
+/* checks that index is a vector of indices in [1, size], and returns a
+   contiguous version of it */
+static THLongTensor* THTensor_(indexVector)(THLongTensor *index, long size, int argNumber)
+{
+  THLongTensor *idx;
+  long *idx_data;
+  long i, n;
+
+  THArgCheck(index->nDimension == 1, argNumber, "index should be a vector");
+
+  idx = THLongTensor_newContiguous(index);
+  idx_data = THLongTensor_data(idx);
+  n = idx->size[0];
+  for(i = 0; i < n; i++)
+  {
+    if(idx_data[i] < 1 || idx_data[i] > size)
+    {
+      long value = idx_data[i];
+      THLongTensor_free(idx);
+      THError("index %ld out of range [1, %ld]", value, size);
+    }
+  }
+  return idx;
+}
+
+/* number of elements in a slice of t along dim */
+static long THTensor_(indexSliceSize)(THTensor *t, int dim)
+{
+  long sliceSize = 1;
+  int d;
+
+  for(d = 0; d < t->nDimension; d++)
+  {
+    if(d != dim)
+      sliceSize *= t->size[d];
+  }
+  return sliceSize;
+}
+
+/* Offsets of the elements in a slice of t along dim, or NULL when the slices
+   are contiguous rows (offsets 0, 1, ..., sliceSize-1). */
+static long* THTensor_(indexOffsets)(THTensor *t, int dim, long sliceSize)
+{
+  int rows = THTensor_(isContiguous)(t);
+  long *offsets;
+  long s;
+  int d;
+
+  for(d = 0; d < dim && rows; d++)
+    rows = (t->size[d] == 1);
+  if(rows)
+    return NULL;
+
+  offsets = THAlloc(sizeof(long)*sliceSize);
+#pragma omp parallel for private(s) if(sliceSize >= THGetParallelThreshold())
+  for(s = 0; s < sliceSize; s++)
+    offsets[s] = THTensor_sliceOffset(t->nDimension, t->size, t->stride, dim, s);
+  return offsets;
+}
+
+/* checks that index has the size of t, except along dim (unless dim is -1) */
+static void THTensor_(indexCheckIndexSize)(THLongTensor *index, THTensor *t, int dim, int argNumber)
+{
+  int d;
+
+  THArgCheck(index->nDimension == t->nDimension, argNumber, "inconsistent number of dimensions");
+  for(d = 0; d < t->nDimension; d++)
+    THArgCheck(d == dim || index->size[d] == t->size[d], argNumber, "inconsistent index size");
+}
+
+/* checks that src has the size of tensor, except n along dim */
+static void THTensor_(indexCheckSize)(THTensor *tensor, THTensor *src, int dim, long n, int argNumber)
+{
+  int d;
+
+  THArgCheck(src->nDimension == tensor->nDimension, argNumber, "inconsistent number of dimensions");
+  for(d = 0; d < src->nDimension; d++)
+    THArgCheck(src->size[d] == (d == dim ? n : tensor->size[d]), argNumber, "inconsistent tensor size");
+}
+
+void THTensor_(indexSelect)(THTensor *tensor, THTensor *src, int dim, THLongTensor *index)
+{
+  THLongStorage *size;
+  THLongTensor *idx;
+  long *idx_data, *tensor_offsets, *src_offsets;
+  real *tensor_data, *src_data;
+  long i, n, sliceSize;
+
+  THArgCheck(tensor != src, 1, "result and source should be different tensors");
+  THArgCheck(dim >= 0 && dim < src->nDimension, 3, "invalid dimension");
+
+  idx = THTensor_(indexVector)(index, src->size[dim], 4);
+  idx_data = THLongTensor_data(idx);
+  n = idx->size[0];
+
+  size = THTensor_(newSizeOf)(src);
+  THLongStorage_set(size, dim, n);
+  THTensor_(resize)(tensor, size, NULL);
+  THLongStorage_free(size);
+
+  sliceSize = THTensor_(indexSliceSize)(src, dim);
+  tensor_offsets = THTensor_(indexOffsets)(tensor, dim, sliceSize);
+  src_offsets = THTensor_(indexOffsets)(src, dim, sliceSize);
+  tensor_data = THTensor_(data)(tensor);
+  src_data = THTensor_(data)(src);
+
+#pragma omp parallel for private(i) if(n > 1 && n*sliceSize >= THGetParallelThreshold())
+  for(i = 0; i < n; i++)
+  {
+    real *tensor_slice = tensor_data + i*tensor->stride[dim];
+    real *src_slice = src_data + (idx_data[i]-1)*src->stride[dim];
+    long k;
+
+    if(!tensor_offsets && !src_offsets)
+      memcpy(tensor_slice, src_slice, sizeof(real)*sliceSize);
+    else
+    {
+      for(k = 0; k < sliceSize; k++)
+        tensor_slice[TH_INDEX_OFFSET(tensor_offsets, k)] = src_slice[TH_INDEX_OFFSET(src_offsets, k)];
+    }
+  }
+
+  THFree(tensor_offsets);
+  THFree(src_offsets);
+  THLongTensor_free(idx);
+}
+
+/* indexCopy (accumulate == 0) and indexAdd (accumulate == 1) */
+static void THTensor_(indexAccumulate)(THTensor *tensor, int dim, THLongTensor *index, THTensor *src, int accumulate)
+{
+  THLongTensor *idx;
+  long *idx_data, *tensor_offsets, *src_offsets;
+  real *tensor_data, *src_data;
+  long i, n, sliceSize;
+
+  THArgCheck(dim >= 0 && dim < tensor->nDimension, 2, "invalid dimension");
+  THArgCheck(index->nDimension == 1, 3, "index should be a vector");
+  THTensor_(indexCheckSize)(tensor, src, dim, index->size[0], 4);
+
+  idx = THTensor_(indexVector)(index, tensor->size[dim], 3);
+  idx_data = THLongTensor_data(idx);
+  n = idx->size[0];
+
+  sliceSize = THTensor_(indexSliceSize)(tensor, dim);
+  tensor_offsets = THTensor_(indexOffsets)(tensor, dim, sliceSize);
+  src_offsets = THTensor_(indexOffsets)(src, dim, sliceSize);
+  tensor_data = THTensor_(data)(tensor);
+  src_data = THTensor_(data)(src);
+
+#pragma omp parallel private(i) if(sliceSize > 1 && n*sliceSize >= THGetParallelThreshold())
+  {
+    long first, length, k;
+    THTensorApply_chunk(sliceSize, &first, &length);
+
+    for(i = 0; i < n; i++)
+    {
+      real *tensor_slice = tensor_data + (idx_data[i]-1)*tensor->stride[dim];
+      real *src_slice = src_data + i*src->stride[dim];
+
+      if(!tensor_offsets && !src_offsets)
+      {
+        if(accumulate)
+          THVector_(add)(tensor_slice+first, src_slice+first, 1, length);
+        else
+          memcpy(tensor_slice+first, src_slice+first, sizeof(real)*length);
+      }
+      else if(accumulate)
+      {
+        for(k = first; k < first+length; k++)
+          tensor_slice[TH_INDEX_OFFSET(tensor_offsets, k)] += src_slice[TH_INDEX_OFFSET(src_offsets, k)];
+      }
+      else
+      {
+        for(k = first; k < first+length; k++)
+          tensor_slice[TH_INDEX_OFFSET(tensor_offsets, k)] = src_slice[TH_INDEX_OFFSET(src_offsets, k)];
+      }
+    }
+  }
+
+  THFree(tensor_offsets);
+  THFree(src_offsets);
+  THLongTensor_free(idx);
+}
+
+void THTensor_(indexCopy)(THTensor *tensor, int dim, THLongTensor *index, THTensor *src)
+{
+  THTensor_(indexAccumulate)(tensor, dim, index, src, 0);
+}
+
+void THTensor_(indexAdd)(THTensor *tensor, int dim, THLongTensor *index, THTensor *src)
+{
+  THTensor_(indexAccumulate)(tensor, dim, index, src, 1);
+}
+
+void THTensor_(indexFill)(THTensor *tensor, int dim, THLongTensor *index, real val)
+{
+  THLongTensor *idx;
+  long *idx_data, *tensor_offsets;
+  real *tensor_data;
+  long i, n, sliceSize;
+
+  THArgCheck(dim >= 0 && dim < tensor->nDimension, 2, "invalid dimension");
+
+  idx = THTensor_(indexVector)(index, tensor->size[dim], 3);
+  idx_data = THLongTensor_data(idx);
+  n = idx->size[0];
+
+  sliceSize = THTensor_(indexSliceSize)(tensor, dim);
+  tensor_offsets = THTensor_(indexOffsets)(tensor, dim, sliceSize);
+  tensor_data = THTensor_(data)(tensor);
+
+#pragma omp parallel private(i) if(sliceSize > 1 && n*sliceSize >= THGetParallelThreshold())
+  {
+    long first, length, k;
+    THTensorApply_chunk(sliceSize, &first, &length);
+
+    for(i = 0; i < n; i++)
+    {
+      real *tensor_slice = tensor_data + (idx_data[i]-1)*tensor->stride[dim];
+
+      if(!tensor_offsets)
+        THVector_(fill)(tensor_slice+first, val, length);
+      else
+      {
+        for(k = first; k < first+length; k++)
+          tensor_slice[tensor_offsets[k]] = val;
+      }
+    }
+  }
+
+  THFree(tensor_offsets);
+  THLongTensor_free(idx);
+}
+
+void THTensor_(gather)(THTensor *tensor, THTensor *src, int dim, THLongTensor *index)
+{
+  THLongStorage *size;
+  long *index_data;
+  real *tensor_data, *src_data;
+  long s, n, nslice;
+  int invalid = 0;
+
+  THArgCheck(tensor != src, 1, "result and source should be different tensors");
+  THArgCheck(dim >= 0 && dim < src->nDimension, 3, "invalid dimension");
+  THTensor_(indexCheckIndexSize)(index, src, dim, 4);
+
+  size = THLongTensor_newSizeOf(index);
+  THTensor_(resize)(tensor, size, NULL);
+  THLongStorage_free(size);
+  n = index->size[dim];
+  nslice = THLongTensor_nElement(index)/n;
+  tensor_data = THTensor_(data)(tensor);
+  src_data = THTensor_(data)(src);
+  index_data = THLongTensor_data(index);
+
+#pragma omp parallel for private(s) reduction(||:invalid) if(nslice > 1 && nslice*n >= THGetParallelThreshold())
+  for(s = 0; s < nslice; s++)
+  {
+    real *tensor_slice = tensor_data + THTensor_sliceOffset(tensor->nDimension, tensor->size, tensor->stride, dim, s);
+    real *src_slice = src_data + THTensor_sliceOffset(src->nDimension, src->size, src->stride, dim, s);
+    long *index_slice = index_data + THTensor_sliceOffset(index->nDimension, index->size, index->stride, dim, s);
+    long j;
+
+    for(j = 0; j < n; j++)
+    {
+      long k = index_slice[j*index->stride[dim]];
+      if(k < 1 || k > src->size[dim])
+      {
+        invalid = 1;
+        break;
+      }
+      tensor_slice[j*tensor->stride[dim]] = src_slice[(k-1)*src->stride[dim]];
+    }
+  }
+
+  THArgCheck(!invalid, 4, "index out of range");
+}
+
+void THTensor_(scatter)(THTensor *tensor, int dim, THLongTensor *index, THTensor *src)
+{
+  long *index_data;
+  real *tensor_data, *src_data;
+  long s, n, nslice;
+  int invalid = 0;
+
+  THArgCheck(dim >= 0 && dim < tensor->nDimension, 2, "invalid dimension");
+  THTensor_(indexCheckIndexSize)(index, tensor, dim, 3);
+  THTensor_(indexCheckIndexSize)(index, src, -1, 4);
+
+  n = index->size[dim];
+  nslice = THLongTensor_nElement(index)/n;
+  tensor_data = THTensor_(data)(tensor);
+  src_data = THTensor_(data)(src);
+  index_data = THLongTensor_data(index);
+
+#pragma omp parallel for private(s) reduction(||:invalid) if(nslice > 1 && nslice*n >= THGetParallelThreshold())
+  for(s = 0; s < nslice; s++)
+  {
+    real *tensor_slice = tensor_data + THTensor_sliceOffset(tensor->nDimension, tensor->size, tensor->stride, dim, s);
+    real *src_slice = src_data + THTensor_sliceOffset(src->nDimension, src->size, src->stride, dim, s);
+    long *index_slice = index_data + THTensor_sliceOffset(index->nDimension, index->size, index->stride, dim, s);
+    long j;
+
+    for(j = 0; j < n; j++)
+    {
+      long k = index_slice[j*index->stride[dim]];
+      if(k < 1 || k > tensor->size[dim])
+      {
+        invalid = 1;
+        break;
+      }
+      tensor_slice[(k-1)*tensor->stride[dim]] = src_slice[j*src->stride[dim]];
+    }
+  }
+
+  THArgCheck(!invalid, 3, "index out of range");
+}
+
+#undef TH_INDEX_OFFSET
+
+#endif
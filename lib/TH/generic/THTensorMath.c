@@ -4,14 +4,22 @@
 
 void THTensor_(fill)(THTensor *r_, real value)
 {
-  TH_TENSOR_APPLY(real, r_, 
-                  THVector_(fill)(r__data, value, r__size); break;);
+  if(THTensor_(nElement)(r_) < THGetParallelThreshold())
+    TH_TENSOR_APPLY(real, r_,
+                    THVector_(fill)(r__data, value, r__size); break;)
+  else if(THTensor_(isContiguous)(r_))
+  {
+    real *r__data = THTensor_(data)(r_);
+    TH_PARALLEL_CHUNKS(THTensor_(nElement)(r_), r__offset, r__length,
+                       THVector_(fill)(r__data+r__offset, value, r__length););
+  }
+  else
+    TH_TENSOR_PARALLEL_APPLY(real, r_, *r__data = value;);
 }
 
 void THTensor_(zero)(THTensor *r_)
 {
-  TH_TENSOR_APPLY(real, r_, 
-                  THVector_(fill)(r__data, 0, r__size); break;);
+  THTensor_(fill)(r_, 0);
 }
 
 void THTensor_(maskedFill)(THTensor *tensor, THByteTensor *mask, real value)
@@ -80,6 +88,8 @@ real THTensor_(minall)(THTensor *tensor)
 {
   real theMin;
   THArgCheck(tensor->nDimension > 0, 1, "tensor must have one dimension");
+  if(THTensor_(isContiguous)(tensor))
+    return THVector_(min)(THTensor_(data)(tensor), THTensor_(nElement)(tensor));
   theMin = THTensor_(data)(tensor)[0];
   TH_TENSOR_APPLY(real, tensor, if(*tensor_data < theMin) theMin = *tensor_data;);
   return theMin; 
@@ -89,6 +99,8 @@ real THTensor_(maxall)(THTensor *tensor)
 {
   real theMax;
   THArgCheck(tensor->nDimension > 0, 1, "tensor must have one dimension");
+  if(THTensor_(isContiguous)(tensor))
+    return THVector_(max)(THTensor_(data)(tensor), THTensor_(nElement)(tensor));
   theMax = THTensor_(data)(tensor)[0];
   TH_TENSOR_APPLY(real, tensor, if(*tensor_data > theMax) theMax = *tensor_data;);
   return theMax; 
@@ -97,6 +109,8 @@ real THTensor_(maxall)(THTensor *tensor)
 accreal THTensor_(sumall)(THTensor *tensor)
 {
   accreal sum = 0;
+  if(THTensor_(isContiguous)(tensor))
+    return THVector_(sum)(THTensor_(data)(tensor), THTensor_(nElement)(tensor));
   TH_TENSOR_APPLY(real, tensor, sum += *tensor_data;);
   return sum;
 }
@@ -104,37 +118,70 @@ accreal THTensor_(sumall)(THTensor *tensor)
 void THTensor_(add)(THTensor *r_, THTensor *t, real value)
 {
   THTensor_(resizeAs)(r_, t);
-  TH_TENSOR_APPLY2(real, r_, real, t, *r__data = *t_data + value;);
+  TH_TENSOR_PARALLEL_APPLY2(real, r_, real, t, *r__data = *t_data + value;);
 }
 
 void THTensor_(mul)(THTensor *r_, THTensor *t, real value)
 {
   THTensor_(resizeAs)(r_, t);
-  TH_TENSOR_APPLY2(real, r_, real, t, *r__data = *t_data * value;);
+  TH_TENSOR_PARALLEL_APPLY2(real, r_, real, t, *r__data = *t_data * value;);
 }
 
 void THTensor_(div)(THTensor *r_, THTensor *t, real value)
 {
   THTensor_(resizeAs)(r_, t);
-  TH_TENSOR_APPLY2(real, r_, real, t, *r__data = *t_data / value;);
+  TH_TENSOR_PARALLEL_APPLY2(real, r_, real, t, *r__data = *t_data / value;);
+}
+
+/* true when r_, t and src are contiguous, with the same number of elements */
+static int THTensor_(isContiguous3)(THTensor *r_, THTensor *t, THTensor *src)
+{
+  return THTensor_(isContiguous)(r_) && THTensor_(isContiguous)(t) && THTensor_(isContiguous)(src)
+    && THTensor_(nElement)(r_) == THTensor_(nElement)(src);
 }
 
 void THTensor_(cadd)(THTensor *r_, THTensor *t, real value, THTensor *src)
 {
   THTensor_(resizeAs)(r_, t);
-  TH_TENSOR_APPLY3(real, r_, real, t, real, src, *r__data = *t_data + value * *src_data;);
+  if(r_ == t && THTensor_(isContiguous3)(r_, t, src))
+  {
+    real *r__data = THTensor_(data)(r_);
+    real *src_data = THTensor_(data)(src);
+    TH_PARALLEL_CHUNKS(THTensor_(nElement)(r_), r__offset, r__length,
+                       THVector_(add)(r__data+r__offset, src_data+r__offset, value, r__length););
+  }
+  else
+    TH_TENSOR_PARALLEL_APPLY3(real, r_, real, t, real, src, *r__data = *t_data + value * *src_data;);
 }
 
 void THTensor_(cmul)(THTensor *r_, THTensor *t, THTensor *src)
 {
   THTensor_(resizeAs)(r_, t);
-  TH_TENSOR_APPLY3(real, r_, real, t, real, src, *r__data = *t_data * *src_data;);
+  if(THTensor_(isContiguous3)(r_, t, src))
+  {
+    real *r__data = THTensor_(data)(r_);
+    real *t_data = THTensor_(data)(t);
+    real *src_data = THTensor_(data)(src);
+    TH_PARALLEL_CHUNKS(THTensor_(nElement)(r_), r__offset, r__length,
+                       THVector_(cmul)(r__data+r__offset, t_data+r__offset, src_data+r__offset, r__length););
+  }
+  else
+    TH_TENSOR_PARALLEL_APPLY3(real, r_, real, t, real, src, *r__data = *t_data * *src_data;);
 }
 
 void THTensor_(cdiv)(THTensor *r_, THTensor *t, THTensor *src)
 {
   THTensor_(resizeAs)(r_, t);
-  TH_TENSOR_APPLY3(real, r_, real, t, real, src, *r__data = *t_data / *src_data;);
+  if(THTensor_(isContiguous3)(r_, t, src))
+  {
+    real *r__data = THTensor_(data)(r_);
+    real *t_data = THTensor_(data)(t);
+    real *src_data = THTensor_(data)(src);
+    TH_PARALLEL_CHUNKS(THTensor_(nElement)(r_), r__offset, r__length,
+                       THVector_(cdiv)(r__data+r__offset, t_data+r__offset, src_data+r__offset, r__length););
+  }
+  else
+    TH_TENSOR_PARALLEL_APPLY3(real, r_, real, t, real, src, *r__data = *t_data / *src_data;);
 }
 
 void THTensor_(addcmul)(THTensor *r_, THTensor *t, real value, THTensor *src1, THTensor *src2)
@@ -145,7 +192,7 @@ void THTensor_(addcmul)(THTensor *r_, THTensor *t, real value, THTensor *src1, T
     THTensor_(copy)(r_, t);
   }
 
-  TH_TENSOR_APPLY3(real, r_, real, src1, real, src2, *r__data += value * *src1_data * *src2_data;);
+  TH_TENSOR_PARALLEL_APPLY3(real, r_, real, src1, real, src2, *r__data += value * *src1_data * *src2_data;);
 }
 
 
@@ -157,7 +204,7 @@ void THTensor_(addcdiv)(THTensor *r_, THTensor *t, real value, THTensor *src1, T
     THTensor_(copy)(r_, t);
   }
 
-  TH_TENSOR_APPLY3(real, r_, real, src1, real, src2, *r__data += value * *src1_data / *src2_data;);
+  TH_TENSOR_PARALLEL_APPLY3(real, r_, real, src1, real, src2, *r__data += value * *src1_data / *src2_data;);
 }
 
 void THTensor_(addmv)(THTensor *r_, real beta, THTensor *t, real alpha, THTensor *mat, THTensor *vec)
@@ -312,6 +359,119 @@ void THTensor_(addmm)(THTensor *r_, real beta, THTensor *t, real alpha, THTensor
     THTensor_(freeCopyTo)(r__, r_);
 } 
 
+void THTensor_(baddbmm)(THTensor *r_, real beta, THTensor *t, real alpha, THTensor *batch1, THTensor *batch2)
+{
+  char transpose_r, transpose_b1, transpose_b2;
+  THTensor *r__, *b1_, *b2_;
+  int dr, dc; /* dimensions of the rows and columns of r__, as seen by gemm */
+
+  if( (batch1->nDimension != 3) || (batch2->nDimension != 3) )
+    THError("3D tensors expected");
+
+  if(t->nDimension != 3)
+    THError("size mismatch");
+
+  if( (t->size[0] != batch1->size[0]) || (t->size[0] != batch2->size[0])
+      || (t->size[1] != batch1->size[1]) || (t->size[2] != batch2->size[2]) || (batch1->size[2] != batch2->size[1]) )
+    THError("size mismatch");
+
+  if(t != r_)
+  {
+    THTensor_(resizeAs)(r_, t);
+    THTensor_(copy)(r_, t);
+  }
+
+  /* same logic as addmm, on the two last dimensions */
+
+  /* r_ */
+  if(r_->stride[1] == 1)
+  {
+    transpose_r = 'n';
+    r__ = r_;
+  }
+  else if(r_->stride[2] == 1)
+  {
+    THTensor *swap = batch2;
+    batch2 = batch1;
+    batch1 = swap;
+    transpose_r = 't';
+    r__ = r_;
+  }
+  else
+  {
+    THTensor *rt = THTensor_(newTranspose)(r_, 1, 2);
+    transpose_r = 'n';
+    r__ = THTensor_(newClone)(rt);
+    THTensor_(transpose)(r__, NULL, 1, 2);
+    THTensor_(free)(rt);
+  }
+  dr = (transpose_r == 'n' ? 1 : 2);
+  dc = (transpose_r == 'n' ? 2 : 1);
+
+  /* batch1 */
+  if(batch1->stride[dr] == 1)
+  {
+    transpose_b1 = 'n';
+    b1_ = batch1;
+  }
+  else if(batch1->stride[dc] == 1)
+  {
+    transpose_b1 = 't';
+    b1_ = batch1;
+  }
+  else
+  {
+    transpose_b1 = (transpose_r == 'n' ? 't' : 'n');
+    b1_ = THTensor_(newContiguous)(batch1);
+  }
+
+  /* batch2 */
+  if(batch2->stride[dr] == 1)
+  {
+    transpose_b2 = 'n';
+    b2_ = batch2;
+  }
+  else if(batch2->stride[dc] == 1)
+  {
+    transpose_b2 = 't';
+    b2_ = batch2;
+  }
+  else
+  {
+    transpose_b2 = (transpose_r == 'n' ? 't' : 'n');
+    b2_ = THTensor_(newContiguous)(batch2);
+  }
+
+  /* do the operation */
+  THBlas_(gemmBatched)(transpose_b1,
+                       transpose_b2,
+                       r__->size[0],
+                       r__->size[dr],
+                       r__->size[dc],
+                       b1_->size[dc],
+                       alpha,
+                       THTensor_(data)(b1_),
+                       (transpose_b1 == 'n' ? b1_->stride[dc] : b1_->stride[dr]),
+                       b1_->stride[0],
+                       THTensor_(data)(b2_),
+                       (transpose_b2 == 'n' ? b2_->stride[dc] : b2_->stride[dr]),
+                       b2_->stride[0],
+                       beta,
+                       THTensor_(data)(r__),
+                       r__->stride[dc],
+                       r__->stride[0]);
+
+  /* free intermediate variables */
+  if(b1_ != batch1)
+    THTensor_(free)(b1_);
+
+  if(b2_ != batch2)
+    THTensor_(free)(b2_);
+
+  if(r__ != r_)
+    THTensor_(freeCopyTo)(r__, r_);
+}
+
 void THTensor_(addr)(THTensor *r_, real beta, THTensor *t, real alpha, THTensor *vec1, THTensor *vec2)
 {
   if( (vec1->nDimension != 1) || (vec2->nDimension != 1) )
@@ -364,102 +524,440 @@ long THTensor_(numel)(THTensor *t)
   return THTensor_(nElement)(t);
 }
 
-void THTensor_(max)(THTensor *values_, THLongTensor *indices_, THTensor *t, int dimension)
+/* Reductions along a dimension.
+
+   The slices to reduce are grouped in blocks of up to THREDUCE_WIDTH
+   neighbours along the "block dimension", the one with the smallest stride.
+   When this stride is smaller than the one of the reduced dimension (e.g.
+   when reducing a row-major matrix over its rows), a block is reduced one
+   row at a time, with an inner loop over contiguous elements. Otherwise a
+   block is a single slice, walked along its own stride.
+
+   Blocks are spread over threads. When there are too few of them (e.g. the
+   columns of a tall matrix), the rows are also cut in chunks, whose partial
+   results are combined at the end.
+
+   Sums are computed pairwise, so their rounding error grows like log(n)
+   instead of n. Variances sum the squares of the elements minus the first
+   one of their slice, which avoids most of the cancellation of sum(x^2) -
+   n*mean^2. */
+
+#ifndef THREDUCE_WIDTH
+#define THREDUCE_WIDTH 128
+#define THREDUCE_PAIRWISE 128
+#define THREDUCE_MINCHUNK 4096
+#define THREDUCE_SUM 0
+#define THREDUCE_MEAN 1
+#define THREDUCE_PROD 2
+#define THREDUCE_NORM 3
+#define THREDUCE_STD 4
+#define THREDUCE_VAR 5
+#define THREDUCE_MAX 6
+#define THREDUCE_MIN 7
+#endif
+
+/* runs CODE for each element x of rows [I0, n), slice j of the block */
+#define THREDUCE_LOOP(I0, CODE) \
+  if(bw == 1) \
+  { \
+    j = 0; \
+    for(i = I0; i < n; i++) \
+    { \
+      real x = src[i*stride]; \
+      CODE \
+    } \
+  } \
+  else if(bstride == 1) \
+  { \
+    for(i = I0; i < n; i++) \
+    { \
+      real *row = src+i*stride; \
+      for(j = 0; j < bw; j++) \
+      { \
+        real x = row[j]; \
+        CODE \
+      } \
+    } \
+  } \
+  else \
+  { \
+    for(i = I0; i < n; i++) \
+    { \
+      real *row = src+i*stride; \
+      for(j = 0; j < bw; j++) \
+      { \
+        real x = row[j*bstride]; \
+        CODE \
+      } \
+    } \
+  }
+
+/* Reduces n rows of a block of bw slices: element j of row i is
+   src[i*stride+j*bstride]. The rows are the rows i0... of the slices, whose
+   first rows are in shift. Leaves the partial results in res1 and res2. */
+static void THTensor_(reduceRows)(int op, real *src, long n, long stride, long bw, long bstride,
+                                  real *shift, long i0, real value, accreal *res1, accreal *res2)
 {
-  THLongStorage *dim;
-  long i;
+  accreal acc1[THREDUCE_WIDTH], acc2[THREDUCE_WIDTH];
+  long i, j;
 
-  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "dimension out of range");
+  /* pairwise sums */
+  if(n > THREDUCE_PAIRWISE && op != THREDUCE_PROD && op != THREDUCE_MAX && op != THREDUCE_MIN)
+  {
+    accreal part1[THREDUCE_WIDTH], part2[THREDUCE_WIDTH];
+    long half = n/2;
 
-  dim = THTensor_(newSizeOf)(t);
-  THLongStorage_set(dim, dimension, 1);
-  THTensor_(resize)(values_, dim, NULL);
-  THLongTensor_resize(indices_, dim, NULL);
-  THLongStorage_free(dim);
+    THTensor_(reduceRows)(op, src, half, stride, bw, bstride, shift, i0, value, res1, res2);
+    THTensor_(reduceRows)(op, src+half*stride, n-half, stride, bw, bstride, shift, i0+half, value, part1, part2);
+    for(j = 0; j < bw; j++)
+    {
+      res1[j] += part1[j];
+      res2[j] += part2[j];
+    }
+    return;
+  }
 
-  TH_TENSOR_DIM_APPLY3(real, t, real, values_, long, indices_, dimension,
-                       long theIndex = 0;
-                       real theMax = t_data[0];
-                       for(i = 1; i < t_size; i++)
-                       {
-                         if(t_data[i*t_stride] > theMax)
-                         {
-                           theIndex = i;
-                           theMax = t_data[i*t_stride];
-                         }
-                       }
-                       *indices__data = theIndex;
-                       *values__data = theMax;);  
+  /* the accumulators are local, so that the compiler can keep them in
+     registers when there is a single slice */
+
+  for(j = 0; j < bw; j++)
+  {
+    acc1[j] = (op == THREDUCE_PROD ? 1 : 0);
+    acc2[j] = 0;
+  }
+
+  switch(op)
+  {
+    case THREDUCE_SUM:
+    case THREDUCE_MEAN:
+      if(bw == 1)
+      {
+        /* a single slice: independent partial sums */
+        accreal sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+        for(i = 0; i+3 < n; i += 4)
+        {
+          sum0 += src[i*stride];
+          sum1 += src[(i+1)*stride];
+          sum2 += src[(i+2)*stride];
+          sum3 += src[(i+3)*stride];
+        }
+        for(; i < n; i++)
+          sum0 += src[i*stride];
+        acc1[0] = (sum0+sum1)+(sum2+sum3);
+      }
+      else
+      {
+        THREDUCE_LOOP(0, acc1[j] += x;)
+      }
+      break;
+
+    case THREDUCE_PROD:
+      THREDUCE_LOOP(0, acc1[j] *= x;)
+      break;
+
+    case THREDUCE_NORM:
+      if(value == 2)
+      {
+        THREDUCE_LOOP(0, acc1[j] += (accreal)x*x;)
+      }
+      else
+      {
+        THREDUCE_LOOP(0, acc1[j] += pow(fabs(x), value);)
+      }
+      break;
+
+    case THREDUCE_STD:
+    case THREDUCE_VAR:
+    {
+      accreal c[THREDUCE_WIDTH];
+      for(j = 0; j < bw; j++)
+        c[j] = shift[j*bstride];
+      THREDUCE_LOOP(0,
+                    accreal d = x-c[j];
+                    acc1[j] += d;
+                    acc2[j] += d*d;)
+      break;
+    }
 
+    case THREDUCE_MAX:
+      for(j = 0; j < bw; j++)
+      {
+        acc1[j] = src[j*bstride];
+        acc2[j] = i0;
+      }
+      THREDUCE_LOOP(1,
+                    if(x > acc1[j])
+                    {
+                      acc1[j] = x;
+                      acc2[j] = i0+i;
+                    })
+      break;
+
+    case THREDUCE_MIN:
+      for(j = 0; j < bw; j++)
+      {
+        acc1[j] = src[j*bstride];
+        acc2[j] = i0;
+      }
+      THREDUCE_LOOP(1,
+                    if(x < acc1[j])
+                    {
+                      acc1[j] = x;
+                      acc2[j] = i0+i;
+                    })
+      break;
+  }
+
+  memcpy(res1, acc1, sizeof(accreal)*bw);
+  memcpy(res2, acc2, sizeof(accreal)*bw);
 }
 
-void THTensor_(min)(THTensor *values_, THLongTensor *indices_, THTensor *t, int dimension)
-{
-  THLongStorage *dim;
-  long i;
+#undef THREDUCE_LOOP
 
-  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "dimension out of range");
+/* adds the partial results of a chunk (the next rows) to the ones of the previous chunks */
+static void THTensor_(reduceCombine)(int op, long bw, accreal *acc1, accreal *acc2, accreal *part1, accreal *part2)
+{
+  long j;
 
-  dim = THTensor_(newSizeOf)(t);
-  THLongStorage_set(dim, dimension, 1);
-  THTensor_(resize)(values_, dim, NULL);
-  THLongTensor_resize(indices_, dim, NULL);
-  THLongStorage_free(dim);
+  for(j = 0; j < bw; j++)
+  {
+    switch(op)
+    {
+      case THREDUCE_PROD:
+        acc1[j] *= part1[j];
+        break;
+      case THREDUCE_MAX:
+        if(part1[j] > acc1[j])
+        {
+          acc1[j] = part1[j];
+          acc2[j] = part2[j];
+        }
+        break;
+      case THREDUCE_MIN:
+        if(part1[j] < acc1[j])
+        {
+          acc1[j] = part1[j];
+          acc2[j] = part2[j];
+        }
+        break;
+      default:
+        acc1[j] += part1[j];
+        acc2[j] += part2[j];
+    }
+  }
+}
 
-  TH_TENSOR_DIM_APPLY3(real, t, real, values_, long, indices_, dimension,
-                       long theIndex = 0;
-                       real theMin = t_data[0];
-                       for(i = 1; i < t_size; i++)
-                       {
-                         if(t_data[i*t_stride] < theMin)
-                         {
-                           theIndex = i;
-                           theMin = t_data[i*t_stride];
-                         }
-                       }
-                       *indices__data = theIndex;
-                       *values__data = theMin;);  
+/* writes the results of the bw slices of a block, each over n elements */
+static void THTensor_(reduceFinish)(int op, long n, long bw, real value, int flag, accreal *acc1, accreal *acc2,
+                                    real *dst, long dstStride, long *idst, long idstStride)
+{
+  long j;
 
+  for(j = 0; j < bw; j++)
+  {
+    switch(op)
+    {
+      case THREDUCE_MEAN:
+        dst[j*dstStride] = (real)acc1[j]/n;
+        break;
+      case THREDUCE_NORM:
+        dst[j*dstStride] = pow(acc1[j], 1.0/value);
+        break;
+      case THREDUCE_STD:
+      case THREDUCE_VAR:
+      {
+        double mean = (double)acc1[j]/n;
+        double var = (flag ? (double)acc2[j]/n - mean*mean : ((double)acc2[j] - mean*acc1[j])/(n-1));
+        var = (var < 0 ? 0 : var);
+        dst[j*dstStride] = (real)(op == THREDUCE_STD ? sqrt(var) : var);
+        break;
+      }
+      case THREDUCE_MAX:
+      case THREDUCE_MIN:
+        dst[j*dstStride] = (real)acc1[j];
+        idst[j*idstStride] = (long)acc2[j];
+        break;
+      default:
+        dst[j*dstStride] = (real)acc1[j];
+    }
+  }
 }
 
+/* Sizes and strides of a tensor seen as a grid of blocks: the block
+   dimension is moved last, and cut in blocks of THREDUCE_WIDTH slices. The
+   block number b is then the slice number of the grid (see
+   THTensor_sliceOffset), and b % nblocks its position along the block
+   dimension. */
+static void THTensor_(reduceGrid)(int nDimension, const long *size, const long *stride, int bdim, long nblocks,
+                                  long *gsize, long *gstride)
+{
+  int d, k = 0;
 
-void THTensor_(sum)(THTensor *r_, THTensor *t, int dimension)
+  for(d = 0; d < nDimension; d++)
+  {
+    if(d == bdim)
+      continue;
+    gsize[k] = size[d];
+    gstride[k] = stride[d];
+    k++;
+  }
+  if(bdim >= 0)
+  {
+    gsize[k] = nblocks;
+    gstride[k] = stride[bdim]*THREDUCE_WIDTH;
+  }
+}
+
+/* Reduces t along dimension into r_ (and ri_ for max and min), which must
+   already have the size of t, but 1 along dimension. */
+static void THTensor_(reduceDim)(int op, THTensor *r_, THLongTensor *ri_, THTensor *t, int dimension, real value, int flag)
 {
-  THLongStorage *dim;
+  int nDimension = t->nDimension;
+  long n = t->size[dimension];
+  long stride = t->stride[dimension];
+  long nelement = THTensor_(nElement)(t);
+  int bdim = -1, gdim = dimension, d;
+  long bsize = 1, nblocks = 1, nitems, nchunks = 1, ntasks, task;
+  long bstride = 0, rbstride = 0, ibstride = 0;
+  long *geometry;
+  long *tsize, *tstride, *rsize, *rstride, *isize, *istride;
+  real *t_data = THTensor_(data)(t);
+  real *r_data = THTensor_(data)(r_);
+  long *ri_data = (ri_ ? THLongTensor_data(ri_) : NULL);
+  accreal *partial = NULL;
+  int parallel = 0;
 
-  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "dimension out of range");
-  
-  dim = THTensor_(newSizeOf)(t);
+  if(nelement == 0)
+    return;
+
+  for(d = 0; d < nDimension; d++)
+  {
+    if(d != dimension && t->size[d] > 1 && (bdim < 0 || labs(t->stride[d]) < labs(t->stride[bdim])))
+      bdim = d;
+  }
+  if(bdim >= 0 && n > 1 && labs(t->stride[bdim]) >= labs(stride))
+    bdim = -1;
+
+  if(bdim >= 0)
+  {
+    bsize = t->size[bdim];
+    nblocks = (bsize+THREDUCE_WIDTH-1)/THREDUCE_WIDTH;
+    bstride = t->stride[bdim];
+    rbstride = r_->stride[bdim];
+    ibstride = (ri_ ? ri_->stride[bdim] : 0);
+    gdim = (dimension > bdim ? dimension-1 : dimension);
+  }
+
+  geometry = THAlloc(sizeof(long)*6*nDimension);
+  tsize = geometry; tstride = tsize+nDimension;
+  rsize = tstride+nDimension; rstride = rsize+nDimension;
+  isize = rstride+nDimension; istride = isize+nDimension;
+  THTensor_(reduceGrid)(nDimension, t->size, t->stride, bdim, nblocks, tsize, tstride);
+  THTensor_(reduceGrid)(nDimension, r_->size, r_->stride, bdim, nblocks, rsize, rstride);
+  if(ri_)
+    THTensor_(reduceGrid)(nDimension, ri_->size, ri_->stride, bdim, nblocks, isize, istride);
+
+  nitems = nelement/n/bsize*nblocks;
+
+#ifdef _OPENMP
+  parallel = TH_TENSOR_PARALLEL_APPLY_ISPARALLEL(nelement);
+  if(parallel && nitems < 2*THGetNumThreads())
+  {
+    nchunks = THMin((2*THGetNumThreads()+nitems-1)/nitems, n/THREDUCE_MINCHUNK);
+    nchunks = (nchunks < 1 ? 1 : nchunks);
+  }
+#endif
+
+  ntasks = nitems*nchunks;
+  if(nchunks > 1)
+    partial = THAlloc(sizeof(accreal)*2*THREDUCE_WIDTH*ntasks);
+
+#pragma omp parallel for private(task) schedule(dynamic, 1) if(parallel)
+  for(task = 0; task < ntasks; task++)
+  {
+    long item = task/nchunks;
+    long chunk = task%nchunks;
+    long bw = (bdim >= 0 ? THMin(THREDUCE_WIDTH, bsize-(item%nblocks)*THREDUCE_WIDTH) : 1);
+    long i0 = n/nchunks*chunk + THMin(chunk, n%nchunks);
+    long len = n/nchunks + (chunk < n%nchunks ? 1 : 0);
+    real *src = t_data + THTensor_sliceOffset(nDimension, tsize, tstride, gdim, item);
+    accreal acc1[THREDUCE_WIDTH], acc2[THREDUCE_WIDTH];
+
+    THTensor_(reduceRows)(op, src+i0*stride, len, stride, bw, bstride, src, i0, value, acc1, acc2);
+
+    if(nchunks == 1)
+    {
+      THTensor_(reduceFinish)(op, n, bw, value, flag, acc1, acc2,
+                              r_data + THTensor_sliceOffset(nDimension, rsize, rstride, gdim, item), rbstride,
+                              (ri_ ? ri_data + THTensor_sliceOffset(nDimension, isize, istride, gdim, item) : NULL), ibstride);
+    }
+    else
+    {
+      memcpy(partial+2*THREDUCE_WIDTH*task, acc1, sizeof(accreal)*bw);
+      memcpy(partial+2*THREDUCE_WIDTH*task+THREDUCE_WIDTH, acc2, sizeof(accreal)*bw);
+    }
+  }
+
+  if(nchunks > 1)
+  {
+    long item, chunk;
+    for(item = 0; item < nitems; item++)
+    {
+      long bw = (bdim >= 0 ? THMin(THREDUCE_WIDTH, bsize-(item%nblocks)*THREDUCE_WIDTH) : 1);
+      accreal *acc = partial+2*THREDUCE_WIDTH*item*nchunks;
+      for(chunk = 1; chunk < nchunks; chunk++)
+        THTensor_(reduceCombine)(op, bw, acc, acc+THREDUCE_WIDTH, acc+2*THREDUCE_WIDTH*chunk, acc+2*THREDUCE_WIDTH*chunk+THREDUCE_WIDTH);
+      THTensor_(reduceFinish)(op, n, bw, value, flag, acc, acc+THREDUCE_WIDTH,
+                              r_data + THTensor_sliceOffset(nDimension, rsize, rstride, gdim, item), rbstride,
+                              (ri_ ? ri_data + THTensor_sliceOffset(nDimension, isize, istride, gdim, item) : NULL), ibstride);
+    }
+    THFree(partial);
+  }
+
+  THFree(geometry);
+}
+
+/* resizes r_ (and ri_) as t, but with a size of 1 along dimension */
+static void THTensor_(reduceResize)(THTensor *r_, THLongTensor *ri_, THTensor *t, int dimension)
+{
+  THLongStorage *dim = THTensor_(newSizeOf)(t);
   THLongStorage_set(dim, dimension, 1);
   THTensor_(resize)(r_, dim, NULL);
+  if(ri_)
+    THLongTensor_resize(ri_, dim, NULL);
   THLongStorage_free(dim);
+}
 
-  TH_TENSOR_DIM_APPLY2(real, t, real, r_, dimension,
-                       accreal sum = 0;
-                       long i;
-                       for(i = 0; i < t_size; i++)
-                         sum += t_data[i*t_stride];
-                       *r__data = (real)sum;);
+void THTensor_(max)(THTensor *values_, THLongTensor *indices_, THTensor *t, int dimension)
+{
+  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "dimension out of range");
+
+  THTensor_(reduceResize)(values_, indices_, t, dimension);
+  THTensor_(reduceDim)(THREDUCE_MAX, values_, indices_, t, dimension, 0, 0);
 }
 
-void THTensor_(prod)(THTensor *r_, THTensor *t, int dimension)
+void THTensor_(min)(THTensor *values_, THLongTensor *indices_, THTensor *t, int dimension)
 {
-  THLongStorage *dim;
+  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "dimension out of range");
+
+  THTensor_(reduceResize)(values_, indices_, t, dimension);
+  THTensor_(reduceDim)(THREDUCE_MIN, values_, indices_, t, dimension, 0, 0);
+}
 
+void THTensor_(sum)(THTensor *r_, THTensor *t, int dimension)
+{
   THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "dimension out of range");
 
-  dim = THTensor_(newSizeOf)(t);
-  THLongStorage_set(dim, dimension, 1);
-  THTensor_(resize)(r_, dim, NULL);
-  THLongStorage_free(dim);
-  
-  TH_TENSOR_DIM_APPLY2(real, t, real, r_, dimension,
-                       accreal prod = 1;
-                       long i;
-                       for(i = 0; i < t_size; i++)
-                         prod *= t_data[i*t_stride];
-                       *r__data = (real)prod;);
+  THTensor_(reduceResize)(r_, NULL, t, dimension);
+  THTensor_(reduceDim)(THREDUCE_SUM, r_, NULL, t, dimension, 0, 0);
+}
 
+void THTensor_(prod)(THTensor *r_, THTensor *t, int dimension)
+{
+  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "dimension out of range");
+
+  THTensor_(reduceResize)(r_, NULL, t, dimension);
+  THTensor_(reduceDim)(THREDUCE_PROD, r_, NULL, t, dimension, 0, 0);
 }
 
 void THTensor_(cumsum)(THTensor *r_, THTensor *t, int dimension)
@@ -500,14 +998,14 @@ void THTensor_(sign)(THTensor *r_, THTensor *t)
   THTensor_(resizeAs)(r_, t);
 
 #if defined (TH_REAL_IS_BYTE)
-  TH_TENSOR_APPLY2(real, r_, real, t, 
-		   if (*t_data > 0) *r__data = 1;
-		   else *r__data = 0;);
+  TH_TENSOR_PARALLEL_APPLY2(real, r_, real, t, 
+                            if (*t_data > 0) *r__data = 1;
+                            else *r__data = 0;);
 #else
-  TH_TENSOR_APPLY2(real, r_, real, t, 
-		   if (*t_data > 0) *r__data = 1;
-		   else if (*t_data < 0) *r__data = -1;
-		   else *r__data = 0;);
+  TH_TENSOR_PARALLEL_APPLY2(real, r_, real, t, 
+                            if (*t_data > 0) *r__data = 1;
+                            else if (*t_data < 0) *r__data = -1;
+                            else *r__data = 0;);
 #endif
 }
 
@@ -668,7 +1166,7 @@ void THTensor_(range)(THTensor *r_, real xmin, real xmax, real step)
   TH_TENSOR_APPLY(real, r_, *r__data = xmin + (i++)*step;);
 }
 
-void THTensor_(randperm)(THTensor *r_, long n)
+void THTensor_(randperm)(THTensor *r_, THGenerator *gen, long n)
 {
   real *r__data;
   long r__stride_0;
@@ -685,7 +1183,7 @@ void THTensor_(randperm)(THTensor *r_, long n)
 
   for(i = 0; i < n-1; i++)
   {    
-    long z = THRandom_random() % (n-i);
+    long z = THGenerator_random(gen) % (n-i);
     real sav = r__data[i*r__stride_0];
     r__data[i*r__stride_0] = r__data[(z+i)*r__stride_0];
     r__data[(z+i)*r__stride_0] = sav;
@@ -698,85 +1196,6 @@ void THTensor_(reshape)(THTensor *r_, THTensor *t, THLongStorage *size)
   THTensor_(copy)(r_, t);
 }
 
-/* I cut and pasted (slightly adapted) the quicksort code from
-   http://www.alienryderflex.com/quicksort/
-   This public-domain C implementation by Darel Rex Finley.
-   Thanks man :)
-*/
-#define  MAX_LEVELS  300
-static void THTensor_(quicksortascend)(real *arr, long *idx, long elements, long stride)
-{
-  long beg[MAX_LEVELS], end[MAX_LEVELS], i=0, L, R, swap, pid;
-  real piv;
-  
-  beg[0]=0; end[0]=elements;
-  while (i>=0) {
-    L=beg[i]; R=end[i]-1;
-    if (L<R) {
-      piv=arr[L*stride];
-      pid=idx[L*stride];
-      while (L<R) {
-        while (arr[R*stride]>=piv && L<R) R--; if (L<R) {idx[L*stride]=idx[R*stride]; arr[L*stride]=arr[R*stride]; L++;}
-        while (arr[L*stride]<=piv && L<R) L++; if (L<R) {idx[R*stride]=idx[L*stride]; arr[R*stride]=arr[L*stride]; R--;} }
-      idx[L*stride]=pid; arr[L*stride]=piv; beg[i+1]=L+1; end[i+1]=end[i]; end[i++]=L;
-      if (end[i]-beg[i]>end[i-1]-beg[i-1]) {
-        swap=beg[i]; beg[i]=beg[i-1]; beg[i-1]=swap;
-        swap=end[i]; end[i]=end[i-1]; end[i-1]=swap; }}
-    else {
-      i--; }}}
-
-static void THTensor_(quicksortdescend)(real *arr, long *idx, long elements, long stride)
-{
-  long beg[MAX_LEVELS], end[MAX_LEVELS], i=0, L, R, swap, pid;
-  real piv;
-  
-  beg[0]=0; end[0]=elements;
-  while (i>=0) {
-    L=beg[i]; R=end[i]-1;
-    if (L<R) {
-      piv=arr[L*stride];
-      pid=idx[L*stride];
-      while (L<R) {
-        while (arr[R*stride]<=piv && L<R) R--; if (L<R) {idx[L*stride]=idx[R*stride]; arr[L*stride]=arr[R*stride]; L++;}
-        while (arr[L*stride]>=piv && L<R) L++; if (L<R) {idx[R*stride]=idx[L*stride]; arr[R*stride]=arr[L*stride]; R--;} }
-      idx[L*stride]=pid; arr[L*stride]=piv; beg[i+1]=L+1; end[i+1]=end[i]; end[i++]=L;
-      if (end[i]-beg[i]>end[i-1]-beg[i-1]) {
-        swap=beg[i]; beg[i]=beg[i-1]; beg[i-1]=swap;
-        swap=end[i]; end[i]=end[i-1]; end[i-1]=swap; }}
-    else {
-      i--; }}}
-
-void THTensor_(sort)(THTensor *rt_, THLongTensor *ri_, THTensor *t, int dimension, int descendingOrder)
-{
-  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "invalid dimension");
-
-  THTensor_(resizeAs)(rt_, t);
-  THTensor_(copy)(rt_, t);
-
-  {
-    THLongStorage *size = THTensor_(newSizeOf)(t);
-    THLongTensor_resize(ri_, size, NULL);
-    THLongStorage_free(size);
-  }
-
-  if(descendingOrder)
-  {
-    TH_TENSOR_DIM_APPLY2(real, rt_, long, ri_, dimension, 
-                         long i;
-                         for(i = 0; i < ri__size; i++)
-                           ri__data[i*ri__stride] = i;
-                         THTensor_(quicksortdescend)(rt__data, ri__data, rt__size, rt__stride);)
-      }
-  else
-  {
-    TH_TENSOR_DIM_APPLY2(real, rt_, long, ri_, dimension,
-                         long i;
-                         for(i = 0; i < ri__size; i++)
-                           ri__data[i*ri__stride] = i;
-                         THTensor_(quicksortascend)(rt__data, ri__data, rt__size, rt__stride);)
-      }
-}
-
 void THTensor_(tril)(THTensor *r_, THTensor *t, long k)
 {
   long t_size_0, t_size_1;
@@ -890,14 +1309,14 @@ void THTensor_(cat)(THTensor *r_, THTensor *ta, THTensor *tb, int dimension)
   {									\
     THByteTensor_rawResize(r_, t->nDimension, t->size, NULL);		\
     THByteTensor_zero(r_);						\
-    TH_TENSOR_APPLY2(unsigned char, r_, real, t,			\
+    TH_TENSOR_PARALLEL_APPLY2(unsigned char, r_, real, t,		\
 		     if (*t_data OP value) *r__data = 1;);		\
   }									\
   void THTensor_(NAME##Tensor)(THByteTensor *r_, THTensor *ta, THTensor *tb) \
   {									\
     THByteTensor_rawResize(r_, ta->nDimension, ta->size, NULL);		\
     THByteTensor_zero(r_);						\
-    TH_TENSOR_APPLY3(unsigned char, r_, real, ta, real, tb,		\
+    TH_TENSOR_PARALLEL_APPLY3(unsigned char, r_, real, ta, real, tb,	\
 		     if(*ta_data OP *tb_data) *r__data = 1;);		\
   }									\
 
@@ -916,19 +1335,38 @@ TENSOR_IMPLEMENT_LOGICAL(ne,!=)
   void THTensor_(NAME)(THTensor *r_, THTensor *t)                \
   {                                                           \
     THTensor_(resizeAs)(r_, t);                               \
-    TH_TENSOR_APPLY2(real, t, real, r_, *r__data = CFUNC(*t_data);); \
+    TH_TENSOR_PARALLEL_APPLY2(real, t, real, r_, *r__data = CFUNC(*t_data);); \
   }                                                           \
 
 #define LAB_IMPLEMENT_BASIC_FUNCTION_VALUE(NAME, CFUNC)                 \
   void THTensor_(NAME)(THTensor *r_, THTensor *t, real value)              \
   {                                                                     \
     THTensor_(resizeAs)(r_, t);                                         \
-    TH_TENSOR_APPLY2(real, t, real, r_, *r__data = CFUNC(*t_data, value);); \
+    TH_TENSOR_PARALLEL_APPLY2(real, t, real, r_, *r__data = CFUNC(*t_data, value);); \
   }                                                                     \
                                                                         \
-LAB_IMPLEMENT_BASIC_FUNCTION(log,log)
-LAB_IMPLEMENT_BASIC_FUNCTION(log1p,log1p)
-LAB_IMPLEMENT_BASIC_FUNCTION(exp,exp)
+/* functions with a THVector version (which is approximate in fast mode, see
+   THVector_setFastMath()), used on contiguous tensors */
+#define LAB_IMPLEMENT_VECTOR_FUNCTION(NAME, CFUNC)                      \
+  void THTensor_(NAME)(THTensor *r_, THTensor *t)                       \
+  {                                                                     \
+    THTensor_(resizeAs)(r_, t);                                         \
+    if(THTensor_(isContiguous)(r_) && THTensor_(isContiguous)(t))       \
+    {                                                                   \
+      real *r__data = THTensor_(data)(r_);                              \
+      real *t_data = THTensor_(data)(t);                                \
+      TH_PARALLEL_CHUNKS(THTensor_(nElement)(r_), r__offset, r__length, \
+                         THVector_(NAME)(r__data+r__offset, t_data+r__offset, r__length);); \
+    }                                                                   \
+    else                                                                \
+      TH_TENSOR_PARALLEL_APPLY2(real, t, real, r_, *r__data = CFUNC(*t_data);); \
+  }                                                                     \
+
+#define LAB_SIGMOID(x) (1./(1.+exp(-(x))))
+
+LAB_IMPLEMENT_VECTOR_FUNCTION(log,log)
+LAB_IMPLEMENT_VECTOR_FUNCTION(log1p,log1p)
+LAB_IMPLEMENT_VECTOR_FUNCTION(exp,exp)
 LAB_IMPLEMENT_BASIC_FUNCTION(cos,cos)
 LAB_IMPLEMENT_BASIC_FUNCTION(acos,acos)
 LAB_IMPLEMENT_BASIC_FUNCTION(cosh,cosh)
@@ -937,7 +1375,8 @@ LAB_IMPLEMENT_BASIC_FUNCTION(asin,asin)
 LAB_IMPLEMENT_BASIC_FUNCTION(sinh,sinh)
 LAB_IMPLEMENT_BASIC_FUNCTION(tan,tan)
 LAB_IMPLEMENT_BASIC_FUNCTION(atan,atan)
-LAB_IMPLEMENT_BASIC_FUNCTION(tanh,tanh)
+LAB_IMPLEMENT_VECTOR_FUNCTION(tanh,tanh)
+LAB_IMPLEMENT_VECTOR_FUNCTION(sigmoid,LAB_SIGMOID)
 LAB_IMPLEMENT_BASIC_FUNCTION_VALUE(pow,pow)
 LAB_IMPLEMENT_BASIC_FUNCTION(sqrt,sqrt)
 LAB_IMPLEMENT_BASIC_FUNCTION(ceil,ceil)
@@ -947,125 +1386,39 @@ LAB_IMPLEMENT_BASIC_FUNCTION(abs,fabs)
 void THTensor_(atan2)(THTensor *r_, THTensor *tx, THTensor *ty)
 {
   THTensor_(resizeAs)(r_, tx);
-  TH_TENSOR_APPLY3(real, r_, real, tx, real, ty, *r__data = atan2(*tx_data,*ty_data););
+  TH_TENSOR_PARALLEL_APPLY3(real, r_, real, tx, real, ty, *r__data = atan2(*tx_data,*ty_data););
 }
 
 void THTensor_(mean)(THTensor *r_, THTensor *t, int dimension)
 {
-  THLongStorage *dim;
-
   THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "invalid dimension");
 
-  dim = THTensor_(newSizeOf)(t);
-  THLongStorage_set(dim, dimension, 1);
-  THTensor_(resize)(r_, dim, NULL);
-  THLongStorage_free(dim);
-
-  TH_TENSOR_DIM_APPLY2(real, t, real, r_, dimension,
-                       accreal sum = 0;
-                       long i;
-                       for(i = 0; i < t_size; i++)
-                         sum += t_data[i*t_stride];
-                       *r__data = (real)sum/t_size;);
+  THTensor_(reduceResize)(r_, NULL, t, dimension);
+  THTensor_(reduceDim)(THREDUCE_MEAN, r_, NULL, t, dimension, 0, 0);
 }
 
 void THTensor_(std)(THTensor *r_, THTensor *t, int dimension, int flag)
 {
-  THLongStorage *dim;
-
   THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 3, "invalid dimension");
 
-  dim = THTensor_(newSizeOf)(t);
-  THLongStorage_set(dim, dimension, 1);
-  THTensor_(resize)(r_, dim, NULL);
-  THLongStorage_free(dim);
-
-  TH_TENSOR_DIM_APPLY2(real, t, real, r_, dimension,
-                       accreal sum = 0;
-                       accreal sum2 = 0;
-                       long i;
-                       for(i = 0; i < t_size; i++)
-                       {
-                         real z = t_data[i*t_stride];
-                         sum += z;
-                         sum2 += z*z;
-                       }
-
-                       if(flag)
-                       {
-                         sum /= t_size;
-                         sum2 /= t_size;
-                         sum2 -= sum*sum;
-                         sum2 = (sum2 < 0 ? 0 : sum2);
-                         *r__data = (real)sqrt(sum2);
-                       }
-                       else
-                       {
-                         sum /= t_size;
-                         sum2 /= t_size-1;
-                         sum2 -= ((real)t_size)/((real)(t_size-1))*sum*sum;
-                         sum2 = (sum2 < 0 ? 0 : sum2);
-                         *r__data = (real)sqrt(sum2);
-                       });
+  THTensor_(reduceResize)(r_, NULL, t, dimension);
+  THTensor_(reduceDim)(THREDUCE_STD, r_, NULL, t, dimension, 0, flag);
 }
 
 void THTensor_(var)(THTensor *r_, THTensor *t, int dimension, int flag)
 {
-  THLongStorage *dim;
-
   THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 3, "invalid dimension");
 
-  dim = THTensor_(newSizeOf)(t);
-  THLongStorage_set(dim, dimension, 1);
-  THTensor_(resize)(r_, dim, NULL);
-  THLongStorage_free(dim);
-
-  TH_TENSOR_DIM_APPLY2(real, t, real, r_, dimension,
-                       accreal sum = 0;
-                       accreal sum2 = 0;
-                       long i;
-                       for(i = 0; i < t_size; i++)
-                       {
-                         real z = t_data[i*t_stride];
-                         sum += z;
-                         sum2 += z*z;
-                       }
-
-                       if(flag)
-                       {
-                         sum /= t_size;
-                         sum2 /= t_size;
-                         sum2 -= sum*sum;
-                         sum2 = (sum2 < 0 ? 0 : sum2);
-                         *r__data = sum2;
-                       }
-                       else
-                       {
-                         sum /= t_size;
-                         sum2 /= t_size-1;
-                         sum2 -= ((real)t_size)/((real)(t_size-1))*sum*sum;
-                         sum2 = (sum2 < 0 ? 0 : sum2);
-                         *r__data = (real)sum2;
-                       });
+  THTensor_(reduceResize)(r_, NULL, t, dimension);
+  THTensor_(reduceDim)(THREDUCE_VAR, r_, NULL, t, dimension, 0, flag);
 }
 
 void THTensor_(norm)(THTensor *r_, THTensor *t, real value, int dimension)
 {
-  THLongStorage *dim;
-
   THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 3, "invalid dimension");
 
-  dim = THTensor_(newSizeOf)(t);
-  THLongStorage_set(dim, dimension, 1);
-  THTensor_(resize)(r_, dim, NULL);
-  THLongStorage_free(dim);
-
-  TH_TENSOR_DIM_APPLY2(real, t, real, r_, dimension,
-                       accreal sum = 0;
-                       long i;
-                       for(i = 0; i < t_size; i++)
-                         sum += pow(fabs(t_data[i*t_stride]), value);
-                       *r__data = pow(sum, 1.0/value);)
+  THTensor_(reduceResize)(r_, NULL, t, dimension);
+  THTensor_(reduceDim)(THREDUCE_NORM, r_, NULL, t, dimension, value, 0);
 }
 
 accreal THTensor_(normall)(THTensor *tensor, real value)
@@ -1146,16 +1499,16 @@ void THTensor_(logspace)(THTensor *r_, real a, real b, long n)
   }
 }
 
-void THTensor_(rand)(THTensor *r_, THLongStorage *size)
+void THTensor_(rand)(THTensor *r_, THGenerator *gen, THLongStorage *size)
 {
   THTensor_(resize)(r_, size, NULL);
-  THTensor_(uniform)(r_, 0, 1);
+  THTensor_(uniform)(r_, gen, 0, 1);
 }
 
-void THTensor_(randn)(THTensor *r_, THLongStorage *size)
+void THTensor_(randn)(THTensor *r_, THGenerator *gen, THLongStorage *size)
 {
   THTensor_(resize)(r_, size, NULL);
-  THTensor_(normal)(r_, 0, 1);
+  THTensor_(normal)(r_, gen, 0, 1);
 }
 
 void THTensor_(histc)(THTensor *hist, THTensor *tensor, long nbins, real minvalue, real maxvalue)
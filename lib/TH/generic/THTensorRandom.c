@@ -2,64 +2,215 @@
 #define TH_GENERIC_FILE "generic/THTensorRandom.c"
 #else
 
-TH_API void THTensor_(random)(THTensor *self)
+/* numbers drawn at once by the bulk generators */
+#ifndef TH_RANDOM_BLOCK
+#define TH_RANDOM_BLOCK 256
+#endif
+
+/* Fills SELF with random integers drawn from GEN.
+
+   A Mersenne Twister is sequential: MT_CODE is applied to each element, in
+   the order of TH_TENSOR_APPLY.
+
+   A Philox stream is split by offset instead: PHILOX_CODE computes the i-th
+   element (in the linear order of the tensor) from the number found in
+   "philox" at position pos = base+i. Contiguous tensors are then filled in
+   parallel, and the results do not depend on the number of threads nor on
+   the strides of the tensor. */
+#define THTensor_randomFill(SELF, GEN, MT_CODE, PHILOX_CODE) \
+{ \
+  if((GEN)->type == TH_GENERATOR_PHILOX) \
+  { \
+    long THTensor_randomFill_n = THTensor_(nElement)(SELF); \
+    unsigned long long THTensor_randomFill_base = THGenerator_reserve(GEN, THTensor_randomFill_n); \
+    unsigned long THTensor_randomFill_seed = (GEN)->the_initial_seed; \
+\
+    if(THTensor_(isContiguous)(SELF)) \
+    { \
+      real *THTensor_randomFill_data = THTensor_(data)(SELF); \
+      TH_PARALLEL_CHUNKS(THTensor_randomFill_n, THTensor_randomFill_offset, THTensor_randomFill_length, \
+      { \
+        THPhilox philox; \
+        real *self_data = THTensor_randomFill_data+THTensor_randomFill_offset; \
+        real *THTensor_randomFill_end = self_data+THTensor_randomFill_length; \
+        unsigned long long pos = THTensor_randomFill_base+THTensor_randomFill_offset; \
+        THPhilox_init(&philox, THTensor_randomFill_seed); \
+        for(; self_data < THTensor_randomFill_end; self_data++, pos++) \
+        { \
+          PHILOX_CODE \
+        } \
+      }); \
+    } \
+    else \
+    { \
+      THPhilox philox; \
+      unsigned long long pos = THTensor_randomFill_base; \
+      THPhilox_init(&philox, THTensor_randomFill_seed); \
+      TH_TENSOR_APPLY(real, SELF, PHILOX_CODE pos++;); \
+    } \
+  } \
+  else \
+    TH_TENSOR_APPLY(real, SELF, MT_CODE); \
+}
+
+TH_API void THTensor_(random)(THTensor *self, THGenerator *gen)
 {
 #if defined(TH_REAL_IS_BYTE)
-  TH_TENSOR_APPLY(real, self, *self_data = (unsigned char)(THRandom_random() % (UCHAR_MAX+1)););
+  THTensor_randomFill(self, gen,
+                      *self_data = (unsigned char)(THGenerator_random(gen) % (UCHAR_MAX+1));,
+                      *self_data = (unsigned char)(THPhilox_get(&philox, pos) % (UCHAR_MAX+1)););
 #elif defined(TH_REAL_IS_CHAR)
-  TH_TENSOR_APPLY(real, self, *self_data = (char)(THRandom_random() % (CHAR_MAX+1)););
+  THTensor_randomFill(self, gen,
+                      *self_data = (char)(THGenerator_random(gen) % (CHAR_MAX+1));,
+                      *self_data = (char)(THPhilox_get(&philox, pos) % (CHAR_MAX+1)););
 #elif defined(TH_REAL_IS_SHORT)
-  TH_TENSOR_APPLY(real, self, *self_data = (short)(THRandom_random() % (SHRT_MAX+1)););
+  THTensor_randomFill(self, gen,
+                      *self_data = (short)(THGenerator_random(gen) % (SHRT_MAX+1));,
+                      *self_data = (short)(THPhilox_get(&philox, pos) % (SHRT_MAX+1)););
 #elif defined(TH_REAL_IS_INT)
-  TH_TENSOR_APPLY(real, self, *self_data = (int)(THRandom_random() % (INT_MAX+1UL)););
+  THTensor_randomFill(self, gen,
+                      *self_data = (int)(THGenerator_random(gen) % (INT_MAX+1UL));,
+                      *self_data = (int)(THPhilox_get(&philox, pos) % (INT_MAX+1UL)););
 #elif defined(TH_REAL_IS_LONG)
-  TH_TENSOR_APPLY(real, self, *self_data = (long)(THRandom_random() % (LONG_MAX+1UL)););
+  THTensor_randomFill(self, gen,
+                      *self_data = (long)(THGenerator_random(gen) % (LONG_MAX+1UL));,
+                      *self_data = (long)(THPhilox_get(&philox, pos) % (LONG_MAX+1UL)););
 #elif defined(TH_REAL_IS_FLOAT)
-  TH_TENSOR_APPLY(real, self, *self_data = (float)(THRandom_random() % ((1UL << FLT_MANT_DIG)+1)););
+  THTensor_randomFill(self, gen,
+                      *self_data = (float)(THGenerator_random(gen) % ((1UL << FLT_MANT_DIG)+1));,
+                      *self_data = (float)(THPhilox_get(&philox, pos) % ((1UL << FLT_MANT_DIG)+1)););
 #elif defined(TH_REAL_IS_DOUBLE)
-  TH_TENSOR_APPLY(real, self, *self_data = (float)(THRandom_random() % ((1UL << DBL_MANT_DIG)+1)););
+  THTensor_randomFill(self, gen,
+                      *self_data = (float)(THGenerator_random(gen) % ((1UL << DBL_MANT_DIG)+1));,
+                      *self_data = (float)(THPhilox_get(&philox, pos) % ((1UL << DBL_MANT_DIG)+1)););
 #else
 #error "Unknown type"
 #endif
 }
 
-TH_API void THTensor_(geometric)(THTensor *self, double p)
+/* Fills SELF with numbers drawn in blocks of TH_RANDOM_BLOCK by BLOCK
+   (THGenerator_uniformBlock or THGenerator_normalBlock, with parameters A and
+   B), and transformed by CODE from x into *self_data.
+
+   The numbers are drawn in the linear order of the tensor, whatever its
+   strides. Contiguous tensors are written directly, and in parallel chunks
+   when GEN is a Philox generator. */
+#define THTensor_blockFill(SELF, GEN, BLOCK, A, B, CODE) \
+{ \
+  long THTensor_blockFill_n = THTensor_(nElement)(SELF); \
+  unsigned long long THTensor_blockFill_base = \
+    ((GEN)->type == TH_GENERATOR_PHILOX ? THGenerator_reserve(GEN, THTensor_blockFill_n) : 0); \
+\
+  if(THTensor_(isContiguous)(SELF)) \
+  { \
+    real *THTensor_blockFill_data = THTensor_(data)(SELF); \
+    if((GEN)->type == TH_GENERATOR_PHILOX) \
+    { \
+      TH_PARALLEL_CHUNKS(THTensor_blockFill_n, THTensor_blockFill_offset, THTensor_blockFill_length, \
+                         THTensor_blockFillChunk(GEN, BLOCK, A, B, CODE, \
+                                                 THTensor_blockFill_data+THTensor_blockFill_offset, \
+                                                 THTensor_blockFill_base+THTensor_blockFill_offset, \
+                                                 THTensor_blockFill_length)); \
+    } \
+    else \
+      THTensor_blockFillChunk(GEN, BLOCK, A, B, CODE, THTensor_blockFill_data, 0, THTensor_blockFill_n); \
+  } \
+  else \
+  { \
+    double THTensor_blockFill_buf[TH_RANDOM_BLOCK]; \
+    long THTensor_blockFill_done = 0; \
+    long THTensor_blockFill_k = 0; \
+    long THTensor_blockFill_m = 0; \
+    TH_TENSOR_APPLY(real, SELF, \
+                    if(THTensor_blockFill_k == THTensor_blockFill_m) \
+                    { \
+                      THTensor_blockFill_m = THMin(TH_RANDOM_BLOCK, THTensor_blockFill_n-THTensor_blockFill_done); \
+                      BLOCK(GEN, THTensor_blockFill_base+THTensor_blockFill_done, THTensor_blockFill_buf, THTensor_blockFill_m, A, B); \
+                      THTensor_blockFill_done += THTensor_blockFill_m; \
+                      THTensor_blockFill_k = 0; \
+                    } \
+                    { \
+                      double x = THTensor_blockFill_buf[THTensor_blockFill_k++]; \
+                      CODE \
+                    }); \
+  } \
+}
+
+/* fills LENGTH contiguous elements starting at DATA (see above) */
+#define THTensor_blockFillChunk(GEN, BLOCK, A, B, CODE, DATA, POS, LENGTH) \
+{ \
+  double THTensor_blockFill_buf[TH_RANDOM_BLOCK]; \
+  real *self_data = (DATA); \
+  long THTensor_blockFill_done = 0; \
+  while(THTensor_blockFill_done < (LENGTH)) \
+  { \
+    long THTensor_blockFill_m = THMin(TH_RANDOM_BLOCK, (LENGTH)-THTensor_blockFill_done); \
+    long THTensor_blockFill_k; \
+    BLOCK(GEN, (POS)+THTensor_blockFill_done, THTensor_blockFill_buf, THTensor_blockFill_m, A, B); \
+    for(THTensor_blockFill_k = 0; THTensor_blockFill_k < THTensor_blockFill_m; THTensor_blockFill_k++, self_data++) \
+    { \
+      double x = THTensor_blockFill_buf[THTensor_blockFill_k]; \
+      CODE \
+    } \
+    THTensor_blockFill_done += THTensor_blockFill_m; \
+  } \
+}
+
+TH_API void THTensor_(geometric)(THTensor *self, THGenerator *gen, double p)
 {
-  TH_TENSOR_APPLY(real, self, *self_data = (real)THRandom_geometric(p););
+  double lp = log(p);
+  THArgCheck(p > 0 && p < 1, 3, "must be > 0 and < 1");
+  THTensor_blockFill(self, gen, THGenerator_uniformBlock, 0, 1,
+                     *self_data = (real)((int)(log(1-x) / lp) + 1););
 }
 
-TH_API void THTensor_(bernoulli)(THTensor *self, double p)
+TH_API void THTensor_(bernoulli)(THTensor *self, THGenerator *gen, double p)
 {
-  TH_TENSOR_APPLY(real, self, *self_data = (real)THRandom_bernoulli(p););
+  THArgCheck(p >= 0 && p <= 1, 3, "must be >= 0 and <= 1");
+  THTensor_blockFill(self, gen, THGenerator_uniformBlock, 0, 1,
+                     *self_data = (real)(x <= p););
 }
 
 #if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
 
-TH_API void THTensor_(uniform)(THTensor *self, double a, double b)
+TH_API void THTensor_(uniform)(THTensor *self, THGenerator *gen, double a, double b)
 {
-  TH_TENSOR_APPLY(real, self, *self_data = (real)THRandom_uniform(a, b););
+  THTensor_blockFill(self, gen, THGenerator_uniformBlock, a, b,
+                     *self_data = (real)x;);
 }
 
-TH_API void THTensor_(normal)(THTensor *self, double mean, double stdv)
+TH_API void THTensor_(normal)(THTensor *self, THGenerator *gen, double mean, double stdv)
 {
-  TH_TENSOR_APPLY(real, self, *self_data = (real)THRandom_normal(mean, stdv););
+  THArgCheck(stdv > 0, 4, "standard deviation must be strictly positive");
+  THTensor_blockFill(self, gen, THGenerator_normalBlock, mean, stdv,
+                     *self_data = (real)x;);
 }
 
-TH_API void THTensor_(exponential)(THTensor *self, double lambda)
+TH_API void THTensor_(exponential)(THTensor *self, THGenerator *gen, double lambda)
 {
-  TH_TENSOR_APPLY(real, self, *self_data = (real)THRandom_exponential(lambda););
+  THTensor_blockFill(self, gen, THGenerator_uniformBlock, 0, 1,
+                     *self_data = (real)(-1. / lambda * log(1-x)););
 }
 
-TH_API void THTensor_(cauchy)(THTensor *self, double median, double sigma)
+TH_API void THTensor_(cauchy)(THTensor *self, THGenerator *gen, double median, double sigma)
 {
-  TH_TENSOR_APPLY(real, self, *self_data = (real)THRandom_cauchy(median, sigma););
+  THTensor_blockFill(self, gen, THGenerator_uniformBlock, 0, 1,
+                     *self_data = (real)(median + sigma * tan(M_PI*(x-0.5))););
 }
 
-TH_API void THTensor_(logNormal)(THTensor *self, double mean, double stdv)
+TH_API void THTensor_(logNormal)(THTensor *self, THGenerator *gen, double mean, double stdv)
 {
-  TH_TENSOR_APPLY(real, self, *self_data = (real)THRandom_logNormal(mean, stdv););
+  double zm = mean*mean;
+  double zs = stdv*stdv;
+  THArgCheck(stdv > 0, 4, "standard deviation must be strictly positive");
+  THTensor_blockFill(self, gen, THGenerator_normalBlock, log(zm/sqrt(zs + zm)), sqrt(log(zs/zm+1)),
+                     *self_data = (real)exp(x););
 }
 
 #endif
 
+#undef THTensor_blockFill
+#undef THTensor_blockFillChunk
+#undef THTensor_randomFill
+
 #endif
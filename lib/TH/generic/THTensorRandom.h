@@ -2,16 +2,16 @@
 #define TH_GENERIC_FILE "generic/THTensorRandom.h"
 #else
 
-TH_API void THTensor_(random)(THTensor *self);
-TH_API void THTensor_(geometric)(THTensor *self, double p);
-TH_API void THTensor_(bernoulli)(THTensor *self, double p);
+TH_API void THTensor_(random)(THTensor *self, THGenerator *gen);
+TH_API void THTensor_(geometric)(THTensor *self, THGenerator *gen, double p);
+TH_API void THTensor_(bernoulli)(THTensor *self, THGenerator *gen, double p);
 
 #if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
-TH_API void THTensor_(uniform)(THTensor *self, double a, double b);
-TH_API void THTensor_(normal)(THTensor *self, double mean, double stdv);
-TH_API void THTensor_(exponential)(THTensor *self, double lambda);
-TH_API void THTensor_(cauchy)(THTensor *self, double median, double sigma);
-TH_API void THTensor_(logNormal)(THTensor *self, double mean, double stdv);
+TH_API void THTensor_(uniform)(THTensor *self, THGenerator *gen, double a, double b);
+TH_API void THTensor_(normal)(THTensor *self, THGenerator *gen, double mean, double stdv);
+TH_API void THTensor_(exponential)(THTensor *self, THGenerator *gen, double lambda);
+TH_API void THTensor_(cauchy)(THTensor *self, THGenerator *gen, double median, double sigma);
+TH_API void THTensor_(logNormal)(THTensor *self, THGenerator *gen, double mean, double stdv);
 #endif
 
 #endif
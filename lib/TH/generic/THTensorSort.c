@@ -0,0 +1,368 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/THTensorSort.c"
+#else
+
+/* Sorting and selection along a dimension.
+
+   Each slice is copied in a contiguous buffer, as keys which are unsigned
+   integers ordered like the values, with the index of each value. Slices are
+   processed in parallel, each thread with its own buffers.
+
+   Floating-point values become keys by flipping their sign bit, and all
+   their other bits too when negative; signed integers by flipping their sign
+   bit. Complementing the keys reverses the order. Short slices are sorted
+   with a quicksort which breaks ties with the indices, long ones with a
+   radix sort: both are stable, so equal values keep the order of their
+   indices. Selections (topk, kthvalue) partition the keys around the k-th
+   one, in linear time. */
+
+#if defined(TH_REAL_IS_BYTE) || defined(TH_REAL_IS_CHAR)
+#define THSortKey unsigned char
+#define THSORT_RADIX_BITS 8
+#elif defined(TH_REAL_IS_SHORT)
+#define THSortKey unsigned short
+#define THSORT_RADIX_BITS 8
+#elif defined(TH_REAL_IS_INT) || defined(TH_REAL_IS_FLOAT)
+#define THSortKey unsigned int
+#define THSORT_RADIX_BITS 11
+#else
+#define THSortKey unsigned long long
+#define THSORT_RADIX_BITS 11
+#endif
+
+#define THSORT_SIGN ((THSortKey)1 << (8*sizeof(THSortKey)-1))
+#define THSORT_RADIX_PASSES ((int)(8*sizeof(THSortKey)+THSORT_RADIX_BITS-1)/THSORT_RADIX_BITS)
+
+#ifndef THSORT_RADIX_THRESHOLD
+#define THSORT_INSERTION_THRESHOLD 16
+#define THSORT_RADIX_THRESHOLD 512
+#define THSORT_SORT 0
+#define THSORT_TOPK 1
+#define THSORT_KTHVALUE 2
+#endif
+
+static THSortKey THTensor_(sortKey)(real x)
+{
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+  THSortKey k;
+  memcpy(&k, &x, sizeof(real));
+  return ((k & THSORT_SIGN) ? ~k : (k | THSORT_SIGN));
+#else
+  return (THSortKey)x ^ ((real)-1 < 0 ? THSORT_SIGN : 0);
+#endif
+}
+
+static real THTensor_(sortValue)(THSortKey k)
+{
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+  real x;
+  k = ((k & THSORT_SIGN) ? (k ^ THSORT_SIGN) : ~k);
+  memcpy(&x, &k, sizeof(real));
+  return x;
+#else
+  return (real)(k ^ ((real)-1 < 0 ? THSORT_SIGN : 0));
+#endif
+}
+
+#define THSORT_LESS(I, J) \
+  (key[I] < key[J] || (key[I] == key[J] && idx[I] < idx[J]))
+
+#define THSORT_SWAP(I, J) \
+  { \
+    THSortKey swapk_ = key[I]; long swapi_ = idx[I]; \
+    key[I] = key[J]; idx[I] = idx[J]; \
+    key[J] = swapk_; idx[J] = swapi_; \
+  }
+
+static void THTensor_(insertionSort)(THSortKey *key, long *idx, long n)
+{
+  long i, j;
+
+  for(i = 1; i < n; i++)
+  {
+    THSortKey k = key[i];
+    long x = idx[i];
+    for(j = i; j > 0 && (key[j-1] > k || (key[j-1] == k && idx[j-1] > x)); j--)
+    {
+      key[j] = key[j-1];
+      idx[j] = idx[j-1];
+    }
+    key[j] = k;
+    idx[j] = x;
+  }
+}
+
+/* Orders by key, then by index: as indices are distinct, the result is the
+   one of a stable sort. Recurses on the smaller part only. */
+static void THTensor_(quickSort)(THSortKey *key, long *idx, long n)
+{
+  while(n > THSORT_INSERTION_THRESHOLD)
+  {
+    long mid = n/2, i, j;
+    THSortKey pivot;
+    long pivotIdx;
+
+    /* median of three, moved at n-2; key[0] and key[n-1] stop the scans */
+    if(THSORT_LESS(mid, 0))
+      THSORT_SWAP(mid, 0);
+    if(THSORT_LESS(n-1, 0))
+      THSORT_SWAP(n-1, 0);
+    if(THSORT_LESS(n-1, mid))
+      THSORT_SWAP(n-1, mid);
+    THSORT_SWAP(mid, n-2);
+
+    pivot = key[n-2];
+    pivotIdx = idx[n-2];
+    i = 0;
+    j = n-2;
+    for(;;)
+    {
+      do i++; while(key[i] < pivot || (key[i] == pivot && idx[i] < pivotIdx));
+      do j--; while(key[j] > pivot || (key[j] == pivot && idx[j] > pivotIdx));
+      if(j < i)
+        break;
+      THSORT_SWAP(i, j);
+    }
+    THSORT_SWAP(i, n-2);
+
+    if(i < n-i-1)
+    {
+      THTensor_(quickSort)(key, idx, i);
+      key += i+1;
+      idx += i+1;
+      n -= i+1;
+    }
+    else
+    {
+      THTensor_(quickSort)(key+i+1, idx+i+1, n-i-1);
+      n = i;
+    }
+  }
+  THTensor_(insertionSort)(key, idx, n);
+}
+
+/* least significant digit first; keyTmp and idxTmp are buffers of size n */
+static void THTensor_(radixSort)(THSortKey *key, long *idx, THSortKey *keyTmp, long *idxTmp, long n)
+{
+  long count[THSORT_RADIX_PASSES][1 << THSORT_RADIX_BITS];
+  THSortKey mask = ((THSortKey)1 << THSORT_RADIX_BITS) - 1;
+  THSortKey *keySrc = key, *keyDst = keyTmp, *keySwap;
+  long *idxSrc = idx, *idxDst = idxTmp, *idxSwap;
+  long i;
+  int pass, d;
+
+  memset(count, 0, sizeof(count));
+  for(i = 0; i < n; i++)
+  {
+    THSortKey k = key[i];
+    for(pass = 0; pass < THSORT_RADIX_PASSES; pass++)
+      count[pass][(k >> (THSORT_RADIX_BITS*pass)) & mask]++;
+  }
+
+  for(pass = 0; pass < THSORT_RADIX_PASSES; pass++)
+  {
+    int shift = THSORT_RADIX_BITS*pass;
+    long sum = 0;
+
+    /* nothing to do if all the keys have the same digit */
+    if(count[pass][(keySrc[0] >> shift) & mask] == n)
+      continue;
+
+    for(d = 0; d < (1 << THSORT_RADIX_BITS); d++)
+    {
+      long c = count[pass][d];
+      count[pass][d] = sum;
+      sum += c;
+    }
+
+    for(i = 0; i < n; i++)
+    {
+      long pos = count[pass][(keySrc[i] >> shift) & mask]++;
+      keyDst[pos] = keySrc[i];
+      idxDst[pos] = idxSrc[i];
+    }
+
+    keySwap = keySrc; keySrc = keyDst; keyDst = keySwap;
+    idxSwap = idxSrc; idxSrc = idxDst; idxDst = idxSwap;
+  }
+
+  if(keySrc != key)
+  {
+    memcpy(key, keySrc, sizeof(THSortKey)*n);
+    memcpy(idx, idxSrc, sizeof(long)*n);
+  }
+}
+
+static void THTensor_(sortKeys)(THSortKey *key, long *idx, THSortKey *keyTmp, long *idxTmp, long n)
+{
+  if(n < THSORT_RADIX_THRESHOLD)
+    THTensor_(quickSort)(key, idx, n);
+  else
+    THTensor_(radixSort)(key, idx, keyTmp, idxTmp, n);
+}
+
+/* Moves the k-th smallest key (from 0) at position k, with smaller or equal
+   keys before it, and larger or equal keys after it (Hoare's selection, with
+   a median of three pivot). */
+static void THTensor_(selectKeys)(THSortKey *key, long *idx, long n, long k)
+{
+  long l = 0, r = n-1;
+
+  while(r > l+1)
+  {
+    long mid = l + (r-l)/2;
+    long i, j;
+    THSortKey pivot;
+    long pivotIdx;
+
+    /* key[l] <= key[l+1] (the pivot) <= key[r] stop the scans below */
+    THSORT_SWAP(mid, l+1);
+    if(key[l] > key[r])
+      THSORT_SWAP(l, r);
+    if(key[l+1] > key[r])
+      THSORT_SWAP(l+1, r);
+    if(key[l] > key[l+1])
+      THSORT_SWAP(l, l+1);
+
+    i = l+1;
+    j = r;
+    pivot = key[l+1];
+    pivotIdx = idx[l+1];
+    for(;;)
+    {
+      do i++; while(key[i] < pivot);
+      do j--; while(key[j] > pivot);
+      if(j < i)
+        break;
+      THSORT_SWAP(i, j);
+    }
+    key[l+1] = key[j];
+    idx[l+1] = idx[j];
+    key[j] = pivot;
+    idx[j] = pivotIdx;
+
+    if(j >= k)
+      r = j-1;
+    if(j <= k)
+      l = i;
+  }
+
+  if(r == l+1 && key[r] < key[l])
+    THSORT_SWAP(l, r);
+}
+
+/* Runs the given mode on one slice of n elements, and writes the nout
+   first ones. key and idx are buffers of size 2n. */
+static void THTensor_(sortSlice)(real *dst, long dstStride, long *idst, long idstStride, long nout,
+                                 real *src, long srcStride, long n,
+                                 THSortKey *key, long *idx, THSortKey flip, int mode, long k, int sorted)
+{
+  long i;
+
+  for(i = 0; i < n; i++)
+  {
+    key[i] = THTensor_(sortKey)(src[i*srcStride]) ^ flip;
+    idx[i] = i;
+  }
+
+  if(mode == THSORT_SORT)
+    THTensor_(sortKeys)(key, idx, key+n, idx+n, n);
+  else
+  {
+    THTensor_(selectKeys)(key, idx, n, k-1);
+    if(mode == THSORT_KTHVALUE)
+    {
+      key[0] = key[k-1];
+      idx[0] = idx[k-1];
+    }
+    else if(sorted)
+      THTensor_(sortKeys)(key, idx, key+n, idx+n, k);
+  }
+
+  for(i = 0; i < nout; i++)
+  {
+    dst[i*dstStride] = THTensor_(sortValue)(key[i] ^ flip);
+    idst[i*idstStride] = idx[i];
+  }
+}
+
+/* Runs the given mode on each slice of t along dimension. The output
+   tensors must already have their size: n (sort), k (topk) or 1 (kthvalue)
+   along dimension, as t elsewhere. */
+static void THTensor_(sortSlices)(THTensor *rt_, THLongTensor *ri_, THTensor *t, int dimension, int descendingOrder, int mode, long k, int sorted)
+{
+  long n = t->size[dimension];
+  long nslice = (n > 0 ? THTensor_(nElement)(t)/n : 0);
+  real *t_data = THTensor_(data)(t);
+  real *rt_data = THTensor_(data)(rt_);
+  long *ri_data = THLongTensor_data(ri_);
+  THSortKey flip = (descendingOrder ? (THSortKey)~(THSortKey)0 : 0);
+  long s;
+
+#pragma omp parallel private(s) if(nslice > 1 && nslice*n >= THGetParallelThreshold())
+  {
+    THSortKey *key = THAlloc(sizeof(THSortKey)*2*n);
+    long *idx = THAlloc(sizeof(long)*2*n);
+
+#pragma omp for schedule(dynamic, 1)
+    for(s = 0; s < nslice; s++)
+    {
+      THTensor_(sortSlice)(rt_data + THTensor_sliceOffset(rt_->nDimension, rt_->size, rt_->stride, dimension, s),
+                           rt_->stride[dimension],
+                           ri_data + THTensor_sliceOffset(ri_->nDimension, ri_->size, ri_->stride, dimension, s),
+                           ri_->stride[dimension],
+                           rt_->size[dimension],
+                           t_data + THTensor_sliceOffset(t->nDimension, t->size, t->stride, dimension, s),
+                           t->stride[dimension],
+                           n, key, idx, flip, mode, k, sorted);
+    }
+
+    THFree(key);
+    THFree(idx);
+  }
+}
+
+/* resizes the outputs as t, but with size along dimension */
+static void THTensor_(sortResize)(THTensor *rt_, THLongTensor *ri_, THTensor *t, int dimension, long size)
+{
+  THLongStorage *dim = THTensor_(newSizeOf)(t);
+  THLongStorage_set(dim, dimension, size);
+  THTensor_(resize)(rt_, dim, NULL);
+  THLongTensor_resize(ri_, dim, NULL);
+  THLongStorage_free(dim);
+}
+
+void THTensor_(sort)(THTensor *rt_, THLongTensor *ri_, THTensor *t, int dimension, int descendingOrder)
+{
+  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "invalid dimension");
+
+  THTensor_(sortResize)(rt_, ri_, t, dimension, t->size[dimension]);
+  THTensor_(sortSlices)(rt_, ri_, t, dimension, descendingOrder, THSORT_SORT, 0, 0);
+}
+
+void THTensor_(topk)(THTensor *rt_, THLongTensor *ri_, THTensor *t, long k, int dimension, int dir, int sorted)
+{
+  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 3, "invalid dimension");
+  THArgCheck(k >= 1 && k <= t->size[dimension], 2, "k out of range");
+
+  THTensor_(sortResize)(rt_, ri_, t, dimension, k);
+  THTensor_(sortSlices)(rt_, ri_, t, dimension, dir, THSORT_TOPK, k, sorted);
+}
+
+void THTensor_(kthvalue)(THTensor *values_, THLongTensor *indices_, THTensor *t, long k, int dimension)
+{
+  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 3, "invalid dimension");
+  THArgCheck(k >= 1 && k <= t->size[dimension], 2, "k out of range");
+
+  THTensor_(sortResize)(values_, indices_, t, dimension, 1);
+  THTensor_(sortSlices)(values_, indices_, t, dimension, 0, THSORT_KTHVALUE, k, 0);
+}
+
+#undef THSORT_LESS
+#undef THSORT_SWAP
+#undef THSortKey
+#undef THSORT_SIGN
+#undef THSORT_RADIX_BITS
+#undef THSORT_RADIX_PASSES
+
+#endif
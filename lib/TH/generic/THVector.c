@@ -2,7 +2,10 @@
 #define TH_GENERIC_FILE "generic/THVector.c"
 #else
 
-static inline void THVector_(fill)(real *x, const real c, const long n) {
+/* plain C versions, used for integer types and when no SIMD instruction set
+   is available */
+
+static inline void THVector_(fill_DEFAULT)(real *x, const real c, const long n) {
   long i = 0;
 
   for(; i < n-4; i += 4)
@@ -17,7 +20,7 @@ static inline void THVector_(fill)(real *x, const real c, const long n) {
     x[i] = c;
 }
 
-static inline void THVector_(add)(real *y, const real *x, const real c, const long n)
+static inline void THVector_(add_DEFAULT)(real *y, const real *x, const real c, const long n)
 {
   long i = 0;
 
@@ -33,7 +36,7 @@ static inline void THVector_(add)(real *y, const real *x, const real c, const lo
     y[i] += c * x[i];
 }
 
-static inline void THVector_(diff)(real *z, const real *x, const real *y, const long n)
+static inline void THVector_(diff_DEFAULT)(real *z, const real *x, const real *y, const long n)
 {
   long i = 0;
 
@@ -49,7 +52,7 @@ static inline void THVector_(diff)(real *z, const real *x, const real *y, const
     z[i] = x[i] - y[i];
 }
 
-static inline void THVector_(scale)(real *y, const real c, const long n)
+static inline void THVector_(scale_DEFAULT)(real *y, const real c, const long n)
 {
   long i = 0;
 
@@ -65,7 +68,7 @@ static inline void THVector_(scale)(real *y, const real c, const long n)
     y[i] *= c;
 }
 
-static inline void THVector_(mul)(real *y, const real *x, const long n)
+static inline void THVector_(mul_DEFAULT)(real *y, const real *x, const long n)
 {
   long i = 0;
 
@@ -81,4 +84,162 @@ static inline void THVector_(mul)(real *y, const real *x, const long n)
     y[i] *= x[i];
 }
 
+static inline void THVector_(cmul_DEFAULT)(real *z, const real *x, const real *y, const long n)
+{
+  long i = 0;
+
+  for(; i < n-4; i += 4)
+  {
+    z[i] = x[i] * y[i];
+    z[i+1] = x[i+1] * y[i+1];
+    z[i+2] = x[i+2] * y[i+2];
+    z[i+3] = x[i+3] * y[i+3];
+  }
+
+  for(; i < n; i++)
+    z[i] = x[i] * y[i];
+}
+
+static inline void THVector_(cdiv_DEFAULT)(real *z, const real *x, const real *y, const long n)
+{
+  long i = 0;
+
+  for(; i < n-4; i += 4)
+  {
+    z[i] = x[i] / y[i];
+    z[i+1] = x[i+1] / y[i+1];
+    z[i+2] = x[i+2] / y[i+2];
+    z[i+3] = x[i+3] / y[i+3];
+  }
+
+  for(; i < n; i++)
+    z[i] = x[i] / y[i];
+}
+
+static inline accreal THVector_(dot_DEFAULT)(const real *x, const real *y, const long n)
+{
+  accreal sum = 0;
+  long i;
+
+  for(i = 0; i < n; i++)
+    sum += x[i] * y[i];
+
+  return sum;
+}
+
+static inline accreal THVector_(sum_DEFAULT)(const real *x, const long n)
+{
+  accreal sum = 0;
+  long i;
+
+  for(i = 0; i < n; i++)
+    sum += x[i];
+
+  return sum;
+}
+
+static inline real THVector_(max_DEFAULT)(const real *x, const long n)
+{
+  real theMax = x[0];
+  long i;
+
+  for(i = 1; i < n; i++)
+  {
+    if(x[i] > theMax)
+      theMax = x[i];
+  }
+
+  return theMax;
+}
+
+static inline real THVector_(min_DEFAULT)(const real *x, const long n)
+{
+  real theMin = x[0];
+  long i;
+
+  for(i = 1; i < n; i++)
+  {
+    if(x[i] < theMin)
+      theMin = x[i];
+  }
+
+  return theMin;
+}
+
+/* the gemm micro-kernel computes a block of 8 x TH_VECTOR_GEMM_NR */
+static inline int THVector_(gemmMR_DEFAULT)(void)
+{
+  return 8;
+}
+
+static inline void THVector_(gemmKernel_DEFAULT)(const long k, const real alpha, const real *a, const real *b, real *c, const long ldc)
+{
+  real acc[8*TH_VECTOR_GEMM_NR];
+  long p;
+  int i, j;
+
+  for(i = 0; i < 8*TH_VECTOR_GEMM_NR; i++)
+    acc[i] = 0;
+
+  for(p = 0; p < k; p++, a += 8, b += TH_VECTOR_GEMM_NR)
+  {
+    for(j = 0; j < TH_VECTOR_GEMM_NR; j++)
+    {
+      for(i = 0; i < 8; i++)
+        acc[j*8+i] += a[i]*b[j];
+    }
+  }
+
+  for(j = 0; j < TH_VECTOR_GEMM_NR; j++)
+  {
+    for(i = 0; i < 8; i++)
+      c[j*ldc+i] += alpha*acc[j*8+i];
+  }
+}
+
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+
+/* C library versions, used in precise mode */
+static inline void THVector_(exp_DEFAULT)(real *y, const real *x, const long n)
+{
+  long i;
+
+  for(i = 0; i < n; i++)
+    y[i] = exp(x[i]);
+}
+
+static inline void THVector_(log_DEFAULT)(real *y, const real *x, const long n)
+{
+  long i;
+
+  for(i = 0; i < n; i++)
+    y[i] = log(x[i]);
+}
+
+static inline void THVector_(log1p_DEFAULT)(real *y, const real *x, const long n)
+{
+  long i;
+
+  for(i = 0; i < n; i++)
+    y[i] = log1p(x[i]);
+}
+
+static inline void THVector_(tanh_DEFAULT)(real *y, const real *x, const long n)
+{
+  long i;
+
+  for(i = 0; i < n; i++)
+    y[i] = tanh(x[i]);
+}
+
+static inline void THVector_(sigmoid_DEFAULT)(real *y, const real *x, const long n)
+{
+  long i;
+
+  for(i = 0; i < n; i++)
+    y[i] = 1./(1.+exp(-x[i]));
+}
+
+#endif
+
 #endif
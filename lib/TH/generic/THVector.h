@@ -0,0 +1,44 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/THVector.h"
+#else
+
+/* x = c */
+TH_API void THVector_(fill)(real *x, const real c, const long n);
+/* y += c*x */
+TH_API void THVector_(add)(real *y, const real *x, const real c, const long n);
+/* z = x - y */
+TH_API void THVector_(diff)(real *z, const real *x, const real *y, const long n);
+/* y *= c */
+TH_API void THVector_(scale)(real *y, const real c, const long n);
+/* y *= x */
+TH_API void THVector_(mul)(real *y, const real *x, const long n);
+/* z = x * y */
+TH_API void THVector_(cmul)(real *z, const real *x, const real *y, const long n);
+/* z = x / y */
+TH_API void THVector_(cdiv)(real *z, const real *x, const real *y, const long n);
+/* sum(x*y) */
+TH_API accreal THVector_(dot)(const real *x, const real *y, const long n);
+/* sum(x) */
+TH_API accreal THVector_(sum)(const real *x, const long n);
+/* max(x) and min(x): n must be positive */
+TH_API real THVector_(max)(const real *x, const long n);
+TH_API real THVector_(min)(const real *x, const long n);
+
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+/* y = f(x), element-wise (y may be x); see THVector_setFastMath() */
+TH_API void THVector_(exp)(real *y, const real *x, const long n);
+TH_API void THVector_(log)(real *y, const real *x, const long n);
+TH_API void THVector_(log1p)(real *y, const real *x, const long n);
+TH_API void THVector_(tanh)(real *y, const real *x, const long n);
+/* y = 1/(1+exp(-x)) */
+TH_API void THVector_(sigmoid)(real *y, const real *x, const long n);
+#endif
+
+/* micro-kernel of the built-in gemm (see THBlas.c): c += alpha*a*b, where a
+   is a k x MR panel packed row by row (MR = THVector_(gemmMR)()), b a
+   k x TH_VECTOR_GEMM_NR panel packed row by row, and c a MR x TH_VECTOR_GEMM_NR
+   column-major block with leading dimension ldc */
+TH_API int THVector_(gemmMR)(void);
+TH_API void THVector_(gemmKernel)(const long k, const real alpha, const real *a, const real *b, real *c, const long ldc);
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/THVectorDispatch.c"
+#else
+
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+
+/* Each operation goes through a function pointer, set by
+   THVector_(dispatchInit)() to the version of the selected instruction set.
+   The transcendental functions keep their C library version in precise
+   mode. */
+
+static void (*THVector_(fill_DISPATCHPTR))(real *, const real, const long) = &THVector_(fill_DEFAULT);
+static void (*THVector_(add_DISPATCHPTR))(real *, const real *, const real, const long) = &THVector_(add_DEFAULT);
+static void (*THVector_(diff_DISPATCHPTR))(real *, const real *, const real *, const long) = &THVector_(diff_DEFAULT);
+static void (*THVector_(scale_DISPATCHPTR))(real *, const real, const long) = &THVector_(scale_DEFAULT);
+static void (*THVector_(mul_DISPATCHPTR))(real *, const real *, const long) = &THVector_(mul_DEFAULT);
+static void (*THVector_(cmul_DISPATCHPTR))(real *, const real *, const real *, const long) = &THVector_(cmul_DEFAULT);
+static void (*THVector_(cdiv_DISPATCHPTR))(real *, const real *, const real *, const long) = &THVector_(cdiv_DEFAULT);
+static accreal (*THVector_(dot_DISPATCHPTR))(const real *, const real *, const long) = &THVector_(dot_DEFAULT);
+static accreal (*THVector_(sum_DISPATCHPTR))(const real *, const long) = &THVector_(sum_DEFAULT);
+static real (*THVector_(max_DISPATCHPTR))(const real *, const long) = &THVector_(max_DEFAULT);
+static real (*THVector_(min_DISPATCHPTR))(const real *, const long) = &THVector_(min_DEFAULT);
+static void (*THVector_(exp_DISPATCHPTR))(real *, const real *, const long) = &THVector_(exp_DEFAULT);
+static void (*THVector_(log_DISPATCHPTR))(real *, const real *, const long) = &THVector_(log_DEFAULT);
+static void (*THVector_(log1p_DISPATCHPTR))(real *, const real *, const long) = &THVector_(log1p_DEFAULT);
+static void (*THVector_(tanh_DISPATCHPTR))(real *, const real *, const long) = &THVector_(tanh_DEFAULT);
+static void (*THVector_(sigmoid_DISPATCHPTR))(real *, const real *, const long) = &THVector_(sigmoid_DEFAULT);
+static int (*THVector_(gemmMR_DISPATCHPTR))(void) = &THVector_(gemmMR_DEFAULT);
+static void (*THVector_(gemmKernel_DISPATCHPTR))(const long, const real, const real *, const real *, real *, const long) = &THVector_(gemmKernel_DEFAULT);
+
+#define THVector_SET_DISPATCH(ISA) \
+  THVector_(fill_DISPATCHPTR) = &THVector_(fill_##ISA); \
+  THVector_(add_DISPATCHPTR) = &THVector_(add_##ISA); \
+  THVector_(diff_DISPATCHPTR) = &THVector_(diff_##ISA); \
+  THVector_(scale_DISPATCHPTR) = &THVector_(scale_##ISA); \
+  THVector_(mul_DISPATCHPTR) = &THVector_(mul_##ISA); \
+  THVector_(cmul_DISPATCHPTR) = &THVector_(cmul_##ISA); \
+  THVector_(cdiv_DISPATCHPTR) = &THVector_(cdiv_##ISA); \
+  THVector_(dot_DISPATCHPTR) = &THVector_(dot_##ISA); \
+  THVector_(sum_DISPATCHPTR) = &THVector_(sum_##ISA); \
+  THVector_(max_DISPATCHPTR) = &THVector_(max_##ISA); \
+  THVector_(min_DISPATCHPTR) = &THVector_(min_##ISA); \
+  THVector_(gemmMR_DISPATCHPTR) = &THVector_(gemmMR_##ISA); \
+  THVector_(gemmKernel_DISPATCHPTR) = &THVector_(gemmKernel_##ISA); \
+  THVector_SET_DISPATCH_MATH(ISA)
+
+#define THVector_SET_DISPATCH_MATH(ISA) \
+  THVector_(exp_DISPATCHPTR) = &THVector_(exp_##ISA); \
+  THVector_(log_DISPATCHPTR) = &THVector_(log_##ISA); \
+  THVector_(log1p_DISPATCHPTR) = &THVector_(log1p_##ISA); \
+  THVector_(tanh_DISPATCHPTR) = &THVector_(tanh_##ISA); \
+  THVector_(sigmoid_DISPATCHPTR) = &THVector_(sigmoid_##ISA);
+
+static void THVector_(dispatchInit)(int simd)
+{
+  THVector_SET_DISPATCH(DEFAULT)
+#ifdef TH_HAVE_SSE2
+  if(simd >= TH_SIMD_SSE2)
+  {
+    THVector_SET_DISPATCH(SSE2)
+  }
+#endif
+#ifdef TH_HAVE_AVX
+  if(simd >= TH_SIMD_AVX)
+  {
+    THVector_SET_DISPATCH(AVX)
+  }
+#endif
+#ifdef TH_HAVE_AVX2
+  if(simd >= TH_SIMD_AVX2)
+  {
+    THVector_SET_DISPATCH(AVX2)
+  }
+#endif
+#ifdef TH_HAVE_AVX512
+  if(simd >= TH_SIMD_AVX512)
+  {
+    THVector_SET_DISPATCH(AVX512)
+  }
+#endif
+#ifdef __NEON__
+  THVector_(dispatchInitNEON)();
+#endif
+  if(!THVector_fastMath)
+  {
+    THVector_SET_DISPATCH_MATH(DEFAULT)
+  }
+}
+
+#undef THVector_SET_DISPATCH
+#undef THVector_SET_DISPATCH_MATH
+
+#define THVector_DISPATCH(NAME) (*THVector_(NAME##_DISPATCHPTR))
+
+#else
+
+/* integer types are not dispatched */
+#define THVector_DISPATCH(NAME) THVector_(NAME##_DEFAULT)
+
+#endif
+
+void THVector_(fill)(real *x, const real c, const long n)
+{
+  THVector_DISPATCH(fill)(x, c, n);
+}
+
+void THVector_(add)(real *y, const real *x, const real c, const long n)
+{
+  THVector_DISPATCH(add)(y, x, c, n);
+}
+
+void THVector_(diff)(real *z, const real *x, const real *y, const long n)
+{
+  THVector_DISPATCH(diff)(z, x, y, n);
+}
+
+void THVector_(scale)(real *y, const real c, const long n)
+{
+  THVector_DISPATCH(scale)(y, c, n);
+}
+
+void THVector_(mul)(real *y, const real *x, const long n)
+{
+  THVector_DISPATCH(mul)(y, x, n);
+}
+
+void THVector_(cmul)(real *z, const real *x, const real *y, const long n)
+{
+  THVector_DISPATCH(cmul)(z, x, y, n);
+}
+
+void THVector_(cdiv)(real *z, const real *x, const real *y, const long n)
+{
+  THVector_DISPATCH(cdiv)(z, x, y, n);
+}
+
+accreal THVector_(dot)(const real *x, const real *y, const long n)
+{
+  return THVector_DISPATCH(dot)(x, y, n);
+}
+
+accreal THVector_(sum)(const real *x, const long n)
+{
+  return THVector_DISPATCH(sum)(x, n);
+}
+
+real THVector_(max)(const real *x, const long n)
+{
+  return THVector_DISPATCH(max)(x, n);
+}
+
+real THVector_(min)(const real *x, const long n)
+{
+  return THVector_DISPATCH(min)(x, n);
+}
+
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+
+void THVector_(exp)(real *y, const real *x, const long n)
+{
+  THVector_DISPATCH(exp)(y, x, n);
+}
+
+void THVector_(log)(real *y, const real *x, const long n)
+{
+  THVector_DISPATCH(log)(y, x, n);
+}
+
+void THVector_(log1p)(real *y, const real *x, const long n)
+{
+  THVector_DISPATCH(log1p)(y, x, n);
+}
+
+void THVector_(tanh)(real *y, const real *x, const long n)
+{
+  THVector_DISPATCH(tanh)(y, x, n);
+}
+
+void THVector_(sigmoid)(real *y, const real *x, const long n)
+{
+  THVector_DISPATCH(sigmoid)(y, x, n);
+}
+
+#endif
+
+int THVector_(gemmMR)(void)
+{
+  return THVector_DISPATCH(gemmMR)();
+}
+
+void THVector_(gemmKernel)(const long k, const real alpha, const real *a, const real *b, real *c, const long ldc)
+{
+  THVector_DISPATCH(gemmKernel)(k, alpha, a, b, c, ldc);
+}
+
+#undef THVector_DISPATCH
+
+#endif
@@ -0,0 +1,546 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/THVectorSIMD.c"
+#else
+
+/*
+   SIMD versions of the THVector operations, for the instruction set
+   TH_VECTOR_ISA. The including file must define, for each real type, the
+   vector type THRealSIMD_t holding THRealSIMD_SIZE reals, and the
+   (unaligned) load/store, set1, add, sub, mul, div, max, min and fmadd
+   primitives, as well as those used by the transcendental functions (see
+   below).
+*/
+
+#define THSIMD_(NAME) TH_CONCAT_4(TH,Real,SIMD_,NAME)
+#define THSIMD_t THSIMD_(t)
+#define THSIMD_SIZE THSIMD_(SIZE)
+
+/* reductions of reals are flushed in the accreal accumulator every
+   THSIMD_BLOCK elements */
+#define THSIMD_BLOCK 1024
+
+static inline accreal THVectorSIMD_(hsum)(THSIMD_t v)
+{
+  real buf[THSIMD_SIZE];
+  accreal sum = 0;
+  int k;
+
+  THSIMD_(store)(buf, v);
+  for(k = 0; k < THSIMD_SIZE; k++)
+    sum += buf[k];
+
+  return sum;
+}
+
+void THVectorSIMD_(fill)(real *x, const real c, const long n)
+{
+  THSIMD_t vc = THSIMD_(set1)(c);
+  long i = 0;
+
+  for(; i <= n-2*THSIMD_SIZE; i += 2*THSIMD_SIZE)
+  {
+    THSIMD_(store)(x+i, vc);
+    THSIMD_(store)(x+i+THSIMD_SIZE, vc);
+  }
+
+  for(; i < n; i++)
+    x[i] = c;
+}
+
+void THVectorSIMD_(add)(real *y, const real *x, const real c, const long n)
+{
+  THSIMD_t vc = THSIMD_(set1)(c);
+  long i = 0;
+
+  for(; i <= n-2*THSIMD_SIZE; i += 2*THSIMD_SIZE)
+  {
+    THSIMD_(store)(y+i, THSIMD_(fmadd)(vc, THSIMD_(load)(x+i), THSIMD_(load)(y+i)));
+    THSIMD_(store)(y+i+THSIMD_SIZE, THSIMD_(fmadd)(vc, THSIMD_(load)(x+i+THSIMD_SIZE), THSIMD_(load)(y+i+THSIMD_SIZE)));
+  }
+
+  for(; i < n; i++)
+    y[i] += c * x[i];
+}
+
+void THVectorSIMD_(diff)(real *z, const real *x, const real *y, const long n)
+{
+  long i = 0;
+
+  for(; i <= n-2*THSIMD_SIZE; i += 2*THSIMD_SIZE)
+  {
+    THSIMD_(store)(z+i, THSIMD_(sub)(THSIMD_(load)(x+i), THSIMD_(load)(y+i)));
+    THSIMD_(store)(z+i+THSIMD_SIZE, THSIMD_(sub)(THSIMD_(load)(x+i+THSIMD_SIZE), THSIMD_(load)(y+i+THSIMD_SIZE)));
+  }
+
+  for(; i < n; i++)
+    z[i] = x[i] - y[i];
+}
+
+void THVectorSIMD_(scale)(real *y, const real c, const long n)
+{
+  THSIMD_t vc = THSIMD_(set1)(c);
+  long i = 0;
+
+  for(; i <= n-2*THSIMD_SIZE; i += 2*THSIMD_SIZE)
+  {
+    THSIMD_(store)(y+i, THSIMD_(mul)(THSIMD_(load)(y+i), vc));
+    THSIMD_(store)(y+i+THSIMD_SIZE, THSIMD_(mul)(THSIMD_(load)(y+i+THSIMD_SIZE), vc));
+  }
+
+  for(; i < n; i++)
+    y[i] *= c;
+}
+
+void THVectorSIMD_(mul)(real *y, const real *x, const long n)
+{
+  long i = 0;
+
+  for(; i <= n-2*THSIMD_SIZE; i += 2*THSIMD_SIZE)
+  {
+    THSIMD_(store)(y+i, THSIMD_(mul)(THSIMD_(load)(y+i), THSIMD_(load)(x+i)));
+    THSIMD_(store)(y+i+THSIMD_SIZE, THSIMD_(mul)(THSIMD_(load)(y+i+THSIMD_SIZE), THSIMD_(load)(x+i+THSIMD_SIZE)));
+  }
+
+  for(; i < n; i++)
+    y[i] *= x[i];
+}
+
+void THVectorSIMD_(cmul)(real *z, const real *x, const real *y, const long n)
+{
+  long i = 0;
+
+  for(; i <= n-2*THSIMD_SIZE; i += 2*THSIMD_SIZE)
+  {
+    THSIMD_(store)(z+i, THSIMD_(mul)(THSIMD_(load)(x+i), THSIMD_(load)(y+i)));
+    THSIMD_(store)(z+i+THSIMD_SIZE, THSIMD_(mul)(THSIMD_(load)(x+i+THSIMD_SIZE), THSIMD_(load)(y+i+THSIMD_SIZE)));
+  }
+
+  for(; i < n; i++)
+    z[i] = x[i] * y[i];
+}
+
+void THVectorSIMD_(cdiv)(real *z, const real *x, const real *y, const long n)
+{
+  long i = 0;
+
+  for(; i <= n-2*THSIMD_SIZE; i += 2*THSIMD_SIZE)
+  {
+    THSIMD_(store)(z+i, THSIMD_(div)(THSIMD_(load)(x+i), THSIMD_(load)(y+i)));
+    THSIMD_(store)(z+i+THSIMD_SIZE, THSIMD_(div)(THSIMD_(load)(x+i+THSIMD_SIZE), THSIMD_(load)(y+i+THSIMD_SIZE)));
+  }
+
+  for(; i < n; i++)
+    z[i] = x[i] / y[i];
+}
+
+accreal THVectorSIMD_(dot)(const real *x, const real *y, const long n)
+{
+  accreal sum = 0;
+  long i = 0;
+
+  while(i <= n-4*THSIMD_SIZE)
+  {
+    long end = THMin(n, i+THSIMD_BLOCK);
+    THSIMD_t s0 = THSIMD_(set1)(0), s1 = THSIMD_(set1)(0);
+    THSIMD_t s2 = THSIMD_(set1)(0), s3 = THSIMD_(set1)(0);
+
+    for(; i <= end-4*THSIMD_SIZE; i += 4*THSIMD_SIZE)
+    {
+      s0 = THSIMD_(fmadd)(THSIMD_(load)(x+i), THSIMD_(load)(y+i), s0);
+      s1 = THSIMD_(fmadd)(THSIMD_(load)(x+i+THSIMD_SIZE), THSIMD_(load)(y+i+THSIMD_SIZE), s1);
+      s2 = THSIMD_(fmadd)(THSIMD_(load)(x+i+2*THSIMD_SIZE), THSIMD_(load)(y+i+2*THSIMD_SIZE), s2);
+      s3 = THSIMD_(fmadd)(THSIMD_(load)(x+i+3*THSIMD_SIZE), THSIMD_(load)(y+i+3*THSIMD_SIZE), s3);
+    }
+    sum += THVectorSIMD_(hsum)(THSIMD_(add)(THSIMD_(add)(s0, s1), THSIMD_(add)(s2, s3)));
+  }
+
+  for(; i < n; i++)
+    sum += x[i] * y[i];
+
+  return sum;
+}
+
+accreal THVectorSIMD_(sum)(const real *x, const long n)
+{
+  accreal sum = 0;
+  long i = 0;
+
+  while(i <= n-4*THSIMD_SIZE)
+  {
+    long end = THMin(n, i+THSIMD_BLOCK);
+    THSIMD_t s0 = THSIMD_(set1)(0), s1 = THSIMD_(set1)(0);
+    THSIMD_t s2 = THSIMD_(set1)(0), s3 = THSIMD_(set1)(0);
+
+    for(; i <= end-4*THSIMD_SIZE; i += 4*THSIMD_SIZE)
+    {
+      s0 = THSIMD_(add)(s0, THSIMD_(load)(x+i));
+      s1 = THSIMD_(add)(s1, THSIMD_(load)(x+i+THSIMD_SIZE));
+      s2 = THSIMD_(add)(s2, THSIMD_(load)(x+i+2*THSIMD_SIZE));
+      s3 = THSIMD_(add)(s3, THSIMD_(load)(x+i+3*THSIMD_SIZE));
+    }
+    sum += THVectorSIMD_(hsum)(THSIMD_(add)(THSIMD_(add)(s0, s1), THSIMD_(add)(s2, s3)));
+  }
+
+  for(; i < n; i++)
+    sum += x[i];
+
+  return sum;
+}
+
+/* Note: max(x, m) returns m when x is a NaN, exactly like the
+   "if(x > m) m = x" scalar loop */
+real THVectorSIMD_(max)(const real *x, const long n)
+{
+  real theMax = x[0];
+  long i = 0;
+
+  if(n >= 2*THSIMD_SIZE)
+  {
+    real buf[THSIMD_SIZE];
+    THSIMD_t m0 = THSIMD_(set1)(x[0]), m1 = m0;
+    int k;
+
+    for(; i <= n-2*THSIMD_SIZE; i += 2*THSIMD_SIZE)
+    {
+      m0 = THSIMD_(max)(THSIMD_(load)(x+i), m0);
+      m1 = THSIMD_(max)(THSIMD_(load)(x+i+THSIMD_SIZE), m1);
+    }
+    THSIMD_(store)(buf, THSIMD_(max)(m1, m0));
+    for(k = 0; k < THSIMD_SIZE; k++)
+    {
+      if(buf[k] > theMax)
+        theMax = buf[k];
+    }
+  }
+
+  for(; i < n; i++)
+  {
+    if(x[i] > theMax)
+      theMax = x[i];
+  }
+
+  return theMax;
+}
+
+real THVectorSIMD_(min)(const real *x, const long n)
+{
+  real theMin = x[0];
+  long i = 0;
+
+  if(n >= 2*THSIMD_SIZE)
+  {
+    real buf[THSIMD_SIZE];
+    THSIMD_t m0 = THSIMD_(set1)(x[0]), m1 = m0;
+    int k;
+
+    for(; i <= n-2*THSIMD_SIZE; i += 2*THSIMD_SIZE)
+    {
+      m0 = THSIMD_(min)(THSIMD_(load)(x+i), m0);
+      m1 = THSIMD_(min)(THSIMD_(load)(x+i+THSIMD_SIZE), m1);
+    }
+    THSIMD_(store)(buf, THSIMD_(min)(m1, m0));
+    for(k = 0; k < THSIMD_SIZE; k++)
+    {
+      if(buf[k] < theMin)
+        theMin = buf[k];
+    }
+  }
+
+  for(; i < n; i++)
+  {
+    if(x[i] < theMin)
+      theMin = x[i];
+  }
+
+  return theMin;
+}
+
+/*
+   Transcendental functions, after the Cephes library. The argument is reduced
+   to a small interval, where the function is approximated by a polynomial
+   (float) or a rational function (double). This needs a few more primitives:
+   round (to the nearest integer), ldexp(x, n) = x*2^n (n integer), getexp and
+   getmant (exponent and mantissa in [1, 2) of a positive normal number), and
+   selectlt(a, b, x, y) = (a < b ? x : y).
+
+   Special values (NaN, infinities, zeros, underflows and overflows) follow
+   the C library. Denormal results of exp are computed exactly, and denormal
+   arguments of log are handled.
+*/
+
+#if defined(TH_REAL_IS_FLOAT)
+#define THSIMD_EXP_LO -104.0f                 /* exp(x) rounds to 0 below */
+#define THSIMD_EXP_HI 89.0f                   /* exp(x) overflows above */
+#define THSIMD_LN2_HI 0.693359375f            /* ln(2) = LN2_HI + LN2_LO */
+#define THSIMD_LN2_LO -2.12194440e-4f
+#define THSIMD_LOG_LN2_HI 0.693359375f        /* split used by log */
+#define THSIMD_LOG_LN2_LO -2.12194440e-4f
+#define THSIMD_MIN_NORMAL 1.17549435e-38f     /* FLT_MIN */
+#define THSIMD_DENORMAL_SCALE 33554432.0f     /* 2^25 */
+#define THSIMD_DENORMAL_EXP 25.0f
+#else
+#define THSIMD_EXP_LO -746.0
+#define THSIMD_EXP_HI 710.0
+#define THSIMD_LN2_HI 6.93145751953125e-1
+#define THSIMD_LN2_LO 1.42860682030941723212e-6
+#define THSIMD_LOG_LN2_HI 0.693359375
+#define THSIMD_LOG_LN2_LO -2.121944400546905827679e-4
+#define THSIMD_MIN_NORMAL 2.2250738585072014e-308  /* DBL_MIN */
+#define THSIMD_DENORMAL_SCALE 18014398509481984.0  /* 2^54 */
+#define THSIMD_DENORMAL_EXP 54.0
+#endif
+
+#define THSIMD_POLY2(X, C0, C1) THSIMD_(fmadd)(THSIMD_(set1)(C0), X, THSIMD_(set1)(C1))
+#define THSIMD_HORNER(P, X, C) THSIMD_(fmadd)(P, X, THSIMD_(set1)(C))
+
+static inline THSIMD_t THVectorSIMD_(expv)(THSIMD_t x)
+{
+  THSIMD_t n, r, p;
+#if defined(TH_REAL_IS_DOUBLE)
+  THSIMD_t rr, q;
+#endif
+
+  /* max and min return their second argument when one of them is a NaN, so
+     NaNs go through */
+  x = THSIMD_(min)(THSIMD_(set1)(THSIMD_EXP_HI), THSIMD_(max)(THSIMD_(set1)(THSIMD_EXP_LO), x));
+
+  /* x = n*ln(2) + r, with |r| <= ln(2)/2 */
+  n = THSIMD_(round)(THSIMD_(mul)(x, THSIMD_(set1)(1.44269504088896341)));
+  r = THSIMD_(fmadd)(n, THSIMD_(set1)(-THSIMD_LN2_HI), x);
+  r = THSIMD_(fmadd)(n, THSIMD_(set1)(-THSIMD_LN2_LO), r);
+
+#if defined(TH_REAL_IS_FLOAT)
+  p = THSIMD_POLY2(r, 1.9875691500e-4f, 1.3981999507e-3f);
+  p = THSIMD_HORNER(p, r, 8.3334519073e-3f);
+  p = THSIMD_HORNER(p, r, 4.1665795894e-2f);
+  p = THSIMD_HORNER(p, r, 1.6666665459e-1f);
+  p = THSIMD_HORNER(p, r, 5.0000001201e-1f);
+  p = THSIMD_(fmadd)(p, THSIMD_(mul)(r, r), THSIMD_(add)(r, THSIMD_(set1)(1)));
+#else
+  /* exp(r) = 1 + 2*r*P(r^2)/(Q(r^2) - r*P(r^2)) */
+  rr = THSIMD_(mul)(r, r);
+  p = THSIMD_POLY2(rr, 1.26177193074810590878e-4, 3.02994407707441961300e-2);
+  p = THSIMD_HORNER(p, rr, 9.99999999999999999910e-1);
+  p = THSIMD_(mul)(p, r);
+  q = THSIMD_POLY2(rr, 3.00198505138664455042e-6, 2.52448340349684104192e-3);
+  q = THSIMD_HORNER(q, rr, 2.27265548208155028766e-1);
+  q = THSIMD_HORNER(q, rr, 2.00000000000000000009e0);
+  p = THSIMD_(div)(p, THSIMD_(sub)(q, p));
+  p = THSIMD_(fmadd)(p, THSIMD_(set1)(2), THSIMD_(set1)(1));
+#endif
+
+  return THSIMD_(ldexp)(p, n);
+}
+
+static inline THSIMD_t THVectorSIMD_(logv)(THSIMD_t x)
+{
+  THSIMD_t zero = THSIMD_(set1)(0), one = THSIMD_(set1)(1);
+  THSIMD_t minNormal = THSIMD_(set1)(THSIMD_MIN_NORMAL), sqrt2 = THSIMD_(set1)(1.41421356237309504880);
+  THSIMD_t xs, e, m, f, z, y;
+#if defined(TH_REAL_IS_DOUBLE)
+  THSIMD_t q;
+#endif
+
+  /* x = 2^e*m, with sqrt(1/2) < m <= sqrt(2); denormals are scaled first */
+  xs = THSIMD_(selectlt)(x, minNormal, THSIMD_(mul)(x, THSIMD_(set1)(THSIMD_DENORMAL_SCALE)), x);
+  e = THSIMD_(getexp)(xs);
+  e = THSIMD_(selectlt)(x, minNormal, THSIMD_(sub)(e, THSIMD_(set1)(THSIMD_DENORMAL_EXP)), e);
+  m = THSIMD_(getmant)(xs);
+  e = THSIMD_(selectlt)(sqrt2, m, THSIMD_(add)(e, one), e);
+  m = THSIMD_(selectlt)(sqrt2, m, THSIMD_(mul)(m, THSIMD_(set1)(0.5)), m);
+
+  /* log(m) = f - f^2/2 + f^3*P(f) (float) or f^3*P(f)/Q(f) (double) */
+  f = THSIMD_(sub)(m, one);
+  z = THSIMD_(mul)(f, f);
+#if defined(TH_REAL_IS_FLOAT)
+  y = THSIMD_POLY2(f, 7.0376836292e-2f, -1.1514610310e-1f);
+  y = THSIMD_HORNER(y, f, 1.1676998740e-1f);
+  y = THSIMD_HORNER(y, f, -1.2420140846e-1f);
+  y = THSIMD_HORNER(y, f, 1.4249322787e-1f);
+  y = THSIMD_HORNER(y, f, -1.6668057665e-1f);
+  y = THSIMD_HORNER(y, f, 2.0000714765e-1f);
+  y = THSIMD_HORNER(y, f, -2.4999993993e-1f);
+  y = THSIMD_HORNER(y, f, 3.3333331174e-1f);
+#else
+  y = THSIMD_POLY2(f, 1.01875663804580931796e-4, 4.97494994976747001425e-1);
+  y = THSIMD_HORNER(y, f, 4.70579119878881725854e0);
+  y = THSIMD_HORNER(y, f, 1.44989225341610930846e1);
+  y = THSIMD_HORNER(y, f, 1.79368678507819816313e1);
+  y = THSIMD_HORNER(y, f, 7.70838733755885391666e0);
+  q = THSIMD_(add)(f, THSIMD_(set1)(1.12873587189167450590e1));
+  q = THSIMD_HORNER(q, f, 4.52279145837532221105e1);
+  q = THSIMD_HORNER(q, f, 8.29875266912776603211e1);
+  q = THSIMD_HORNER(q, f, 7.11544750618563894466e1);
+  q = THSIMD_HORNER(q, f, 2.31251620126765340583e1);
+  y = THSIMD_(div)(y, q);
+#endif
+  y = THSIMD_(mul)(THSIMD_(mul)(y, f), z);
+  y = THSIMD_(fmadd)(e, THSIMD_(set1)(THSIMD_LOG_LN2_LO), y);
+  y = THSIMD_(fmadd)(z, THSIMD_(set1)(-0.5), y);
+  y = THSIMD_(add)(f, y);
+  y = THSIMD_(fmadd)(e, THSIMD_(set1)(THSIMD_LOG_LN2_HI), y);
+
+  /* log(0) = -inf, log(x < 0) = NaN, log(inf) = inf, log(NaN) = NaN */
+  y = THSIMD_(selectlt)(zero, x, y, THSIMD_(set1)(-HUGE_VAL));
+  y = THSIMD_(selectlt)(x, zero, THSIMD_(set1)(NAN), y);
+  y = THSIMD_(selectlt)(x, THSIMD_(set1)(HUGE_VAL), y, x);
+
+  return y;
+}
+
+/* log1p(x) = log(u)*x/(u-1), with u = 1+x, corrects the rounding of u */
+static inline THSIMD_t THVectorSIMD_(log1pv)(THSIMD_t x)
+{
+  THSIMD_t zero = THSIMD_(set1)(0);
+  THSIMD_t u = THSIMD_(add)(x, THSIMD_(set1)(1));
+  THSIMD_t d = THSIMD_(sub)(u, THSIMD_(set1)(1));
+  THSIMD_t y = THSIMD_(mul)(THVectorSIMD_(logv)(u), THSIMD_(div)(x, d));
+
+  /* log1p(x) = x when u = 1, log1p(inf) = inf */
+  y = THSIMD_(selectlt)(zero, THSIMD_(max)(d, THSIMD_(sub)(zero, d)), y, x);
+  y = THSIMD_(selectlt)(x, THSIMD_(set1)(HUGE_VAL), y, x);
+
+  return y;
+}
+
+static inline THSIMD_t THVectorSIMD_(tanhv)(THSIMD_t x)
+{
+  THSIMD_t zero = THSIMD_(set1)(0), one = THSIMD_(set1)(1);
+  THSIMD_t ax = THSIMD_(max)(x, THSIMD_(sub)(zero, x));
+  THSIMD_t z = THSIMD_(mul)(x, x);
+  THSIMD_t ys, yl;
+#if defined(TH_REAL_IS_DOUBLE)
+  THSIMD_t q;
+#endif
+
+  /* |x| < 0.625: tanh(x) = x + x^3*P(x^2) (float) or x^3*P(x^2)/Q(x^2) (double) */
+#if defined(TH_REAL_IS_FLOAT)
+  ys = THSIMD_POLY2(z, -5.70498872745e-3f, 2.06390887954e-2f);
+  ys = THSIMD_HORNER(ys, z, -5.37397155531e-2f);
+  ys = THSIMD_HORNER(ys, z, 1.33314422036e-1f);
+  ys = THSIMD_HORNER(ys, z, -3.33332819422e-1f);
+#else
+  ys = THSIMD_POLY2(z, -9.64399179425052238628e-1, -9.92877231001918586564e1);
+  ys = THSIMD_HORNER(ys, z, -1.61468768441708447952e3);
+  q = THSIMD_(add)(z, THSIMD_(set1)(1.12811678491632931402e2));
+  q = THSIMD_HORNER(q, z, 2.23548839060100448583e3);
+  q = THSIMD_HORNER(q, z, 4.84406305325125486048e3);
+  ys = THSIMD_(div)(ys, q);
+#endif
+  ys = THSIMD_(fmadd)(THSIMD_(mul)(ys, z), x, x);
+
+  /* otherwise tanh(|x|) = 1 - 2/(exp(2|x|)+1) */
+  yl = THVectorSIMD_(expv)(THSIMD_(add)(ax, ax));
+  yl = THSIMD_(sub)(one, THSIMD_(div)(THSIMD_(set1)(2), THSIMD_(add)(yl, one)));
+  yl = THSIMD_(selectlt)(x, zero, THSIMD_(sub)(zero, yl), yl);
+
+  return THSIMD_(selectlt)(ax, THSIMD_(set1)(0.625), ys, yl);
+}
+
+/* with e = exp(-|x|): sigmoid(x) = 1/(1+e) for x >= 0, and e/(1+e) for
+   x < 0, so that exp never overflows and denormal results are kept */
+static inline THSIMD_t THVectorSIMD_(sigmoidv)(THSIMD_t x)
+{
+  THSIMD_t zero = THSIMD_(set1)(0), one = THSIMD_(set1)(1);
+  THSIMD_t ax = THSIMD_(max)(x, THSIMD_(sub)(zero, x));
+  THSIMD_t e = THVectorSIMD_(expv)(THSIMD_(sub)(zero, ax));
+  THSIMD_t r = THSIMD_(div)(one, THSIMD_(add)(one, e));
+  return THSIMD_(selectlt)(x, zero, THSIMD_(mul)(e, r), r);
+}
+
+/* the last elements go through a zero-padded buffer, so that they get the
+   same approximation as the others */
+#define THSIMD_IMPLEMENT_MAP(NAME) \
+  void THVectorSIMD_(NAME)(real *y, const real *x, const long n) \
+  { \
+    long i = 0; \
+    \
+    for(; i <= n-THSIMD_SIZE; i += THSIMD_SIZE) \
+      THSIMD_(store)(y+i, THVectorSIMD_(NAME##v)(THSIMD_(load)(x+i))); \
+    \
+    if(i < n) \
+    { \
+      real buf[THSIMD_SIZE]; \
+      long k; \
+      for(k = 0; k < THSIMD_SIZE; k++) \
+        buf[k] = (i+k < n ? x[i+k] : 0); \
+      THSIMD_(store)(buf, THVectorSIMD_(NAME##v)(THSIMD_(load)(buf))); \
+      for(k = 0; i+k < n; k++) \
+        y[i+k] = buf[k]; \
+    } \
+  }
+
+THSIMD_IMPLEMENT_MAP(exp)
+THSIMD_IMPLEMENT_MAP(log)
+THSIMD_IMPLEMENT_MAP(log1p)
+THSIMD_IMPLEMENT_MAP(tanh)
+THSIMD_IMPLEMENT_MAP(sigmoid)
+
+#undef THSIMD_IMPLEMENT_MAP
+#undef THSIMD_POLY2
+#undef THSIMD_HORNER
+#undef THSIMD_EXP_LO
+#undef THSIMD_EXP_HI
+#undef THSIMD_LN2_HI
+#undef THSIMD_LN2_LO
+#undef THSIMD_LOG_LN2_HI
+#undef THSIMD_LOG_LN2_LO
+#undef THSIMD_MIN_NORMAL
+#undef THSIMD_DENORMAL_SCALE
+#undef THSIMD_DENORMAL_EXP
+
+/* The gemm micro-kernel computes a block of 2*THSIMD_SIZE x 6, kept in 12
+   vector registers. */
+int THVectorSIMD_(gemmMR)(void)
+{
+  return 2*THSIMD_SIZE;
+}
+
+#define THSIMD_GEMM_COLUMN_FMADD(J) \
+  bj = THSIMD_(set1)(b[J]); \
+  c##J##0 = THSIMD_(fmadd)(a0, bj, c##J##0); \
+  c##J##1 = THSIMD_(fmadd)(a1, bj, c##J##1);
+
+#define THSIMD_GEMM_COLUMN_STORE(J) \
+  THSIMD_(store)(c+J*ldc, THSIMD_(fmadd)(valpha, c##J##0, THSIMD_(load)(c+J*ldc))); \
+  THSIMD_(store)(c+J*ldc+THSIMD_SIZE, THSIMD_(fmadd)(valpha, c##J##1, THSIMD_(load)(c+J*ldc+THSIMD_SIZE)));
+
+void THVectorSIMD_(gemmKernel)(const long k, const real alpha, const real *a, const real *b, real *c, const long ldc)
+{
+  THSIMD_t c00 = THSIMD_(set1)(0), c01 = c00, c10 = c00, c11 = c00;
+  THSIMD_t c20 = c00, c21 = c00, c30 = c00, c31 = c00;
+  THSIMD_t c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+  THSIMD_t valpha = THSIMD_(set1)(alpha);
+  long p;
+
+  for(p = 0; p < k; p++, a += 2*THSIMD_SIZE, b += TH_VECTOR_GEMM_NR)
+  {
+    THSIMD_t a0 = THSIMD_(load)(a);
+    THSIMD_t a1 = THSIMD_(load)(a+THSIMD_SIZE);
+    THSIMD_t bj;
+
+    THSIMD_GEMM_COLUMN_FMADD(0)
+    THSIMD_GEMM_COLUMN_FMADD(1)
+    THSIMD_GEMM_COLUMN_FMADD(2)
+    THSIMD_GEMM_COLUMN_FMADD(3)
+    THSIMD_GEMM_COLUMN_FMADD(4)
+    THSIMD_GEMM_COLUMN_FMADD(5)
+  }
+
+  THSIMD_GEMM_COLUMN_STORE(0)
+  THSIMD_GEMM_COLUMN_STORE(1)
+  THSIMD_GEMM_COLUMN_STORE(2)
+  THSIMD_GEMM_COLUMN_STORE(3)
+  THSIMD_GEMM_COLUMN_STORE(4)
+  THSIMD_GEMM_COLUMN_STORE(5)
+}
+
+#undef THSIMD_GEMM_COLUMN_FMADD
+#undef THSIMD_GEMM_COLUMN_STORE
+
+#undef THSIMD_
+#undef THSIMD_t
+#undef THSIMD_SIZE
+#undef THSIMD_BLOCK
+
+#endif
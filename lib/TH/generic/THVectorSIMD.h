@@ -0,0 +1,27 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/THVectorSIMD.h"
+#else
+
+/* SIMD versions of the THVector operations, for the instruction set
+   TH_VECTOR_ISA (see THVector.c) */
+
+void THVectorSIMD_(fill)(real *x, const real c, const long n);
+void THVectorSIMD_(add)(real *y, const real *x, const real c, const long n);
+void THVectorSIMD_(diff)(real *z, const real *x, const real *y, const long n);
+void THVectorSIMD_(scale)(real *y, const real c, const long n);
+void THVectorSIMD_(mul)(real *y, const real *x, const long n);
+void THVectorSIMD_(cmul)(real *z, const real *x, const real *y, const long n);
+void THVectorSIMD_(cdiv)(real *z, const real *x, const real *y, const long n);
+accreal THVectorSIMD_(dot)(const real *x, const real *y, const long n);
+accreal THVectorSIMD_(sum)(const real *x, const long n);
+real THVectorSIMD_(max)(const real *x, const long n);
+real THVectorSIMD_(min)(const real *x, const long n);
+void THVectorSIMD_(exp)(real *y, const real *x, const long n);
+void THVectorSIMD_(log)(real *y, const real *x, const long n);
+void THVectorSIMD_(log1p)(real *y, const real *x, const long n);
+void THVectorSIMD_(tanh)(real *y, const real *x, const long n);
+void THVectorSIMD_(sigmoid)(real *y, const real *x, const long n);
+int THVectorSIMD_(gemmMR)(void);
+void THVectorSIMD_(gemmKernel)(const long k, const real alpha, const real *a, const real *b, real *c, const long ldc);
+
+#endif
@@ -116,6 +116,49 @@ static int luaT_mt__call(lua_State *L);
 static int luaT_cmt__call(lua_State *L);
 static int luaT_cmt__newindex(lua_State *L);
 
+/* Metatables of the classes checked by luaT_toudata, by address of the
+   class name: the bindings pass the same string literal on every call, so
+   the check of an instance of tname is one pointer comparison. Entries are
+   also tagged with the registry of their lua_State, and with a generation
+   bumped by each new class, so that they never outlive the metatable they
+   point to. Instances of a subclass are checked by name (luaT_isclassof). */
+#ifndef _WIN32
+#define LUAT_CLASS_CACHE_SIZE 64
+
+typedef struct luaT_ClassCacheEntry
+{
+  const char *tname;
+  const void *registry;
+  const void *metatable;
+  unsigned long generation;
+} luaT_ClassCacheEntry;
+
+static __thread luaT_ClassCacheEntry luaT_classCache[LUAT_CLASS_CACHE_SIZE];
+static volatile unsigned long luaT_classGeneration = 1;
+
+#define luaT_classCacheEntry(tname) (&luaT_classCache[((size_t)(tname) >> 3) % LUAT_CLASS_CACHE_SIZE])
+
+/* caches the metatable on top of the stack as the class tname */
+static void luaT_classCacheSet(lua_State *L, const char *tname)
+{
+  luaT_ClassCacheEntry *entry = luaT_classCacheEntry(tname);
+  entry->tname = tname;
+  entry->registry = lua_topointer(L, LUA_REGISTRYINDEX);
+  entry->metatable = lua_topointer(L, -1);
+  entry->generation = luaT_classGeneration;
+}
+
+/* is the metatable on top of the stack the (cached) class tname? */
+static int luaT_classCacheHit(lua_State *L, const char *tname)
+{
+  luaT_ClassCacheEntry *entry = luaT_classCacheEntry(tname);
+  return entry->tname == tname
+    && entry->metatable == lua_topointer(L, -1)
+    && entry->generation == luaT_classGeneration
+    && entry->registry == lua_topointer(L, LUA_REGISTRYINDEX);
+}
+#endif
+
 const char* luaT_newmetatable(lua_State *L, const char *tname, const char *parenttname,
                               lua_CFunction constructor, lua_CFunction destructor, lua_CFunction factory)
 {
@@ -126,6 +169,9 @@ const char* luaT_newmetatable(lua_State *L, const char *tname, const char *paren
   (destructor ? lua_pushcfunction(L, destructor) : lua_pushnil(L));
   (factory ? lua_pushcfunction(L, factory) : lua_pushnil(L));
   lua_call(L, 5, 1);
+#ifndef _WIN32
+  luaT_classCacheSet(L, tname);
+#endif
   return luaT_typenameid(L, tname);
 }
 
@@ -182,27 +228,62 @@ void luaT_pushudata(lua_State *L, void *udata, const char *tname)
     lua_pushnil(L);
 }
 
+/* the name of a class is stored in the registry, with its metatable as key
+   (see luaT_lua_newmetatable): it identifies the class, and is found from
+   the metatable of an object without hashing any string, and compared to
+   tname for each class of the chain. Returns 1 if the object is an instance
+   of tname, 2 or more if it is an instance of a subclass, 0 otherwise. The
+   metatable of tname itself is only needed in the latter case. */
+static int luaT_isclassof(lua_State *L, const char *tname)
+{
+  int depth = 1;
+
+  /* the metatable of the object, or a parent class, is on top of the stack */
+  for(;;)
+  {
+    const char *mtname;
+    lua_pushvalue(L, -1);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    mtname = lua_tostring(L, -1);
+    lua_pop(L, 1); /* the string/nil */
+    if(mtname && !strcmp(mtname, tname))
+      return depth;
+    if(!lua_getmetatable(L, -1)) /* the parent class */
+      break;
+    lua_remove(L, -2);
+    depth++;
+  }
+  return 0;
+}
+
 void *luaT_toudata(lua_State *L, int ud, const char *tname)
 {
   void **p = lua_touserdata(L, ud);
   if(p != NULL) /* value is a userdata? */
   {
-    if(!luaT_pushmetatable(L, tname))
-      luaL_error(L, "Torch internal problem: cannot find metatable for type <%s>", tname);
-
-    /* initialize the table we want to get the metatable on */
-    /* note that we have to be careful with indices, as we just inserted stuff */
-    lua_pushvalue(L, (ud < 0 ? ud - 1 : ud));
-    while(lua_getmetatable(L, -1)) /* get the next metatable */
+    if(lua_getmetatable(L, ud))
     {
-      lua_remove(L, -2); /* remove the previous metatable [or object, if first time] */
-      if(lua_rawequal(L, -1, -2))
+      int depth;
+#ifndef _WIN32
+      if(luaT_classCacheHit(L, tname))
       {
-        lua_pop(L, 2);  /* remove the two metatables */
+        lua_pop(L, 1); /* the metatable */
         return *p;
       }
+#endif
+      depth = luaT_isclassof(L, tname);
+#ifndef _WIN32
+      if(depth == 1)
+        luaT_classCacheSet(L, tname);
+#endif
+      lua_pop(L, 1); /* the metatable */
+      if(depth)
+        return *p;
     }
-    lua_pop(L, 2); /* remove the two metatables */
+
+    if(!luaT_pushmetatable(L, tname))
+      luaL_error(L, "Torch internal problem: cannot find metatable for type <%s>", tname);
+    lua_pop(L, 1);
   }
   return NULL;
 }
@@ -410,6 +491,9 @@ int luaT_lua_newmetatable(lua_State *L)
   {
     /* create the metatable */
     lua_newtable(L);
+#ifndef _WIN32
+    luaT_classGeneration++;
+#endif
 
     /* registry[name] = metatable */
     lua_pushvalue(L, -1);
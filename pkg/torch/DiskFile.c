@@ -54,6 +54,29 @@ static int torch_DiskFile_bigEndianEncoding(lua_State *L)
   return 1;
 }
 
+static int torch_DiskFile_mmap(lua_State *L)
+{
+  THFile *self = luaT_checkudata(L, 1, "torch.DiskFile");
+  THDiskFile_mmap(self);
+  lua_settop(L, 1);
+  return 1;
+}
+
+static int torch_DiskFile_noMmap(lua_State *L)
+{
+  THFile *self = luaT_checkudata(L, 1, "torch.DiskFile");
+  THDiskFile_noMmap(self);
+  lua_settop(L, 1);
+  return 1;
+}
+
+static int torch_DiskFile_isMmap(lua_State *L)
+{
+  THFile *self = luaT_checkudata(L, 1, "torch.DiskFile");
+  lua_pushboolean(L, THDiskFile_isMmap(self));
+  return 1;
+}
+
 static int torch_DiskFile___tostring__(lua_State *L)
 {
   THFile *self = luaT_checkudata(L, 1, "torch.DiskFile");
@@ -71,6 +94,9 @@ static const struct luaL_Reg torch_DiskFile__ [] = {
   {"nativeEndianEncoding", torch_DiskFile_nativeEndianEncoding},
   {"littleEndianEncoding", torch_DiskFile_littleEndianEncoding},
   {"bigEndianEncoding", torch_DiskFile_bigEndianEncoding},
+  {"mmap", torch_DiskFile_mmap},
+  {"noMmap", torch_DiskFile_noMmap},
+  {"isMmap", torch_DiskFile_isMmap},
   {"__tostring__", torch_DiskFile___tostring__},
   {NULL, NULL}
 };
@@ -0,0 +1,207 @@
+-- Lazy elementwise expressions.
+--
+-- torch.lazy(x) (or x:lazy()) starts an expression, which is extended with
+-- the usual pointwise operations without computing anything, and evaluated
+-- in a single fused pass over its operands by eval(). Expressions are
+-- immutable: each operation returns a new one.
+
+local Expression = torch.class('torch.Expression')
+
+function Expression:__init(tensor)
+   assert(torch.typename(tensor) and torch.typename(tensor):match('^torch%..*Tensor$'), 'tensor expected')
+   self.type = torch.typename(tensor)
+   self.code = {'tensor', 1}
+   self.operands = {tensor}
+end
+
+local function copy(self)
+   local e = torch.Expression(self.operands[1])
+   e.code = {unpack(self.code)}
+   e.operands = {unpack(self.operands)}
+   return e
+end
+
+-- appends the code of x (a tensor or an expression) to the expression e
+local function push(e, x)
+   local xe = x
+   if torch.typename(x) ~= 'torch.Expression' then
+      xe = torch.Expression(x)
+   end
+   if xe.type ~= e.type then
+      error(string.format('%s expected, got %s', e.type, xe.type), 3)
+   end
+   for i=1,#xe.code,2 do
+      local op, arg = xe.code[i], xe.code[i+1]
+      if op == 'tensor' then
+         local operand = xe.operands[arg]
+         arg = nil
+         for k,t in ipairs(e.operands) do
+            if t == operand then
+               arg = k
+               break
+            end
+         end
+         if not arg then
+            table.insert(e.operands, operand)
+            arg = #e.operands
+         end
+      end
+      table.insert(e.code, op)
+      table.insert(e.code, arg)
+   end
+end
+
+local function instr(e, op, arg)
+   table.insert(e.code, op)
+   table.insert(e.code, arg or 0)
+end
+
+-- e:add(value), e:add(x) or e:add(value, x)
+function Expression:add(a, b)
+   local e = copy(self)
+   if type(a) == 'number' and b == nil then
+      instr(e, 'addvalue', a)
+   elseif type(a) == 'number' then
+      push(e, b)
+      instr(e, 'mulvalue', a)
+      instr(e, 'add')
+   else
+      push(e, a)
+      instr(e, 'add')
+   end
+   return e
+end
+
+function Expression:csub(x)
+   local e = copy(self)
+   push(e, x)
+   instr(e, 'sub')
+   return e
+end
+
+function Expression:mul(value)
+   local e = copy(self)
+   instr(e, 'mulvalue', value)
+   return e
+end
+
+function Expression:div(value)
+   local e = copy(self)
+   instr(e, 'divvalue', value)
+   return e
+end
+
+function Expression:pow(value)
+   local e = copy(self)
+   instr(e, 'powvalue', value)
+   return e
+end
+
+function Expression:cmul(x)
+   local e = copy(self)
+   push(e, x)
+   instr(e, 'mul')
+   return e
+end
+
+function Expression:cdiv(x)
+   local e = copy(self)
+   push(e, x)
+   instr(e, 'div')
+   return e
+end
+
+function Expression:atan2(x)
+   local e = copy(self)
+   push(e, x)
+   instr(e, 'atan2')
+   return e
+end
+
+-- e + value*x1*x2 and e + value*x1/x2, as addcmul and addcdiv
+local function addc(self, op, value, x1, x2)
+   if type(value) ~= 'number' then
+      value, x1, x2 = 1, value, x1
+   end
+   local e = copy(self)
+   push(e, x1)
+   instr(e, 'mulvalue', value)
+   push(e, x2)
+   instr(e, op)
+   instr(e, 'add')
+   return e
+end
+
+function Expression:addcmul(value, x1, x2)
+   return addc(self, 'mul', value, x1, x2)
+end
+
+function Expression:addcdiv(value, x1, x2)
+   return addc(self, 'div', value, x1, x2)
+end
+
+for _,name in ipairs{'neg', 'sign', 'abs', 'exp', 'log', 'log1p', 'sqrt', 'tanh', 'sigmoid',
+                     'cos', 'acos', 'cosh', 'sin', 'asin', 'sinh', 'tan', 'atan', 'ceil', 'floor'} do
+   Expression[name] = function(self)
+                         local e = copy(self)
+                         instr(e, name)
+                         return e
+                      end
+end
+
+-- operators: the expression must be the first operand; * and / only take
+-- numbers, as for tensors
+function Expression.__add__(e, x)
+   return e:add(x)
+end
+
+function Expression.__sub__(e, x)
+   if type(x) == 'number' then
+      return e:add(-x)
+   end
+   return e:csub(x)
+end
+
+function Expression.__mul__(e, value)
+   assert(type(value) == 'number', 'expression * number expected (see cmul)')
+   return e:mul(value)
+end
+
+function Expression.__div__(e, value)
+   assert(type(value) == 'number', 'expression / number expected (see cdiv)')
+   return e:div(value)
+end
+
+function Expression.__unm__(e)
+   return e:neg()
+end
+
+-- evaluates the expression into res (a new tensor by default), which gets
+-- the size of the first operand; res may be one of the operands
+function Expression:eval(res)
+   res = res or torch.getmetatable(self.type).new()
+   return res:evaluate(self.code, self.operands)
+end
+
+function Expression:__tostring__()
+   local txt = {}
+   for i=1,#self.code,2 do
+      local op, arg = self.code[i], self.code[i+1]
+      if op == 'tensor' then
+         table.insert(txt, '$' .. arg)
+      elseif op:match('value$') then
+         table.insert(txt, op .. ' ' .. arg)
+      else
+         table.insert(txt, op)
+      end
+   end
+   return string.format('torch.Expression [%s] (%d operands)', table.concat(txt, ' '), #self.operands)
+end
+
+function torch.lazy(tensor)
+   return torch.Expression(tensor)
+end
+
+for _,Real in ipairs{'Byte', 'Char', 'Short', 'Int', 'Long', 'Float', 'Double'} do
+   rawset(torch.getmetatable('torch.' .. Real .. 'Tensor'), 'lazy', torch.lazy)
+end
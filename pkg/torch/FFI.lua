@@ -0,0 +1,237 @@
+-- LuaJIT FFI access to tensors and storages.
+--
+-- With LuaJIT, Storage:data() and Tensor:data() return a pointer to the raw
+-- data, which is indexed from 0 and can be read and written in compiled
+-- loops, and apply(), map() and map2() are implemented in Lua over these
+-- pointers, so that the JIT compiles the whole loop with the given function.
+-- With plain Lua, nothing is changed.
+
+local ok, ffi = pcall(require, 'ffi')
+if not ok then
+   return
+end
+
+-- must match the structures in TH/generic/THStorage.h and TH/generic/THTensor.h
+local cdefs = [[
+typedef struct THRealStorage
+{
+    real *data;
+    long size;
+    int refcount;
+    char flag;
+} THRealStorage;
+
+typedef struct THRealTensor
+{
+    long *size;
+    long *stride;
+    int nDimension;
+    THRealStorage *storage;
+    long storageOffset;
+    int refcount;
+    char flag;
+    long inlineSize[4];   /* TH_TENSOR_INLINE_DIMS */
+    long inlineStride[4];
+} THRealTensor;
+]]
+
+local reals = {Byte='unsigned char', Char='char', Short='short', Int='int',
+               Long='long', Float='float', Double='double'}
+
+-- checks the value returned by the function given to apply(), map() or map2()
+local function checkvalue(v)
+   if type(v) ~= 'number' then
+      error('given function should return a number or nil', 3)
+   end
+   return v
+end
+
+-- sizes and strides as tables of numbers, and number of elements
+local function geometry(t)
+   local size, stride = {}, {}
+   local n = (t.nDimension > 0) and 1 or 0
+   for d=1,t.nDimension do
+      size[d] = tonumber(t.size[d-1])
+      stride[d] = tonumber(t.stride[d-1])
+      n = n*size[d]
+   end
+   return size, stride, n
+end
+
+local function iscontiguous(size, stride)
+   local z = 1
+   for d=#size,1,-1 do
+      if size[d] ~= 1 then
+         if stride[d] ~= z then
+            return false
+         end
+         z = z*size[d]
+      end
+   end
+   return true
+end
+
+local function issamesize(size1, size2)
+   if #size1 ~= #size2 then
+      return false
+   end
+   for d=1,#size1 do
+      if size1[d] ~= size2[d] then
+         return false
+      end
+   end
+   return true
+end
+
+-- offset of the first element of a row (from 0), rows being the slices
+-- along the last dimension
+local function rowoffset(row, size, stride)
+   local offset = 0
+   for d=#size-1,1,-1 do
+      offset = offset + (row % size[d])*stride[d]
+      row = math.floor(row / size[d])
+   end
+   return offset
+end
+
+for Real, real in pairs(reals) do
+   local Storage = torch.getmetatable('torch.' .. Real .. 'Storage')
+   local Tensor = torch.getmetatable('torch.' .. Real .. 'Tensor')
+
+   if not pcall(ffi.typeof, 'TH' .. Real .. 'Tensor') then
+      ffi.cdef((string.gsub(string.gsub(cdefs, 'THReal', 'TH' .. Real), 'real', real)))
+   end
+   local Storage_ct = ffi.typeof('TH' .. Real .. 'Storage*')
+   local Tensor_ct = ffi.typeof('TH' .. Real .. 'Tensor*')
+
+   -- the C implementations, used when the tensors have different sizes and
+   -- are not all contiguous
+   local cmap, cmap2 = Tensor.map, Tensor.map2
+
+   local tname = 'torch.' .. Real .. 'Tensor'
+   local function checktensor(t, narg)
+      if torch.typename(t) ~= tname then
+         error(string.format('bad argument #%d (%s expected)', narg, tname), 3)
+      end
+      return Tensor.cdata(t)
+   end
+
+   function Storage:cdata()
+      return ffi.cast(Storage_ct, torch.pointer(self))
+   end
+
+   function Storage:data()
+      return Storage.cdata(self).data
+   end
+
+   function Tensor:cdata()
+      return ffi.cast(Tensor_ct, torch.pointer(self))
+   end
+
+   function Tensor:data()
+      local t = Tensor.cdata(self)
+      if t.storage == nil then
+         return nil
+      end
+      return t.storage.data + t.storageOffset
+   end
+
+   function Tensor:apply(func)
+      local size, stride, n = geometry(Tensor.cdata(self))
+      if n == 0 then
+         return self
+      end
+      local data = Tensor.data(self)
+      if iscontiguous(size, stride) then
+         for i=0,n-1 do
+            local v = func(tonumber(data[i]))
+            if v ~= nil then
+               data[i] = checkvalue(v)
+            end
+         end
+      else
+         local nd = #size
+         local inner, istride = size[nd], stride[nd]
+         for row=0,n/inner-1 do
+            local p = data + rowoffset(row, size, stride)
+            for i=0,inner-1 do
+               local v = func(tonumber(p[i*istride]))
+               if v ~= nil then
+                  p[i*istride] = checkvalue(v)
+               end
+            end
+         end
+      end
+      return self
+   end
+
+   function Tensor:map(src, func)
+      local size, stride, n = geometry(Tensor.cdata(self))
+      local ssize, sstride, sn = geometry(checktensor(src, 1))
+      assert(n == sn, 'inconsistent tensor size')
+      if n == 0 then
+         return self
+      end
+      local data, sdata = Tensor.data(self), Tensor.data(src)
+      if iscontiguous(size, stride) and iscontiguous(ssize, sstride) then
+         for i=0,n-1 do
+            local v = func(tonumber(data[i]), tonumber(sdata[i]))
+            if v ~= nil then
+               data[i] = checkvalue(v)
+            end
+         end
+      elseif issamesize(size, ssize) then
+         local nd = #size
+         local inner, istride, sistride = size[nd], stride[nd], sstride[nd]
+         for row=0,n/inner-1 do
+            local p = data + rowoffset(row, size, stride)
+            local sp = sdata + rowoffset(row, ssize, sstride)
+            for i=0,inner-1 do
+               local v = func(tonumber(p[i*istride]), tonumber(sp[i*sistride]))
+               if v ~= nil then
+                  p[i*istride] = checkvalue(v)
+               end
+            end
+         end
+      else
+         cmap(self, src, func)
+      end
+      return self
+   end
+
+   function Tensor:map2(src1, src2, func)
+      local size, stride, n = geometry(Tensor.cdata(self))
+      local size1, stride1, n1 = geometry(checktensor(src1, 1))
+      local size2, stride2, n2 = geometry(checktensor(src2, 2))
+      assert(n == n1 and n == n2, 'inconsistent tensor size')
+      if n == 0 then
+         return self
+      end
+      local data, data1, data2 = Tensor.data(self), Tensor.data(src1), Tensor.data(src2)
+      if iscontiguous(size, stride) and iscontiguous(size1, stride1) and iscontiguous(size2, stride2) then
+         for i=0,n-1 do
+            local v = func(tonumber(data[i]), tonumber(data1[i]), tonumber(data2[i]))
+            if v ~= nil then
+               data[i] = checkvalue(v)
+            end
+         end
+      elseif issamesize(size, size1) and issamesize(size, size2) then
+         local nd = #size
+         local inner, istride, istride1, istride2 = size[nd], stride[nd], stride1[nd], stride2[nd]
+         for row=0,n/inner-1 do
+            local p = data + rowoffset(row, size, stride)
+            local p1 = data1 + rowoffset(row, size1, stride1)
+            local p2 = data2 + rowoffset(row, size2, stride2)
+            for i=0,inner-1 do
+               local v = func(tonumber(p[i*istride]), tonumber(p1[i*istride1]), tonumber(p2[i*istride2]))
+               if v ~= nil then
+                  p[i*istride] = checkvalue(v)
+               end
+            end
+         end
+      else
+         cmap2(self, src1, src2, func)
+      end
+      return self
+   end
+end
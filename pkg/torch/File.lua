@@ -20,6 +20,16 @@ local TYPE_TORCH    = 4
 local TYPE_BOOLEAN  = 5
 local TYPE_FUNCTION = 6
 
+-- aligned format: a header, the object itself, in which the data of each
+-- storage starts at a multiple of the alignment, then a table of contents of
+-- the storages, then its position and the magic number again
+local TYPE_ALIGNED    = 0x54374141 -- magic number, instead of a type index
+local ALIGNED_VERSION = 1
+
+local function isStorage(typename)
+   return typename:match('^torch%.%a+Storage$') ~= nil
+end
+
 function File:isWritableObject(object)
    local typename = type(object)
    local typeidx
@@ -105,7 +115,12 @@ function File:writeObject(object, force)
             self:writeChar(version)
             self:writeInt(#className)
             self:writeChar(className)
-            if object.write then
+            local env = torch.getenv(self)
+            if env.alignment and isStorage(torch.typename(object)) then
+               local position = object:write(self, env.alignment)
+               table.insert(env.storages, {index=index, typename=torch.typename(object),
+                                           position=position, size=object:size()})
+            elseif object.write then
                object:write(self)
             elseif type(object) == 'table' then
                local var = {}
@@ -148,7 +163,17 @@ function File:readObject()
       return nil
    end
 
-   if typeidx == TYPE_NUMBER then
+   if typeidx == TYPE_ALIGNED then
+      local env = torch.getenv(self)
+      local version = self:readInt()
+      if version > ALIGNED_VERSION then
+         error(string.format('unsupported aligned format version <%d>', version))
+      end
+      env.alignment = self:readLong()
+      local object = self:readObject()
+      env.alignment = nil
+      return object
+   elseif typeidx == TYPE_NUMBER then
       return self:readDouble()
    elseif typeidx == TYPE_BOOLEAN then
       return self:readBool()
@@ -190,7 +215,10 @@ function File:readObject()
          end
          local object = torch.factory(className)()
          objects[index] = object
-         if object.read then
+         local alignment = torch.getenv(self).alignment
+         if alignment and isStorage(className) then
+            object:read(self, versionNumber, alignment)
+         elseif object.read then
             object:read(self, versionNumber)
          elseif type(object) == 'table' then
             local var = self:readObject()
@@ -217,24 +245,360 @@ function File:readObject()
    end
 end
 
+function File:writeAlignedObject(object, alignment)
+   alignment = alignment or 4096
+   assert(self:isBinary(), 'the aligned format requires a binary file')
+   assert(alignment > 0, 'alignment must be positive')
+   if not torch.getenv(self).writeObjects then
+      torch.setenv(self, {writeObjects={}, writeObjectsRef={}, readObjects={}})
+   end
+   local env = torch.getenv(self)
+
+   self:writeInt(TYPE_ALIGNED)
+   self:writeInt(ALIGNED_VERSION)
+   self:writeLong(alignment)
+   env.alignment = alignment
+   env.storages = {}
+   self:writeObject(object)
+   env.alignment = nil
+
+   -- table of contents (positions are stored 0-based)
+   local position = self:position()
+   self:writeInt(#env.storages)
+   for _,entry in ipairs(env.storages) do
+      local typename = torch.CharStorage():string(entry.typename)
+      self:writeInt(entry.index)
+      self:writeInt(#typename)
+      self:writeChar(typename)
+      self:writeLong(entry.position-1)
+      self:writeLong(entry.size)
+   end
+   -- (a double, so that the trailer has the same size everywhere)
+   self:writeDouble(position-1)
+   self:writeInt(TYPE_ALIGNED)
+   env.storages = nil
+end
+
+-- returns the storages of a file written with writeAlignedObject(), as a list
+-- of {index=, typename=, position=, size=}, or nil for other files
+function File:readTableOfContents()
+   local position = self:position()
+   local toc
+   self:seekEnd()
+   local length = self:position()-1
+   local trailer = 12 -- position (double) and magic number (int)
+   if self:isBinary() and length >= trailer then
+      self:seek(length-trailer+1)
+      local tocPosition = self:readDouble()
+      if self:readInt() == TYPE_ALIGNED and tocPosition >= 0 and tocPosition < length then
+         toc = {}
+         self:seek(tocPosition+1)
+         for i=1,self:readInt() do
+            local entry = {}
+            entry.index = self:readInt()
+            entry.typename = self:readChar(self:readInt()):string()
+            entry.position = self:readLong()+1
+            entry.size = self:readLong()
+            table.insert(toc, entry)
+         end
+      end
+   end
+   self:seek(position)
+   return toc
+end
+
 -- simple helpers to save/load arbitrary objects/tables
-function torch.save(filename, object, mode)
+function torch.save(filename, object, mode, alignment)
    mode = mode or 'binary'
    local file = torch.DiskFile(filename, 'w')
-   file[mode](file)
-   file:writeObject(object)
+   if mode == 'aligned' then
+      file:binary()
+      file:writeAlignedObject(object, alignment)
+   else
+      file[mode](file)
+      file:writeObject(object)
+   end
    file:close()
 end
 
 function torch.load(filename, mode)
    mode = mode or 'binary'
    local file = torch.DiskFile(filename, 'r')
-   file[mode](file)
+   if mode == 'mmap' then
+      file:binary()
+      file:mmap()
+   else
+      file[mode](file)
+   end
    local object = file:readObject()
    file:close()
    return object
 end
 
+-- lazy reading: when opened, only the structure of the object is read (tables,
+-- numbers, strings...), and the data of storages and tensors is skipped; they
+-- are read when they are asked for
+local ObjectReader = torch.class('torch.ObjectReader')
+
+local Node = {} -- metatable of the objects not read yet
+
+local function isTensor(typename)
+   return typename:match('^torch%.%a+Tensor$') ~= nil
+end
+
+local elementSizes = {}
+local function elementSize(typename)
+   elementSizes[typename] = elementSizes[typename] or torch.factory(typename)():elementSize()
+   return elementSizes[typename]
+end
+
+function ObjectReader:__init(filename, mode)
+   mode = mode or 'binary'
+   local file = torch.DiskFile(filename, 'r')
+   if mode == 'mmap' then
+      file:binary()
+      file:mmap()
+   else
+      file[mode](file)
+   end
+   self.file = file
+   self.nodes = {} -- index -> node
+   -- objects read so far; objects not read yet are read when readObject() looks for them
+   self.objects = setmetatable({}, {__index = function(objects, index)
+                                                 local node = self.nodes[index]
+                                                 if node then
+                                                    return self:materialize(node)
+                                                 end
+                                              end})
+   torch.setenv(file, {writeObjects={}, writeObjectsRef={}, readObjects=self.objects})
+   self.root = self:skim()
+end
+
+-- like File:readObject(), but returns a node instead of tables, storages and tensors
+function ObjectReader:skim()
+   local file = self.file
+   local typeidx = file:readInt()
+
+   if typeidx == TYPE_NIL then
+      return nil
+   elseif typeidx == TYPE_ALIGNED then
+      local version = file:readInt()
+      if version > ALIGNED_VERSION then
+         error(string.format('unsupported aligned format version <%d>', version))
+      end
+      torch.getenv(file).alignment = file:readLong()
+      return self:skim()
+   elseif typeidx == TYPE_NUMBER then
+      return file:readDouble()
+   elseif typeidx == TYPE_BOOLEAN then
+      return file:readBool()
+   elseif typeidx == TYPE_STRING then
+      return file:readChar(file:readInt()):string()
+   elseif typeidx == TYPE_FUNCTION then
+      local dumped = file:readChar(file:readInt()):string()
+      return setmetatable({kind='function', dumped=dumped, upvalues=self:skim()}, Node)
+   elseif typeidx == TYPE_TABLE or typeidx == TYPE_TORCH then
+      local index = file:readInt()
+      if self.nodes[index] or rawget(self.objects, index) then
+         return self.nodes[index] or rawget(self.objects, index)
+      end
+
+      local node
+      if typeidx == TYPE_TABLE then
+         node = setmetatable({kind='table', index=index, keys={}, values={}, fields={}}, Node)
+         self.nodes[index] = node
+         for i=1,file:readInt() do
+            local k = self:skim()
+            local v = self:skim()
+            table.insert(node.keys, k)
+            table.insert(node.values, v)
+            if getmetatable(k) ~= Node then
+               node.fields[k] = v
+            end
+         end
+         return node
+      end
+
+      local version, className, versionNumber
+      version = file:readChar(file:readInt()):string()
+      versionNumber = tonumber(string.match(version, '^V (.*)$'))
+      if not versionNumber then
+         className = version
+         versionNumber = 0 -- file created before existence of versioning system
+      else
+         className = file:readChar(file:readInt()):string()
+      end
+      if not torch.factory(className) then
+         error(string.format('unknown Torch class <%s>', tostring(className)))
+      end
+
+      node = setmetatable({kind='torch', index=index, typename=className, version=versionNumber}, Node)
+      local alignment = torch.getenv(file).alignment
+      if isStorage(className) and file:isBinary() then
+         node.position = file:position()
+         node.size = file:readLong()
+         local position = file:position()-1
+         if alignment then
+            position = math.ceil(position/alignment)*alignment
+         end
+         file:seek(position + node.size*elementSize(className) + 1)
+         self.nodes[index] = node
+      elseif isTensor(className) then
+         node.position = file:position()
+         local nDimension = file:readInt()
+         node.size = file:readLong(nDimension)
+         file:readLong(nDimension) -- stride
+         file:readLong() -- storage offset
+         self.nodes[index] = node
+         self:skim() -- storage
+      else
+         local object = torch.factory(className)()
+         if object.read then
+            -- unknown format: read it now
+            rawset(self.objects, index, object)
+            if isStorage(className) then
+               object:read(file, versionNumber, alignment)
+            else
+               object:read(file, versionNumber)
+            end
+            return object
+         elseif type(object) == 'table' then
+            node.kind = 'object'
+            self.nodes[index] = node
+            node.var = self:skim()
+         else
+            error(string.format('Cannot load object class <%s>', tostring(className)))
+         end
+      end
+      return node
+   else
+      error('unknown object')
+   end
+end
+
+-- reads the object of a node
+function ObjectReader:materialize(node)
+   if getmetatable(node) ~= Node then
+      return node
+   end
+
+   if node.kind == 'function' then
+      local func = loadstring(node.dumped)
+      for index,upvalue in ipairs(self:materialize(node.upvalues)) do
+         debug.setupvalue(func, index, upvalue)
+      end
+      return func
+   end
+
+   local object = rawget(self.objects, node.index)
+   if object then
+      return object
+   end
+
+   if node.kind == 'table' then
+      object = {}
+      rawset(self.objects, node.index, object)
+      for i,k in ipairs(node.keys) do
+         object[self:materialize(k)] = self:materialize(node.values[i])
+      end
+   elseif node.kind == 'object' then
+      object = torch.factory(node.typename)()
+      rawset(self.objects, node.index, object)
+      for k,v in pairs(self:materialize(node.var)) do
+         object[k] = v
+      end
+   else
+      local file = self.file
+      local position = file:position()
+      object = torch.factory(node.typename)()
+      rawset(self.objects, node.index, object)
+      file:seek(node.position)
+      if isStorage(node.typename) then
+         object:read(file, node.version, torch.getenv(file).alignment)
+      else
+         object:read(file, node.version)
+      end
+      file:seek(position)
+   end
+   return object
+end
+
+-- node at the given path (keys separated by dots)
+function ObjectReader:node(path)
+   local node = self.root
+   for key in string.gmatch(path or '', '[^%.]+') do
+      if getmetatable(node) == Node and node.kind == 'object' then
+         node = node.var
+      end
+      local value
+      if getmetatable(node) == Node and node.kind == 'table' then
+         value = node.fields[key]
+         if value == nil and tonumber(key) then
+            value = node.fields[tonumber(key)]
+         end
+      elseif type(node) == 'table' and getmetatable(node) ~= Node then
+         value = node[key]
+         if value == nil and tonumber(key) then
+            value = node[tonumber(key)]
+         end
+      end
+      if value == nil then
+         error(string.format('no object at <%s>', path))
+      end
+      node = value
+   end
+   return node
+end
+
+function ObjectReader:get(path)
+   return self:materialize(self:node(path))
+end
+
+function ObjectReader:keys(path)
+   local node = self:node(path)
+   local keys = {}
+   if getmetatable(node) == Node and node.kind == 'object' then
+      node = node.var
+   end
+   if getmetatable(node) == Node then
+      if node.kind == 'table' then
+         for _,k in ipairs(node.keys) do
+            table.insert(keys, k)
+         end
+      end
+   elseif type(node) == 'table' then
+      for k,_ in pairs(node) do
+         table.insert(keys, k)
+      end
+   end
+   return keys
+end
+
+function ObjectReader:typename(path)
+   local node = self:node(path)
+   if getmetatable(node) == Node then
+      return node.typename or node.kind
+   end
+   return torch.typename(node) or type(node)
+end
+
+-- size of a tensor (or storage), without reading it
+function ObjectReader:size(path)
+   local node = self:node(path)
+   if getmetatable(node) == Node and node.kind == 'torch' and node.size then
+      return node.size
+   end
+   return self:materialize(node):size()
+end
+
+function ObjectReader:close()
+   self.file:close()
+end
+
+function torch.open(filename, mode)
+   return torch.ObjectReader(filename, mode)
+end
+
 -- simple helpers to serialize/deserialize arbitrary objects/tables
 function torch.serialize(object)
    local f = torch.MemoryFile()
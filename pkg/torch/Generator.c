@@ -0,0 +1,36 @@
+#include "general.h"
+
+static int torch_Generator_new(lua_State *L)
+{
+  static const char *const types[] = {"mt", "philox", NULL};
+  int type = luaL_checkoption(L, 1, "mt", types);
+  THGenerator *gen = THGenerator_new(type == 0 ? TH_GENERATOR_MT : TH_GENERATOR_PHILOX);
+  luaT_pushudata(L, gen, "torch.Generator");
+  return 1;
+}
+
+static int torch_Generator_free(lua_State *L)
+{
+  THGenerator *gen = luaT_checkudata(L, 1, "torch.Generator");
+  THGenerator_free(gen);
+  return 0;
+}
+
+static int torch_Generator___tostring__(lua_State *L)
+{
+  THGenerator *gen = luaT_checkudata(L, 1, "torch.Generator");
+  lua_pushfstring(L, "torch.Generator [type: %s]", (gen->type == TH_GENERATOR_PHILOX ? "philox" : "mt"));
+  return 1;
+}
+
+static const struct luaL_Reg torch_Generator__ [] = {
+  {"__tostring__", torch_Generator___tostring__},
+  {NULL, NULL}
+};
+
+void torch_Generator_init(lua_State *L)
+{
+  luaT_newmetatable(L, "torch.Generator", NULL, torch_Generator_new, torch_Generator_free, NULL);
+  luaL_register(L, NULL, torch_Generator__);
+  lua_pop(L, 1);
+}
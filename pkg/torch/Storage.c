@@ -5,5 +5,47 @@
 #define THFile_writeRealRaw TH_CONCAT_3(THFile_write, Real, Raw)
 #define torch_Storage TH_CONCAT_STRING_3(torch.,Real,Storage)
 
+/* zeros up to the next multiple of alignment */
+static void torch_Storage_writePadding(THFile *file, long alignment)
+{
+  char zeros[256];
+  long padding = (alignment - THFile_position(file) % alignment) % alignment;
+
+  memset(zeros, 0, sizeof(zeros));
+  while(padding > 0)
+  {
+    long n = (padding < (long)sizeof(zeros) ? padding : (long)sizeof(zeros));
+    THFile_writeCharRaw(file, zeros, n);
+    padding -= n;
+  }
+}
+
+static void torch_Storage_skipPadding(THFile *file, long alignment)
+{
+  long position = THFile_position(file);
+  if(position % alignment)
+    THFile_seek(file, position + alignment - position % alignment);
+}
+
+/* storages smaller than this are read even from mapped files */
+#define TORCH_STORAGE_MMAP_MIN_SIZE 16384
+
+/* can size bytes at the current position of the file be mapped, with the given alignment? */
+static int torch_Storage_isMappable(lua_State *L, int index, long size, long alignment)
+{
+  THFile *file = luaT_toudata(L, index, "torch.DiskFile");
+
+  if(!file || !THDiskFile_isMmap(file) || size < TORCH_STORAGE_MMAP_MIN_SIZE)
+    return 0;
+
+#if !(defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64))
+  /* unaligned accesses are not allowed everywhere */
+  if(THFile_position(file) % alignment)
+    return 0;
+#endif
+
+  return 1;
+}
+
 #include "generic/Storage.c"
 #include "THGenerateAllTypes.h"
@@ -406,6 +406,31 @@ for _,Tensor in ipairs({"ByteTensor", "CharTensor",
          {name=Tensor, dim=2}}
      )
 
+   wrap("bmm",
+        cname("baddbmm"),
+        {{name=Tensor, default=true, returned=true, method={default='nil'},
+          init=function(arg)
+                  return table.concat(
+                     {
+                        arg.__metatable.init(arg),
+                        string.format("TH%s_resize3d(%s, %s->size[0], %s->size[1], %s->size[2]);", Tensor, arg:carg(), arg.args[5]:carg(), arg.args[5]:carg(), arg.args[6]:carg())
+                     }, '\n')
+               end,
+          precall=function(arg)
+                     return table.concat(
+                        {
+                           string.format("TH%s_zero(%s);", Tensor, arg:carg()),
+                           arg.__metatable.precall(arg)
+                        }, '\n')
+                  end
+       },
+         {name=real, default=1, invisible=true},
+         {name=Tensor, default=1, invisible=true},
+         {name=real, default=1, invisible=true},
+         {name=Tensor, dim=3},
+         {name=Tensor, dim=3}}
+     )
+
    wrap("ger",
         cname("addr"),
         {{name=Tensor, default=true, returned=true, method={default='nil'},
@@ -434,6 +459,7 @@ for _,Tensor in ipairs({"ByteTensor", "CharTensor",
    for _,f in ipairs({
                         {name="addmv", dim1=1, dim2=2, dim3=1},
                         {name="addmm", dim1=2, dim2=2, dim3=2},
+                        {name="baddbmm", dim1=3, dim2=3, dim3=3},
                         {name="addr",  dim1=2, dim2=1, dim3=1},
                      }
                   ) do
@@ -540,6 +566,7 @@ for _,Tensor in ipairs({"ByteTensor", "CharTensor",
                             string.format("TH%s_add(%s, %s, 1);", Tensor, arg:carg(), arg:carg())
                          }, '\n')
                    end},
+         {name='Generator', default=true},
          {name="long"}})
 
    wrap("sort",
@@ -549,7 +576,67 @@ for _,Tensor in ipairs({"ByteTensor", "CharTensor",
          {name=Tensor},
          {name="index", default=lastdim(3)},
          {name="boolean", default=0}})
+
+   wrap("topk",
+        cname("topk"),
+        {{name=Tensor, default=true, returned=true},
+         {name="IndexTensor", default=true, returned=true, noreadadd=true},
+         {name=Tensor},
+         {name="long"},
+         {name="index", default=lastdim(3)},
+         {name="boolean", default=0},
+         {name="boolean", default=0}})
+
+   wrap("kthvalue",
+        cname("kthvalue"),
+        {{name=Tensor, default=true, returned=true},
+         {name="IndexTensor", default=true, returned=true, noreadadd=true},
+         {name=Tensor},
+         {name="long"},
+         {name="index", default=lastdim(3)}})
    
+   wrap("indexSelect",
+        cname("indexSelect"),
+        {{name=Tensor, default=true, returned=true},
+         {name=Tensor},
+         {name="index"},
+         {name="IndexTensor", noreadadd=true}})
+
+   wrap("indexCopy",
+        cname("indexCopy"),
+        {{name=Tensor, returned=true},
+         {name="index"},
+         {name="IndexTensor", noreadadd=true},
+         {name=Tensor}})
+
+   wrap("indexAdd",
+        cname("indexAdd"),
+        {{name=Tensor, returned=true},
+         {name="index"},
+         {name="IndexTensor", noreadadd=true},
+         {name=Tensor}})
+
+   wrap("indexFill",
+        cname("indexFill"),
+        {{name=Tensor, returned=true},
+         {name="index"},
+         {name="IndexTensor", noreadadd=true},
+         {name=real}})
+
+   wrap("gather",
+        cname("gather"),
+        {{name=Tensor, default=true, returned=true},
+         {name=Tensor},
+         {name="index"},
+         {name="IndexTensor", noreadadd=true}})
+
+   wrap("scatter",
+        cname("scatter"),
+        {{name=Tensor, returned=true},
+         {name="index"},
+         {name="IndexTensor", noreadadd=true},
+         {name=Tensor}})
+
    wrap("tril",
         cname("tril"),
         {{name=Tensor, default=true, returned=true},
@@ -572,64 +659,72 @@ for _,Tensor in ipairs({"ByteTensor", "CharTensor",
    if Tensor == 'ByteTensor' then -- we declare this only once
       interface:print(
          [[
-static int THRandom_random2__(long a, long b)
+static int THRandom_random2__(THGenerator *gen, long a, long b)
 {
   THArgCheck(b >= a, 2, "upper bound must be larger than lower bound");
-  return((THRandom_random() % (b+1-a)) + a);
+  return((THGenerator_random(gen) % (b+1-a)) + a);
 }
          
-static int THRandom_random1__(long b)
+static int THRandom_random1__(THGenerator *gen, long b)
 {
   THArgCheck(b > 0, 1, "upper bound must be strictly positive");
-  return(THRandom_random() % b + 1);
+  return(THGenerator_random(gen) % b + 1);
 }
          ]])
    end
 
    interface:print(string.gsub(
                       [[
-static void THTensor_random2__(THTensor *self, long a, long b)
+static void THTensor_random2__(THTensor *self, THGenerator *gen, long a, long b)
 {
   THArgCheck(b >= a, 2, "upper bound must be larger than lower bound");
-  TH_TENSOR_APPLY(real, self, *self_data = ((THRandom_random() % (b+1-a)) + a);)
+  TH_TENSOR_APPLY(real, self, *self_data = ((THGenerator_random(gen) % (b+1-a)) + a);)
 }
 
-static void THTensor_random1__(THTensor *self, long b)
+static void THTensor_random1__(THTensor *self, THGenerator *gen, long b)
 {
   THArgCheck(b > 0, 1, "upper bound must be strictly positive");
-  TH_TENSOR_APPLY(real, self, *self_data = (THRandom_random() % b + 1);)
+  TH_TENSOR_APPLY(real, self, *self_data = (THGenerator_random(gen) % b + 1);)
 }
 ]], 'Tensor', Tensor):gsub('real', real))
 
    wrap('random',
         'THRandom_random2__',
-        {{name='long'},
+        {{name='Generator', default=true},
+         {name='long'},
          {name='long'},
          {name='long', creturned=true}},
         'THRandom_random1__',
-        {{name='long'},
+        {{name='Generator', default=true},
+         {name='long'},
+         {name='long', creturned=true}},
+        'THGenerator_random',
+        {{name='Generator', default=true},
          {name='long', creturned=true}},
-        'THRandom_random',
-        {{name='long', creturned=true}},
         cname("random2__"),
         {{name=Tensor, returned=true},
+         {name='Generator', default=true},
          {name='long'},
          {name='long'}},
         cname("random1__"),
         {{name=Tensor, returned=true},
+         {name='Generator', default=true},
          {name='long'}},
         cname("random"),
-        {{name=Tensor, returned=true}})
+        {{name=Tensor, returned=true},
+         {name='Generator', default=true}})
 
    for _,f in ipairs({{name='geometric'},
                       {name='bernoulli', a=0.5}}) do
       
       wrap(f.name,
-           string.format("THRandom_%s", f.name),
-           {{name="double", default=f.a},
+           string.format("THGenerator_%s", f.name),
+           {{name='Generator', default=true},
+            {name="double", default=f.a},
             {name="double", creturned=true}},
            cname(f.name),
            {{name=Tensor, returned=true},
+            {name='Generator', default=true},
             {name=real, default=f.a}})
    end
 
@@ -890,6 +985,11 @@ static void THTensor_random1__(THTensor *self, long b)
                {name=real, creturned=true}})
          
       end
+         wrap("sigmoid",
+              cname("sigmoid"),
+              {{name=Tensor, default=true, returned=true, method={default='nil'}},
+               {name=Tensor, method={default=1}}})
+
          wrap("abs",
               cname("abs"),
               {{name=Tensor, default=true, returned=true, method={default='nil'}},
@@ -922,11 +1022,13 @@ static void THTensor_random1__(THTensor *self, long b)
       wrap("rand",
            cname("rand"),
            {{name=Tensor, default=true, returned=true, method={default='nil'}},
+            {name='Generator', default=true},
             {name="LongArg"}})
 
       wrap("randn",
            cname("randn"),
            {{name=Tensor, default=true, returned=true, method={default='nil'}},
+            {name='Generator', default=true},
             {name="LongArg"}})
       
       for _,f in ipairs({{name='uniform', a=0, b=1},
@@ -935,12 +1037,14 @@ static void THTensor_random1__(THTensor *self, long b)
                          {name='logNormal', a=1, b=2}}) do
          
          wrap(f.name,
-              string.format("THRandom_%s", f.name),
-              {{name="double", default=f.a},
+              string.format("THGenerator_%s", f.name),
+              {{name='Generator', default=true},
+               {name="double", default=f.a},
                {name="double", default=f.b},
                {name="double", creturned=true}},
               cname(f.name),
               {{name=Tensor, returned=true},
+               {name='Generator', default=true},
                {name=real, default=f.a},
                {name=real, default=f.b}})
       end
@@ -948,11 +1052,13 @@ static void THTensor_random1__(THTensor *self, long b)
       for _,f in ipairs({{name='exponential'}}) do
          
          wrap(f.name,
-              string.format("THRandom_%s", f.name),
-              {{name="double", default=f.a},
+              string.format("THGenerator_%s", f.name),
+              {{name='Generator', default=true},
+               {name="double", default=f.a},
                {name="double", creturned=true}},
               cname(f.name),
               {{name=Tensor, returned=true},
+               {name='Generator', default=true},
                {name=real, default=f.a}})
       end
       
@@ -95,6 +95,12 @@ static int torch_Storage_(__len__)(lua_State *L)
   return 1;
 }
 
+static int torch_Storage_(elementSize)(lua_State *L)
+{
+  lua_pushnumber(L, sizeof(real));
+  return 1;
+}
+
 static int torch_Storage_(__newindex__)(lua_State *L)
 {
   if(lua_isnumber(L, 2))
@@ -172,21 +178,43 @@ static int torch_Storage_(write)(lua_State *L)
 {
   THStorage *storage = luaT_checkudata(L, 1, torch_Storage);
   THFile *file = luaT_checkudata(L, 2, "torch.File");
+  long alignment = luaL_optlong(L, 3, 0);
  
   THFile_writeLongScalar(file, storage->size);
+  if(alignment > 0)
+  {
+    /* the data starts at a multiple of alignment: returns its position */
+    torch_Storage_writePadding(file, alignment);
+    lua_pushnumber(L, THFile_position(file)+1);
+  }
   THFile_writeRealRaw(file, storage->data, storage->size);
 
-  return 0;
+  return (alignment > 0 ? 1 : 0);
 }
 
 static int torch_Storage_(read)(lua_State *L)
 {
   THStorage *storage = luaT_checkudata(L, 1, torch_Storage);
   THFile *file = luaT_checkudata(L, 2, "torch.File");
+  long alignment = luaL_optlong(L, 4, 0); /* (3 is the version) */
   long size = THFile_readLongScalar(file);
 
-  THStorage_(resize)(storage, size);
-  THFile_readRealRaw(file, storage->data, storage->size);
+  if(alignment > 0)
+    torch_Storage_skipPadding(file, alignment);
+
+  if(torch_Storage_isMappable(L, 2, sizeof(real)*size, sizeof(real)))
+  {
+    long position = THFile_position(file);
+    THStorage *mapped = THStorage_(newWithMappingRange)(THDiskFile_name(file), position, size, 0);
+    THStorage_(swap)(storage, mapped);
+    THStorage_(free)(mapped);
+    THFile_seek(file, position + sizeof(real)*size);
+  }
+  else
+  {
+    THStorage_(resize)(storage, size);
+    THFile_readRealRaw(file, storage->data, storage->size);
+  }
 
   return 0;
 }
@@ -194,6 +222,7 @@ static int torch_Storage_(read)(lua_State *L)
 static const struct luaL_Reg torch_Storage_(_) [] = {
   {"size", torch_Storage_(__len__)},
   {"__len__", torch_Storage_(__len__)},
+  {"elementSize", torch_Storage_(elementSize)},
   {"__newindex__", torch_Storage_(__newindex__)},
   {"__index__", torch_Storage_(__index__)},
   {"resize", torch_Storage_(resize)},
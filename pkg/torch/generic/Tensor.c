@@ -432,6 +432,14 @@ static int torch_Tensor_(isContiguous)(lua_State *L)
   return 1;
 }
 
+static int torch_Tensor_(isSetTo)(lua_State *L)
+{
+  THTensor *tensor = luaT_checkudata(L, 1, torch_Tensor);
+  THTensor *src = luaT_checkudata(L, 2, torch_Tensor);
+  lua_pushboolean(L, THTensor_(isSetTo)(tensor, src));
+  return 1;
+}
+
 static int torch_Tensor_(nElement)(lua_State *L)
 {
   THTensor *tensor = luaT_checkudata(L, 1, torch_Tensor);
@@ -976,6 +984,51 @@ static int torch_Tensor_(map2)(lua_State *L)
   return 1;
 }
 
+/* self:evaluate(program, operands), where program is a table of instruction
+   names, each followed by its argument: an index in the table of operands
+   ("tensor"), a value ("value" and "*value"), or anything else (see
+   TH/THTensorExpr.h). The buffers are userdata, collected on error. */
+static int torch_Tensor_(evaluate)(lua_State *L)
+{
+  THTensor *tensor = luaT_checkudata(L, 1, torch_Tensor);
+  THExprInstr *code;
+  THTensor **operand;
+  int ncode, noperand, i;
+
+  luaL_checktype(L, 2, LUA_TTABLE);
+  luaL_checktype(L, 3, LUA_TTABLE);
+  luaL_argcheck(L, lua_objlen(L, 2) % 2 == 0, 2, "instructions and arguments expected");
+  ncode = lua_objlen(L, 2)/2;
+  noperand = lua_objlen(L, 3);
+
+  code = lua_newuserdata(L, sizeof(THExprInstr)*ncode);
+  for(i = 0; i < ncode; i++)
+  {
+    lua_rawgeti(L, 2, 2*i+1);
+    lua_rawgeti(L, 2, 2*i+2);
+    luaL_argcheck(L, lua_isstring(L, -2), 2, "instruction name expected");
+    code[i].op = THExpr_opcode(lua_tostring(L, -2));
+    luaL_argcheck(L, code[i].op >= 0, 2, "unknown instruction");
+    code[i].value = lua_tonumber(L, -1);
+    code[i].arg = (int)code[i].value-1;
+    lua_pop(L, 2);
+  }
+
+  operand = lua_newuserdata(L, sizeof(THTensor*)*(noperand > 0 ? noperand : 1));
+  for(i = 0; i < noperand; i++)
+  {
+    lua_rawgeti(L, 3, i+1);
+    operand[i] = luaT_toudata(L, -1, torch_Tensor);
+    luaL_argcheck(L, operand[i] != NULL, 3, "table of " torch_Tensor " expected");
+    lua_pop(L, 1);
+  }
+
+  THTensor_(evaluate)(tensor, ncode, code, noperand, operand);
+
+  lua_settop(L, 1);
+  return 1;
+}
+
 static int torch_Tensor_(factory)(lua_State *L)
 {
   THTensor *tensor = THTensor_(new)();
@@ -1013,22 +1066,24 @@ static int torch_Tensor_(read)(lua_State *L)
 {
   THTensor *tensor = luaT_checkudata(L, 1, torch_Tensor);
   THFile *file = luaT_checkudata(L, 2, "torch.File");
+  int nDimension = THFile_readIntScalar(file);
+  THLongStorage *size = THLongStorage_newWithSize(nDimension);
+  THLongStorage *stride = THLongStorage_newWithSize(nDimension);
+  long storageOffset;
 
-  tensor->nDimension = THFile_readIntScalar(file);
-  tensor->size = THAlloc(sizeof(long)*tensor->nDimension);
-  tensor->stride = THAlloc(sizeof(long)*tensor->nDimension);
-  THFile_readLongRaw(file, tensor->size, tensor->nDimension);
-  THFile_readLongRaw(file, tensor->stride, tensor->nDimension);
-  tensor->storageOffset = THFile_readLongScalar(file);
-  tensor->storageOffset--;  /* to respect Lua convention */
+  /* userdata, collected if reading fails */
+  luaT_pushudata(L, size, "torch.LongStorage");
+  luaT_pushudata(L, stride, "torch.LongStorage");
+  THFile_readLongRaw(file, size->data, nDimension);
+  THFile_readLongRaw(file, stride->data, nDimension);
+  storageOffset = THFile_readLongScalar(file);
+  storageOffset--;  /* to respect Lua convention */
 
   lua_getfield(L, 2, "readObject"); /* the method */
   lua_pushvalue(L, 2); /* the file */
   lua_call(L, 1, 1); /* call the method */
 
-  tensor->storage = luaT_toudata(L, -1, torch_Storage);
-  if(tensor->storage)
-    THStorage_(retain)(tensor->storage);
+  THTensor_(setStorage)(tensor, luaT_toudata(L, -1, torch_Storage), storageOffset, size, stride);
 
   return 0;
 }
@@ -1054,11 +1109,13 @@ static const struct luaL_Reg torch_Tensor_(_) [] = {
   {"t", torch_Tensor_(t)},
   {"unfold", torch_Tensor_(unfold)},
   {"isContiguous", torch_Tensor_(isContiguous)},
+  {"isSetTo", torch_Tensor_(isSetTo)},
   {"nElement", torch_Tensor_(nElement)},
   {"copy", torch_Tensor_(copy)},
   {"apply", torch_Tensor_(apply)},
   {"map", torch_Tensor_(map)},
   {"map2", torch_Tensor_(map2)},
+  {"evaluate", torch_Tensor_(evaluate)},
   {"read", torch_Tensor_(read)},
   {"write", torch_Tensor_(write)},
   {"__index__", torch_Tensor_(__index__)},
@@ -8,6 +8,7 @@ extern void torch_DiskFile_init(lua_State *L);
 extern void torch_MemoryFile_init(lua_State *L);
 extern void torch_PipeFile_init(lua_State *L);
 extern void torch_Timer_init(lua_State *L);
+extern void torch_Generator_init(lua_State *L);
 
 extern void torch_ByteStorage_init(lua_State *L);
 extern void torch_CharStorage_init(lua_State *L);
@@ -83,6 +84,7 @@ DLL_EXPORT int luaopen_libtorch(lua_State *L)
   torch_DoubleTensorOperator_init(L);
 
   torch_Timer_init(L);
+  torch_Generator_init(L);
   torch_DiskFile_init(L);
   torch_PipeFile_init(L);
   torch_MemoryFile_init(L);
@@ -72,6 +72,8 @@ end
 torch.setdefaulttensortype('torch.DoubleTensor')
 
 include('Tensor.lua')
+include('FFI.lua')
+include('Expression.lua')
 include('File.lua')
 include('CmdLine.lua')
 include('Tester.lua')
@@ -8,13 +8,15 @@ interface:print(
 
 for _,name in ipairs({"seed", "initialSeed"}) do
    interface:wrap(name,
-                  string.format("THRandom_%s",name),
-                  {{name="long", creturned=true}})
+                  string.format("THGenerator_%s",name),
+                  {{name='Generator', default=true},
+                   {name="long", creturned=true}})
 end
 
 interface:wrap('manualSeed',
-               'THRandom_manualSeed',
-               {{name="long"}})
+               'THGenerator_manualSeed',
+               {{name='Generator', default=true},
+                {name="long"}})
 
 interface:register("random__")
                 
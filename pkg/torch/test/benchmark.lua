@@ -0,0 +1,281 @@
+-- Micro-benchmarks of the torch package.
+-- Usage: torch benchmark.lua [benchmark names...]
+-- Without arguments, all benchmarks are run.
+
+require 'torch'
+
+local torchbench = {}
+
+-- runs f() n times, and prints the average time per call
+local function timeit(name, n, f)
+   f() -- warm up
+   local timer = torch.Timer()
+   for i=1,n do
+      f()
+   end
+   local t = timer:time().real
+   print(string.format('%-40s %12.3f us/call', name, t/n*1e6))
+   return t/n
+end
+
+function torchbench.alloc()
+   -- temporary buffers, allocated, written and released, with each allocator
+   local name, options = torch.getallocator()
+   for _,sz in ipairs{10, 1000, 100000, 1000000, 10000000} do
+      for _,allocator in ipairs{'system', 'caching'} do
+         torch.setallocator(allocator)
+         local y = torch.DoubleTensor()
+         timeit(string.format('alloc %d (%s)', sz, allocator), math.max(math.floor(1e8/sz), 10),
+                function()
+                   y:resize(sz):fill(0)
+                   y:set()
+                end)
+      end
+   end
+   torch.setallocator(name, options)
+end
+
+function torchbench.binding()
+   -- per-call overhead of the C bindings (argument type checks), on 1-element tensors
+   local n = 1000000
+   local x, y = torch.Tensor(1), torch.Tensor(1)
+   local dim, add, cmul, addcmul = x.dim, x.add, x.cmul, x.addcmul
+   timeit('dim', n, function() dim(x) end)
+   timeit('x:dim() (with method lookup)', n, function() x:dim() end)
+   timeit('add 1 tensor', n, function() add(x, y) end)
+   timeit('cmul 2 tensors', n, function() cmul(x, y, y) end)
+   timeit('addcmul 3 tensors', n, function() addcmul(x, x, 2, y, y) end)
+end
+
+function torchbench.views()
+   -- creation of views, a tensor header each
+   local n = 1000000
+   local x = torch.rand(10, 20, 30)
+   local y = torch.rand(2, 3, 4, 5, 6, 7)
+   timeit('select 3d', n, function() x:select(1, 2) end)
+   timeit('narrow 3d', n, function() x:narrow(2, 3, 4) end)
+   timeit('transpose 3d', n, function() x:transpose(1, 3) end)
+   timeit('select 6d', n, function() y:select(1, 2) end)
+end
+
+function torchbench.apply()
+   -- per-call overhead of the apply macros on small tensors
+   local n = 200000
+   for _,sz in ipairs{1, 10, 100} do
+      local x = torch.rand(sz, sz)
+      local y = torch.rand(sz, sz)
+      local z = torch.rand(sz, sz)
+      local xt = torch.rand(sz, sz):t()
+      local yt = torch.rand(sz, sz):t()
+      local ni = math.max(math.floor(n/(sz*sz)), 100)
+      timeit(string.format('fill %dx%d', sz, sz), ni, function() x:fill(1) end)
+      timeit(string.format('add contiguous %dx%d', sz, sz), ni, function() x:add(y) end)
+      timeit(string.format('cmul contiguous %dx%d', sz, sz), ni, function() x:cmul(y, z) end)
+      timeit(string.format('add transposed %dx%d', sz, sz), ni, function() xt:add(yt) end)
+      timeit(string.format('cmul transposed %dx%d', sz, sz), ni, function() xt:cmul(yt, z) end)
+      timeit(string.format('sum %dx%d', sz, sz), ni, function() x:sum() end)
+   end
+end
+
+function torchbench.map()
+   -- Lua functions applied to each element (compiled loops with LuaJIT)
+   local x = torch.rand(1000, 1000)
+   local y = torch.rand(1000, 1000)
+   local xt = torch.rand(1000, 1000):t()
+   timeit('apply 1000x1000', 5, function() x:apply(function(v) return v*v + 1 end) end)
+   timeit('apply transposed 1000x1000', 5, function() xt:apply(function(v) return v*v + 1 end) end)
+   timeit('map 1000x1000', 5, function() x:map(y, function(a, b) return a < b and a or b end) end)
+   timeit('map2 1000x1000', 5, function() x:map2(y, xt, function(a, b, c) return a + b*c end) end)
+   if jit then
+      timeit('data() loop 1000x1000', 5, function()
+         local p = x:data()
+         for i=0,x:nElement()-1 do
+            p[i] = p[i]*p[i] + 1
+         end
+      end)
+   end
+end
+
+function torchbench.lazy()
+   -- a chain of pointwise operations, eager and as one fused expression
+   for _,sz in ipairs{100, 1000, 3000} do
+      local x = torch.rand(sz, sz)
+      local y = torch.rand(sz, sz)
+      local z = torch.rand(sz, sz)
+      local res = torch.Tensor(sz, sz)
+      local ni = math.max(1, math.floor(1e7/(sz*sz)))
+      timeit(string.format('eager 5 ops %dx%d', sz, sz), ni,
+             function() res:copy(x):add(2, y):cmul(z):addcmul(0.5, y, z):div(3):abs() end)
+      local e = x:lazy():add(2, y):cmul(z):addcmul(0.5, y, z):div(3):abs()
+      timeit(string.format('lazy 5 ops %dx%d', sz, sz), ni, function() e:eval(res) end)
+   end
+end
+
+function torchbench.gemm()
+   -- matrix-matrix products, with each gemm implementation (see torch.setgemm)
+   local current = torch.getgemm()
+   for _,type in ipairs{'torch.FloatTensor', 'torch.DoubleTensor'} do
+      for _,sz in ipairs{32, 64, 128, 256, 512, 1024} do
+         for _,trans in ipairs{'nn', 'tn', 'nt', 'tt'} do
+            local a = torch.rand(sz, sz):type(type)
+            local b = torch.rand(sz, sz):type(type)
+            local c = torch.Tensor(sz, sz):type(type)
+            if trans:sub(1,1) == 't' then a = a:t() end
+            if trans:sub(2,2) == 't' then b = b:t() end
+            local n = math.max(math.floor(2e8/(sz*sz*sz)), 1)
+            for _,gemm in ipairs{'reference', 'builtin', 'blas'} do
+               -- the reference loop is too slow on large matrices
+               if gemm ~= 'reference' or sz <= 256 then
+                  torch.setgemm(gemm)
+                  local name = string.format('%s %s %d %s (%s)', type, torch.getgemm(), sz, trans, torch.getsimd())
+                  local t = timeit(name, gemm == 'reference' and 1 or n, function() c:mm(a, b) end)
+                  print(string.format('%-40s %12.3f GFLOPS', '', 2*sz*sz*sz/t*1e-9))
+               end
+            end
+         end
+      end
+   end
+   torch.setgemm(current)
+end
+
+function torchbench.bmm()
+   -- batches of small products: bmm vs one mm per matrix
+   for _,sz in ipairs{4, 16, 64} do
+      local bs = 256
+      local a = torch.rand(bs, sz, sz)
+      local b = torch.rand(bs, sz, sz)
+      local c = torch.Tensor(bs, sz, sz)
+      local n = math.max(math.floor(2e7/(bs*sz*sz*sz)), 10)
+      timeit(string.format('mm loop %dx%dx%d', bs, sz, sz), n,
+             function()
+                for i=1,bs do
+                   c[i]:mm(a[i], b[i])
+                end
+             end)
+      timeit(string.format('bmm %dx%dx%d', bs, sz, sz), n, function() c:bmm(a, b) end)
+   end
+end
+
+function torchbench.math()
+   -- transcendental functions, in precise (C library) and fast (SIMD) modes
+   local mode = torch.getmathmode()
+   for _,type in ipairs{'torch.FloatTensor', 'torch.DoubleTensor'} do
+      local x = torch.rand(1000000):add(0.1):type(type)
+      local y = x:clone()
+      for _,name in ipairs{'exp', 'log', 'log1p', 'tanh', 'sigmoid'} do
+         for _,m in ipairs{'precise', 'fast'} do
+            torch.setmathmode(m)
+            timeit(string.format('%s %s 1e6 (%s, %s)', type, name, m, torch.getsimd()), 20,
+                   function() y[name](y, x) end)
+         end
+      end
+   end
+   torch.setmathmode(mode)
+end
+
+function torchbench.reduce()
+   -- reductions of a feature matrix over its rows (columns statistics) and columns
+   local x = torch.FloatTensor(200000, 512):uniform()
+   local y, i = torch.FloatTensor(), torch.LongTensor()
+   for _,dim in ipairs{1, 2} do
+      timeit(string.format('sum 200000x512 dim %d', dim), 5, function() y:sum(x, dim) end)
+      timeit(string.format('std 200000x512 dim %d', dim), 5, function() y:std(x, dim) end)
+      timeit(string.format('max 200000x512 dim %d', dim), 5, function() y:max(i, x, dim) end)
+   end
+end
+
+function torchbench.sort()
+   -- full sorts, and selections of a few elements, of short and long slices
+   for _,size in ipairs{{10000, 100}, {100, 10000}, {1, 1000000}} do
+      local x = torch.rand(size[1], size[2])
+      local y, i = torch.Tensor(), torch.LongTensor()
+      local name = string.format('%dx%d', size[1], size[2])
+      timeit('sort ' .. name, 10, function() y:sort(i, x) end)
+      timeit('sort descending ' .. name, 10, function() y:sort(i, x, 2, true) end)
+      timeit('topk 10 ' .. name, 10, function() y:topk(i, x, math.min(10, size[2])) end)
+      timeit('kthvalue median ' .. name, 10, function() y:kthvalue(i, x, size[2]/2) end)
+      local xi = x:clone():mul(1e6):int()
+      local yi = torch.IntTensor()
+      timeit('sort int ' .. name, 10, function() yi:sort(i, xi) end)
+   end
+end
+
+function torchbench.index()
+   -- minibatch assembly from a dataset, against a loop of row copies
+   local data = torch.FloatTensor(60000, 784):uniform()
+   local idx = torch.LongTensor(256):random(60000)
+   local batch = torch.FloatTensor(256, 784)
+   timeit('row copies 256 of 60000x784', 100, function()
+      for i=1,256 do
+         batch[i]:copy(data[idx[i]])
+      end
+   end)
+   timeit('indexSelect 256 of 60000x784', 100, function() batch:indexSelect(data, 1, idx) end)
+   timeit('indexAdd 256 of 60000x784', 100, function() data:indexAdd(1, idx, batch) end)
+   local cols = torch.LongTensor(10000, 10):random(784)
+   local x = torch.FloatTensor(10000, 784):uniform()
+   local y = torch.FloatTensor()
+   timeit('gather 10 of 10000x784 dim 2', 100, function() y:gather(x, 2, cols) end)
+   timeit('scatter 10 of 10000x784 dim 2', 100, function() x:scatter(2, cols, y) end)
+end
+
+function torchbench.random()
+   -- tensor fills with the default (Mersenne Twister) and a Philox generator
+   local x = torch.FloatTensor(10000000)
+   for _,type in ipairs{'mt', 'philox'} do
+      local gen = torch.Generator(type)
+      timeit('uniform 1e7 ' .. type, 5, function() x:uniform(gen) end)
+      timeit('normal 1e7 ' .. type, 5, function() x:normal(gen) end)
+      timeit('bernoulli 1e7 ' .. type, 5, function() x:bernoulli(gen, 0.5) end)
+   end
+end
+
+function torchbench.load()
+   -- loading a model-sized file, read or mapped (the file stays in the page cache)
+   local filename = os.tmpname()
+   local obj = {}
+   for i=1,20 do
+      obj[i] = torch.FloatTensor(1000, 1000):fill(i)
+   end
+   torch.save(filename, obj)
+   for _,mode in ipairs{'binary', 'mmap'} do
+      timeit(string.format('load 20x4MB (%s)', mode), 20,
+             function()
+                torch.load(filename, mode)
+                collectgarbage()
+             end)
+   end
+   os.remove(filename)
+end
+
+function torchbench.open()
+   -- reading one small tensor of a large file: whole file vs lazy reader
+   local filename = os.tmpname()
+   local obj = {modules = {}}
+   for i=1,20 do
+      obj.modules[i] = {weight = torch.FloatTensor(1000, 1000):fill(i), bias = torch.FloatTensor(1000):fill(i)}
+   end
+   torch.save(filename, obj)
+   timeit('torch.load', 10, function() local b = torch.load(filename).modules[3].bias; collectgarbage() end)
+   timeit('torch.open():get()', 10,
+          function()
+             local reader = torch.open(filename)
+             local b = reader:get('modules.3.bias')
+             reader:close()
+             collectgarbage()
+          end)
+   os.remove(filename)
+end
+
+local names = {...}
+if #names == 0 then
+   for name in pairs(torchbench) do
+      table.insert(names, name)
+   end
+   table.sort(names)
+end
+for _,name in ipairs(names) do
+   assert(torchbench[name], 'unknown benchmark <' .. name .. '>')
+   print('==> ' .. name)
+   torchbench[name]()
+end
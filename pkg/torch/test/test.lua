@@ -46,6 +46,76 @@ function torchtest.prod()
    torch.prod(mxx,x,2)
    mytester:asserteq(maxdiff(mx,mxx),0,'torch.prod value')
 end
+function torchtest.reductions()
+   -- each reduction along each dimension, against a plain loop over the
+   -- slices; the sizes give several blocks of slices, and pairwise sums
+   local function check(x, name)
+      for d=1,x:dim() do
+         local n = x:size(d)
+         local xt = x:transpose(d, x:dim()):contiguous()
+         local rows = xt:clone():resize(xt:nElement()/n, n)
+         local results = {
+            sum = torch.sum(x, d), prod = torch.prod(x, d), mean = torch.mean(x, d),
+            std = torch.std(x, d), var = torch.var(x, d), varb = torch.var(x, d, true),
+            norm = torch.norm(x, 3, d), norm2 = torch.norm(x, 2, d)
+         }
+         local maxv, maxi = torch.max(x, d)
+         local minv, mini = torch.min(x, d)
+         for k,r in pairs(results) do
+            results[k] = r:transpose(d, x:dim()):contiguous():resize(rows:size(1))
+         end
+         maxv = maxv:transpose(d, x:dim()):contiguous():resize(rows:size(1))
+         maxi = maxi:transpose(d, x:dim()):contiguous():resize(rows:size(1))
+         minv = minv:transpose(d, x:dim()):contiguous():resize(rows:size(1))
+         mini = mini:transpose(d, x:dim()):contiguous():resize(rows:size(1))
+         local err = 0
+         for r=1,rows:size(1) do
+            local row = rows[r]
+            local sum, prod, norm, norm2, ss = 0, 1, 0, 0, 0
+            local mx, mxi, mn, mni = row[1], 1, row[1], 1
+            for i=1,n do
+               local v = row[i]
+               sum = sum + v
+               prod = prod * v
+               norm = norm + math.abs(v)^3
+               norm2 = norm2 + v*v
+               if v > mx then mx, mxi = v, i end
+               if v < mn then mn, mni = v, i end
+            end
+            local mean = sum/n
+            for i=1,n do
+               ss = ss + (row[i]-mean)^2
+            end
+            local expected = {
+               sum = sum, prod = prod, mean = mean, std = math.sqrt(ss/(n-1)), var = ss/(n-1),
+               varb = ss/n, norm = norm^(1/3), norm2 = math.sqrt(norm2)
+            }
+            for k,v in pairs(expected) do
+               err = math.max(err, math.abs(results[k][r]-v)/math.max(1, math.abs(v)))
+            end
+            mytester:asserteq(maxv[r], mx, name .. ' max value')
+            mytester:asserteq(maxi[r], mxi, name .. ' max index')
+            mytester:asserteq(minv[r], mn, name .. ' min value')
+            mytester:asserteq(mini[r], mni, name .. ' min index')
+         end
+         mytester:assertlt(err, 1e-10, name .. ' dimension ' .. d)
+      end
+   end
+
+   local x = torch.rand(3,300,140):add(0.5)
+   check(x, 'contiguous')
+   check(x:transpose(1,3), 'transposed')
+   check(x:narrow(3,2,130):narrow(2,3,200), 'narrowed')
+   check(x:select(1,2):t(), 'matrix')
+   check(torch.rand(9000,3):add(0.5), 'tall')
+
+   -- shifted sums: the variance of values far from 0 keeps its precision
+   local y = torch.randn(1000,4):add(1e8)
+   local v = torch.var(y, 1)
+   local ref = torch.var(y:clone():add(-1e8), 1)
+   mytester:assertlt(maxdiff(v, ref), 1e-6, 'torch.var offset')
+   mytester:assertlt(maxdiff(torch.var(y:t(), 2):t(), ref), 1e-6, 'torch.var offset transposed')
+end
 function torchtest.cumsum()
    local x = torch.rand(msize,msize)
    local mx = torch.cumsum(x,2)
@@ -137,6 +207,224 @@ function torchtest.sort()
    torch.sort(mxx,ixx,x)
    mytester:asserteq(maxdiff(mx,mxx),0,'torch.sort value')
    mytester:asserteq(maxdiff(ix,ixx),0,'torch.sort index')
+
+   -- checks y,i against a selection sort of each row of x
+   local function checkrows(x, y, i, descending, name)
+      for r=1,x:size(1) do
+         local row = x[r]:clone()
+         for j=1,row:size(1) do
+            local best = j
+            for k=j+1,row:size(1) do
+               if (descending and row[k] > row[best]) or (not descending and row[k] < row[best]) then
+                  best = k
+               end
+            end
+            mytester:asserteq(y[r][j], row[best], name .. ' value')
+            mytester:asserteq(x[r][i[r][j]], y[r][j], name .. ' index')
+            row[best] = row[j]
+            row[j] = y[r][j]
+         end
+      end
+   end
+
+   -- short (insertion) and long (radix) rows, negative values, each order
+   for _,n in ipairs{10, 300} do
+      local x = torch.randn(5,n)
+      local y,i = torch.sort(x)
+      checkrows(x, y, i, false, 'torch.sort ascending')
+      y,i = torch.sort(x, 2, true)
+      checkrows(x, y, i, true, 'torch.sort descending')
+      y,i = torch.sort(x:t(), 1)
+      checkrows(x, y:t(), i:t(), false, 'torch.sort transposed')
+   end
+
+   for _,type in ipairs{'torch.IntTensor', 'torch.LongTensor', 'torch.ShortTensor', 'torch.ByteTensor'} do
+      local x = torch.rand(3,200):mul(200):floor()
+      if type ~= 'torch.ByteTensor' then
+         x:add(-100)
+      end
+      x = x:type(type)
+      local y,i = torch.sort(x)
+      checkrows(x, y, i, false, 'torch.sort ' .. type)
+      y,i = torch.sort(x, 2, true)
+      checkrows(x, y, i, true, 'torch.sort descending ' .. type)
+   end
+
+   -- stable: equal values keep their order
+   for _,n in ipairs{10, 300} do
+      local x = torch.rand(n):mul(4):floor()
+      local y,i = torch.sort(x)
+      for j=2,n do
+         if y[j] == y[j-1] then
+            mytester:assertlt(i[j-1], i[j], 'torch.sort stable')
+         end
+      end
+   end
+end
+function torchtest.topk()
+   for _,n in ipairs{10, 300} do
+      local x = torch.randn(4,n)
+      local sy,si = torch.sort(x, 2, true)
+      local y,i = torch.topk(x, 5, 2, true, true)
+      mytester:asserteq(maxdiff(y,sy:narrow(2,1,5)),0,'torch.topk largest sorted')
+      y,i = torch.topk(x, 5, 2, true)
+      for r=1,4 do
+         for j=1,5 do
+            mytester:asserteq(x[r][i[r][j]], y[r][j], 'torch.topk index')
+         end
+      end
+      local sorted = torch.sort(y, 2, true)
+      mytester:asserteq(maxdiff(sorted,sy:narrow(2,1,5)),0,'torch.topk largest')
+      sy = torch.sort(x, 1)
+      y = torch.topk(x, 2, 1, false, true)
+      mytester:asserteq(maxdiff(y,sy:narrow(1,1,2)),0,'torch.topk smallest')
+      y = torch.topk(x, n, 2, false, true)
+      mytester:asserteq(maxdiff(y,torch.sort(x)),0,'torch.topk all')
+   end
+   local mx,ix = torch.topk(torch.rand(msize,msize), 3)
+   mytester:asserteq(mx:size(2),3,'torch.topk size')
+   mytester:asserteq(ix:size(2),3,'torch.topk size')
+end
+function torchtest.kthvalue()
+   local x = torch.randn(msize,msize)
+   local sy = torch.sort(x)
+   for _,k in ipairs{1, 10, msize} do
+      local y,i = torch.kthvalue(x, k)
+      mytester:asserteq(y:size(2),1,'torch.kthvalue size')
+      mytester:asserteq(maxdiff(y,sy:narrow(2,k,1)),0,'torch.kthvalue value')
+      for r=1,msize do
+         mytester:asserteq(x[r][i[r][1]], y[r][1], 'torch.kthvalue index')
+      end
+   end
+   local y = torch.kthvalue(x, 7, 1)
+   mytester:asserteq(maxdiff(y,torch.sort(x,1):narrow(1,7,1)),0,'torch.kthvalue dimension')
+   local mxx = torch.Tensor()
+   local ixx = torch.LongTensor()
+   local mx,ix = torch.kthvalue(x, 3)
+   torch.kthvalue(mxx, ixx, x, 3)
+   mytester:asserteq(maxdiff(mx,mxx),0,'torch.kthvalue value')
+   mytester:asserteq(maxdiff(ix,ixx),0,'torch.kthvalue index')
+end
+function torchtest.indexSelect()
+   local x = torch.rand(7,5,6)
+   local index = torch.LongTensor{3,1,7,3}
+   for dim=1,3 do
+      for _,src in ipairs{x, x:transpose(1,3)} do
+         local idx = index:clone():apply(function(i) return math.min(i, src:size(dim)) end)
+         local y = torch.indexSelect(src, dim, idx)
+         mytester:asserteq(y:size(dim), idx:size(1), 'torch.indexSelect size')
+         for j=1,idx:size(1) do
+            mytester:asserteq(maxdiff(y:select(dim,j), src:select(dim,idx[j])), 0, 'torch.indexSelect value')
+         end
+         local yy = torch.Tensor(2,2):t()
+         torch.indexSelect(yy, src, dim, idx)
+         mytester:asserteq(maxdiff(yy, y), 0, 'torch.indexSelect result')
+      end
+   end
+   mytester:asserteq(maxdiff(index, torch.LongTensor{3,1,7,3}), 0, 'torch.indexSelect index unchanged')
+   mytester:assertError(function() torch.indexSelect(x, 1, torch.LongTensor{8}) end, 'torch.indexSelect out of range')
+   mytester:assertError(function() torch.indexSelect(x, 1, torch.LongTensor{{1}}) end, 'torch.indexSelect matrix index')
+   -- large rows (parallel)
+   local x = torch.rand(1000,300)
+   local idx = torch.LongTensor(500):random(1000)
+   local y = x:indexSelect(1, idx)
+   for j=1,500,37 do
+      mytester:asserteq(maxdiff(y[j], x[idx[j]]), 0, 'torch.indexSelect rows')
+   end
+end
+function torchtest.indexCopy()
+   for dim=1,3 do
+      local x = torch.rand(6,5,4)
+      local idx = torch.LongTensor{2,4,1}
+      local size = x:size(); size[dim] = 3
+      local src = torch.rand(size)
+      local y = x:clone():indexCopy(dim, idx, src)
+      local z = x:clone()
+      for j=1,3 do
+         z:select(dim, idx[j]):copy(src:select(dim, j))
+      end
+      mytester:asserteq(maxdiff(y, z), 0, 'torch.indexCopy value')
+      y = x:transpose(1,3):clone():transpose(1,3)
+      y:indexCopy(dim, idx, src:transpose(1,3):clone():transpose(1,3))
+      mytester:asserteq(maxdiff(y, z), 0, 'torch.indexCopy non-contiguous')
+   end
+   -- the last duplicate wins
+   local x = torch.zeros(3,2000):indexCopy(1, torch.LongTensor{2,2}, torch.Tensor{1,2}:resize(2,1):expand(2,2000):clone())
+   mytester:asserteq(x[2]:min(), 2, 'torch.indexCopy duplicates')
+   mytester:asserteq(x[1]:max(), 0, 'torch.indexCopy duplicates')
+   mytester:assertError(function() x:indexCopy(1, torch.LongTensor{1,2}, torch.Tensor(3,2000)) end, 'torch.indexCopy size')
+   mytester:assertError(function() x:indexCopy(1, torch.LongTensor{0}, torch.Tensor(1,2000)) end, 'torch.indexCopy out of range')
+end
+function torchtest.indexAdd()
+   for _,dim in ipairs{1,2} do
+      local x = torch.rand(500,400)
+      local idx = torch.LongTensor{3,1,3,3,7}
+      local size = x:size(); size[dim] = 5
+      local src = torch.rand(size)
+      local y = x:clone():indexAdd(dim, idx, src)
+      local z = x:clone()
+      for j=1,5 do
+         z:select(dim, idx[j]):add(src:select(dim, j))
+      end
+      mytester:assertlt(maxdiff(y, z), 1e-12, 'torch.indexAdd value')
+      y = x:t():clone():t():indexAdd(dim, idx, src)
+      mytester:assertlt(maxdiff(y, z), 1e-12, 'torch.indexAdd non-contiguous')
+   end
+end
+function torchtest.indexFill()
+   for dim=1,3 do
+      local x = torch.rand(6,5,4)
+      local idx = torch.LongTensor{2,4,2}
+      local z = x:clone()
+      for j=1,3 do
+         z:select(dim, idx[j]):fill(-1)
+      end
+      mytester:asserteq(maxdiff(x:clone():indexFill(dim, idx, -1), z), 0, 'torch.indexFill value')
+      mytester:asserteq(maxdiff(x:transpose(1,3):clone():transpose(1,3):indexFill(dim, idx, -1), z), 0, 'torch.indexFill non-contiguous')
+   end
+end
+function torchtest.gather()
+   local x = torch.rand(5,6,7)
+   for dim=1,3 do
+      local size = x:size(); size[dim] = 4
+      local idx = torch.LongTensor():resize(size):random(x:size(dim))
+      for _,src in ipairs{x, x:transpose(1,3):clone():transpose(1,3)} do
+         local y = torch.gather(src, dim, idx)
+         local z = torch.Tensor(size)
+         for i=1,size[1] do
+            for j=1,size[2] do
+               for k=1,size[3] do
+                  local c = {i,j,k}
+                  c[dim] = idx[i][j][k]
+                  z[i][j][k] = src[c[1]][c[2]][c[3]]
+               end
+            end
+         end
+         mytester:asserteq(maxdiff(y, z), 0, 'torch.gather value')
+      end
+   end
+   mytester:assertError(function() torch.gather(x, 1, torch.LongTensor(5,6,7):fill(6)) end, 'torch.gather out of range')
+   mytester:assertError(function() torch.gather(x, 1, torch.LongTensor(5,6,6):fill(1)) end, 'torch.gather size')
+end
+function torchtest.scatter()
+   for dim=1,3 do
+      local x = torch.rand(5,6,7)
+      local size = x:size(); size[dim] = 4
+      local idx = torch.LongTensor():resize(size)
+      -- a permutation along dim, so that scatter inverts gather
+      local perm = torch.randperm(x:size(dim)):narrow(1,1,4)
+      for i=1,4 do
+         idx:select(dim, i):fill(perm[i])
+      end
+      local src = torch.rand(size)
+      local y = x:clone():scatter(dim, idx, src)
+      mytester:asserteq(maxdiff(torch.gather(y, dim, idx), src), 0, 'torch.scatter value')
+      local z = x:clone():indexCopy(dim, perm:long(), src)
+      mytester:asserteq(maxdiff(y, z), 0, 'torch.scatter indexCopy')
+   end
+   local x = torch.zeros(3,4)
+   mytester:assertError(function() x:scatter(2, torch.LongTensor(3,2):fill(5), torch.Tensor(3,2)) end, 'torch.scatter out of range')
+   mytester:assertError(function() x:scatter(2, torch.LongTensor(3,2):fill(1), torch.Tensor(3,3)) end, 'torch.scatter size')
 end
 function torchtest.tril()
    local x = torch.rand(msize,msize)
@@ -160,6 +448,17 @@ function torchtest.cat()
    torch.cat(mxx,x,y,1)
    mytester:asserteq(maxdiff(mx,mxx),0,'torch.cat value')
 end
+function torchtest.isSetTo()
+   local x = torch.rand(msize,msize)
+   local y = torch.Tensor():set(x)
+   mytester:assert(y:isSetTo(x), 'torch.isSetTo same view')
+   mytester:assert(not x:clone():isSetTo(x), 'torch.isSetTo copy')
+   mytester:assert(not x:narrow(1,2,msize-1):isSetTo(x), 'torch.isSetTo offset')
+   mytester:assert(not x:t():isSetTo(x), 'torch.isSetTo strides')
+   mytester:assert(x:narrow(2,1,3):isSetTo(y:narrow(2,1,3)), 'torch.isSetTo narrow')
+   y:resize(msize*msize)
+   mytester:assert(not y:isSetTo(x), 'torch.isSetTo resized')
+end
 function torchtest.sin()
    local x = torch.rand(msize,msize,msize)
    local mx = torch.sin(x)
@@ -167,6 +466,516 @@ function torchtest.sin()
    torch.sin(mxx,x)
    mytester:asserteq(maxdiff(mx,mxx),0,'torch.sin value')
 end
+function torchtest.parallelApply()
+   local nthread = torch.getnumthreads()
+   local threshold = torch.getparallelthreshold()
+   local x = torch.rand(37,53,msize):transpose(1,3)
+   local y = torch.rand(msize,53,37)
+   local z = torch.rand(msize,37*53):narrow(2,3,53*37-5)
+   local function ops()
+      local r = {}
+      r.add = torch.add(x,y)
+      r.cmul = torch.cmul(x,y)
+      r.addcdiv = torch.addcdiv(x,0.5,y,torch.add(x,1))
+      r.sin = torch.sin(x)
+      r.pow = torch.pow(y,3)
+      r.copy = torch.Tensor(msize,53,37):copy(x)
+      r.fill = z:clone():fill(3):narrow(2,1,37)
+      r.mul = torch.mul(z,2)
+      r.sign = torch.sign(torch.add(x,-0.5))
+      r.lt = torch.lt(x,y):double()
+      return r
+   end
+   torch.setnumthreads(1)
+   local serial = ops()
+   torch.setnumthreads(math.max(nthread,4))
+   torch.setparallelthreshold(1000)
+   local parallel = ops()
+   torch.setnumthreads(nthread)
+   torch.setparallelthreshold(threshold)
+   for name,res in pairs(serial) do
+      mytester:asserteq(maxdiff(res,parallel[name]),0,'parallel apply ' .. name)
+   end
+end
+function torchtest.simd()
+   local current = torch.getsimd()
+   local function ops(ttype, n)
+      torch.manualSeed(123)
+      local x = torch.rand(n):type(ttype)
+      local y = torch.rand(n):add(0.5):type(ttype)
+      local r = {}
+      r.cmul = torch.cmul(x,y)
+      r.cdiv = torch.cdiv(x,y)
+      r.add = x:clone():add(3,y)
+      r.fill = torch.Tensor(n):type(ttype):fill(7)
+      r.sum = x:sum()
+      r.max = x:max()
+      r.min = x:min()
+      r.dot = x:dot(y)
+      return r
+   end
+   for _,ttype in ipairs{'torch.FloatTensor', 'torch.DoubleTensor'} do
+      for _,n in ipairs{1, 7, 33, 1031, 5000} do
+         torch.setsimd('default')
+         local ref = ops(ttype, n)
+         for _,simd in ipairs{'sse2', 'avx', 'avx2', 'avx512'} do
+            torch.setsimd(simd)
+            local res = ops(ttype, n)
+            for name,val in pairs(ref) do
+               local msg = string.format('%s %s n=%d (%s)', name, ttype, n, torch.getsimd())
+               if type(val) ~= "number" then
+                  mytester:assertlt(maxdiff(val,res[name]),1e-5,msg)
+               else
+                  mytester:assertlt(math.abs(val-res[name]),1e-3,msg)
+               end
+            end
+         end
+      end
+   end
+   torch.setsimd(current)
+end
+function torchtest.mathmode()
+   local simd, mode = torch.getsimd(), torch.getmathmode()
+   local funcs = {exp = {-20, 20}, log = {1e-3, 100}, log1p = {-0.9, 100},
+                  tanh = {-10, 10}, sigmoid = {-20, 20}}
+   local special = {1/0, -1/0, 0/0, 0, -1, -2, 1e-30, -1e-30, 1e30, -1e30, 100, -100, 800, -800}
+   -- maximum relative error
+   local function relerr(x, ref)
+      local err = torch.add(x, -1, ref):abs():cdiv(torch.abs(ref):add(1e-300))
+      return err:max()
+   end
+   local function sameSpecial(x, ref)
+      for i=1,ref:nElement() do
+         local a, b = x[i], ref[i]
+         if (a ~= a) ~= (b ~= b) or (b == b and (math.abs(b) == 1/0 or b == 0) and a ~= b) then
+            return false
+         end
+      end
+      return true
+   end
+   for _,ttype in ipairs{'torch.FloatTensor', 'torch.DoubleTensor'} do
+      local tol = (ttype == 'torch.FloatTensor' and 1e-6 or 1e-14)
+      for name,range in pairs(funcs) do
+         for _,n in ipairs{1, 7, 33, 1031} do
+            local x = torch.rand(n):mul(range[2]-range[1]):add(range[1]):type(ttype)
+            local xs = torch.Tensor(special):type(ttype)
+            local xnc = torch.rand(n, 3):mul(range[2]-range[1]):add(range[1]):type(ttype):t()
+            torch.setmathmode('precise')
+            local ref, refs, refnc = torch[name](x), torch[name](xs), torch[name](xnc)
+            torch.setmathmode('fast')
+            for _,s in ipairs{'sse2', 'avx', 'avx2', 'avx512'} do
+               torch.setsimd(s)
+               local msg = string.format('%s %s n=%d (%s)', name, ttype, n, torch.getsimd())
+               mytester:assertlt(relerr(torch[name](x), ref), tol, msg)
+               mytester:assertlt(relerr(torch[name](xnc), refnc), tol, msg .. ' non-contiguous')
+               mytester:assert(sameSpecial(torch[name](xs), refs), msg .. ' special values')
+               local y = x:clone()
+               y[name](y)
+               mytester:assertlt(relerr(y, ref), tol, msg .. ' in place')
+            end
+            torch.setsimd(simd)
+         end
+      end
+   end
+   -- float sigmoid around the denormal range: relative error, plus at most one denormal
+   local x = torch.linspace(-104, -87, 1001):float()
+   torch.setmathmode('precise')
+   local ref = torch.sigmoid(x):double()
+   torch.setmathmode('fast')
+   for _,s in ipairs{'sse2', 'avx', 'avx2', 'avx512'} do
+      torch.setsimd(s)
+      local err = torch.sigmoid(x):double():add(-1, ref):abs()
+      mytester:assertle(err:add(-1e-6, ref):max(), 2^-149, 'sigmoid denormals (' .. torch.getsimd() .. ')')
+   end
+   torch.setsimd(simd)
+   mytester:asserteq(torch.setmathmode('precise'), 'precise', 'setmathmode')
+   mytester:asserteq(torch.getmathmode(), 'precise', 'getmathmode')
+   torch.setmathmode(mode)
+end
+function torchtest.gemm()
+   local current = torch.getgemm()
+   local nthread = torch.getnumthreads()
+   torch.setnumthreads(math.max(nthread,4))
+   -- integer values: the products are exact, whatever the summation order
+   for _,ttype in ipairs{'torch.FloatTensor', 'torch.DoubleTensor', 'torch.LongTensor'} do
+      for _,sz in ipairs{{1,1,1}, {7,13,5}, {33,65,129}, {130,70,300}} do
+         local m, n, k = sz[1], sz[2], sz[3]
+         local a = torch.rand(m,k):mul(10):floor():type(ttype)
+         local at = torch.rand(k,m):mul(10):floor():type(ttype):t()
+         local b = torch.rand(k,n):mul(10):floor():type(ttype)
+         local bt = torch.rand(n,k):mul(10):floor():type(ttype):t()
+         local c = torch.rand(m,n):mul(10):floor():type(ttype)
+         for _,ab in ipairs{{a,b}, {at,b}, {a,bt}, {at,bt}} do
+            torch.setgemm('reference')
+            local ref = torch.addmm(2, c, 3, ab[1], ab[2])
+            for _,gemm in ipairs{'builtin', 'blas'} do
+               torch.setgemm(gemm)
+               local res = torch.addmm(2, c, 3, ab[1], ab[2])
+               mytester:asserteq(maxdiff(ref,res), 0,
+                                 string.format('gemm %s %dx%dx%d (%s)', ttype, m, n, k, gemm))
+            end
+         end
+      end
+   end
+   torch.setnumthreads(nthread)
+   torch.setgemm(current)
+end
+function torchtest.bmm()
+   local nthread = torch.getnumthreads()
+   torch.setnumthreads(math.max(nthread,4))
+   for _,sz in ipairs{{1,1,1,1}, {5,7,13,3}, {20,33,17,65}} do
+      local bs, m, n, k = sz[1], sz[2], sz[3], sz[4]
+      local b1 = torch.rand(bs,m,k)
+      local b1t = torch.rand(bs,k,m):transpose(2,3)
+      local b1nc = torch.rand(bs,m,2*k):narrow(3,1,k)
+      local b2 = torch.rand(bs,k,n)
+      local b2t = torch.rand(bs,n,k):transpose(2,3)
+      local b2nc = torch.rand(bs,k,n,2):select(4,1)
+      local c = torch.rand(bs,m,n)
+      for _,bb in ipairs{{b1,b2}, {b1t,b2}, {b1,b2t}, {b1t,b2t}, {b1nc,b2nc}} do
+         local mx = torch.bmm(bb[1], bb[2])
+         local mxa = torch.baddbmm(2, c, 3, bb[1], bb[2])
+         local mxt = torch.Tensor(bs,n,m):transpose(2,3)
+         mxt:baddbmm(0, mxt, 1, bb[1], bb[2])
+         local err, erra, errt = 0, 0, 0
+         for i=1,bs do
+            local ref = torch.mm(bb[1][i], bb[2][i])
+            err = math.max(err, maxdiff(mx[i], ref))
+            erra = math.max(erra, maxdiff(mxa[i], torch.addmm(2, c[i], 3, bb[1][i], bb[2][i])))
+            errt = math.max(errt, maxdiff(mxt[i], ref))
+         end
+         mytester:assertlt(err, 1e-10, string.format('bmm %dx%dx%dx%d', bs, m, n, k))
+         mytester:assertlt(erra, 1e-10, string.format('baddbmm %dx%dx%dx%d', bs, m, n, k))
+         mytester:assertlt(errt, 1e-10, string.format('baddbmm transposed result %dx%dx%dx%d', bs, m, n, k))
+      end
+   end
+   -- in place, with the method form
+   local c = torch.rand(4,3,5)
+   local a = torch.rand(4,3,2)
+   local b = torch.rand(4,2,5)
+   local ref = torch.baddbmm(c, a, b)
+   c:baddbmm(a, b)
+   mytester:assertlt(maxdiff(c, ref), 1e-10, 'baddbmm in place')
+   torch.setnumthreads(nthread)
+end
+function torchtest.allocator()
+   local name, options = torch.getallocator()
+   for _,allocator in ipairs{'system', 'caching'} do
+      torch.setallocator(allocator)
+      collectgarbage()
+      local before = torch.allocatorstats(true).allocated
+      local x = torch.DoubleTensor(1000000):fill(1)
+      local stats = torch.allocatorstats()
+      mytester:assertge(stats.allocated - before, 8000000, 'allocated bytes (' .. allocator .. ')')
+      mytester:assertge(stats.peak, stats.allocated, 'peak bytes (' .. allocator .. ')')
+      -- resized with the other allocator: goes back to its own allocator
+      torch.setallocator(allocator == 'system' and 'caching' or 'system')
+      x:resize(2000000):narrow(1,1000001,1000000):fill(2)
+      mytester:asserteq(x:sum(), 3000000, 'resize across allocators (' .. allocator .. ')')
+      x = nil
+      collectgarbage()
+      mytester:assertle(torch.allocatorstats().allocated, before, 'freed bytes (' .. allocator .. ')')
+   end
+   torch.setallocator('caching', {hugepages=true})
+   local x = torch.FloatTensor(3000000):fill(1)
+   mytester:asserteq(x:sum(), 3000000, 'huge pages')
+   local cached = torch.allocatorstats().cached
+   x = nil
+   collectgarbage()
+   mytester:assertgt(torch.allocatorstats().cached, cached, 'cached bytes')
+   torch.emptycache()
+   mytester:assertle(torch.allocatorstats().cached, cached, 'empty cache')
+   torch.setallocator('caching', {maxcached=0})
+   local y = torch.FloatTensor(3000000)
+   y = nil
+   collectgarbage()
+   mytester:assertle(torch.allocatorstats().cached, cached, 'no caching')
+   torch.setallocator(name, options)
+end
+function torchtest.memorystats()
+   collectgarbage()
+   torch.resetmemorystats()
+   local before = torch.memorystats()
+   local x = torch.FloatTensor(1000)
+   local y = torch.ShortStorage(10)
+   local stats = torch.memorystats()
+   mytester:asserteq(stats.Float.live - before.Float.live, 4000, 'Float live bytes')
+   mytester:asserteq(stats.Short.live - before.Short.live, 20, 'Short live bytes')
+   mytester:asserteq(stats.live - before.live, 4020, 'live bytes')
+   x:resize(2000)
+   mytester:asserteq(torch.memorystats().Float.live - before.Float.live, 8000, 'live bytes after resize')
+   x = nil
+   y = nil
+   collectgarbage()
+   stats = torch.memorystats()
+   mytester:asserteq(stats.live, before.live, 'live bytes after free')
+   -- (temporary size storages count as well)
+   mytester:assertge(stats.peak - before.live, 8020, 'peak bytes')
+   torch.resetmemorystats()
+   mytester:asserteq(torch.memorystats().peak, stats.live, 'peak bytes after reset')
+
+   local calls = {}
+   torch.setmemorythreshold(stats.live + 10000, function(live, threshold) table.insert(calls, live) end)
+   local z1 = torch.DoubleTensor(1000)
+   mytester:asserteq(#calls, 0, 'hook below threshold')
+   local z2 = torch.DoubleTensor(1000)
+   mytester:asserteq(#calls, 1, 'hook crossing threshold')
+   mytester:assertge(calls[1], stats.live + 10000, 'hook live bytes')
+   local z3 = torch.DoubleTensor(1000)
+   mytester:asserteq(#calls, 1, 'hook above threshold')
+   torch.setmemorythreshold()
+
+   -- set from a coroutine, which is collected before the hook runs
+   z1, z2, z3 = nil, nil, nil
+   collectgarbage()
+   calls = {}
+   coroutine.wrap(function()
+                     torch.setmemorythreshold(torch.memorystats().live + 10000,
+                                              function(live, threshold) table.insert(calls, live) end)
+                  end)()
+   collectgarbage()
+   z1 = torch.DoubleTensor(2000)
+   mytester:asserteq(#calls, 1, 'hook set from a coroutine')
+   torch.setmemorythreshold()
+end
+function torchtest.loadMmap()
+   local filename = os.tmpname()
+   local x = torch.rand(100, 100)
+   local obj = {x = x, y = x:narrow(1, 11, 10), z = torch.IntTensor(10000):fill(3),
+                small = torch.FloatTensor{1, 2, 3}, name = 'mmap'}
+   torch.save(filename, obj)
+   local loaded = torch.load(filename, 'mmap')
+   mytester:asserteq(maxdiff(loaded.x, x), 0, 'mapped tensor')
+   mytester:asserteq(maxdiff(loaded.y, obj.y), 0, 'mapped narrowed tensor')
+   mytester:asserteq(torch.pointer(loaded.x:storage()), torch.pointer(loaded.y:storage()), 'shared mapped storage')
+   mytester:asserteq(loaded.z:sum(), 30000, 'mapped int tensor')
+   mytester:asserteq(maxdiff(loaded.small, obj.small), 0, 'small tensor')
+   mytester:asserteq(loaded.name, 'mmap', 'string')
+   -- modifications are private
+   loaded.x:fill(1)
+   mytester:asserteq(maxdiff(torch.load(filename, 'mmap').x, x), 0, 'private mapping')
+   mytester:asserteq(maxdiff(torch.load(filename).x, x), 0, 'read after mapping')
+   -- resizing copies the data out of the mapping
+   local r = torch.range(1, 10000)
+   torch.save(filename, r)
+   local rm = torch.load(filename, 'mmap')
+   rm:resize(20000)
+   mytester:asserteq(rm:storage():size(), 20000, 'resized mapped storage')
+   mytester:asserteq(maxdiff(rm:narrow(1, 1, 10000), r), 0, 'data of a resized mapped storage')
+   rm:fill(0)
+   mytester:asserteq(rm:sum(), 0, 'fill of a resized mapped storage')
+   rm:resize(10)
+   mytester:asserteq(rm:storage():size(), 20000, 'storage kept when shrinking the tensor')
+   rm = torch.load(filename, 'mmap')
+   rm:storage():resize(100)
+   mytester:asserteq(maxdiff(torch.Tensor(rm:storage()), torch.range(1, 100)), 0, 'shrunk mapped storage')
+   mytester:asserteq(maxdiff(torch.load(filename), r), 0, 'file unchanged by resizing')
+   loaded = nil
+   collectgarbage()
+   local file = torch.DiskFile(filename, 'r'):binary():mmap()
+   mytester:assert(file:isMmap(), 'isMmap')
+   file:ascii()
+   mytester:assert(not file:isMmap(), 'ascii files are not mapped')
+   file:close()
+   os.remove(filename)
+end
+function torchtest.saveAligned()
+   local filename = os.tmpname()
+   local x = torch.rand(100, 100)
+   local obj = {x = x, y = x:narrow(1, 11, 10), z = torch.IntTensor(1000):fill(3), name = 'aligned'}
+   for _,alignment in ipairs{4096, 64} do
+      torch.save(filename, obj, 'aligned', alignment)
+      for _,mode in ipairs{'binary', 'mmap'} do
+         local loaded = torch.load(filename, mode)
+         mytester:asserteq(maxdiff(loaded.x, x), 0, 'aligned tensor (' .. mode .. ')')
+         mytester:asserteq(maxdiff(loaded.y, obj.y), 0, 'aligned narrowed tensor (' .. mode .. ')')
+         mytester:asserteq(loaded.z:sum(), 3000, 'aligned int tensor (' .. mode .. ')')
+         mytester:asserteq(loaded.name, 'aligned', 'string (' .. mode .. ')')
+      end
+      local file = torch.DiskFile(filename, 'r'):binary()
+      local toc = file:readTableOfContents()
+      mytester:asserteq(#toc, 2, 'table of contents size')
+      for _,entry in ipairs(toc) do
+         mytester:asserteq((entry.position-1) % alignment, 0, 'aligned position')
+      end
+      local entry = toc[1].typename == 'torch.DoubleStorage' and toc[1] or toc[2]
+      mytester:asserteq(entry.typename, 'torch.DoubleStorage', 'table of contents type')
+      mytester:asserteq(entry.size, 10000, 'table of contents storage size')
+      file:seek(entry.position)
+      mytester:asserteq(maxdiff(torch.DoubleTensor(file:readDouble(entry.size)), torch.DoubleTensor(x:storage())), 0,
+                        'data at table of contents position')
+      file:close()
+   end
+   -- the default format is still read, and has no table of contents
+   torch.save(filename, obj)
+   mytester:asserteq(maxdiff(torch.load(filename).x, x), 0, 'default format')
+   local file = torch.DiskFile(filename, 'r'):binary()
+   mytester:asserteq(file:readTableOfContents(), nil, 'no table of contents')
+   file:close()
+   os.remove(filename)
+end
+function torchtest.open()
+   local filename = os.tmpname()
+   local big = torch.rand(1000, 1000)
+   local bias = torch.rand(10)
+   local obj = {modules = {{weight = big, bias = bias}, {weight = big:narrow(1, 1, 10)}},
+                shared = bias, name = 'net', size = 3, f = function() return bias:size(1) end}
+   for _,format in ipairs{'binary', 'aligned'} do
+      torch.save(filename, obj, format)
+      collectgarbage()
+      local before = torch.memorystats().live
+      local reader = torch.open(filename)
+      mytester:assertlt(torch.memorystats().live - before, 100000, 'nothing read when opening (' .. format .. ')')
+      mytester:asserteq(reader:typename('modules.1.weight'), 'torch.DoubleTensor', 'typename (' .. format .. ')')
+      mytester:asserteq(reader:size('modules.1.weight')[2], 1000, 'size (' .. format .. ')')
+      mytester:asserteq(#reader:keys('modules'), 2, 'keys (' .. format .. ')')
+      mytester:asserteq(reader:get('name'), 'net', 'string (' .. format .. ')')
+      mytester:asserteq(reader:get('size'), 3, 'number (' .. format .. ')')
+      local b = reader:get('modules.1.bias')
+      mytester:asserteq(maxdiff(b, bias), 0, 'tensor (' .. format .. ')')
+      mytester:assertlt(torch.memorystats().live - before, 100000, 'only the requested tensor is read (' .. format .. ')')
+      mytester:asserteq(torch.pointer(reader:get('shared')), torch.pointer(b), 'shared tensor (' .. format .. ')')
+      local w = reader:get('modules.2.weight')
+      mytester:asserteq(maxdiff(w, big:narrow(1, 1, 10)), 0, 'narrowed tensor (' .. format .. ')')
+      mytester:asserteq(torch.pointer(reader:get('modules.1.weight'):storage()), torch.pointer(w:storage()),
+                        'shared storage (' .. format .. ')')
+      mytester:asserteq(reader:get('f')(), 10, 'function (' .. format .. ')')
+      local all = reader:get()
+      mytester:asserteq(torch.pointer(all.modules[1].bias), torch.pointer(b), 'whole object (' .. format .. ')')
+      mytester:asserteq(maxdiff(all.modules[1].weight, big), 0, 'whole object tensor (' .. format .. ')')
+      reader:close()
+   end
+   os.remove(filename)
+end
+function torchtest.applyManyDims()
+   -- more dimensions than the apply counters kept on the stack
+   local size = torch.LongStorage(20):fill(1)
+   size[19] = 7
+   size[20] = 5
+   local x = torch.rand(size):transpose(19,20)
+   local y = torch.rand(size):transpose(19,20)
+   local mx = torch.add(x,y)
+   local mxx = torch.add(x:contiguous(),y:contiguous())
+   mytester:asserteq(maxdiff(mx,mxx),0,'apply with many dimensions')
+   mytester:assert(math.abs(x:sum()-x:contiguous():sum()) < 1e-10,'apply with many dimensions (sum)')
+end
+function torchtest.tensorDims()
+   -- sizes and strides are kept in the tensor up to 4 dimensions, and
+   -- allocated beyond: views going from one case to the other
+   local x = torch.rand(3,4,5,6)
+   local u = x:unfold(4,2,2)
+   mytester:asserteq(u:dim(), 5, 'unfold to 5 dimensions')
+   mytester:asserteq(u:size(4), 3, 'unfold size')
+   mytester:asserteq(u[{2,3,4,3,2}], x[{2,3,4,6}], 'unfold element')
+   local v = u:select(5,1)
+   mytester:asserteq(v:dim(), 4, 'select back to 4 dimensions')
+   mytester:asserteq(maxdiff(v, x:indexSelect(4, torch.LongTensor{1,3,5})), 0, 'select after unfold')
+   local w = torch.Tensor(2,1,3,1,4,1,5)
+   mytester:asserteq(w:stride(1), 60, 'stride with 7 dimensions')
+   w = w:squeeze()
+   mytester:asserteq(w:dim(), 4, 'squeeze to 4 dimensions')
+   mytester:asserteq(w:stride(1), 60, 'stride after squeeze')
+   w:resize(2,3,4,5,1,2)
+   mytester:asserteq(w:stride(5), 2, 'resize to 6 dimensions')
+   w:resize(7)
+   mytester:asserteq(w:dim(), 1, 'resize to 1 dimension')
+   -- serialization, on both sides of the limit
+   for _,y in ipairs{x, u, torch.rand(2,3,2,3,2,3)} do
+      local f = torch.MemoryFile():binary()
+      f:writeObject(y)
+      f:seek(1)
+      local z = f:readObject()
+      f:close()
+      mytester:asserteq(z:dim(), y:dim(), 'serialized dimensions')
+      for d=1,y:dim() do
+         mytester:asserteq(z:size(d), y:size(d), 'serialized size')
+      end
+      mytester:asserteq(maxdiff(z, y), 0, 'serialized tensor')
+   end
+end
+function torchtest.applyMap()
+   -- elements are visited in order, whatever the strides
+   for _,x in ipairs{torch.Tensor(4,5), torch.Tensor(5,4):t(), torch.Tensor(4,10):narrow(2,3,5)} do
+      local i = 0
+      x:apply(function() i = i + 1; return i end)
+      mytester:asserteq(maxdiff(x, torch.range(1,20):resize(4,5)), 0, 'apply order')
+      local s = 0
+      x:apply(function(v) s = s + v end)
+      mytester:asserteq(s, 210, 'apply without result')
+      local y = torch.range(1,20):resize(5,4):t()
+      x:map(y, function(a, b) return a - b end)
+      mytester:asserteq(maxdiff(x, torch.range(1,20):resize(4,5) - torch.range(1,20):resize(5,4):t()), 0, 'map')
+      x:map2(y, torch.ones(20), function(a, b, c) return b + c end)
+      mytester:asserteq(maxdiff(x, y + 1), 0, 'map2')
+   end
+   -- integer types, and sizes which only match in number of elements
+   local x = torch.LongTensor(3,4):fill(2^40)
+   local y = torch.LongTensor(12):fill(3)
+   x:t():map(y, function(a, b) return a + b end)
+   mytester:asserteq(x:max(), 2^40 + 3, 'map long')
+   mytester:asserteq(x:min(), 2^40 + 3, 'map long')
+   local z = torch.LongTensor(2,6):t():map2(x, y, function(c, a, b) return a - b end)
+   mytester:asserteq(z:max(), 2^40, 'map2 long')
+   local b = torch.ByteTensor(12):fill(250):apply(function(v) return v + 3 end)
+   mytester:asserteq(b:min(), 253, 'apply byte')
+   mytester:assertError(function() x:apply(function() return 'a' end) end, 'apply bad result')
+   mytester:assertError(function() x:map(torch.LongTensor(5), function(a, b) return b end) end, 'map size')
+   mytester:assertError(function() x:map(torch.IntTensor(12), function(a, b) return b end) end, 'map type')
+end
+function torchtest.lazy()
+   local x = torch.rand(20,30)
+   local y = torch.rand(30,20):t()
+   local z = torch.rand(20,40):narrow(2,6,30)
+   -- arithmetic gives exactly the eager results
+   local e = x:lazy():add(2, y):cmul(z):addcmul(0.5, y, z):addcdiv(x, z):div(3) - y
+   local ref = x:clone():add(2, y):cmul(z):addcmul(0.5, y, z):addcdiv(x, z):div(3):add(-1, y)
+   mytester:asserteq(maxdiff(e:eval(), ref), 0, 'lazy arithmetic')
+   mytester:asserteq(#e.operands, 3, 'lazy operands shared')
+   -- into a non-contiguous result, which may be an operand
+   local res = torch.Tensor(30,20):t()
+   e:eval(res)
+   mytester:asserteq(maxdiff(res, ref), 0, 'lazy non-contiguous result')
+   local yy = y:clone()
+   y:lazy():mul(2):add(x):eval(y)
+   mytester:asserteq(maxdiff(y, yy*2 + x), 0, 'lazy result operand')
+   -- operands are read when evaluating
+   local w = torch.zeros(20,30)
+   local f = torch.lazy(w):add(1):tanh()
+   w:fill(1)
+   mytester:assertlt(maxdiff(f:eval(), torch.Tensor(20,30):fill(math.tanh(2))), 1e-12, 'lazy late read')
+   -- unary functions
+   local u = torch.rand(20,30):mul(0.9):add(0.05)
+   for _,name in ipairs{'abs', 'exp', 'log', 'log1p', 'sqrt', 'tanh', 'sigmoid', 'cos', 'acos', 'cosh',
+                        'sin', 'asin', 'sinh', 'tan', 'atan', 'ceil', 'floor', 'sign'} do
+      mytester:assertlt(maxdiff(u:lazy()[name](u:lazy()):eval(), torch[name](u)), 1e-12, 'lazy ' .. name)
+   end
+   mytester:asserteq(maxdiff((-u:lazy()):eval(), -u), 0, 'lazy neg')
+   -- same kernels as the tensor functions, on contiguous tensors or not
+   local ut = torch.rand(30,20):mul(0.9):add(0.05):t()
+   for _,name in ipairs{'exp', 'log', 'log1p', 'tanh', 'sigmoid'} do
+      mytester:asserteq(maxdiff(u:lazy()[name](u:lazy()):eval(), torch[name](u)), 0, 'lazy exact ' .. name)
+      mytester:asserteq(maxdiff(ut:lazy()[name](ut:lazy()):eval(), torch[name](ut)), 0, 'lazy exact non-contiguous ' .. name)
+   end
+   mytester:assertlt(maxdiff(u:lazy():pow(3):atan2(x):eval(), torch.atan2(torch.pow(u, 3), x)), 1e-12, 'lazy pow atan2')
+   -- deep expressions, through the L1 blocks and threads
+   local big = torch.rand(1000,1001)
+   local g = big:lazy()
+   local gref = big:clone()
+   for i=1,20 do
+      g = g:mul(0.5):add(big)
+      gref:mul(0.5):add(big)
+   end
+   mytester:asserteq(maxdiff(g:eval(), gref), 0, 'lazy long expression')
+   -- integer types
+   local a = torch.LongTensor(5,6):fill(2^40)
+   local b = torch.LongTensor(6,5):fill(3):t()
+   local c = (a:lazy():cmul(b) - a):div(2):eval()
+   mytester:asserteq(c:min(), 2^40, 'lazy long')
+   mytester:asserteq(c:max(), 2^40, 'lazy long')
+   mytester:assertError(function() a:lazy():exp():eval() end, 'lazy float only function')
+   mytester:assertError(function() a:lazy():add(torch.IntTensor(5,6)) end, 'lazy type')
+   mytester:assertError(function() x:lazy():add(torch.rand(7)):eval() end, 'lazy size')
+end
 function torchtest.linspace()
    local from = math.random()
    local to = from+math.random()
@@ -203,6 +1012,72 @@ function torchtest.randn()
    torch.randn(mxx,msize,msize)
    mytester:asserteq(maxdiff(mx,mxx),0,'torch.randn value')
 end
+function torchtest.generator()
+   -- generators are independent from each other and from the default one
+   local g1, g2 = torch.Generator(), torch.Generator()
+   torch.manualSeed(g1, 123)
+   torch.manualSeed(g2, 123)
+   mytester:asserteq(torch.initialSeed(g1), 123, 'generator initial seed')
+   torch.manualSeed(123)
+   local x = torch.rand(g1, msize)
+   local d = torch.rand(msize)
+   mytester:asserteq(maxdiff(torch.rand(g2, msize), x), 0, 'independent generators')
+   mytester:asserteq(maxdiff(d, x), 0, 'default generator')
+   torch.manualSeed(g1, 123)
+   mytester:asserteq(maxdiff(torch.Tensor(msize):uniform(g1), x), 0, 'generator manualSeed')
+
+   -- tensors are filled in blocks, with the same numbers as one by one
+   for _,f in ipairs{{'uniform', -1, 1}, {'normal', 2, 3}, {'exponential', 2}} do
+      torch.manualSeed(g1, 5)
+      local x = torch.Tensor(517, 3):t()
+      x[f[1]](x, g1, unpack(f, 2))
+      torch.manualSeed(g1, 5)
+      local y = torch.Tensor(3, 517)
+      y:apply(function() return torch[f[1]](g1, unpack(f, 2)) end)
+      mytester:assertlt(maxdiff(x, y), 1e-12, 'bulk ' .. f[1])
+   end
+
+   -- a philox stream does not depend on the strides, nor on the number of threads
+   local nthread = torch.getnumthreads()
+   local threshold = torch.getparallelthreshold()
+   local gen = torch.Generator('philox')
+   local function fill(f, nthread, contiguous)
+      torch.setnumthreads(nthread)
+      torch.setparallelthreshold(1000)
+      torch.manualSeed(gen, 42)
+      local x = contiguous and torch.Tensor(msize, 517) or torch.Tensor(517, msize):t()
+      x[f[1]](x, gen, unpack(f, 2))
+      return x
+   end
+   for _,f in ipairs{{'uniform', -1, 1}, {'normal', 2, 3}, {'bernoulli', 0.3},
+                     {'random'}, {'geometric', 0.5}, {'exponential', 2},
+                     {'cauchy', 0, 1}, {'logNormal', 1, 2}} do
+      local x = fill(f, 1, true)
+      mytester:asserteq(maxdiff(fill(f, math.max(nthread, 4), true), x), 0, 'philox ' .. f[1] .. ' threads')
+      mytester:asserteq(maxdiff(fill(f, 1, false), x), 0, 'philox ' .. f[1] .. ' strides')
+   end
+
+   -- consecutive fills continue the stream
+   torch.manualSeed(gen, 7)
+   local x = torch.Tensor(2*msize):normal(gen)
+   torch.manualSeed(gen, 7)
+   local y = torch.Tensor(2*msize)
+   y:narrow(1, 1, msize):normal(gen)
+   y:narrow(1, msize+1, msize):normal(gen)
+   mytester:asserteq(maxdiff(x, y), 0, 'philox consecutive fills')
+
+   -- moments
+   local x = torch.randn(gen, 100000)
+   mytester:assertlt(math.abs(x:mean()), 0.02, 'philox normal mean')
+   mytester:assertlt(math.abs(x:std()-1), 0.02, 'philox normal stdv')
+   x:uniform(gen)
+   mytester:assertlt(math.abs(x:mean()-0.5), 0.01, 'philox uniform mean')
+   mytester:assert(x:min() >= 0 and x:max() < 1, 'philox uniform range')
+   mytester:assertlt(math.abs(x:bernoulli(gen, 0.3):mean()-0.3), 0.01, 'philox bernoulli mean')
+
+   torch.setnumthreads(nthread)
+   torch.setparallelthreshold(threshold)
+end
 function torchtest.gesv()
    if not torch.gesv then return end
    local a=torch.Tensor({{6.80, -2.11,  5.66,  5.97,  8.23},
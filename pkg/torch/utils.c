@@ -3,10 +3,6 @@
 
 #include <sys/time.h>
 
-#ifdef _OPENMP
-#include <omp.h>
-#endif
-
 THLongStorage* torch_checklongargs(lua_State *L, int index)
 {
   THLongStorage *storage;
@@ -139,20 +135,196 @@ const char* torch_getdefaulttensortype(lua_State *L)
 
 static int torch_getnumthreads(lua_State *L)
 {
-#ifdef _OPENMP
-  lua_pushinteger(L, omp_get_max_threads());
-#else
-  lua_pushinteger(L, 1);
-#endif
+  lua_pushinteger(L, THGetNumThreads());
   return 1;
 }
 
 static int torch_setnumthreads(lua_State *L)
 {
   int nth = luaL_checkint(L,1);
-#ifdef _OPENMP
-  omp_set_num_threads(nth);
-#endif
+  luaL_argcheck(L, nth > 0, 1, "positive number expected");
+  THSetNumThreads(nth);
+  return 0;
+}
+
+static int torch_getparallelthreshold(lua_State *L)
+{
+  lua_pushnumber(L, THGetParallelThreshold());
+  return 1;
+}
+
+static int torch_setparallelthreshold(lua_State *L)
+{
+  long threshold = (long)luaL_checknumber(L,1);
+  luaL_argcheck(L, threshold > 0, 1, "positive number expected");
+  THSetParallelThreshold(threshold);
+  return 0;
+}
+
+static int torch_getsimd(lua_State *L)
+{
+  lua_pushstring(L, THVector_SIMDName(THVector_getSIMD()));
+  lua_pushstring(L, THVector_SIMDName(THVector_getSIMDSupported()));
+  return 2;
+}
+
+static int torch_setsimd(lua_State *L)
+{
+  static const char *names[] = {"default", "sse2", "avx", "avx2", "avx512", NULL};
+  int simd = luaL_checkoption(L, 1, NULL, names);
+  lua_pushstring(L, THVector_SIMDName(THVector_setSIMD(simd)));
+  return 1;
+}
+
+static const char *torch_mathmode_names[] = {"precise", "fast", NULL};
+
+static int torch_getmathmode(lua_State *L)
+{
+  lua_pushstring(L, torch_mathmode_names[THVector_getFastMath()]);
+  return 1;
+}
+
+static int torch_setmathmode(lua_State *L)
+{
+  THVector_setFastMath(luaL_checkoption(L, 1, NULL, torch_mathmode_names));
+  lua_pushstring(L, torch_mathmode_names[THVector_getFastMath()]);
+  return 1;
+}
+
+static const char *torch_gemm_names[] = {"blas", "builtin", "reference", NULL};
+
+static int torch_getgemm(lua_State *L)
+{
+  lua_pushstring(L, torch_gemm_names[THBlas_getGemmMode()]);
+  return 1;
+}
+
+static int torch_setgemm(lua_State *L)
+{
+  THBlas_setGemmMode(luaL_checkoption(L, 1, NULL, torch_gemm_names));
+  lua_pushstring(L, torch_gemm_names[THBlas_getGemmMode()]);
+  return 1;
+}
+
+static int torch_getallocator(lua_State *L)
+{
+  lua_pushstring(L, THAllocator_get()->name);
+  lua_newtable(L);
+  lua_pushnumber(L, THCachingAllocator_getMaxCached());
+  lua_setfield(L, -2, "maxcached");
+  lua_pushboolean(L, THCachingAllocator_getHugePages());
+  lua_setfield(L, -2, "hugepages");
+  return 2;
+}
+
+static int torch_setallocator(lua_State *L)
+{
+  static const char *names[] = {"caching", "system", NULL};
+  int allocator = luaL_checkoption(L, 1, "caching", names);
+
+  if(!lua_isnoneornil(L, 2))
+  {
+    luaL_checktype(L, 2, LUA_TTABLE);
+    lua_getfield(L, 2, "maxcached");
+    if(!lua_isnil(L, -1))
+      THCachingAllocator_setMaxCached((long)luaL_checknumber(L, -1));
+    lua_pop(L, 1);
+    lua_getfield(L, 2, "hugepages");
+    if(!lua_isnil(L, -1))
+      THCachingAllocator_setHugePages(lua_toboolean(L, -1));
+    lua_pop(L, 1);
+  }
+
+  THAllocator_set(allocator == 0 ? &THCachingAllocator : &THSystemAllocator);
+  return 0;
+}
+
+static int torch_allocatorstats(lua_State *L)
+{
+  THAllocatorStats stats;
+  THAllocator_getStats(&stats);
+  lua_newtable(L);
+  lua_pushnumber(L, stats.allocated);
+  lua_setfield(L, -2, "allocated");
+  lua_pushnumber(L, stats.peak);
+  lua_setfield(L, -2, "peak");
+  lua_pushnumber(L, stats.cached);
+  lua_setfield(L, -2, "cached");
+  if(lua_toboolean(L, 1))
+    THAllocator_resetPeak();
+  return 1;
+}
+
+static int torch_emptycache(lua_State *L)
+{
+  THAllocator_emptyCache();
+  return 0;
+}
+
+static int torch_memorystats(lua_State *L)
+{
+  THStorageMemoryStats stats;
+  int type;
+
+  THStorage_getMemoryStats(&stats);
+  lua_newtable(L);
+  lua_pushnumber(L, stats.live);
+  lua_setfield(L, -2, "live");
+  lua_pushnumber(L, stats.peak);
+  lua_setfield(L, -2, "peak");
+  for(type = 0; type < TH_STORAGE_NTYPES; type++)
+  {
+    lua_newtable(L);
+    lua_pushnumber(L, stats.typeLive[type]);
+    lua_setfield(L, -2, "live");
+    lua_pushnumber(L, stats.typePeak[type]);
+    lua_setfield(L, -2, "peak");
+    lua_setfield(L, -2, THStorage_typeName(type));
+  }
+  return 1;
+}
+
+static int torch_resetmemorystats(lua_State *L)
+{
+  THStorage_resetMemoryStats();
+  return 0;
+}
+
+/* the hook runs on a thread of its own, created with the package: the
+   state that set the threshold may be a coroutine, suspended or collected
+   by the time the threshold is crossed */
+static lua_State *torch_memoryhookL = NULL;
+
+static void torch_memoryhook(long live, long threshold, void *data)
+{
+  lua_State *L = torch_memoryhookL;
+  lua_getfield(L, LUA_REGISTRYINDEX, "torch.memoryhook");
+  lua_pushnumber(L, live);
+  lua_pushnumber(L, threshold);
+  /* we are in the middle of an allocation: errors cannot be raised */
+  if(lua_pcall(L, 2, 0, 0))
+  {
+    fprintf(stderr, "warning: error in memory threshold hook: %s\n", lua_tostring(L, -1));
+    lua_pop(L, 1);
+  }
+}
+
+static int torch_setmemorythreshold(lua_State *L)
+{
+  if(lua_isnoneornil(L, 1))
+  {
+    THStorage_setMemoryHook(0, NULL, NULL);
+    lua_pushnil(L);
+    lua_setfield(L, LUA_REGISTRYINDEX, "torch.memoryhook");
+  }
+  else
+  {
+    long threshold = luaL_checklong(L, 1);
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+    lua_pushvalue(L, 2);
+    lua_setfield(L, LUA_REGISTRYINDEX, "torch.memoryhook");
+    THStorage_setMemoryHook(threshold, torch_memoryhook, NULL);
+  }
   return 0;
 }
 
@@ -162,6 +334,21 @@ static const struct luaL_Reg torch_utils__ [] = {
   {"toc", torch_lua_toc},
   {"setnumthreads", torch_setnumthreads},
   {"getnumthreads", torch_getnumthreads},
+  {"setparallelthreshold", torch_setparallelthreshold},
+  {"getparallelthreshold", torch_getparallelthreshold},
+  {"setsimd", torch_setsimd},
+  {"getsimd", torch_getsimd},
+  {"setmathmode", torch_setmathmode},
+  {"getmathmode", torch_getmathmode},
+  {"setgemm", torch_setgemm},
+  {"getgemm", torch_getgemm},
+  {"setallocator", torch_setallocator},
+  {"getallocator", torch_getallocator},
+  {"allocatorstats", torch_allocatorstats},
+  {"emptycache", torch_emptycache},
+  {"memorystats", torch_memorystats},
+  {"resetmemorystats", torch_resetmemorystats},
+  {"setmemorythreshold", torch_setmemorythreshold},
   {"factory", luaT_lua_factory},
   {"getconstructortable", luaT_lua_getconstructortable},
   {"typename", luaT_lua_typename},
@@ -179,4 +366,6 @@ static const struct luaL_Reg torch_utils__ [] = {
 void torch_utils_init(lua_State *L)
 {
   luaL_register(L, NULL, torch_utils__);
+  torch_memoryhookL = lua_newthread(L);
+  lua_setfield(L, LUA_REGISTRYINDEX, "torch.memoryhookthread");
 }
@@ -159,6 +159,43 @@ wrap.argtypes.IndexTensor = {
               end
 }
 
+-- a random number generator: when not given, the default one is used
+wrap.argtypes.Generator = {
+
+   helpname = function(arg)
+               return "Generator"
+            end,
+
+   declare = function(arg)
+                return string.format("THGenerator *arg%d = NULL;", arg.i)
+             end,
+
+   check = function(arg, idx)
+              return string.format('(arg%d = luaT_toudata(L, %d, "torch.Generator"))', arg.i, idx)
+           end,
+
+   read = function(arg, idx)
+          end,
+
+   init = function(arg)
+             return string.format('arg%d = THGenerator_default();', arg.i)
+          end,
+
+   carg = function(arg)
+             return string.format('arg%d', arg.i)
+          end,
+
+   creturn = function(arg)
+                error('a generator cannot be returned by a C function')
+             end,
+
+   precall = function(arg)
+             end,
+
+   postcall = function(arg)
+              end
+}
+
 for _,typename in ipairs({"ByteTensor", "CharTensor", "ShortTensor", "IntTensor", "LongTensor",
                           "FloatTensor", "DoubleTensor"}) do
 